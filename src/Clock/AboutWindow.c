@@ -19,16 +19,35 @@
 #include "AboutWindow.h"
 #include "MathHelpers.h"
 #include "Drawing.h"
+#include "DpiAwareness.h"
 
 #define szCLASS L"ClockAboutWndClass"
 
+static int aboutDpi = DPI_DEFAULT; // DPI of the monitor the window is on. Every size below is in 96 DPI pixels and scaled to this
+
+static int Scale(int value) {
+	return ScaleForDpi(value, aboutDpi);
+}
+
 LRESULT CALLBACK AboutWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 	switch (msg) {
 	case WM_CREATE:
 		// Disable the main window
 		CenterWindow(hwnd, NULL);
+		aboutDpi = GetWindowDpi(hwnd);
 		CreateAboutControls(hwnd);
 		break;
+	case WM_DPICHANGED_: {
+		// Dragged onto a monitor with another scale. The new size lays the controls out again, see HandleAboutSize
+		aboutDpi = LOWORD(wParam);
+		HFONT hFont = GetDialogFont(aboutDpi);
+		SendMessage(g_hWndAboutOkBtn, WM_SETFONT, (WPARAM)hFont, (LPARAM)TRUE);
+		SendMessage(g_hWndAboutText, WM_SETFONT, (WPARAM)hFont, (LPARAM)TRUE);
+		SendMessage(g_hWndAboutLink, WM_SETFONT, (WPARAM)hFont, (LPARAM)TRUE);
+		ApplyDpiChange(hwnd, lParam);
+		InvalidateRect(hwnd, NULL, TRUE);
+	}
+		break;
 	case WM_SIZE:
 		HandleAboutSize(hwnd);
 		break;
@@ -40,7 +59,7 @@ LRESULT CALLBACK AboutWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		GetClientRect(hwnd, &rc);
 
 		// Draw the anti-aliased logo. C++ function that uses the extern "C" marker to be used in C.
-		DrawImage(hdc, rc.right - 64 - 10, 10, 64, 64, IDB_ABTICON);
+		DrawImage(hdc, rc.right - Scale(64) - Scale(10), Scale(10), Scale(64), Scale(64), IDB_ABTICON);
 
 		EndPaint(hwnd, &ps);
 	}
@@ -121,7 +140,8 @@ ATOM RegisterAboutClass(HINSTANCE hInstance) {
 BOOL InitAbout(void) {
 	RegisterAboutClass(g_hInst);
 
-	g_hWndAbout = CreateWindow(szCLASS, L"About - Clock", WS_POPUP | WS_CAPTION | WS_SYSMENU, CW_USEDEFAULT, CW_USEDEFAULT, 270, 235, NULL, NULL, g_hInst, NULL);
+	aboutDpi = GetSystemDpi(); // It's centered on the primary monitor
+	g_hWndAbout = CreateWindow(szCLASS, L"About - Clock", WS_POPUP | WS_CAPTION | WS_SYSMENU, CW_USEDEFAULT, CW_USEDEFAULT, Scale(270), Scale(235), NULL, NULL, g_hInst, NULL);
 	if (!g_hWndAbout) {
 		return FALSE;
 	}
@@ -135,31 +155,36 @@ BOOL InitAbout(void) {
 }
 
 void CreateAboutControls(HWND hwnd) {
+	HFONT hFont = GetDialogFont(aboutDpi);
 	g_hWndAboutOkBtn = CreateWindow(WC_BUTTON, L"Ok", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON, 0, 0, 0, 0, hwnd, (HMENU)ABOUT_OK_BTN_ID, g_hInst, NULL);
-	SendMessage(g_hWndAboutOkBtn, WM_SETFONT, (WPARAM)g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndAboutOkBtn, WM_SETFONT, (WPARAM)hFont, (LPARAM)TRUE);
 
-	g_hWndAboutText = CreateWindow(WC_STATIC, L"Insert text here", WS_CHILD | WS_VISIBLE | SS_OWNERDRAW, 10, 10, 181, 180, hwnd, (HMENU)ABOUT_TEXT_ID, g_hInst, NULL);
-	SendMessage(g_hWndAboutText, WM_SETFONT, (WPARAM)g_hfBtnFont, (LPARAM)TRUE);
+	g_hWndAboutText = CreateWindow(WC_STATIC, L"Insert text here", WS_CHILD | WS_VISIBLE | SS_OWNERDRAW, 0, 0, 0, 0, hwnd, (HMENU)ABOUT_TEXT_ID, g_hInst, NULL);
+	SendMessage(g_hWndAboutText, WM_SETFONT, (WPARAM)hFont, (LPARAM)TRUE);
 	WCHAR buffer[1024];
 	GetAboutMessage(buffer, sizeof(buffer) / sizeof(wchar_t));
 	SetWindowText(g_hWndAboutText, buffer);
 
-	g_hWndAboutLink = CreateWindow(WC_LINK, L"<a>https://github.com/Totally-A-Boar/XPClock</a>", WS_CHILD | WS_VISIBLE | WS_OVERLAPPED, 10, 140, 250, 25, hwnd, (HMENU)ABOUT_LINK_ID, g_hInst, NULL);
-	SendMessage(g_hWndAboutLink, WM_SETFONT, (WPARAM)g_hfBtnFont, (LPARAM)TRUE);
+	g_hWndAboutLink = CreateWindow(WC_LINK, L"<a>https://github.com/Totally-A-Boar/XPClock</a>", WS_CHILD | WS_VISIBLE | WS_OVERLAPPED, 0, 0, 0, 0, hwnd, (HMENU)ABOUT_LINK_ID, g_hInst, NULL);
+	SendMessage(g_hWndAboutLink, WM_SETFONT, (WPARAM)hFont, (LPARAM)TRUE);
 }
 
 void HandleAboutSize(HWND hwnd) {
 	RECT rc;
 	GetClientRect(hwnd, &rc);
 
-	int width = 100;
-	int height = 30;
+	int width = Scale(100);
+	int height = Scale(30);
 
-	int x = rc.right - width - 10;
-	int y = rc.bottom - height - 10;
+	int x = rc.right - width - Scale(10);
+	int y = rc.bottom - height - Scale(10);
 
 	// Move the window
 	SetWindowPos(g_hWndAboutOkBtn, NULL, x, y, width, height, SWP_NOZORDER | SWP_NOACTIVATE);
+
+	// The text and link don't move with the window's size, only with its scale
+	SetWindowPos(g_hWndAboutText, NULL, Scale(10), Scale(10), Scale(181), Scale(180), SWP_NOZORDER | SWP_NOACTIVATE);
+	SetWindowPos(g_hWndAboutLink, NULL, Scale(10), Scale(140), Scale(250), Scale(25), SWP_NOZORDER | SWP_NOACTIVATE);
 }
 
 void GetAboutMessage(WCHAR* buffer, size_t size) {
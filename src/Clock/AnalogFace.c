@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "AnalogFace.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Lengths and half widths of a hand, as fractions of the face's radius. Each hand runs from 'tail' behind the center to 'length' in front of it, narrowing towards the tip
+typedef struct __HandShape {
+	float tail;
+	float length;
+	float baseWidth;
+	float tipWidth;
+} HandShape;
+
+static const HandShape handShapes[ANALOG_HAND_COUNT] = {
+	{ 0.12f, 0.50f, 0.036f, 0.022f }, // Hour
+	{ 0.12f, 0.76f, 0.026f, 0.014f }, // Minute
+	{ 0.20f, 0.86f, 0.009f, 0.006f }, // Second
+};
+
+#define CAP_RADIUS 0.035f // Dot over the center where the hands meet
+#define MIN_HALF_WIDTH 0.6f // In pixels. Thinner lines would flicker as they turn on a small face
+
+static float sines[ANALOG_ANGLE_STEPS]; // Filled by the first InitAnalogFace. The cosine of a step is the sine a quarter turn further on
+static int isRotationBuilt = 0;
+
+static void BuildRotationTable(void) {
+	if (isRotationBuilt) return;
+
+	for (int i = 0; i < ANALOG_ANGLE_STEPS; i++) {
+		sines[i] = (float)sin(i * 6.283185307179586 / ANALOG_ANGLE_STEPS);
+	}
+	isRotationBuilt = 1;
+}
+
+// Unit vector pointing at a step, clockwise from 12 with y growing downwards.
+static void GetDirection(int step, float* dx, float* dy) {
+	step %= ANALOG_ANGLE_STEPS;
+	if (step < 0) step += ANALOG_ANGLE_STEPS;
+	*dx = sines[step];
+	*dy = -sines[(step + ANALOG_ANGLE_STEPS / 4) % ANALOG_ANGLE_STEPS];
+}
+
+static float HalfWidth(float fraction, float radius) {
+	float width = fraction * radius;
+	return width < MIN_HALF_WIDTH ? MIN_HALF_WIDTH : width;
+}
+
+// Both ends of a hand and their half widths, for a face with its center at (cx, cy).
+static void GetHandLine(int hand, int step, float cx, float cy, float radius, float* line) {
+	const HandShape* shape = &handShapes[hand];
+	float dx, dy;
+	GetDirection(step, &dx, &dy);
+
+	line[0] = cx - dx * shape->tail * radius;
+	line[1] = cy - dy * shape->tail * radius;
+	line[2] = cx + dx * shape->length * radius;
+	line[3] = cy + dy * shape->length * radius;
+	line[4] = HalfWidth(shape->baseWidth, radius);
+	line[5] = HalfWidth(shape->tipWidth, radius);
+}
+
+// Tick marks every minute, longer and wider every hour, and the numerals inside them.
+static void DrawDial(Framebuffer* fb, int size, const SdfAtlas* numerals) {
+	float center = size / 2.0f, radius = size / 2.0f;
+	uint32_t white = FRAMEBUFFER_RGB(255, 255, 255);
+
+	for (int minute = 0; minute < 60; minute++) {
+		float dx, dy;
+		GetDirection(minute * (ANALOG_ANGLE_STEPS / 60), &dx, &dy);
+
+		int isHour = minute % 5 == 0;
+		float inner = isHour ? 0.84f : 0.90f, outer = 0.96f;
+		float halfWidth = HalfWidth(isHour ? 0.016f : 0.006f, radius);
+		FramebufferDrawLine(fb, center + dx * inner * radius, center + dy * inner * radius, center + dx * outer * radius, center + dy * outer * radius, halfWidth, halfWidth, white, NULL);
+	}
+
+	if (!numerals || !numerals->atlas.pixels) return;
+
+	SdfStyle style = { 0.16f * radius, white, 0.0f, 0, 0.0f, 0 };
+	for (int hour = 1; hour <= 12; hour++) {
+		wchar_t text[3];
+		int length = hour < 10 ? 1 : 2;
+		text[0] = (wchar_t)(hour < 10 ? L'0' + hour : L'1');
+		text[1] = (wchar_t)(L'0' + hour % 10);
+		text[2] = L'\0';
+
+		float dx, dy;
+		GetDirection(hour * (ANALOG_ANGLE_STEPS / 12), &dx, &dy);
+		float x = center + dx * 0.70f * radius - MeasureSdfRun(numerals, text, length, style.size) / 2.0f;
+		float y = center + dy * 0.70f * radius - style.size / 2.0f;
+		DrawSdfRun(numerals, fb, text, length, x, y, &style, NULL);
+	}
+}
+
+int InitAnalogFace(AnalogFace* face, int size, const SdfAtlas* numerals) {
+	memset(face, 0, sizeof(*face));
+	BuildRotationTable();
+	if (size <= 0) return 0;
+
+	// The dial is drawn white on black, then one channel is kept as its coverage
+	Framebuffer scratch;
+	if (!InitFramebuffer(&scratch, size, size)) return 0;
+
+	face->dial = (uint8_t*)malloc((size_t)size * size);
+	if (!face->dial) {
+		FreeFramebuffer(&scratch);
+		return 0;
+	}
+
+	DrawDial(&scratch, size, numerals);
+	for (size_t i = 0; i < (size_t)size * size; i++) {
+		face->dial[i] = (uint8_t)(scratch.pixels[i] >> 8);
+	}
+	FreeFramebuffer(&scratch);
+
+	face->size = size;
+	return 1;
+}
+
+void FreeAnalogFace(AnalogFace* face) {
+	free(face->dial);
+	memset(face, 0, sizeof(*face));
+}
+
+void GetAnalogHandSteps(double seconds, int* steps) {
+	// The hour and minute hands move a little every step too rather than jumping once a minute or an hour
+	steps[ANALOG_HAND_HOUR] = (int)(fmod(seconds, 43200.0) * ANALOG_ANGLE_STEPS / 43200.0) % ANALOG_ANGLE_STEPS;
+	steps[ANALOG_HAND_MINUTE] = (int)(fmod(seconds, 3600.0) * ANALOG_ANGLE_STEPS / 3600.0) % ANALOG_ANGLE_STEPS;
+	steps[ANALOG_HAND_SECOND] = (int)(fmod(seconds, 60.0) * ANALOG_ANGLE_STEPS / 60.0) % ANALOG_ANGLE_STEPS;
+}
+
+void GetAnalogHandBounds(const AnalogFace* face, int x, int y, int hand, int step, FramebufferRect* bounds) {
+	float radius = face->size / 2.0f;
+	float cx = x + radius, cy = y + radius;
+	float line[6];
+	GetHandLine(hand, step, cx, cy, radius, line);
+
+	// Same box FramebufferDrawLine limits itself to
+	float reach = (line[4] > line[5] ? line[4] : line[5]) + 0.5f;
+	float left = (line[0] < line[2] ? line[0] : line[2]) - reach, right = (line[0] > line[2] ? line[0] : line[2]) + reach;
+	float top = (line[1] < line[3] ? line[1] : line[3]) - reach, bottom = (line[1] > line[3] ? line[1] : line[3]) + reach;
+	if (hand == ANALOG_HAND_SECOND) {
+		float cap = CAP_RADIUS * radius + 0.5f;
+		if (cx - cap < left) left = cx - cap;
+		if (cx + cap > right) right = cx + cap;
+		if (cy - cap < top) top = cy - cap;
+		if (cy + cap > bottom) bottom = cy + cap;
+	}
+
+	bounds->left = (int)floorf(left);
+	bounds->top = (int)floorf(top);
+	bounds->right = (int)ceilf(right);
+	bounds->bottom = (int)ceilf(bottom);
+}
+
+void DrawAnalogDial(const AnalogFace* face, Framebuffer* fb, int x, int y, uint32_t color, const FramebufferRect* clip) {
+	if (!face->dial) return;
+	FramebufferBlendMask(fb, x, y, face->dial, face->size, face->size, face->size, color, clip);
+}
+
+void DrawAnalogHands(const AnalogFace* face, Framebuffer* fb, int x, int y, const int* steps, uint32_t color, uint32_t secondColor, const FramebufferRect* clip) {
+	if (!face->size) return;
+
+	float radius = face->size / 2.0f;
+	float cx = x + radius, cy = y + radius;
+	for (int hand = 0; hand < ANALOG_HAND_COUNT; hand++) {
+		float line[6];
+		GetHandLine(hand, steps[hand], cx, cy, radius, line);
+		FramebufferDrawLine(fb, line[0], line[1], line[2], line[3], line[4], line[5], hand == ANALOG_HAND_SECOND ? secondColor : color, clip);
+	}
+
+	float cap = CAP_RADIUS * radius;
+	FramebufferDrawLine(fb, cx, cy, cx, cy, cap, cap, secondColor, clip);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_ANALOG_FACE_H__
+#define __CLOCK_ANALOG_FACE_H__
+
+// An analog clock face: tick marks and numerals drawn once per size into a coverage mask, and hands drawn fresh each frame as anti-aliased tapered lines.
+// Hand angles come from a table of sines a tenth of a degree apart, so turning a hand is a lookup and a few multiplies.
+
+#include "Framebuffer.h"
+#include "SdfAtlas.h"
+
+#define ANALOG_FACE_STYLE 3 // DisplayStyle value that shows the analog face instead of the digital text
+#define ANALOG_ANGLE_STEPS 3600 // Entries in the rotation table. At 60 frames per second the second hand moves one step per frame
+
+#define ANALOG_HAND_HOUR	0
+#define ANALOG_HAND_MINUTE	1
+#define ANALOG_HAND_SECOND	2 // Also draws the cap over the center
+#define ANALOG_HAND_COUNT	3
+
+typedef struct __AnalogFace {
+	int size; // Width and height of the face in pixels. 0 if it hasn't been built
+	uint8_t* dial; // Coverage of the tick marks and numerals, 'size' bytes per row
+} AnalogFace;
+
+int InitAnalogFace(AnalogFace*, int, const SdfAtlas*); // Draws the dial for a face of the given size. The numerals come from the distance field atlas if one is given, otherwise the dial only has tick marks. Returns 0 if out of memory
+void FreeAnalogFace(AnalogFace*); // Releases the dial
+void GetAnalogHandSteps(double, int*); // Turns seconds since midnight into a rotation table step for each hand, clockwise from 12. The fraction of a second makes the second hand sweep
+void GetAnalogHandBounds(const AnalogFace*, int, int, int, int, FramebufferRect*); // Box one hand covers. Takes the face's top left, the hand and its step
+void DrawAnalogDial(const AnalogFace*, Framebuffer*, int, int, uint32_t, const FramebufferRect*); // Blends the dial with its top left at the given position. Takes the color and an optional clip rectangle
+void DrawAnalogHands(const AnalogFace*, Framebuffer*, int, int, const int*, uint32_t, uint32_t, const FramebufferRect*); // Draws every hand at its step. Takes the face's top left, the steps, the color of the hour and minute hands, the second hand's color and an optional clip rectangle
+
+#endif // !__CLOCK_ANALOG_FACE_H__
@@ -21,9 +21,27 @@
 #include "AboutWindow.h"
 #include "SettingsWindow.h"
 #include "NTPClient.h"
+#include "GPSClient.h"
 #include "TrayIcon.h"
+#include "EventQueue.h"
+#include "Compositor.h"
+#include "RenderThread.h"
+#include "DisplayModel.h"
+#include "Motion.h"
+#include "FontFit.h"
+#include "Drawing.h"
+#include "GlyphBackendGDI.h"
+#include "SdfAtlas.h"
+#include "TextEffects.h"
+#include "SegmentDisplay.h"
+#include "AnalogFace.h"
+#include "DigitTransition.h"
+#include "DpiAwareness.h"
+#include "StrokeFont.h"
 #include "Colors.h"
 
+#include <math.h>
+
  // Version of common controls to link to. Changes the appearance of controls. https://learn.microsoft.com/en-us/windows/win32/controls/common-control-versions
 #pragma comment(linker,"\"/manifestdependency:type='win32' \
 name='Microsoft.Windows.Common-Controls' version='6.0.0.0' \
@@ -41,20 +59,40 @@ UINT g_Context = 0; // Context for what part of the UI is being shown. Useful fo
 BOOL g_bIsFullScreen = FALSE; // Used for full screen functionality.
 RECT g_rcWindow; // Used for full screen functionality.
 GradientColor g_GradientColor; // Check the GradientColor comments
+Gradient g_Gradient; // Every stop from the color file. See ParseCustomColor
 COLORREF g_bgColor; // Holds the color that is used if a custom color is parsed, but the gradient effect isn't used
 BOOL g_bGetTime = TRUE; // Variable to check if the time is needed to be checked. This stops the application from crashing if an NTP server can't be reached
 
 // Font resources
 HFONT g_hfMainFont; // Global variable for storing the main font that will be used to render the clock text.
-HFONT g_hfBtnFont; // Same as above, except this one is rendered smaller to fit in buttons. Is used in the settings sub-window.
+
+// Everything that has to be built again for a monitor's scale. A set is kept for each DPI the window has been on, so moving it back to a monitor
+// picks up what was already built there. See DpiScale.h
+typedef struct __ScaleResources {
+	int dpi;
+	HFONT statusFont; // The status line's font
+	HFONT atlasFont; // Font the atlas was last rasterized from, NULL before the first time
+	GlyphAtlas atlas; // Every character the clock can show, rasterized from the font that fits the window. Empty if it couldn't be built, in which case the text goes through TextOutW
+	SegmentDisplay segments; // Shapes of the segments or dots at the size that fits the window. Empty when the digits are drawn with the font
+	AnalogFace face; // Dial of the analog face at the size that fits the window, drawn into the background cache
+} ScaleResources;
+
+static DpiScaleCache scaleCache;
+static ScaleResources* scale; // The set for the monitor the window is on. Only switched on the render thread, or before it starts
+static volatile LONG windowDpi = DPI_DEFAULT; // DPI of the monitor the window is on, set by the UI thread
+static GlyphAtlas* clockAtlas; // The current scale's atlas, segments and dial
+static SegmentDisplay* segmentDisplay;
+static AnalogFace* analogFace;
+static SdfAtlas clockSdf; // Distance fields of the same characters, built once and scaled to any size, so one serves every scale. Used instead of clockAtlas whenever it could be built
+static GradientLUT backgroundGradient; // Colors along the gradient, rebuilt when its size, stops or hue change
+static TextEffects textEffects; // Shadow, outline and glow of the current text, rebuilt only when the text changes
+static BOOL useAnalogFace; // Whether DisplayStyle picked the analog face. Read once when the clock starts
+static DigitTransitions digitTransitions; // Animations of the characters that just changed, and the frames cached for each pair of characters
 
 // Strings
 #define szCLASS L"ClockWndClass" // Constant string for registering the main window class. https://learn.microsoft.com/en-us/windows/win32/intl/registering-window-classes
 WCHAR* g_szMainFont; // Global variable for the font name. Changed to not be constant to accomodate for custom fonts.
 
-// Control ID's
-#define TIMER_ID 0x101 // ID for refresh timer for renderer. See MainWndProc.
-
 // NTP-associated values
 DWORD g_tidNTPThread; // Thread ID for the NTP refresh thread
 HANDLE g_hNTPThread; // Handle for the thread itself.
@@ -64,12 +102,53 @@ HANDLE g_hNTPThread; // Handle for the thread itself.
 // Specific errors I disabled because I either don't know how to fix them, or they don't impact the application.
 #pragma warning(disable : 4047)	// Different levels of indirection.
 
+#pragma region Session notifications
+// wtsapi32 is loaded by hand so the clock still starts where it's missing or the Terminal Services service is turned off.
+typedef BOOL(WINAPI* WTSRegisterSessionNotificationProc)(HWND, DWORD);
+typedef BOOL(WINAPI* WTSUnRegisterSessionNotificationProc)(HWND);
+
+#define NOTIFY_FOR_THIS_SESSION_ 0 // NOTIFY_FOR_THIS_SESSION from wtsapi32.h
+
+static HMODULE hWtsApi;
+static BOOL isSessionWatched = FALSE;
+
+// Asks for WM_WTSSESSION_CHANGE so drawing can stop while the session is locked.
+static void WatchSession(HWND hwnd) {
+	hWtsApi = LoadLibraryW(L"wtsapi32.dll");
+	WTSRegisterSessionNotificationProc Register = hWtsApi ? (WTSRegisterSessionNotificationProc)GetProcAddress(hWtsApi, "WTSRegisterSessionNotification") : NULL;
+	if (Register && Register(hwnd, NOTIFY_FOR_THIS_SESSION_)) {
+		isSessionWatched = TRUE;
+		return;
+	}
+
+	yellow();
+	wprintf(L"Session notifications are unavailable, so the clock keeps drawing while the session is locked. GetLastError: 0x%x\r\n", GetLastError());
+	reset();
+}
+
+static void UnwatchSession(HWND hwnd) {
+	if (isSessionWatched) {
+		WTSUnRegisterSessionNotificationProc Unregister = (WTSUnRegisterSessionNotificationProc)GetProcAddress(hWtsApi, "WTSUnRegisterSessionNotification");
+		if (Unregister) {
+			Unregister(hwnd);
+		}
+		isSessionWatched = FALSE;
+	}
+
+	if (hWtsApi) {
+		FreeLibrary(hWtsApi);
+		hWtsApi = NULL;
+	}
+}
+#pragma endregion
+
 #pragma region Main window
 BOOL CreateClock(void) {
 	RegisterMainClass(g_hInst); // Register the class for the main window
 
 	wprintf(L"Creating main window...\r\n");
-	g_hWndMain = CreateWindowW(szCLASS, L"XPClock", WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT, 800, 600, NULL, g_hMenu, g_hInst, NULL);
+	int dpi = GetSystemDpi(); // The window opens on the primary monitor
+	g_hWndMain = CreateWindowW(szCLASS, L"XPClock", WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT, ScaleForDpi(800, dpi), ScaleForDpi(600, dpi), NULL, g_hMenu, g_hInst, NULL);
 
 	if (!g_hWndMain) {
 		red();
@@ -108,37 +187,73 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	switch (msg) {
 	case WM_CREATE:
 		CreateClockControl(hwnd);
-		if (DVDLogo()) {
-			SetTimer(hwnd, TIMER_ID, 16, NULL); // If the DVD logo effect is used, draw at 60 FPS
+		if (!scale) {
+			return -1;
 		}
-		else {
-			SetTimer(hwnd, TIMER_ID, 66, NULL); // If not, draw at 15 FPS. Hopefully this helps optmize it for older platforms
+		// If the DVD logo effect is used, draw at 60 FPS. If not, draw at 15 FPS. Hopefully this helps optmize it for older platforms
+		// The frames are drawn on their own thread, so the clock keeps ticking while this one is stuck in a message box or a window drag
+		// The analog face's second hand sweeps and the digit animations are only a quarter of a second long, so they need 60 FPS as well
+		if (!StartRenderThread(g_hWndClockOut, (DVDLogo() || useAnalogFace || digitTransitions.style != DIGIT_TRANSITION_NONE) ? 16 : 66, RenderClockFrame)) {
+			return -1;
 		}
+		WatchSession(hwnd);
 		CenterWindow(hwnd, NULL);
+		PostMessage(hwnd, WM_CLOCK_EVENT, 0, 0); // Pick up anything the worker threads posted before the window existed
+		break;
+	case WM_CLOCK_EVENT:
+		DispatchClockEvents();
 		break;
 	case WM_DESTROY:
 		// Make sure to release everythin before exiting.
-		KillTimer(hwnd, TIMER_ID);
+		StopRenderThread(); // Before anything it draws with goes away
+		UnwatchSession(hwnd);
 		DeleteObject(g_hfMainFont);
-		DeleteObject(g_hfBtnFont);
+		FreeDialogFonts();
+		ResetCompositor();
+		FreeFontFit(); // After the back buffer lets go of the font
+		FreeDpiScaleCache(&scaleCache); // Same for the status font
+		FreeGradientLUT(&backgroundGradient);
+		FreeSdfAtlas(&clockSdf);
+		FreeTextEffects(&textEffects);
+		FreeDigitTransitions(&digitTransitions);
 		FreeConsole();
 		CloseHandle(g_hNTPThread);
+		CloseHandle(g_hGPSThread);
 		PostQuitMessage(0);
 		break;
 	case WM_SIZE:
+		// Nothing can be seen while minimized, so the render thread sleeps until the window is restored. The clock keeps time regardless
+		SetRenderSuspended(RENDER_SUSPEND_MINIMIZED, wParam == SIZE_MINIMIZED);
+		if (wParam != SIZE_MINIMIZED) {
+			ResizeText(hwnd);
+		}
+		break;
+	case WM_WTSSESSION_CHANGE:
+		if (wParam == WTS_SESSION_LOCK || wParam == WTS_CONSOLE_DISCONNECT) {
+			wprintf(L"Session locked, suspending drawing.\r\n");
+			SetRenderSuspended(RENDER_SUSPEND_LOCKED, TRUE);
+		}
+		else if (wParam == WTS_SESSION_UNLOCK || wParam == WTS_CONSOLE_CONNECT) {
+			wprintf(L"Session unlocked, resuming drawing.\r\n");
+			SetRenderSuspended(RENDER_SUSPEND_LOCKED, FALSE);
+		}
+		break;
+	case WM_DPICHANGED_:
+		// Moved to a monitor with another scale, or its scale was changed. The render thread picks up that scale's resources on its next frame,
+		// and the window takes the size Windows suggests so it looks the same size as before
+		InterlockedExchange(&windowDpi, LOWORD(wParam));
+		ApplyDpiChange(hwnd, lParam);
+		break;
+	case WM_DISPLAYCHANGE:
+	case WM_THEMECHANGED:
+	case WM_SYSCOLORCHANGE:
+		// The color depth or theme may have changed, so rebuild the back buffer and the background
+		RequestRenderReset();
 		ResizeText(hwnd);
 		break;
 	case WM_DRAWITEM:
 		RenderText(lParam);
 		break;
-	case WM_TIMER: {
-		if (wParam == TIMER_ID) {
-			WCHAR buffer[64];
-			GetCurrentDateTime(buffer, 64);
-			SetWindowTextW(g_hWndClockOut, buffer); // Update the text box
-		}
-		break;
-	}
 	case WM_KEYDOWN:
 		if (wParam == VK_ESCAPE) {
 			PostQuitMessage(0);
@@ -169,6 +284,12 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			wprintf(L"Full screening main window.\r\n");
 			ToggleFullScreen(hwnd);
 		}
+		else if (wParam == 'G') {
+			PrintRenderCounters(); // For checking handle counts on long-running displays
+			PrintCompositorStats();
+			PrintRenderThreadStats();
+			PrintFontFitStats();
+		}
 		break;
 	case WM_COMMAND:
 		if (LOWORD(wParam) == ID_ABOUT_MENU_BTN) {
@@ -189,183 +310,667 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	return DefWindowProc(hwnd, msg, wParam, lParam);
 }
 
-BOOL RenderText(LPARAM lParam) {
-	if (!g_Config.Gradient) {
-		LPDRAWITEMSTRUCT pDIS = (LPDRAWITEMSTRUCT)lParam;
-		HDC hdc = pDIS->hDC;
-		RECT rect = pDIS->rcItem;
+#pragma region Layers
+// Text layer state. The compositor only knows the layer's bounds, the rest lives here. Everything in this region runs on the render thread.
+static DisplayModel displayModel; // The text being shown and where it is
+static unsigned long laidOutGeneration; // Generation of the text the layout was last computed for
+static BounceMotion textMotion; // The DVD logo's position and velocity
+static LONGLONG lastMotionTime; // QueryPerformanceCounter value when the motion was last advanced, 0 before the first frame
+static WCHAR statusText[EVENT_MESSAGE_LENGTH];
+static int statusSeverity;
+static BOOL useAtlas; // Whether the current text can be drawn entirely from the atlas
+static BOOL useSdf; // Whether the current text can be drawn entirely from the distance field atlas. Takes precedence over useAtlas
+static float sdfTextSize; // Line height the distance field text is drawn at, picked to fit the window
+static TextEffectStyle textEffectStyle; // Sizes of the effects for the current text height
+static int segmentStyle; // One of the SEGMENT_STYLE_ values, read once when the clock starts
+static BOOL useSegments; // Whether the current text is drawn with segmentDisplay. Takes precedence over useSdf and useAtlas
+static int faceX, faceY; // Top left of the face in the back buffer
+static int handSteps[ANALOG_HAND_COUNT]; // Rotation table step each hand was last laid out at, -1 when it has to be laid out again
+static RECT handBounds[ANALOG_HAND_COUNT]; // Where each hand was last drawn
+static HFONT clockFont; // Size of the main font that fits the window. Owned by the font fit cache, see FontFit.c
+static int fittedFormat = -1; // Display format clockFont was picked for
+static const CachedImage* backgroundImage; // The background image scaled to the back buffer, NULL if there is none
+
+// Returns whether every character of the text has a glyph in an atlas.
+static BOOL AtlasCoversText(const GlyphAtlas* atlas, const WCHAR* text) {
+	if (!atlas->pixels) return FALSE;
+
+	for (; *text; text++) {
+		if (!FindAtlasGlyph(atlas, *text)) return FALSE;
+	}
+	return TRUE;
+}
 
-		// Create a memory DC for double buffering
-		HDC hMemDC = CreateCompatibleDC(hdc);
-		HBITMAP hBitmap = CreateCompatibleBitmap(hdc, rect.right, rect.bottom);
-		HBITMAP hOldBitmap = (HBITMAP)SelectObject(hMemDC, hBitmap);
+// Builds the current scale's atlas from the main font, or from the built-in stroke font if GDI can't give us one.
+static void BuildClockAtlas(void) {
+	FreeGlyphAtlas(clockAtlas);
+	scale->atlasFont = clockFont;
 
-		HBRUSH hBrush;
+	if (BuildGDIGlyphAtlas(clockAtlas, clockFont)) {
+		return;
+	}
 
-		if (g_Config.CustomColor) {
-			hBrush = CreateSolidBrush(g_bgColor);
-		}
-		else {
-			hBrush = ((HBRUSH)GetStockObject(BLACK_BRUSH));
+	// Give the stroke font the fitted font's line height, so the text is laid out the same as it would have been with GDI
+	int lineHeight = ScaleForDpi(48, scale->dpi);
+	HDC hdc = clockFont ? GetDC(NULL) : NULL;
+	if (hdc) {
+		HFONT hOldFont = (HFONT)SelectObject(hdc, clockFont);
+		TEXTMETRICW tm;
+		if (GetTextMetricsW(hdc, &tm) && tm.tmHeight > 0) {
+			lineHeight = tm.tmHeight;
 		}
+		SelectObject(hdc, hOldFont);
+		ReleaseDC(NULL, hdc);
+	}
 
-		FillRect(hMemDC, &rect, hBrush);
+	StrokeFont strokeFont;
+	GlyphBackend backend;
+	InitStrokeFont(&strokeFont, lineHeight, 0.8f);
+	GetStrokeFontBackend(&strokeFont, &backend);
+	BuildGlyphAtlas(clockAtlas, &backend, GLYPH_ATLAS_CHARSET);
+}
 
-		// Set text color to white
-		SetTextColor(hMemDC, RGB(255, 255, 255));
-		SetBkMode(hMemDC, TRANSPARENT);
+// Builds the distance field atlas from the main font's face, or from the built-in stroke font. Only done once, since it scales to any size.
+static void BuildClockSdf(void) {
+	if (BuildGDISdfAtlas(&clockSdf, g_szMainFont)) {
+		return;
+	}
 
-		// Get the actual text from the control
-		wchar_t text[256];  // Adjust size if needed
-		GetWindowTextW(pDIS->hwndItem, text, 256);
+	StrokeFont strokeFont;
+	GlyphBackend backend;
+	InitStrokeFont(&strokeFont, SDF_REFERENCE_HEIGHT, 0.8f);
+	GetStrokeFontBackend(&strokeFont, &backend);
+	BuildSdfAtlas(&clockSdf, &backend, GLYPH_ATLAS_CHARSET);
+}
 
-		// Select custom font
-		if (g_hfMainFont) {
-			SelectObject(hMemDC, g_hfMainFont);
-		}
+// Fills part of the background cache with the configured background: the image, the gradient, the custom color or black. The gradient always spans the whole window.
+static void FillBackground(RenderSurface* surface, const RECT* rect) {
+	Framebuffer* fb = &surface->framebuffer;
 
-		// Calculate text size
-		SIZE textSize;
-		GetTextExtentPoint32W(hMemDC, text, lstrlenW(text), &textSize);
+	if (backgroundImage && backgroundImage->width == surface->width && backgroundImage->height == surface->height) {
+		Framebuffer image;
+		WrapFramebuffer(&image, backgroundImage->pixels, backgroundImage->width, backgroundImage->height, backgroundImage->width);
+		FramebufferCopy(fb, &image, (const FramebufferRect*)rect);
+		return;
+	}
 
-		// Static variables to keep track of the bouncing text
-		static int dx = 2, dy = 2; // Speed of movement
-		static int posX = 10, posY = 10; // Initial position
+	if (!g_Config.Gradient) {
+		uint32_t color = g_Config.CustomColor ? FRAMEBUFFER_RGB(GetRValue(g_bgColor), GetGValue(g_bgColor), GetBValue(g_bgColor)) : FRAMEBUFFER_RGB(0, 0, 0);
+		FramebufferFill(fb, (const FramebufferRect*)rect, color);
+		return;
+	}
 
-		if (g_Config.DVDLogo) {
-			// Update position
-			posX += dx;
-			posY += dy;
+	if (backgroundGradient.colors) {
+		DrawGradient(&backgroundGradient, fb, (const FramebufferRect*)rect);
+	}
+	else {
+		// The table couldn't be allocated, so fall back to the plain two color gradient
+		FramebufferFillGradient(fb, NULL, (const FramebufferRect*)rect, FRAMEBUFFER_RGB(255, 0, 0), FRAMEBUFFER_RGB(0, 0, 0));
+	}
+}
 
-			// Bounce logic
-			if (posX + textSize.cx >= rect.right || posX <= rect.left) {
-				dx = -dx;
-			}
-			if (posY + textSize.cy >= rect.bottom || posY <= rect.top) {
-				dy = -dy;
+// The background with the analog face's dial over it. The dial only changes with the window's size, so it's cached along with the background and only the hands are drawn each frame.
+static void DrawBackground(RenderSurface* surface, const RECT* rect) {
+	FillBackground(surface, rect);
+	if (analogFace->dial) {
+		DrawAnalogDial(analogFace, &surface->framebuffer, faceX, faceY, FRAMEBUFFER_RGB(255, 255, 255), (const FramebufferRect*)rect);
+	}
+}
+
+// Builds the gradient's lookup table for the back buffer. With the hue drifting, the table changes every time the hue moves a whole degree,
+// and only then is the cached background redrawn. So a slow drift costs a full redraw now and then rather than one per frame.
+static void UpdateBackgroundGradient(BOOL rebuilt) {
+	if (!g_Config.Gradient || backgroundImage) return;
+
+	Gradient gradient;
+	if (g_Config.CustomColor && g_Gradient.stopCount >= 2) {
+		gradient = g_Gradient;
+	}
+	else if (g_Config.CustomColor) {
+		// TRIVERTEX colors are 16 bits per channel
+		InitGradient(&gradient,
+			FRAMEBUFFER_RGB(g_GradientColor.tvColor1.Red >> 8, g_GradientColor.tvColor1.Green >> 8, g_GradientColor.tvColor1.Blue >> 8),
+			FRAMEBUFFER_RGB(g_GradientColor.tvColor2.Red >> 8, g_GradientColor.tvColor2.Green >> 8, g_GradientColor.tvColor2.Blue >> 8));
+	}
+	else {
+		// Create a gradient from red (top) to black (bottom)
+		InitGradient(&gradient, FRAMEBUFFER_RGB(255, 0, 0), FRAMEBUFFER_RGB(0, 0, 0));
+	}
+
+	gradient.angle = (float)(g_Config.GradientAngle % 360);
+	gradient.dither = g_Config.GradientDither;
+	if (g_Config.GradientHueSpeed) {
+		ULONGLONG degrees = (ULONGLONG)GetTickCount() * g_Config.GradientHueSpeed / 60000;
+		gradient.hueShift = (float)(degrees % 360);
+	}
+
+	if (UpdateGradientLUT(&backgroundGradient, &gradient, g_RenderSurface.width, g_RenderSurface.height) && !rebuilt) {
+		InvalidateCompositor();
+	}
+}
+
+// Draws a run of characters through the framebuffer with whichever of the segments, distance field or atlas the text uses. 'offset' is the index
+// of the run's first character in the current text. Pass -1 to draw the run on its own with its top left at the framebuffer's.
+static void DrawClockRun(Framebuffer* fb, const WCHAR* text, int length, int offset, const FramebufferRect* clip) {
+	int x = 0, y = 0;
+	if (offset >= 0) {
+		x = displayModel.layout.x;
+		y = displayModel.layout.y;
+	}
+
+	if (useSegments) {
+		if (offset > 0) x += MeasureSegmentText(segmentDisplay, displayModel.text, offset);
+		DrawSegmentText(segmentDisplay, fb, text, length, x, y, FRAMEBUFFER_RGB(255, 255, 255), TRUE, clip);
+	}
+	else if (useSdf) {
+		SdfStyle style = { sdfTextSize, FRAMEBUFFER_RGB(255, 255, 255), 0.0f, 0, 0.0f, 0 };
+		float left = (float)x + (offset > 0 ? MeasureSdfRun(&clockSdf, displayModel.text, offset, sdfTextSize) : 0.0f);
+		DrawSdfRun(&clockSdf, fb, text, length, left, (float)y, &style, clip);
+	}
+	else {
+		if (offset > 0) x += MeasureGlyphRun(clockAtlas, displayModel.text, offset);
+		DrawGlyphRun(clockAtlas, fb, text, length, x, y, FRAMEBUFFER_RGB(255, 255, 255), clip);
+	}
+}
+
+// Draws one character alone into a mask the size of its cell, the way the text layer would draw it, for building the animation frames from.
+static void DrawCellCoverage(wchar_t ch, uint8_t* mask, int width, int height, void* context) {
+	UNREFERENCED_PARAMETER(context);
+
+	Framebuffer scratch;
+	if (!InitFramebuffer(&scratch, width, height)) return;
+
+	DrawClockRun(&scratch, &ch, 1, -1, NULL);
+	for (size_t i = 0; i < (size_t)width * height; i++) {
+		mask[i] = (uint8_t)(scratch.pixels[i] >> 8);
+	}
+	FreeFramebuffer(&scratch);
+}
+
+static void DrawClockText(RenderSurface* surface, const RECT* clip) {
+	if (useAnalogFace) {
+		DrawAnalogHands(analogFace, &surface->framebuffer, faceX, faceY, handSteps, FRAMEBUFFER_RGB(255, 255, 255), FRAMEBUFFER_RGB(230, 40, 40), (const FramebufferRect*)clip);
+		return;
+	}
+
+	if (textEffects.width) {
+		// The effects' masks start where the text's coverage did, which includes the overhang. See BuildClockTextEffects
+		DrawTextEffects(&textEffects, &surface->framebuffer, displayModel.layout.x - displayModel.layout.height / 8, displayModel.layout.y, &textEffectStyle, (const FramebufferRect*)clip);
+	}
+
+	if (useSegments || useSdf || useAtlas) {
+		// Characters being animated are drawn by their animation instead, so the text is drawn in the runs between them
+		int first = 0;
+		for (int i = 0; i <= displayModel.length; i++) {
+			if (i == displayModel.length || IsDigitAnimating(&digitTransitions, i)) {
+				if (i > first) {
+					DrawClockRun(&surface->framebuffer, displayModel.text + first, i - first, first, (const FramebufferRect*)clip);
+				}
+				first = i + 1;
 			}
 		}
-		else {
-			// Center the text normally
-			posX = (rect.right - rect.left - textSize.cx) / 2;
-			posY = (rect.bottom - rect.top - textSize.cy) / 2;
-		}
+		DrawDigitTransitions(&digitTransitions, &surface->framebuffer, displayModel.layout.x, displayModel.layout.y, FRAMEBUFFER_RGB(255, 255, 255), (const FramebufferRect*)clip);
+		return;
+	}
+
+	SelectRenderFont(surface, clockFont);
+	SetTextColor(surface->hMemDC, RGB(255, 255, 255));
+	TextOutW(surface->hMemDC, displayModel.layout.x, displayModel.layout.y, displayModel.text, displayModel.length);
+}
+
+// Draws the latest status from the event queue (sync errors and such) in the bottom left corner.
+static void DrawStatusLine(RenderSurface* surface, const RECT* clip) {
+	UNREFERENCED_PARAMETER(clip);
+
+	SelectRenderFont(surface, scale->statusFont);
+	SetTextColor(surface->hMemDC, statusSeverity == CLOCK_EVENT_ERROR ? RGB(255, 96, 96) : statusSeverity == CLOCK_EVENT_WARNING ? RGB(255, 208, 64) : RGB(192, 192, 192));
+
+	RECT statusRect = *GetLayerBounds(LAYER_STATUS);
+	DrawTextW(surface->hMemDC, statusText, -1, &statusRect, DT_LEFT | DT_BOTTOM | DT_SINGLELINE | DT_END_ELLIPSIS | DT_NOPREFIX);
+}
+
+// Measures a run of the current text, from the atlas if it can be drawn from there.
+static int MeasureClockText(int length) {
+	if (useSegments) {
+		return MeasureSegmentText(segmentDisplay, displayModel.text, length);
+	}
 
-		// Draw the text at the calculated position
-		TextOutW(hMemDC, posX, posY, text, lstrlenW(text));
+	if (useSdf) {
+		return (int)ceilf(MeasureSdfRun(&clockSdf, displayModel.text, length, sdfTextSize));
+	}
+
+	if (useAtlas) {
+		return MeasureGlyphRun(clockAtlas, displayModel.text, length);
+	}
+
+	SIZE size = { 0, 0 };
+	GetTextExtentPoint32W(g_RenderSurface.hMemDC, displayModel.text, length, &size);
+	return size.cx;
+}
+
+// Sizes the effects from the config for text of a given height, so they keep their proportions as the text scales.
+static void UpdateTextEffectStyle(int height) {
+	TextEffectStyle* style = &textEffectStyle;
+	style->shadowRadius = (int)g_Config.TextShadow * height / 100;
+	style->shadowOffsetX = style->shadowRadius / 2;
+	style->shadowOffsetY = style->shadowRadius / 2;
+	style->shadowColor = FRAMEBUFFER_RGB(0, 0, 0);
+	style->outlineWidth = (int)g_Config.TextOutline * height / 100;
+	style->outlineColor = FRAMEBUFFER_RGB(0, 0, 0);
+	style->glowRadius = (int)g_Config.TextGlow * height / 100;
+	style->glowColor = FRAMEBUFFER_RGB(255, 255, 255);
+}
 
-		// Copy the memory DC to the actual DC
-		BitBlt(hdc, 0, 0, rect.right, rect.bottom, hMemDC, 0, 0, SRCCOPY);
+// Draws the current text white on black and builds its effects from that. Its box is widened by the overhang, as the layer's bounds are.
+// Text that goes through TextOutW has no framebuffer copy to build from, so it goes without.
+static void BuildClockTextEffects(int width, int height, int overhang) {
+	FreeTextEffects(&textEffects);
+	if (!HasTextEffects(&textEffectStyle) || !(useSegments || useSdf || useAtlas)) return;
 
-		// Cleanup
-		SelectObject(hMemDC, hOldBitmap);
-		DeleteObject(hBitmap);
-		DeleteDC(hMemDC);
+	int coverageWidth = width + overhang * 2;
+	Framebuffer scratch;
+	if (!InitFramebuffer(&scratch, coverageWidth, height)) return;
 
-		return TRUE;  // Message handled
+	if (useSegments) {
+		DrawSegmentText(segmentDisplay, &scratch, displayModel.text, displayModel.length, overhang, 0, FRAMEBUFFER_RGB(255, 255, 255), FALSE, NULL); // The ghost would cast a shadow of its own
+	}
+	else if (useSdf) {
+		SdfStyle style = { sdfTextSize, FRAMEBUFFER_RGB(255, 255, 255), 0.0f, 0, 0.0f, 0 };
+		DrawSdfRun(&clockSdf, &scratch, displayModel.text, displayModel.length, (float)overhang, 0.0f, &style, NULL);
 	}
 	else {
-		LPDRAWITEMSTRUCT pDIS = (LPDRAWITEMSTRUCT)lParam;
-		HDC hdc = pDIS->hDC;
-		RECT rect = pDIS->rcItem;
+		DrawGlyphRun(clockAtlas, &scratch, displayModel.text, displayModel.length, overhang, 0, FRAMEBUFFER_RGB(255, 255, 255), NULL);
+	}
 
-		// Create a memory DC for double buffering
-		HDC hMemDC = CreateCompatibleDC(hdc);
-		HBITMAP hBitmap = CreateCompatibleBitmap(hdc, rect.right, rect.bottom);
-		HBITMAP hOldBitmap = (HBITMAP)SelectObject(hMemDC, hBitmap);
+	// Every channel holds the same coverage, so any one will do. It's packed into place over the pixels it came from
+	uint8_t* coverage = (uint8_t*)scratch.pixels;
+	for (size_t i = 0; i < (size_t)coverageWidth * height; i++) {
+		coverage[i] = (uint8_t)(scratch.pixels[i] >> 8);
+	}
 
-		// Create a gradient from red (top) to black (bottom)
-		TRIVERTEX vertex[2];
-		GRADIENT_RECT gRect;
-
-		vertex[0].x = rect.left;
-		vertex[0].y = rect.top;
-		vertex[1].x = rect.right;
-		vertex[1].y = rect.bottom;
-
-		if (g_Config.CustomColor) {
-			vertex[0].Red = g_GradientColor.tvColor1.Red;
-			vertex[0].Green = g_GradientColor.tvColor1.Green;
-			vertex[0].Blue = g_GradientColor.tvColor1.Blue;
-
-			vertex[1].Red = g_GradientColor.tvColor2.Red;
-			vertex[1].Green = g_GradientColor.tvColor2.Green;
-			vertex[1].Blue = g_GradientColor.tvColor2.Blue;
+	if (!BuildTextEffects(&textEffects, coverage, coverageWidth, coverageWidth, height, &textEffectStyle)) {
+		yellow();
+		wprintf(L"Out of memory for the text effects. Drawing the text without them.\r\n");
+		reset();
+	}
+	FreeFramebuffer(&scratch);
+}
+
+// Seconds from the performance counter, the clock the digit animations run on.
+static double GetAnimationSeconds(void) {
+	LARGE_INTEGER frequency, now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart / frequency.QuadPart;
+}
+
+// Starts an animation for each character in the range the formatter reports as changed. Only text drawn through the framebuffer can be animated.
+static void StartClockTransitions(int height) {
+	DisplayModel* model = &displayModel;
+	if (digitTransitions.style == DIGIT_TRANSITION_NONE || !(useSegments || useSdf || useAtlas) || model->previousLength != model->length) return;
+
+	double now = GetAnimationSeconds();
+	for (int i = model->changedFirst; i <= model->changedLast; i++) {
+		if (model->previousText[i] == model->text[i]) continue;
+
+		int left = MeasureClockText(i);
+		StartDigitTransition(&digitTransitions, i, model->previousText[i], model->text[i], left, MeasureClockText(i + 1) - left, height, now, DrawCellCoverage, NULL);
+	}
+}
+
+// Moves the animations on and marks the cells whose frame changed. Only those cells are recomposited, however big the window is.
+static void UpdateClockTransitions(void) {
+	if (digitTransitions.cellCount == 0) return;
+
+	FramebufferRect cells[DIGIT_TRANSITION_MAX_CELLS];
+	int count = UpdateDigitTransitions(&digitTransitions, GetAnimationSeconds(), cells, DIGIT_TRANSITION_MAX_CELLS);
+	for (int i = 0; i < count; i++) {
+		RECT rect = { displayModel.layout.x + cells[i].left, displayModel.layout.y + cells[i].top, displayModel.layout.x + cells[i].right, displayModel.layout.y + cells[i].bottom };
+		AddDirtyRect(&rect);
+	}
+}
+
+// Lays out the clock text and marks what changed. When the text is the same as last frame and isn't bouncing around, this returns right away.
+// Otherwise only the characters that differ are redrawn, unless the text moved.
+static void UpdateClockText(void) {
+	RenderSurface* surface = &g_RenderSurface;
+	DisplayModel* model = &displayModel;
+	if (!surface->hMemDC) return;
+
+	BOOL textChanged = (model->generation != laidOutGeneration);
+	if (!textChanged && !g_Config.DVDLogo) {
+		return;
+	}
+
+	SelectRenderFont(surface, clockFont);
+
+	int width = model->layout.width, height = model->layout.height;
+	if (textChanged) {
+		useSegments = segmentDisplay->wideGhost && SegmentDisplayCovers(model->text);
+		useSdf = !useSegments && AtlasCoversText(&clockSdf.atlas, model->text);
+		useAtlas = !useSegments && !useSdf && AtlasCoversText(clockAtlas, model->text);
+		SetLayerParallel(LAYER_TEXT, useSegments || useSdf || useAtlas); // TextOutW needs the DC, which can't be shared between threads
+
+		if (useSegments) {
+			width = MeasureSegmentText(segmentDisplay, model->text, model->length);
+			height = segmentDisplay->height;
+		}
+		else if (useSdf) {
+			width = (int)ceilf(MeasureSdfRun(&clockSdf, model->text, model->length, sdfTextSize));
+			height = (int)ceilf(sdfTextSize);
+		}
+		else if (useAtlas) {
+			width = MeasureGlyphRun(clockAtlas, model->text, model->length);
+			height = clockAtlas->lineHeight;
 		}
 		else {
-			// Define the start color
-			vertex[0].Red = 0xFFFF;
-			vertex[0].Green = 0x0000;
-			vertex[0].Blue = 0x0000;
-			vertex[0].Alpha = 0x0000;
-
-			// Define the end color (black)
-			vertex[1].Red = 0x0000;
-			vertex[1].Green = 0x0000;
-			vertex[1].Blue = 0x0000;
-			vertex[1].Alpha = 0x0000;
+			SIZE textSize;
+			GetTextExtentPoint32W(surface->hMemDC, model->text, model->length, &textSize);
+			width = textSize.cx;
+			height = textSize.cy;
 		}
+	}
 
-		// Gradient direction (vertical)
-		gRect.UpperLeft = 0;
-		gRect.LowerRight = 1;
+	int x, y;
+	if (g_Config.DVDLogo) {
+		// Step the bounce by however much time has really passed, then draw it at the nearest pixel
+		LARGE_INTEGER frequency, now;
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&now);
+		double elapsed = lastMotionTime ? (double)(now.QuadPart - lastMotionTime) / frequency.QuadPart : 0.0;
+		lastMotionTime = now.QuadPart;
+
+		AdvanceBounceMotion(&textMotion, elapsed, (float)(surface->width - width), (float)(surface->height - height));
+
+		float motionX, motionY;
+		GetBouncePosition(&textMotion, &motionX, &motionY);
+		x = (int)(motionX + 0.5f);
+		y = (int)(motionY + 0.5f);
+	}
+	else {
+		// Center the text normally
+		x = (surface->width - width) / 2;
+		y = (surface->height - height) / 2;
+	}
 
-		// Fill with gradient
-		GradientFill(hMemDC, vertex, 2, &gRect, 1, GRADIENT_FILL_RECT_V);
+	// Italic and some decorative fonts draw a little past their advance width
+	int overhang = height / 8;
+	if (textChanged) {
+		UpdateTextEffectStyle(height);
+		BuildClockTextEffects(width, height, overhang);
+	}
 
-		// Set text color to white
-		SetTextColor(hMemDC, RGB(255, 255, 255));
-		SetBkMode(hMemDC, TRANSPARENT);
+	// Animations only carry on while the text stays the same size. Otherwise the characters have moved within it
+	if (width != model->layout.width || height != model->layout.height) {
+		CancelDigitTransitions(&digitTransitions);
+	}
+	else if (textChanged) {
+		StartClockTransitions(height);
+	}
 
-		// Get the actual text from the control
-		wchar_t text[256];  // Adjust size if needed
-		GetWindowTextW(pDIS->hwndItem, text, 256);
+	// The effects reach further still, and a changed character changes the effects around its neighbours too
+	int padding = textEffects.width ? GetTextEffectPadding(&textEffectStyle) : 0;
+	RECT bounds = { x - overhang - padding, y - padding, x + width + overhang + padding, y + height + padding };
 
-		// Select custom font
-		if (g_hfMainFont) {
-			SelectObject(hMemDC, g_hfMainFont);
+	if (!SetDisplayLayout(model, x, y, width, height)) {
+		// Same place and size, so only the characters that changed need redrawing. Digits sit in fixed-width cells in the atlas, so this is cheap
+		if (model->changedFirst <= model->changedLast) {
+			RECT changed = { x + MeasureClockText(model->changedFirst) - overhang - padding, y - padding, x + MeasureClockText(model->changedLast + 1) + overhang + padding, y + height + padding };
+			AddDirtyRect(&changed);
 		}
+		SetLayerBoundsQuiet(LAYER_TEXT, &bounds);
+	}
+	else {
+		SetLayerBounds(LAYER_TEXT, &bounds);
+	}
 
-		// Calculate text size
-		SIZE textSize;
-		GetTextExtentPoint32W(hMemDC, text, lstrlenW(text), &textSize);
+	laidOutGeneration = model->generation;
+}
 
-		// Static variables to keep track of the bouncing text
-		static int dx = 2, dy = 2; // Speed of movement
-		static int posX = 10, posY = 10; // Initial position
+// Seconds since midnight in the configured time source, with the milliseconds as the fraction.
+static double GetTimeOfDay(void) {
+	if (g_TimeConfig.ts != _TIME_SOURCE_SYSTEM_) {
+		return GetAdjustedSecondsOfDay();
+	}
 
-		if (g_Config.DVDLogo) {
-			// Update position
-			posX += dx;
-			posY += dy;
+	SYSTEMTIME st;
+	GetLocalTime(&st);
+	return st.wHour * 3600.0 + st.wMinute * 60.0 + st.wSecond + st.wMilliseconds / 1000.0;
+}
 
-			// Bounce logic
-			if (posX + textSize.cx >= rect.right || posX <= rect.left) {
-				dx = -dx;
-			}
-			if (posY + textSize.cy >= rect.bottom || posY <= rect.top) {
-				dy = -dy;
+// Turns the hands to the current time. Only a hand that moved a whole step is redrawn, and only over its old and new boxes,
+// so most frames redraw just the second hand and the face behind it comes straight from the background cache.
+static void UpdateAnalogHands(void) {
+	if (!analogFace->size || !g_bGetTime) return;
+
+	int steps[ANALOG_HAND_COUNT];
+	GetAnalogHandSteps(GetTimeOfDay(), steps);
+
+	RECT bounds;
+	SetRectEmpty(&bounds);
+	for (int hand = 0; hand < ANALOG_HAND_COUNT; hand++) {
+		if (steps[hand] != handSteps[hand]) {
+			AddDirtyRect(&handBounds[hand]);
+			GetAnalogHandBounds(analogFace, faceX, faceY, hand, steps[hand], (FramebufferRect*)&handBounds[hand]);
+			AddDirtyRect(&handBounds[hand]);
+			handSteps[hand] = steps[hand];
+		}
+		UnionRect(&bounds, &bounds, &handBounds[hand]);
+	}
+	SetLayerBoundsQuiet(LAYER_TEXT, &bounds);
+}
+
+// Picks the largest text that fits the window for the current format. With segments or the distance field atlas that's just a size to lay out or scale to.
+// Otherwise it's a font, and the atlas is rebuilt if it changed.
+static void FitTextToWindow(void) {
+	RenderSurface* surface = &g_RenderSurface;
+	if (!surface->hMemDC) return;
+
+	int format = g_Config.DisplayFormat;
+	const WCHAR* samples[2];
+	int sampleCount = GetDisplayFormatSamples(format, samples);
+
+	// The DVD logo needs room to move around, so it only gets half the window
+	int width = g_Config.DVDLogo ? surface->width / 2 : surface->width;
+	int height = g_Config.DVDLogo ? surface->height / 2 : surface->height;
+	if (useAnalogFace) {
+		// The face doesn't move with the DVD logo, so it always gets the whole window. The dial is only drawn again when its size changes
+		int size = min(surface->width, surface->height) * FONT_FIT_MARGIN / 100;
+		fittedFormat = format;
+
+		if (size != analogFace->size) {
+			FreeAnalogFace(analogFace);
+			if (!InitAnalogFace(analogFace, size, clockSdf.atlas.pixels ? &clockSdf : NULL)) {
+				yellow();
+				wprintf(L"Out of memory for the analog face.\r\n");
+				reset();
 			}
+			InvalidateCompositor();
 		}
-		else {
-			// Center the text normally
-			posX = (rect.right - rect.left - textSize.cx) / 2;
-			posY = (rect.bottom - rect.top - textSize.cy) / 2;
+		faceX = (surface->width - analogFace->size) / 2;
+		faceY = (surface->height - analogFace->size) / 2;
+		for (int hand = 0; hand < ANALOG_HAND_COUNT; hand++) {
+			handSteps[hand] = -1;
+		}
+		return;
+	}
+
+	if (segmentStyle != SEGMENT_STYLE_NONE) {
+		// The shapes are only worked out again when the size that fits changes
+		int segmentHeight = FitSegmentHeight(segmentStyle, samples, sampleCount, width * FONT_FIT_MARGIN / 100, height * FONT_FIT_MARGIN / 100);
+		fittedFormat = format;
+
+		if (segmentHeight != segmentDisplay->height) {
+			FreeSegmentDisplay(segmentDisplay);
+			InitSegmentDisplay(segmentDisplay, segmentStyle, segmentHeight);
+			InitDisplayModel(&displayModel);
+			laidOutGeneration = 0;
+		}
+		return;
+	}
+
+	if (clockSdf.atlas.pixels) {
+		float size = max(FitSdfHeight(&clockSdf, samples, sampleCount, width * FONT_FIT_MARGIN / 100, height * FONT_FIT_MARGIN / 100), (float)FONT_FIT_MIN_HEIGHT);
+		fittedFormat = format;
+
+		if (size != sdfTextSize) {
+			sdfTextSize = size;
+			InitDisplayModel(&displayModel); // The text has to be measured again at the new size
+			laidOutGeneration = 0;
+		}
+		return;
+	}
+
+	HFONT hFont = FitClockFont(surface->hMemDC, g_szMainFont, format, samples, sampleCount, width, height);
+	fittedFormat = format;
+
+	if (hFont && (hFont != clockFont || hFont != scale->atlasFont)) {
+		clockFont = hFont;
+		if (hFont != scale->atlasFont) {
+			BuildClockAtlas(); // Not if this scale already has the atlas for the font, e.g. when the window is back on a monitor it was on before at the same size
+		}
+		InitDisplayModel(&displayModel); // The text has to be measured again at the new size
+		laidOutGeneration = 0;
+	}
+}
+
+// Starts an empty set for a scale. FitTextToWindow fills in the atlas, segments or dial the first time they're needed at it.
+static void* BuildScaleResources(int dpi, void* context) {
+	UNREFERENCED_PARAMETER(context);
+
+	ScaleResources* resources = (ScaleResources*)calloc(1, sizeof(ScaleResources));
+	if (!resources) return NULL;
+
+	resources->dpi = dpi;
+	resources->statusFont = CreateFont(ScaleForDpi(16, dpi), 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH, g_szMainFont);
+	wprintf(L"Building resources for %d DPI.\r\n", dpi);
+	return resources;
+}
+
+static void FreeScaleResources(void* released, void* context) {
+	UNREFERENCED_PARAMETER(context);
+
+	ScaleResources* resources = (ScaleResources*)released;
+	if (resources->statusFont) {
+		DeleteObject(resources->statusFont);
+	}
+	FreeGlyphAtlas(&resources->atlas);
+	FreeSegmentDisplay(&resources->segments);
+	FreeAnalogFace(&resources->face);
+	free(resources);
+}
+
+// Switches to the resources for the scale of the monitor the window is on, building them the first time. Returns whether it switched.
+// Everything sized for the old scale is laid out again, and the font, segments or dial are only built if this scale doesn't have them at the new size yet.
+static BOOL UpdateScale(void) {
+	int dpi = (int)InterlockedCompareExchange(&windowDpi, 0, 0);
+	if (scale && scale->dpi == NormalizeDpi(dpi)) return FALSE;
+
+	if (!scaleCache.build) {
+		InitDpiScaleCache(&scaleCache, BuildScaleResources, FreeScaleResources, NULL);
+	}
+
+	ScaleResources* resources = (ScaleResources*)GetDpiScaleResources(&scaleCache, dpi);
+	if (!resources) {
+		red();
+		wprintf(L"Out of memory for the resources at %d DPI.\r\n", dpi);
+		reset();
+		return FALSE; // Carry on at the old scale
+	}
+
+	scale = resources;
+	clockAtlas = &scale->atlas;
+	segmentDisplay = &scale->segments;
+	analogFace = &scale->face;
+
+	CancelDigitTransitions(&digitTransitions);
+	InitDisplayModel(&displayModel);
+	laidOutGeneration = 0;
+	fittedFormat = -1;
+	statusText[0] = L'\0';
+	InvalidateCompositor(); // The dial is part of the cached background
+	return TRUE;
+}
+
+// Picks up a new or expired status line.
+static void UpdateStatusLine(void) {
+	if (!g_RenderSurface.hMemDC) return;
+
+	WCHAR status[EVENT_MESSAGE_LENGTH];
+	int severity = CLOCK_EVENT_INFO;
+	if (!GetClockStatus(status, EVENT_MESSAGE_LENGTH, &severity)) {
+		status[0] = L'\0';
+	}
+
+	if (wcscmp(status, statusText) == 0 && severity == statusSeverity) {
+		return;
+	}
+
+	wcscpy(statusText, status);
+	statusSeverity = severity;
+
+	if (status[0] == L'\0') {
+		SetLayerBounds(LAYER_STATUS, NULL);
+		return;
+	}
+
+	int margin = ScaleForDpi(8, scale->dpi);
+	RECT bounds = { margin, 0, g_RenderSurface.width - margin, g_RenderSurface.height - margin / 2 };
+	SelectRenderFont(&g_RenderSurface, scale->statusFont);
+	int height = DrawTextW(g_RenderSurface.hMemDC, status, -1, &bounds, DT_LEFT | DT_SINGLELINE | DT_NOPREFIX | DT_CALCRECT);
+	bounds.left = margin;
+	bounds.right = g_RenderSurface.width - margin;
+	bounds.bottom = g_RenderSurface.height - margin / 2;
+	bounds.top = bounds.bottom - height;
+	SetLayerBounds(LAYER_STATUS, &bounds);
+}
+
+void RenderClockFrame(BOOL rebuilt) {
+	if (rebuilt) {
+		// Lay the text and the status out again from scratch. The DVD logo carries on from where it was, at the configured speed
+		InitDisplayModel(&displayModel);
+		laidOutGeneration = 0;
+		if (!lastMotionTime) {
+			InitBounceMotion(&textMotion, 10.0f, 10.0f, MOTION_DEFAULT_SPEED);
 		}
+		DWORD speed = GetDVDSpeed();
+		SetBounceSpeed(&textMotion, speed ? (float)speed : MOTION_DEFAULT_SPEED);
+		statusText[0] = L'\0';
+	}
 
-		// Draw the text at the calculated position
-		TextOutW(hMemDC, posX, posY, text, lstrlenW(text));
+	if (rebuilt) {
+		// Scaled to the new size here rather than in DrawBackground, which runs on the tile threads. Only done when the size changes
+		WCHAR path[MAX_PATH];
+		backgroundImage = GetBackgroundImage(path, MAX_PATH) ? GetScaledImageFile(path, g_RenderSurface.width, g_RenderSurface.height) : NULL;
+	}
 
-		// Copy the memory DC to the actual DC
-		BitBlt(hdc, 0, 0, rect.right, rect.bottom, hMemDC, 0, 0, SRCCOPY);
+	UpdateBackgroundGradient(rebuilt);
+	UpdateScale();
 
-		// Cleanup
-		SelectObject(hMemDC, hOldBitmap);
-		DeleteObject(hBitmap);
-		DeleteDC(hMemDC);
+	if (rebuilt || fittedFormat != g_Config.DisplayFormat) {
+		FitTextToWindow();
+	}
 
-		return TRUE;  // Message handled
+	if (useAnalogFace) {
+		UpdateAnalogHands();
+	}
+	else {
+		WCHAR buffer[DISPLAY_TEXT_LENGTH];
+		GetCurrentDateTime(buffer, DISPLAY_TEXT_LENGTH);
+		SetDisplayText(&displayModel, buffer);
+		UpdateClockText();
+		UpdateClockTransitions();
 	}
+	UpdateStatusLine();
+}
+#pragma endregion
+
+BOOL RenderText(LPARAM lParam) {
+	// The frame was already built on the render thread. All that's left is copying the part of it Windows asked for.
+	LPDRAWITEMSTRUCT pDIS = (LPDRAWITEMSTRUCT)lParam;
+	PresentRenderFrame(pDIS->hDC);
+
+	return TRUE;  // Message handled
 }
 
 void CreateClockControl(HWND hwnd) {
@@ -376,6 +981,43 @@ void CreateClockControl(HWND hwnd) {
 	if (g_hfMainFont) {
 		SendMessage(g_hWndClockOut, WM_SETFONT, (WPARAM)g_hfMainFont, TRUE);
 	}
+
+	// Resources for the monitor the window opens on. Others are built as it's moved, see UpdateScale
+	InterlockedExchange(&windowDpi, GetWindowDpi(hwnd));
+	if (!UpdateScale()) {
+		return;
+	}
+
+	// Until the render thread knows the window's size and picks a font that fits
+	clockFont = g_hfMainFont;
+	segmentStyle = (int)GetDisplayStyle();
+	if (segmentStyle == ANALOG_FACE_STYLE) {
+		// The numerals are drawn from the distance field once per size, so that's the only font work the face needs
+		wprintf(L"Drawing an analog face.\r\n");
+		useAnalogFace = TRUE;
+		segmentStyle = SEGMENT_STYLE_NONE;
+		BuildClockSdf();
+		SetLayerParallel(LAYER_TEXT, TRUE);
+	}
+	else if (segmentStyle == SEGMENT_STYLE_SEVEN || segmentStyle == SEGMENT_STYLE_MATRIX) {
+		// The segments need no font at all, so don't spend time rasterizing one. TextOutW is still there for anything they can't show
+		wprintf(L"Drawing the digits as %s.\r\n", segmentStyle == SEGMENT_STYLE_SEVEN ? L"seven segments" : L"a dot matrix");
+	}
+	else {
+		segmentStyle = SEGMENT_STYLE_NONE;
+		BuildClockAtlas();
+		BuildClockSdf();
+		sdfTextSize = (float)clockAtlas->lineHeight;
+	}
+
+	// The analog face has no digits to animate
+	DWORD transition = useAnalogFace ? DIGIT_TRANSITION_NONE : GetDigitTransition();
+	InitDigitTransitions(&digitTransitions, transition == DIGIT_TRANSITION_FLAP || transition == DIGIT_TRANSITION_SLIDE ? (int)transition : DIGIT_TRANSITION_NONE);
+
+	SetLayerDrawProc(LAYER_BACKGROUND, DrawBackground);
+	SetLayerParallel(LAYER_BACKGROUND, TRUE);
+	SetLayerDrawProc(LAYER_TEXT, DrawClockText);
+	SetLayerDrawProc(LAYER_STATUS, DrawStatusLine);
 }
 
 void ResizeText(HWND hwnd) {
@@ -386,6 +1028,9 @@ void ResizeText(HWND hwnd) {
 	SetWindowPos(g_hWndClockOut, NULL, rect.left, rect.top,
 		rect.right - rect.left, rect.bottom - rect.top,
 		SWP_NOZORDER | SWP_NOACTIVATE);
+
+	// The render thread rebuilds the back buffers at the new size and lays the text and status out again
+	RequestRenderResize(rect.right - rect.left, rect.bottom - rect.top);
 }
 
 void GetCurrentDateTime(WCHAR* buffer, size_t bufferSize) {
@@ -397,57 +1042,16 @@ void GetCurrentDateTime(WCHAR* buffer, size_t bufferSize) {
 		return;
 	}
 
-	if (g_TimeConfig.ts == 1 && g_bGetTime) {
-		// The user is using network time, so output the NTP time.
-		// See NTPClient.h & NTPClient.c for more details.
+	if (g_TimeConfig.ts != _TIME_SOURCE_SYSTEM_ && g_bGetTime) {
+		// The user is using network or GPS time, so output the adjusted time.
+		// See NTPClient.h & NTPClient.c for more details. GPSClient.c feeds the same adjusted time.
 		OutputNTPTime(buffer, bufferSize);
 	}
 	else {
 		SYSTEMTIME st;
 		GetLocalTime(&st);  // Get local time
 
-		switch (g_Config.DisplayFormat) {
-		case _SHOW_DATE_24_HOUR_FORMAT_:
-			// 24-hour format with date
-			swprintf(buffer, bufferSize, L"%04d-%02d-%02d %02d:%02d:%02d",
-				st.wYear, st.wMonth, st.wDay,
-				st.wHour, st.wMinute, st.wSecond);
-			break;
-
-		case _SHOW_DATE_12_HOUR_FORMAT_: {
-			// 12-hour format with AM/PM and date
-			int hour = st.wHour % 12;
-			if (hour == 0) hour = 12; // Convert 0 to 12 for AM/PM format
-			const WCHAR* ampm = (st.wHour < 12) ? L"AM" : L"PM";
-
-			swprintf(buffer, bufferSize, L"%04d-%02d-%02d %02d:%02d:%02d %s",
-				st.wYear, st.wMonth, st.wDay,
-				hour, st.wMinute, st.wSecond, ampm);
-			break;
-		}
-
-		case _HIDE_DATE_24_HOUR_FORMAT_:
-			// 24-hour format, no date
-			swprintf(buffer, bufferSize, L"%02d:%02d:%02d",
-				st.wHour, st.wMinute, st.wSecond);
-			break;
-
-		case _HIDE_DATE_12_HOUR_FORMAT_: {
-			// 12-hour format with AM/PM, no date
-			int hour = st.wHour % 12;
-			if (hour == 0) hour = 12; // Convert 0 to 12 for AM/PM format
-			const WCHAR* ampm = (st.wHour < 12) ? L"AM" : L"PM";
-
-			swprintf(buffer, bufferSize, L"%02d:%02d:%02d %s",
-				hour, st.wMinute, st.wSecond, ampm);
-			break;
-		}
-
-		default:
-			// Handle unexpected cases (optional, but good practice)
-			buffer[0] = L'\0'; // Empty buffer in case of error
-			break;
-		}
+		FormatDisplayTime(buffer, bufferSize, g_Config.DisplayFormat, st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
 	}
 }
 #pragma endregion
@@ -25,11 +25,8 @@
 #define __CONTEXT_SETTINGS__ 0xC3
 #define __CONTEXT_ALARMS__ 0xC4
 
-// Constants for format identifiers
-#define _SHOW_DATE_24_HOUR_FORMAT_	0
-#define _HIDE_DATE_24_HOUR_FORMAT_	1
-#define _SHOW_DATE_12_HOUR_FORMAT_	2
-#define _HIDE_DATE_12_HOUR_FORMAT_	3
+// Constants for format identifiers. They live with the display model so the headless renderer can use them too
+#include "DisplayModel.h"
 
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -47,6 +44,7 @@
 #include <stdarg.h>
 
 #include "Config.h"
+#include "Gradient.h"
 #include "resource.h"
 
 #ifdef _WIN32_WINNT
@@ -64,7 +62,6 @@ extern UINT g_Context; // Context for what part of the UI is being shown. Useful
 
 extern HINSTANCE g_hInst; // Global variable for storing the handle for the instance for use whenever it is needed. I prefer this method over passing an HINSTANCE into each function.
 extern HFONT g_hfMainFont; // Global variable for storing the main font that will be used to render the clock text. 
-extern HFONT g_hfBtnFont; // Same as above, except this one is rendered smaller to fit in buttons. Is used in the settings sub-window. 
 extern HWND g_hWndMain; // Global variable for storing the window handle for the main window of the application. This is the window where the clock itself is rendered. See MainWndProc. 
 extern HMENU g_hMenu; // Global variable for storing the handle for the menu. This is used to create the menu for the main window.
 
@@ -81,6 +78,7 @@ typedef struct __GradientColor {
 } GradientColor;
 
 extern GradientColor g_GradientColor; // Check the GradientColor comments
+extern Gradient g_Gradient; // Every stop from the color file when the gradient is used, empty otherwise. See ParseCustomColor
 extern COLORREF g_bgColor; // Holds the color that is used if a custom color is parsed, but the gradient effect isn't used
 
 LRESULT CALLBACK MainWndProc(HWND, UINT, WPARAM, LPARAM); // The window procedure for the main window. This is where the timer loop is and where the key events and such are. https://learn.microsoft.com/en-us/windows/win32/winmsg/window-procedures 
@@ -88,7 +86,8 @@ ATOM RegisterMainClass(HINSTANCE); // Registers the class for the main window.
 BOOL InitInstance(HINSTANCE, int); // Stores the HINSTANCE, creates the fonts, and shows the main window.
 BOOL CreateClock(void);
 void CreateClockControl(HWND);	// Creates the static text control that the clock is rendered to. Takes the HWND parameter to use as the parent window for the text.0
-BOOL RenderText(LPARAM); // Renders the text for the clock. Called by the loop in the MainWndProc. 
+BOOL RenderText(LPARAM); // Copies the finished frame to the clock control. Called from WM_DRAWITEM
+void RenderClockFrame(BOOL); // Formats the time and updates the layers for the next frame. Called on the render thread, see RenderThread.c
 void ResizeText(HWND); // Function to dynamically resize the text.
 void GetCurrentDateTime(WCHAR*, size_t); // Gets the system time and formats a wide-string to display it based off of the formats specified above. Takes a pointer to a WCHAR and a size_t to get the size of the buffer. https://cplusplus.com/reference/cwchar/swprintf/ 
 void ToggleFullScreen(HWND); // Revised full screen function to let the user full screen the window on any monitor
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Compositor.h"
+#include "TilePool.h"
+#include "Colors.h"
+
+// The back buffer (g_RenderSurface) always holds the finished frame. Each tick only the rectangles that changed are rebuilt in it:
+// the background is copied from its cache, then every layer above it that overlaps is drawn clipped to the rectangle.
+// Those rectangles are handed back to the caller (the render thread, see RenderThread.c), which only copies and invalidates that much of the window.
+// Big rectangles (a full-screen redraw on a large monitor) are split into tiles and drawn by a pool of threads. Only layers marked parallel,
+// which draw through the framebuffer alone, are drawn in tiles. Layers that use GDI are drawn afterwards on the calling thread, since a DC can't be shared.
+
+static CompositorLayer layers[LAYER_COUNT];
+static RenderSurface backgroundCache;
+static BOOL isBackgroundValid = FALSE;
+static RECT dirty[COMPOSITOR_MAX_DIRTY];
+static int dirtyCount = 0;
+static CompositorStats stats;
+static TilePool* tilePool; // Created the first time a rectangle is big enough to need it
+static BOOL isTilePoolFailed = FALSE;
+
+C_ASSERT(sizeof(RECT) == sizeof(FramebufferRect)); // Dirty rectangles are handed to the framebuffer routines as they are
+
+static LONGLONG RectArea(const RECT* rect) {
+	return (LONGLONG)(rect->right - rect->left) * (rect->bottom - rect->top);
+}
+
+// Clips a rectangle to the back buffer. Returns FALSE if nothing is left.
+static BOOL ClipToSurface(RECT* rect) {
+	RECT surfaceRect = { 0, 0, g_RenderSurface.width, g_RenderSurface.height };
+	return IntersectRect(rect, rect, &surfaceRect);
+}
+
+void SetLayerDrawProc(int layer, LayerDrawProc proc) {
+	layers[layer].Draw = proc;
+}
+
+void SetLayerParallel(int layer, BOOL parallel) {
+	layers[layer].parallel = parallel;
+}
+
+void SetLayerBounds(int layer, const RECT* bounds) {
+	AddDirtyRect(&layers[layer].bounds);
+	SetLayerBoundsQuiet(layer, bounds);
+	AddDirtyRect(&layers[layer].bounds);
+}
+
+void SetLayerBoundsQuiet(int layer, const RECT* bounds) {
+	if (bounds) {
+		layers[layer].bounds = *bounds;
+	}
+	else {
+		SetRectEmpty(&layers[layer].bounds);
+	}
+}
+
+const RECT* GetLayerBounds(int layer) {
+	return &layers[layer].bounds;
+}
+
+void AddDirtyRect(const RECT* rect) {
+	RECT clipped = *rect;
+	if (!ClipToSurface(&clipped)) {
+		return;
+	}
+
+	// Merge with anything it touches. The DVD logo's old and new positions overlap almost completely, so they end up as one rectangle.
+	for (int i = 0; i < dirtyCount; i++) {
+		RECT overlap;
+		if (IntersectRect(&overlap, &dirty[i], &clipped)) {
+			UnionRect(&clipped, &clipped, &dirty[i]);
+			dirty[i] = dirty[--dirtyCount];
+			i = -1; // The grown rectangle may now touch one that was already checked
+		}
+	}
+
+	if (dirtyCount == COMPOSITOR_MAX_DIRTY) {
+		for (int i = 0; i < dirtyCount; i++) {
+			UnionRect(&clipped, &clipped, &dirty[i]);
+		}
+		dirtyCount = 0;
+	}
+
+	dirty[dirtyCount++] = clipped;
+}
+
+void InvalidateCompositor(void) {
+	isBackgroundValid = FALSE;
+
+	RECT all = { 0, 0, g_RenderSurface.width, g_RenderSurface.height };
+	dirtyCount = 0;
+	AddDirtyRect(&all);
+}
+
+BOOL ResizeCompositor(HWND hwnd, int width, int height) {
+	HDC hdc = GetDC(hwnd);
+	BOOL result = PrepareRenderSurface(&g_RenderSurface, hdc, width, height) && PrepareRenderSurface(&backgroundCache, hdc, width, height);
+	ReleaseDC(hwnd, hdc);
+
+	if (!result) {
+		return FALSE;
+	}
+
+	InvalidateCompositor();
+	return TRUE;
+}
+
+// Returns the pool if the rectangle is worth splitting up, NULL to draw it on the calling thread.
+static TilePool* GetTilePool(const RECT* rect) {
+	if (RectArea(rect) < COMPOSITOR_PARALLEL_AREA || isTilePoolFailed) {
+		return NULL;
+	}
+
+	if (!tilePool) {
+		tilePool = CreateTilePool((int)GetRenderThreads());
+		if (!tilePool) {
+			isTilePoolFailed = TRUE;
+			yellow();
+			wprintf(L"Failed to start the tile threads. Drawing every tile on the render thread.\r\n");
+			reset();
+			return NULL;
+		}
+		wprintf(L"Started %d tile threads.\r\n", GetTilePoolThreads(tilePool));
+	}
+
+	return GetTilePoolThreads(tilePool) > 1 ? tilePool : NULL;
+}
+
+static void DrawBackgroundTile(const FramebufferRect* tile, void* context) {
+	UNREFERENCED_PARAMETER(context);
+	layers[LAYER_BACKGROUND].Draw(&backgroundCache, (const RECT*)tile);
+}
+
+// Copies the background into one tile of the back buffer and draws the parallel layers below 'context' (the first layer that isn't parallel) over it.
+static void ComposeTile(const FramebufferRect* tile, void* context) {
+	int serialLayer = *(const int*)context;
+	const RECT* rect = (const RECT*)tile;
+
+	FramebufferCopy(&g_RenderSurface.framebuffer, &backgroundCache.framebuffer, tile);
+	for (int layer = LAYER_BACKGROUND + 1; layer < serialLayer; layer++) {
+		RECT overlap;
+		if (layers[layer].Draw && IntersectRect(&overlap, &layers[layer].bounds, rect)) {
+			layers[layer].Draw(&g_RenderSurface, rect);
+		}
+	}
+}
+
+int CompositeFrame(RECT* damage, int maxDamage) {
+	if (dirtyCount == 0 || !g_RenderSurface.hMemDC) {
+		return 0;
+	}
+
+	if (!isBackgroundValid && backgroundCache.hMemDC) {
+		RECT all = { 0, 0, backgroundCache.width, backgroundCache.height };
+		if (layers[LAYER_BACKGROUND].Draw) {
+			TilePool* pool = layers[LAYER_BACKGROUND].parallel ? GetTilePool(&all) : NULL;
+			if (pool) {
+				RunTiles(pool, (const FramebufferRect*)&all, COMPOSITOR_TILE_WIDTH, COMPOSITOR_TILE_HEIGHT, DrawBackgroundTile, NULL);
+			}
+			else {
+				layers[LAYER_BACKGROUND].Draw(&backgroundCache, &all);
+			}
+		}
+		GdiFlush(); // The cache is read through its pixels from here on
+		isBackgroundValid = TRUE;
+		stats.backgroundBuilds++;
+	}
+
+	// The parallel layers at the bottom of the stack can be drawn in tiles. Everything from the first GDI layer up is drawn on this thread
+	int serialLayer = LAYER_BACKGROUND + 1;
+	while (serialLayer < LAYER_COUNT && (layers[serialLayer].parallel || !layers[serialLayer].Draw)) {
+		serialLayer++;
+	}
+
+	HDC hMemDC = g_RenderSurface.hMemDC;
+	for (int i = 0; i < dirtyCount; i++) {
+		const RECT* rect = &dirty[i];
+
+		// Layers may draw with GDI or straight into the pixels, so finish any batched GDI calls before each CPU pass
+		GdiFlush();
+		TilePool* pool = GetTilePool(rect);
+		if (pool) {
+			RunTiles(pool, (const FramebufferRect*)rect, COMPOSITOR_TILE_WIDTH, COMPOSITOR_TILE_HEIGHT, ComposeTile, &serialLayer);
+			stats.tiledRects++;
+		}
+		else {
+			ComposeTile((const FramebufferRect*)rect, &serialLayer);
+		}
+
+		int saved = SaveDC(hMemDC);
+		IntersectClipRect(hMemDC, rect->left, rect->top, rect->right, rect->bottom);
+		for (int layer = serialLayer; layer < LAYER_COUNT; layer++) {
+			RECT overlap;
+			if (layers[layer].Draw && IntersectRect(&overlap, &layers[layer].bounds, rect)) {
+				GdiFlush();
+				layers[layer].Draw(&g_RenderSurface, rect);
+			}
+		}
+		RestoreDC(hMemDC, saved);
+
+		// RestoreDC puts back whatever font was selected when SaveDC ran, so the surface's cached selection may be stale
+		g_RenderSurface.hFont = (HFONT)GetCurrentObject(hMemDC, OBJ_FONT);
+
+		stats.pixelsComposited += RectArea(rect);
+	}
+
+	stats.frames++;
+	if (dirtyCount == 1 && dirty[0].left == 0 && dirty[0].top == 0 && dirty[0].right == g_RenderSurface.width && dirty[0].bottom == g_RenderSurface.height) {
+		stats.fullFrames++;
+	}
+
+	int count = min(dirtyCount, maxDamage);
+	memcpy(damage, dirty, count * sizeof(RECT));
+	dirtyCount = 0;
+	return count;
+}
+
+void ResetCompositor(void) {
+	DestroyTilePool(tilePool);
+	tilePool = NULL;
+	isTilePoolFailed = FALSE;
+	ResetRenderSurface(&g_RenderSurface);
+	ResetRenderSurface(&backgroundCache);
+	isBackgroundValid = FALSE;
+	dirtyCount = 0;
+}
+
+void GetCompositorStats(CompositorStats* out) {
+	*out = stats;
+}
+
+void PrintCompositorStats(void) {
+	blue();
+	wprintf(L"Compositor: %ld frames (%ld full), %ld background builds. %lld pixels composited. Full-window redraws would have been %lld.\r\n",
+		stats.frames, stats.fullFrames, stats.backgroundBuilds, stats.pixelsComposited, (LONGLONG)stats.frames * g_RenderSurface.width * g_RenderSurface.height);
+	if (tilePool) {
+		TilePoolStats poolStats;
+		GetTilePoolStats(tilePool, &poolStats);
+		wprintf(L"Tile threads: %d, %ld rectangles tiled, %ld tiles, %ld steals. Tiles per thread:", GetTilePoolThreads(tilePool), stats.tiledRects, poolStats.tiles, poolStats.steals);
+		for (int i = 0; i < GetTilePoolThreads(tilePool); i++) {
+			wprintf(L" %ld", poolStats.tilesPerThread[i]);
+		}
+		wprintf(L"\r\n");
+	}
+	reset();
+}
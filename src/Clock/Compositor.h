@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_COMPOSITOR_H__
+#define __CLOCK_COMPOSITOR_H__
+
+#include "Clock.h"
+#include "RenderSurface.h"
+
+// Layers, bottom to top
+#define LAYER_BACKGROUND	0 // Cached in its own bitmap, only redrawn when invalidated
+#define LAYER_TEXT			1 // The clock text
+#define LAYER_STATUS		2 // Status line from the event queue
+#define LAYER_COUNT			3
+
+#define COMPOSITOR_MAX_DIRTY 8 // Dirty rectangles tracked per frame. Past this they're merged into one.
+#define COMPOSITOR_TILE_WIDTH 256 // Tiles are wide and short so each one covers long runs of pixels in memory
+#define COMPOSITOR_TILE_HEIGHT 64
+#define COMPOSITOR_PARALLEL_AREA (512 * 512) // Rectangles smaller than this are drawn on the calling thread. Waking the tile threads would cost more than it saves
+
+typedef void (*LayerDrawProc)(RenderSurface*, const RECT*); // Draws a layer into the back buffer, either with GDI or through the surface's framebuffer. The DC is already clipped to the rectangle being recomposited, the framebuffer isn't
+
+typedef struct __CompositorLayer {
+	LayerDrawProc Draw;
+	RECT bounds; // Area the layer currently covers. Empty if it has nothing to show
+	BOOL parallel; // Set when Draw only writes through the framebuffer, so it can be called for several tiles at once from different threads
+} CompositorLayer;
+
+// Compositor statistics, for comparing against full-window redraws
+typedef struct __CompositorStats {
+	LONG frames; // Frames where something was recomposited
+	LONG fullFrames; // Frames that had to recomposite the whole window
+	LONG backgroundBuilds;
+	LONGLONG pixelsComposited;
+	LONG tiledRects; // Dirty rectangles drawn by the tile threads
+} CompositorStats;
+
+void SetLayerDrawProc(int, LayerDrawProc); // Registers the function that draws a layer. The background's proc is only called when its cache is rebuilt
+void SetLayerParallel(int, BOOL); // Marks whether a layer's proc can be drawn in tiles on the tile threads. Off by default
+void SetLayerBounds(int, const RECT*); // Moves a layer. Both the old and the new area are marked dirty. Pass NULL to hide the layer
+void SetLayerBoundsQuiet(int, const RECT*); // Same as SetLayerBounds without marking anything dirty, for when the caller marks a smaller area itself
+const RECT* GetLayerBounds(int); // Returns the current bounds of a layer
+void AddDirtyRect(const RECT*); // Marks part of the window to be recomposited on the next CompositeFrame
+void InvalidateCompositor(void); // Throws away the cached background and marks the whole window dirty. Used when the colors or display settings change
+BOOL ResizeCompositor(HWND, int, int); // Resizes the back buffer and the background cache and marks everything dirty
+int CompositeFrame(RECT*, int); // Recomposites the dirty rectangles into the back buffer. Copies them into the array (up to the given count) and returns how many there were
+void ResetCompositor(void); // Releases the back buffer and the background cache
+void GetCompositorStats(CompositorStats*); // Copies the statistics
+void PrintCompositorStats(void); // Logs the statistics to the console
+
+#endif // !__CLOCK_COMPOSITOR_H__
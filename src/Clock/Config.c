@@ -22,6 +22,7 @@
 // Define the extern marked variables
 Config g_Config;
 TimeConfig g_TimeConfig;
+GPSConfig g_GPSConfig;
 int g_nTimeZone;
 
 void SaveConfiguration(BOOL b1, BOOL b2, BOOL b3, BOOL b4, BOOL b5, BOOL b6) {
@@ -220,6 +221,30 @@ void ParseCustomColor(void) {
 		}
 	}
 
+	// Any further lines are more stops. Each can end with its position in percent, otherwise the stops are spread evenly
+	ZeroMemory(&g_Gradient, sizeof(g_Gradient));
+	if (GradientUsed()) {
+		uint32_t colors[GRADIENT_MAX_STOPS];
+		int positions[GRADIENT_MAX_STOPS];
+		int count = 2, r, g, b, position;
+		colors[0] = FRAMEBUFFER_RGB(r1, g1, b1);
+		colors[1] = FRAMEBUFFER_RGB(r2, g2, b2);
+		positions[0] = positions[1] = -1;
+
+		while (count < GRADIENT_MAX_STOPS && fgetws(line, sizeof(line) / sizeof(wchar_t), file)) {
+			int fields = swscanf(line, L"( %d, %d, %d ) %d%%", &r, &g, &b, &position);
+			if (fields < 3) {
+				continue;
+			}
+			colors[count] = FRAMEBUFFER_RGB(Clamp(0, 255, r), Clamp(0, 255, g), Clamp(0, 255, b));
+			positions[count++] = fields == 4 ? Clamp(0, 100, position) : -1;
+		}
+
+		for (int i = 0; i < count; i++) {
+			AddGradientStop(&g_Gradient, positions[i] >= 0 ? positions[i] / 100.0f : (float)i / (count - 1), colors[i]);
+		}
+	}
+
 	// Set the parse colors
 	g_bgColor = RGB(r1, g1, b1);
 	g_GradientColor.tvColor1.Red = (COLOR16)(r1 * 257);
@@ -511,6 +536,301 @@ void GetTimeConfig(TimeConfig* tc) {
 	tc->port = (int)temp.port;
 }
 
+void SetGPSConfig(const GPSConfig* gc) {
+	HKEY hKey;
+
+	if (RegCreateKeyEx(HKEY_CURRENT_USER, g_szRegKey, 0, NULL, REG_OPTION_NON_VOLATILE, KEY_WRITE, NULL, &hKey, NULL) != ERROR_SUCCESS) {
+		red();
+		wprintf(L"An error occurred while trying to save the GPS configuration to the registry. (0x%x)\r\n", GetLastError());
+		reset();
+
+		FormattedMessageBox(NULL, L"An error occurred while trying to save the GPS configuration to the registry. (0x%x)\r\n\r\nYour settings have not been saved.", L"Clock", MB_ICONERROR | MB_OK, GetLastError());
+		return;
+	}
+
+	const wchar_t* device = gc->device ? gc->device : L"COM1";
+	DWORD value = gc->baudRate;
+	RegSetValueEx(hKey, L"GPSDevice", 0, REG_SZ, (const BYTE*)device, (DWORD)((wcslen(device) + 1) * sizeof(wchar_t)));
+	RegSetValueEx(hKey, L"GPSBaudRate", 0, REG_DWORD, (const BYTE*)&value, sizeof(value));
+	value = gc->usePPS;
+	RegSetValueEx(hKey, L"GPSUsePPS", 0, REG_DWORD, (const BYTE*)&value, sizeof(value));
+
+	RegCloseKey(hKey);
+}
+
+void GetGPSConfig(GPSConfig* gc) {
+	HKEY hKey;
+
+	// Defaults. 9600 baud is what nearly every consumer receiver ships with.
+	gc->device = NULL;
+	gc->baudRate = 9600;
+	gc->usePPS = FALSE;
+
+	if (RegOpenKeyEx(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+		wchar_t device[MAX_PATH];
+		DWORD size = sizeof(device);
+		DWORD dwType = REG_SZ;
+		ZeroMemory(device, sizeof(device));
+
+		if (RegQueryValueEx(hKey, L"GPSDevice", NULL, &dwType, (LPBYTE)device, &size) == ERROR_SUCCESS && dwType == REG_SZ) {
+			device[MAX_PATH - 1] = L'\0';
+			gc->device = _wcsdup(device);
+		}
+
+		DWORD value = 0;
+		size = sizeof(value);
+		if (RegQueryValueEx(hKey, L"GPSBaudRate", NULL, NULL, (LPBYTE)&value, &size) == ERROR_SUCCESS && value != 0) {
+			gc->baudRate = value;
+		}
+
+		value = 0;
+		size = sizeof(value);
+		if (RegQueryValueEx(hKey, L"GPSUsePPS", NULL, NULL, (LPBYTE)&value, &size) == ERROR_SUCCESS) {
+			gc->usePPS = value;
+		}
+
+		RegCloseKey(hKey);
+	}
+
+	if (!gc->device) {
+		gc->device = _wcsdup(L"COM1");
+	}
+}
+
+DWORD GetNTPKeyID(void) {
+	HKEY hKey;
+	DWORD value = 0;
+	DWORD size = sizeof(value);
+
+	if (RegOpenKeyEx(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+		RegQueryValueEx(hKey, L"NTPKeyID", NULL, NULL, (LPBYTE)&value, &size);
+		RegCloseKey(hKey);
+	}
+
+	return value;
+}
+
+WCHAR* GetNTPKeyFile(void) {
+	HKEY hKey;
+	DWORD dwType = REG_SZ;
+	DWORD dwSize = 0;
+	WCHAR* value = NULL;
+
+	if (RegOpenKeyExW(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
+		return L"";
+	}
+
+	if (RegQueryValueExW(hKey, L"NTPKeyFile", NULL, &dwType, NULL, &dwSize) != ERROR_SUCCESS || dwType != REG_SZ) {
+		RegCloseKey(hKey);
+		return L"";
+	}
+
+	value = (WCHAR*)malloc(dwSize);
+	if (value == NULL) {
+		RegCloseKey(hKey);
+		return L"";
+	}
+
+	if (RegQueryValueExW(hKey, L"NTPKeyFile", NULL, NULL, (LPBYTE)value, &dwSize) != ERROR_SUCCESS) {
+		free(value);
+		RegCloseKey(hKey);
+		return L"";
+	}
+
+	RegCloseKey(hKey);
+	return value;
+}
+
+WCHAR* GetNTPMulticastGroup(void) {
+	HKEY hKey;
+	DWORD dwType = REG_SZ;
+	DWORD dwSize = 0;
+	WCHAR* value = NULL;
+
+	if (RegOpenKeyExW(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
+		return L"224.0.1.1"; // IANA assigned group for NTP
+	}
+
+	if (RegQueryValueExW(hKey, L"NTPMulticastGroup", NULL, &dwType, NULL, &dwSize) != ERROR_SUCCESS || dwType != REG_SZ) {
+		RegCloseKey(hKey);
+		return L"224.0.1.1";
+	}
+
+	value = (WCHAR*)malloc(dwSize);
+	if (value == NULL) {
+		RegCloseKey(hKey);
+		return L"224.0.1.1";
+	}
+
+	if (RegQueryValueExW(hKey, L"NTPMulticastGroup", NULL, NULL, (LPBYTE)value, &dwSize) != ERROR_SUCCESS) {
+		free(value);
+		RegCloseKey(hKey);
+		return L"224.0.1.1";
+	}
+
+	RegCloseKey(hKey);
+	return value;
+}
+
+WCHAR* GetHistoryFile(void) {
+	HKEY hKey;
+	DWORD dwType = REG_SZ;
+	DWORD dwSize = 0;
+	WCHAR* value = NULL;
+
+	if (RegOpenKeyExW(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
+		return L"$(LocalDir)\\history.bin";
+	}
+
+	if (RegQueryValueExW(hKey, L"HistoryFile", NULL, &dwType, NULL, &dwSize) != ERROR_SUCCESS || dwType != REG_SZ) {
+		RegCloseKey(hKey);
+		return L"$(LocalDir)\\history.bin";
+	}
+
+	value = (WCHAR*)malloc(dwSize);
+	if (value == NULL) {
+		RegCloseKey(hKey);
+		return L"$(LocalDir)\\history.bin";
+	}
+
+	if (RegQueryValueExW(hKey, L"HistoryFile", NULL, NULL, (LPBYTE)value, &dwSize) != ERROR_SUCCESS) {
+		free(value);
+		RegCloseKey(hKey);
+		return L"$(LocalDir)\\history.bin";
+	}
+
+	RegCloseKey(hKey);
+	return value;
+}
+
+DWORD GetRenderThreads(void) {
+	HKEY hKey;
+	DWORD value = 0;
+	DWORD size = sizeof(value);
+
+	if (RegOpenKeyEx(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+		RegQueryValueEx(hKey, L"RenderThreads", NULL, NULL, (LPBYTE)&value, &size);
+		RegCloseKey(hKey);
+	}
+
+	return value;
+}
+
+DWORD GetDVDSpeed(void) {
+	HKEY hKey;
+	DWORD value = 0;
+	DWORD size = sizeof(value);
+
+	if (RegOpenKeyEx(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+		RegQueryValueEx(hKey, L"DVDSpeed", NULL, NULL, (LPBYTE)&value, &size);
+		RegCloseKey(hKey);
+	}
+
+	return value;
+}
+
+DWORD GetDisplayStyle(void) {
+	HKEY hKey;
+	DWORD value = 0;
+	DWORD size = sizeof(value);
+
+	if (RegOpenKeyEx(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+		RegQueryValueEx(hKey, L"DisplayStyle", NULL, NULL, (LPBYTE)&value, &size);
+		RegCloseKey(hKey);
+	}
+
+	return value;
+}
+
+DWORD GetDigitTransition(void) {
+	HKEY hKey;
+	DWORD value = 0;
+	DWORD size = sizeof(value);
+
+	if (RegOpenKeyEx(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+		RegQueryValueEx(hKey, L"DigitTransition", NULL, NULL, (LPBYTE)&value, &size);
+		RegCloseKey(hKey);
+	}
+
+	return value;
+}
+
+void GetGradientOptions(Config* config) {
+	HKEY hKey;
+	DWORD size = sizeof(DWORD);
+
+	config->GradientAngle = 0;
+	config->GradientHueSpeed = 0;
+	config->GradientDither = FALSE;
+
+	if (RegOpenKeyEx(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+		RegQueryValueEx(hKey, L"GradientAngle", NULL, NULL, (LPBYTE)&config->GradientAngle, &size);
+		size = sizeof(DWORD);
+		RegQueryValueEx(hKey, L"GradientHueSpeed", NULL, NULL, (LPBYTE)&config->GradientHueSpeed, &size);
+		size = sizeof(DWORD);
+		RegQueryValueEx(hKey, L"GradientDither", NULL, NULL, (LPBYTE)&config->GradientDither, &size);
+		RegCloseKey(hKey);
+	}
+}
+
+void GetTextEffectOptions(Config* config) {
+	HKEY hKey;
+	DWORD size = sizeof(DWORD);
+
+	config->TextShadow = 0;
+	config->TextOutline = 0;
+	config->TextGlow = 0;
+
+	if (RegOpenKeyEx(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+		RegQueryValueEx(hKey, L"TextShadow", NULL, NULL, (LPBYTE)&config->TextShadow, &size);
+		size = sizeof(DWORD);
+		RegQueryValueEx(hKey, L"TextOutline", NULL, NULL, (LPBYTE)&config->TextOutline, &size);
+		size = sizeof(DWORD);
+		RegQueryValueEx(hKey, L"TextGlow", NULL, NULL, (LPBYTE)&config->TextGlow, &size);
+		RegCloseKey(hKey);
+	}
+}
+
+BOOL GetBackgroundImage(WCHAR* buffer, DWORD bufferSize) {
+	HKEY hKey;
+	DWORD dwType = REG_SZ;
+	WCHAR value[MAX_PATH];
+	DWORD dwSize = sizeof(value);
+
+	if (RegOpenKeyExW(HKEY_CURRENT_USER, g_szRegKey, 0, KEY_READ, &hKey) != ERROR_SUCCESS) {
+		return FALSE;
+	}
+
+	LONG result = RegQueryValueExW(hKey, L"BackgroundImage", NULL, &dwType, (LPBYTE)value, &dwSize);
+	RegCloseKey(hKey);
+	if (result != ERROR_SUCCESS || dwType != REG_SZ || dwSize < sizeof(WCHAR)) {
+		return FALSE;
+	}
+	value[min(dwSize / sizeof(WCHAR), MAX_PATH - 1)] = L'\0';
+	if (value[0] == L'\0') {
+		return FALSE;
+	}
+
+	// $(LocalDir) works the same as it does for the color file
+	buffer[0] = L'\0';
+	if (wcsncmp(value, L"$(LocalDir)\\", 12) == 0) {
+		if (!GetModuleFileNameW(NULL, buffer, bufferSize)) {
+			return FALSE;
+		}
+		PathRemoveFileSpecW(buffer);
+		if (wcslen(buffer) + wcslen(value + 11) >= bufferSize) {
+			return FALSE;
+		}
+		wcscat(buffer, value + 11);
+	}
+	else {
+		wcsncpy(buffer, value, bufferSize - 1);
+		buffer[bufferSize - 1] = L'\0';
+	}
+
+	return TRUE;
+}
+
 int GetMatchingTimeZone(int bias) {
 	// This code works despite me not thinking it would. 
 	// This is the line that used to be here: sizeof(g_szTimeZones) / sizeof(g_szTimeZones[0])
@@ -37,8 +37,20 @@ typedef struct __Config {
 	BOOL ConsoleEnabled;
 	BOOL TrayIconEnabled;
 	BOOL MenuEnabled;
+	DWORD GradientAngle; // Degrees clockwise, 0 runs from top to bottom
+	DWORD GradientHueSpeed; // Degrees per minute the gradient's hue drifts by, 0 to keep it still
+	BOOL GradientDither;
+	DWORD TextShadow; // Size of the text's drop shadow in percent of its height, 0 for none
+	DWORD TextOutline; // Width of the text's outline in percent of its height, 0 for none
+	DWORD TextGlow; // Size of the glow around the text in percent of its height, 0 for none
 } Config;
 
+// Identifiers for TimeConfig.ts. These match the order of the time source drop down in the settings window.
+#define _TIME_SOURCE_SYSTEM_	0
+#define _TIME_SOURCE_NTP_		1
+#define _TIME_SOURCE_GPS_		2
+#define _TIME_SOURCE_NTP_BROADCAST_	3
+
 // Time configuration structure
 // Stores data for the NTP client
 typedef struct __TimeConfig {
@@ -59,12 +71,20 @@ typedef struct __TimeConfigStorage {
 } TimeConfigStorage;
 #pragma pack(pop)
 
+// GPS receiver configuration. Used when TimeConfig.ts is _TIME_SOURCE_GPS_
+// Stored as separate registry values so the TimeConfig binary blob stays compatible with older versions.
+typedef struct __GPSConfig {
+	wchar_t* device; // 'COM3' for a serial receiver, or the path to a file/named pipe with raw NMEA
+	DWORD baudRate;
+	BOOL usePPS; // Align the top of each second to the PPS pulse on the DCD line
+} GPSConfig;
+
 // Function declarations
 void SaveConfiguration(BOOL, BOOL, BOOL, BOOL, BOOL, BOOL); // Gets the check state of the toggles and saves it to the registry keys. 
 BOOL GradientUsed(void); // Reads the UseGradient value in the registry key for the application. This function determines whether the red gradient background will be rendered. 
 BOOL DVDLogo(void); // Does the same as above, except it read the DVDLogoEffect value. Determines whether the text moves and bounces around the screen. 
 BOOL CustomColor(void); // Read the 'CustomColor' registry key to check whether the clock.col file should be parsed
-void ParseCustomColor(void); // Parses the 'clock.col' file. Outputs it's results to g_bgColor & g_GradientColor.
+void ParseCustomColor(void); // Parses the 'clock.col' file. Outputs it's results to g_bgColor, g_GradientColor & g_Gradient.
 int GetDisplayFormat(void); // Reads the display format from the registry
 void SaveDisplayFormat(void); // Writes the display format to the registry
 void RestartApplication(void); // Does exactly as the title implies and restarts the application
@@ -74,6 +94,19 @@ void SetColorFile(void); // Opens a file picker dialog and sets the picked file
 WCHAR* GetColorFile(void); // Returns the null-terminated string to the file path
 void SetTimeConfig(const TimeConfig*); // Sets the time configuration based off of the raw structure. Stores directly in bytes
 void GetTimeConfig(TimeConfig*); // Reads the registry value for TimeConfig and restores the binary structure
+void SetGPSConfig(const GPSConfig*); // Saves the GPS receiver settings to the registry
+void GetGPSConfig(GPSConfig*); // Reads the GPS receiver settings. Defaults to COM1 at 9600 baud without PPS
+DWORD GetNTPKeyID(void); // Returns the ID of the symmetric key used to authenticate NTP packets. 0 means authentication is off
+WCHAR* GetNTPKeyFile(void); // Returns the path of the ntp.keys style file the key is read from
+WCHAR* GetNTPMulticastGroup(void); // Returns the multicast group joined in broadcast mode. Defaults to 224.0.1.1, an empty string means broadcasts only
+WCHAR* GetHistoryFile(void); // Returns the path of the sync history log. Defaults to history.bin next to the executable, an empty string turns the log off
+DWORD GetRenderThreads(void); // Returns how many threads draw large frames, counting the UI thread. 0 (the default) means one per processor
+DWORD GetDVDSpeed(void); // Returns how fast the DVD logo moves in pixels per second. 0 (the default) means MOTION_DEFAULT_SPEED
+DWORD GetDisplayStyle(void); // Returns how the time is drawn, one of the SEGMENT_STYLE_ values or ANALOG_FACE_STYLE. 0 (the default) draws the digits with the font
+DWORD GetDigitTransition(void); // Returns how changing characters are animated, one of the DIGIT_TRANSITION_ values. 0 (the default) changes them in one step
+void GetGradientOptions(Config*); // Reads the gradient's angle, hue drift and dithering into the config. All default to 0
+void GetTextEffectOptions(Config*); // Reads the sizes of the text's shadow, outline and glow into the config. All default to 0
+BOOL GetBackgroundImage(WCHAR*, DWORD); // Copies the path of the background image into the buffer, with $(LocalDir) expanded. Returns FALSE if there is none
 int GetMatchingTimeZone(int); // Get's a time zone from the g_szTimeZones array based off of a number.
 void SetTimeZone(int); // Sets the time zone from an integer
 int GetTimeZone(void); // Returns the integer for the time zone
@@ -85,6 +118,7 @@ void CreateReg(void); // Create the registry key on first run. Fixes a bug where
 // Extern variables
 extern Config g_Config; // Global configuration structure
 extern TimeConfig g_TimeConfig; // Global time configuration structure
+extern GPSConfig g_GPSConfig; // Global GPS receiver configuration structure
 extern int g_nTimeZone; // Global identifier for the time zone
 
 #endif // !__CLOCK_CONFIG_H__
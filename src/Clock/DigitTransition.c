@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "DigitTransition.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Smoothstep, so the motion starts and stops gently
+static float Ease(float t) {
+	return t * t * (3.0f - 2.0f * t);
+}
+
+// Copies a row with its coverage scaled by level / 256, which darkens the flap as it turns away from the viewer.
+static void CopyRow(uint8_t* dst, const uint8_t* src, int width, int level) {
+	if (level >= 256) {
+		memcpy(dst, src, width);
+		return;
+	}
+	for (int x = 0; x < width; x++) {
+		dst[x] = (uint8_t)((src[x] * level) >> 8);
+	}
+}
+
+// One frame of a split flap, 't' of the way through. The top half of the old character folds down to the middle, squashed as it turns.
+// Once it's edge on, the bottom half of the new character unfolds from the middle down over the old bottom half. Behind the flap the new top half is already showing.
+static void BuildFlapFrame(uint8_t* out, const uint8_t* from, const uint8_t* to, int width, int height, float t) {
+	int middle = height / 2;
+	if (t < 0.5f) {
+		float p = t * 2.0f;
+		float squash = cosf(p * 1.5707963f);
+		int flapTop = middle - (int)(squash * middle + 0.5f);
+		int level = 256 - (int)(96.0f * p);
+		for (int y = 0; y < height; y++) {
+			uint8_t* row = out + (size_t)y * width;
+			if (y < flapTop) {
+				CopyRow(row, to + (size_t)y * width, width, 256);
+			}
+			else if (y < middle) {
+				int source = middle - (int)((middle - y) / squash);
+				CopyRow(row, from + (size_t)(source < 0 ? 0 : source) * width, width, level);
+			}
+			else {
+				CopyRow(row, from + (size_t)y * width, width, 256);
+			}
+		}
+		return;
+	}
+
+	float p = (t - 0.5f) * 2.0f;
+	float stretch = sinf(p * 1.5707963f);
+	int flapBottom = middle + (int)(stretch * (height - middle) + 0.5f);
+	int level = 160 + (int)(96.0f * p);
+	for (int y = 0; y < height; y++) {
+		uint8_t* row = out + (size_t)y * width;
+		if (y < middle) {
+			CopyRow(row, to + (size_t)y * width, width, 256);
+		}
+		else if (y < flapBottom) {
+			int source = middle + (int)((y - middle) / stretch);
+			CopyRow(row, to + (size_t)(source >= height ? height - 1 : source) * width, width, level);
+		}
+		else {
+			CopyRow(row, from + (size_t)y * width, width, 256);
+		}
+	}
+}
+
+// One frame of the old character sliding up and out with the new one right below it.
+static void BuildSlideFrame(uint8_t* out, const uint8_t* from, const uint8_t* to, int width, int height, float t) {
+	int offset = (int)(Ease(t) * height + 0.5f);
+	for (int y = 0; y < height; y++) {
+		int source = y + offset;
+		memcpy(out + (size_t)y * width, source < height ? from + (size_t)source * width : to + (size_t)(source - height) * width, width);
+	}
+}
+
+// Throws away the least recently used sequence nobody is playing. Returns 0 if every one is in use.
+static int EvictSequence(DigitTransitions* transitions) {
+	TransitionSequence* oldest = NULL;
+	for (int i = 0; i < DIGIT_TRANSITION_CACHE; i++) {
+		TransitionSequence* sequence = &transitions->cache[i];
+		if (sequence->frames && sequence->users == 0 && (!oldest || sequence->lastUsed < oldest->lastUsed)) {
+			oldest = sequence;
+		}
+	}
+	if (!oldest) return 0;
+
+	transitions->cacheBytes -= (size_t)DIGIT_TRANSITION_FRAMES * oldest->width * oldest->height;
+	free(oldest->frames);
+	memset(oldest, 0, sizeof(*oldest));
+	return 1;
+}
+
+// Finds the sequence for a pair of characters at a cell size, building it if it isn't cached. Returns NULL if there's no room for it.
+static TransitionSequence* GetSequence(DigitTransitions* transitions, wchar_t from, wchar_t to, int width, int height, CellCoverageProc proc, void* context) {
+	transitions->useCount++;
+	for (int i = 0; i < DIGIT_TRANSITION_CACHE; i++) {
+		TransitionSequence* sequence = &transitions->cache[i];
+		if (sequence->frames && sequence->from == from && sequence->to == to && sequence->width == width && sequence->height == height) {
+			sequence->lastUsed = transitions->useCount;
+			transitions->reused++;
+			return sequence;
+		}
+	}
+
+	size_t frameSize = (size_t)width * height;
+	size_t bytes = frameSize * DIGIT_TRANSITION_FRAMES;
+	if (bytes > DIGIT_TRANSITION_CACHE_BYTES) return NULL;
+	while (transitions->cacheBytes + bytes > DIGIT_TRANSITION_CACHE_BYTES) {
+		if (!EvictSequence(transitions)) return NULL;
+	}
+
+	TransitionSequence* slot = NULL;
+	while (!slot) {
+		for (int i = 0; i < DIGIT_TRANSITION_CACHE && !slot; i++) {
+			if (!transitions->cache[i].frames) slot = &transitions->cache[i];
+		}
+		if (!slot && !EvictSequence(transitions)) return NULL;
+	}
+
+	// Both characters' coverage is only needed while the frames are built
+	uint8_t* frames = (uint8_t*)malloc(bytes);
+	uint8_t* masks = (uint8_t*)calloc(2, frameSize);
+	if (!frames || !masks) {
+		free(frames);
+		free(masks);
+		return NULL;
+	}
+	proc(from, masks, width, height, context);
+	proc(to, masks + frameSize, width, height, context);
+
+	for (int i = 0; i < DIGIT_TRANSITION_FRAMES; i++) {
+		float t = (float)(i + 1) / DIGIT_TRANSITION_FRAMES;
+		if (transitions->style == DIGIT_TRANSITION_SLIDE) {
+			BuildSlideFrame(frames + frameSize * i, masks, masks + frameSize, width, height, t);
+		}
+		else {
+			BuildFlapFrame(frames + frameSize * i, masks, masks + frameSize, width, height, t);
+		}
+	}
+	free(masks);
+
+	slot->from = from;
+	slot->to = to;
+	slot->width = width;
+	slot->height = height;
+	slot->frames = frames;
+	slot->lastUsed = transitions->useCount;
+	slot->users = 0;
+	transitions->cacheBytes += bytes;
+	transitions->built++;
+	return slot;
+}
+
+void InitDigitTransitions(DigitTransitions* transitions, int style) {
+	memset(transitions, 0, sizeof(*transitions));
+	transitions->style = style;
+}
+
+void FreeDigitTransitions(DigitTransitions* transitions) {
+	int style = transitions->style;
+	for (int i = 0; i < DIGIT_TRANSITION_CACHE; i++) {
+		free(transitions->cache[i].frames);
+	}
+	InitDigitTransitions(transitions, style);
+}
+
+void CancelDigitTransitions(DigitTransitions* transitions) {
+	for (int i = 0; i < transitions->cellCount; i++) {
+		transitions->cells[i].sequence->users--;
+	}
+	transitions->cellCount = 0;
+}
+
+int StartDigitTransition(DigitTransitions* transitions, int index, wchar_t from, wchar_t to, int x, int width, int height, double now, CellCoverageProc proc, void* context) {
+	if (transitions->style == DIGIT_TRANSITION_NONE || width <= 0 || height <= 0) return 0;
+
+	// A position that changes again before its animation finished starts over, from the character the old animation was heading to
+	for (int i = 0; i < transitions->cellCount; i++) {
+		if (transitions->cells[i].index == index) {
+			transitions->cells[i].sequence->users--;
+			transitions->cells[i] = transitions->cells[--transitions->cellCount];
+			break;
+		}
+	}
+	if (transitions->cellCount == DIGIT_TRANSITION_MAX_CELLS) return 0;
+
+	TransitionSequence* sequence = GetSequence(transitions, from, to, width, height, proc, context);
+	if (!sequence) return 0;
+
+	DigitCell* cell = &transitions->cells[transitions->cellCount++];
+	cell->index = index;
+	cell->x = x;
+	cell->width = width;
+	cell->height = height;
+	cell->sequence = sequence;
+	cell->start = now;
+	cell->frame = 0;
+	sequence->users++;
+	return 1;
+}
+
+int UpdateDigitTransitions(DigitTransitions* transitions, double now, FramebufferRect* dirty, int maxDirty) {
+	int count = 0;
+	for (int i = 0; i < transitions->cellCount; ) {
+		DigitCell* cell = &transitions->cells[i];
+		int frame = (int)((now - cell->start) / DIGIT_TRANSITION_SECONDS * DIGIT_TRANSITION_FRAMES);
+		if (frame < 0) frame = 0;
+
+		int finished = frame >= DIGIT_TRANSITION_FRAMES;
+		if ((finished || frame != cell->frame) && count < maxDirty) {
+			FramebufferRect rect = { cell->x, 0, cell->x + cell->width, cell->height };
+			dirty[count++] = rect;
+		}
+
+		if (finished) {
+			// The last frame is the new character, so handing the cell back to the text doesn't change a pixel
+			cell->sequence->users--;
+			*cell = transitions->cells[--transitions->cellCount];
+			continue;
+		}
+		cell->frame = frame;
+		i++;
+	}
+	return count;
+}
+
+int IsDigitAnimating(const DigitTransitions* transitions, int index) {
+	for (int i = 0; i < transitions->cellCount; i++) {
+		if (transitions->cells[i].index == index) return 1;
+	}
+	return 0;
+}
+
+void DrawDigitTransitions(const DigitTransitions* transitions, Framebuffer* fb, int x, int y, uint32_t color, const FramebufferRect* clip) {
+	for (int i = 0; i < transitions->cellCount; i++) {
+		const DigitCell* cell = &transitions->cells[i];
+		const uint8_t* frame = cell->sequence->frames + (size_t)cell->frame * cell->width * cell->height;
+		FramebufferBlendMask(fb, x + cell->x, y, frame, cell->width, cell->width, cell->height, color, clip);
+	}
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_DIGIT_TRANSITION_H__
+#define __CLOCK_DIGIT_TRANSITION_H__
+
+// Split-flap and slide animations for characters that change, drawn over only the changed characters' cells.
+// Each animation is a short sequence of coverage masks built from the old and new character's coverage. Sequences are cached by character pair and cell size,
+// so once each digit has rolled over once, animating it is one masked blend per frame.
+
+#include <stddef.h>
+#include <wchar.h>
+
+#include "Framebuffer.h"
+
+#define DIGIT_TRANSITION_NONE	0 // Characters change in one step
+#define DIGIT_TRANSITION_FLAP	1 // The top half of the old character folds down over its bottom half, showing the new one
+#define DIGIT_TRANSITION_SLIDE	2 // The old character slides up and out as the new one slides in from below
+
+#define DIGIT_TRANSITION_FRAMES 12 // Masks in each sequence, the last one being the new character
+#define DIGIT_TRANSITION_SECONDS 0.25 // How long an animation takes. At 60 frames per second that shows most of the frames
+#define DIGIT_TRANSITION_CACHE 24 // Sequences kept. A clock with seconds uses about 20 pairs
+#define DIGIT_TRANSITION_CACHE_BYTES (32 * 1024 * 1024) // Sequences past this are thrown away, oldest first, so a full-screen 4K clock can't use too much memory
+#define DIGIT_TRANSITION_MAX_CELLS 24 // Characters animating at once. Any more simply change in one step
+
+typedef void (*CellCoverageProc)(wchar_t, uint8_t*, int, int, void*); // Draws one character's coverage into a cleared mask. Takes the character, the mask, its width and height, and the context given to StartDigitTransition
+
+typedef struct __TransitionSequence {
+	wchar_t from;
+	wchar_t to;
+	int width;
+	int height;
+	uint8_t* frames; // DIGIT_TRANSITION_FRAMES masks of width x height, one after another. NULL for an empty slot
+	unsigned long lastUsed;
+	int users; // Cells playing the sequence. It isn't thrown away while any are
+} TransitionSequence;
+
+// A character position being animated. Positions are relative to the top left of the text
+typedef struct __DigitCell {
+	int index;
+	int x;
+	int width;
+	int height;
+	TransitionSequence* sequence;
+	double start; // Seconds, on whatever clock is passed to the other functions
+	int frame; // Frame being shown
+} DigitCell;
+
+typedef struct __DigitTransitions {
+	int style;
+	TransitionSequence cache[DIGIT_TRANSITION_CACHE];
+	size_t cacheBytes;
+	unsigned long useCount;
+	DigitCell cells[DIGIT_TRANSITION_MAX_CELLS];
+	int cellCount;
+	long built; // Sequences built, and how many times a cached one was played instead
+	long reused;
+} DigitTransitions;
+
+void InitDigitTransitions(DigitTransitions*, int); // Empties the cache and sets the animation, one of the DIGIT_TRANSITION_ values
+void FreeDigitTransitions(DigitTransitions*); // Stops every animation and releases the cached sequences
+void CancelDigitTransitions(DigitTransitions*); // Stops every animation, e.g. when the text moves to a new size. The cache is kept
+int StartDigitTransition(DigitTransitions*, int, wchar_t, wchar_t, int, int, int, double, CellCoverageProc, void*); // Starts animating a character position from one character to another. Takes the index, both characters, the cell's left edge, width and height, the time now, and the coverage proc with its context. Returns 0 if it should just change in one step
+int UpdateDigitTransitions(DigitTransitions*, double, FramebufferRect*, int); // Moves each animation to the frame for the time now and ends finished ones. Fills in the cells that need redrawing, relative to the text, and returns how many
+int IsDigitAnimating(const DigitTransitions*, int); // Returns whether a character position is being drawn by an animation
+void DrawDigitTransitions(const DigitTransitions*, Framebuffer*, int, int, uint32_t, const FramebufferRect*); // Blends the current frame of every animation. Takes the text's top left, the color and an optional clip rectangle
+
+#endif // !__CLOCK_DIGIT_TRANSITION_H__
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "DisplayModel.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// The text used to go through the static control with SetWindowTextW and come back out with GetWindowTextW every frame.
+// Now the formatter writes it here and the renderer reads it directly. Only the string compare below runs every frame. Measuring and laying out only happen when the generation moves.
+
+void InitDisplayModel(DisplayModel* model) {
+	memset(model, 0, sizeof(*model));
+	model->changedLast = -1;
+}
+
+int SetDisplayText(DisplayModel* model, const wchar_t* text) {
+	int length = (int)wcslen(text);
+	if (length > DISPLAY_TEXT_LENGTH - 1) length = DISPLAY_TEXT_LENGTH - 1;
+
+	if (length == model->length && wmemcmp(text, model->text, length) == 0) {
+		return 0;
+	}
+
+	if (length == model->length) {
+		int first = 0, last = length - 1;
+		while (text[first] == model->text[first]) first++;
+		while (text[last] == model->text[last]) last--;
+		model->changedFirst = first;
+		model->changedLast = last;
+	}
+	else {
+		model->changedFirst = 0;
+		model->changedLast = length - 1;
+	}
+
+	model->generation++;
+	wmemcpy(model->previousText, model->text, model->length + 1);
+	model->previousLength = model->length;
+	wmemcpy(model->text, text, length);
+	model->text[length] = L'\0';
+	model->length = length;
+
+	// Split at spaces, only touching the segments whose text actually changed
+	int count = 0;
+	for (int i = 0; i < length && count < DISPLAY_MAX_SEGMENTS; ) {
+		while (i < length && text[i] == L' ') i++;
+		if (i >= length) break;
+
+		int start = i;
+		while (i < length && text[i] != L' ') i++;
+		int segmentLength = i - start;
+		if (segmentLength > DISPLAY_SEGMENT_LENGTH - 1) segmentLength = DISPLAY_SEGMENT_LENGTH - 1;
+
+		DisplaySegment* segment = &model->segments[count++];
+		if (count > model->segmentCount || segment->length != segmentLength || segment->start != start || wmemcmp(segment->text, text + start, segmentLength) != 0) {
+			wmemcpy(segment->text, text + start, segmentLength);
+			segment->text[segmentLength] = L'\0';
+			segment->length = segmentLength;
+			segment->start = start;
+			segment->generation = model->generation;
+		}
+	}
+	model->segmentCount = count;
+
+	return 1;
+}
+
+int SetDisplayLayout(DisplayModel* model, int x, int y, int width, int height) {
+	DisplayLayout* layout = &model->layout;
+	if (layout->x == x && layout->y == y && layout->width == width && layout->height == height) {
+		return 0;
+	}
+
+	layout->x = x;
+	layout->y = y;
+	layout->width = width;
+	layout->height = height;
+	layout->generation++;
+	return 1;
+}
+
+const DisplaySegment* FindDisplaySegment(const DisplayModel* model, int index) {
+	for (int i = 0; i < model->segmentCount; i++) {
+		const DisplaySegment* segment = &model->segments[i];
+		if (index >= segment->start && index < segment->start + segment->length) {
+			return segment;
+		}
+	}
+	return NULL;
+}
+
+void FormatDisplayTime(wchar_t* buffer, size_t bufferSize, int format, int year, int month, int day, int hour, int minute, int second) {
+	if (!buffer || bufferSize == 0) return;
+
+	int hour12 = hour % 12;
+	if (hour12 == 0) hour12 = 12; // Convert 0 to 12 for AM/PM format
+	const wchar_t* ampm = hour < 12 ? L"AM" : L"PM";
+
+	switch (format) {
+	case _SHOW_DATE_24_HOUR_FORMAT_:
+		swprintf(buffer, bufferSize, L"%04d-%02d-%02d %02d:%02d:%02d", year, month, day, hour, minute, second);
+		break;
+	case _SHOW_DATE_12_HOUR_FORMAT_:
+		swprintf(buffer, bufferSize, L"%04d-%02d-%02d %02d:%02d:%02d %ls", year, month, day, hour12, minute, second, ampm);
+		break;
+	case _HIDE_DATE_24_HOUR_FORMAT_:
+		swprintf(buffer, bufferSize, L"%02d:%02d:%02d", hour, minute, second);
+		break;
+	case _HIDE_DATE_12_HOUR_FORMAT_:
+		swprintf(buffer, bufferSize, L"%02d:%02d:%02d %ls", hour12, minute, second, ampm);
+		break;
+	default:
+		buffer[0] = L'\0'; // Empty buffer in case of error
+		break;
+	}
+}
+
+int GetDisplayFormatSamples(int format, const wchar_t** samples) {
+	switch (format) {
+	case _HIDE_DATE_24_HOUR_FORMAT_:
+		samples[0] = L"00:00:00";
+		return 1;
+	case _SHOW_DATE_12_HOUR_FORMAT_:
+		samples[0] = L"0000-00-00 00:00:00 AM";
+		samples[1] = L"0000-00-00 00:00:00 PM";
+		return 2;
+	case _HIDE_DATE_12_HOUR_FORMAT_:
+		samples[0] = L"00:00:00 AM";
+		samples[1] = L"00:00:00 PM";
+		return 2;
+	default:
+		samples[0] = L"0000-00-00 00:00:00";
+		return 1;
+	}
+}
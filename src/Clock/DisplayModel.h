@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_DISPLAY_MODEL_H__
+#define __CLOCK_DISPLAY_MODEL_H__
+
+// What the clock shows, split into segments (date, time, AM/PM), with change counters so the renderer can skip frames where nothing changed.
+
+#include <stddef.h>
+#include <wchar.h>
+
+#define DISPLAY_MAX_SEGMENTS	4
+#define DISPLAY_SEGMENT_LENGTH	16
+#define DISPLAY_TEXT_LENGTH		64
+
+// Display formats, as stored in the DisplayFormat registry value
+#define _SHOW_DATE_24_HOUR_FORMAT_	0
+#define _HIDE_DATE_24_HOUR_FORMAT_	1
+#define _SHOW_DATE_12_HOUR_FORMAT_	2
+#define _HIDE_DATE_12_HOUR_FORMAT_	3
+
+typedef struct __DisplaySegment {
+	wchar_t text[DISPLAY_SEGMENT_LENGTH];
+	int length;
+	int start; // Index of the segment's first character in the full text
+	unsigned long generation; // Model generation when the segment last changed
+} DisplaySegment;
+
+// Where the renderer put the text. Kept with the model so the text only has to be measured when it changes.
+typedef struct __DisplayLayout {
+	int x; // Top left of the text
+	int y;
+	int width;
+	int height;
+	unsigned long generation; // Bumped whenever any of the above changes
+} DisplayLayout;
+
+typedef struct __DisplayModel {
+	DisplaySegment segments[DISPLAY_MAX_SEGMENTS];
+	int segmentCount;
+	wchar_t text[DISPLAY_TEXT_LENGTH]; // The segments joined by single spaces
+	int length;
+	unsigned long generation; // Bumped whenever the text changes
+	int changedFirst; // Range of characters that differ from the previous text, inclusive. The whole text if the length changed
+	int changedLast;
+	wchar_t previousText[DISPLAY_TEXT_LENGTH]; // The text before the last change, so the characters in the changed range can be animated from what they were
+	int previousLength;
+	DisplayLayout layout;
+} DisplayModel;
+
+void InitDisplayModel(DisplayModel*); // Empties the model. The next text set counts as a complete change
+int SetDisplayText(DisplayModel*, const wchar_t*); // Splits the text into segments at spaces. Returns 1 and bumps the generation if it differs from the current text
+int SetDisplayLayout(DisplayModel*, int, int, int, int); // Stores the position and size of the text. Returns 1 and bumps the layout generation if they changed
+const DisplaySegment* FindDisplaySegment(const DisplayModel*, int); // Returns the segment a character index falls in, or NULL for the spaces between them
+void FormatDisplayTime(wchar_t*, size_t, int, int, int, int, int, int, int); // Writes a time in a display format. Takes the buffer and its size in characters, the format, then the year, month, day, hour (0 to 23), minute and second
+int GetDisplayFormatSamples(int, const wchar_t**); // Points up to two samples at the widest strings a format can produce, with '0' standing for any digit. Returns how many
+
+#endif // !__CLOCK_DISPLAY_MODEL_H__
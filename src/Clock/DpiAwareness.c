@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "DpiAwareness.h"
+#include "Colors.h"
+
+// Per-monitor DPI came in pieces over several versions of Windows, and none of it exists on XP. Every function is looked up by hand,
+// newest first, and where none is found the clock runs at the system DPI as before.
+
+typedef BOOL(WINAPI* SetProcessDpiAwarenessContextProc)(HANDLE);
+typedef HRESULT(WINAPI* SetProcessDpiAwarenessProc)(int);
+typedef BOOL(WINAPI* SetProcessDPIAwareProc)(void);
+typedef UINT(WINAPI* GetDpiForWindowProc)(HWND);
+typedef HRESULT(WINAPI* GetDpiForMonitorProc)(HMONITOR, int, UINT*, UINT*);
+
+#define DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2_ ((HANDLE)-4) // Windows 10 1703. Also scales the title bar and menu
+#define PROCESS_PER_MONITOR_DPI_AWARE_ 2 // Windows 8.1
+#define MDT_EFFECTIVE_DPI_ 0
+
+static HMODULE hShcore; // Kept loaded for GetDpiForMonitor
+static GetDpiForWindowProc pGetDpiForWindow;
+static GetDpiForMonitorProc pGetDpiForMonitor;
+static DpiScaleCache dialogFonts;
+
+static void* CreateDialogFont(int dpi, void* context) {
+	UNREFERENCED_PARAMETER(context);
+	return CreateFont(ScaleForDpi(16, dpi), 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH, g_szMainFont);
+}
+
+static void DeleteDialogFont(void* hFont, void* context) {
+	UNREFERENCED_PARAMETER(context);
+	DeleteObject((HFONT)hFont);
+}
+
+void EnableDpiAwareness(void) {
+	HMODULE hUser32 = GetModuleHandleW(L"user32.dll");
+	hShcore = LoadLibraryW(L"shcore.dll");
+	pGetDpiForWindow = (GetDpiForWindowProc)GetProcAddress(hUser32, "GetDpiForWindow");
+	pGetDpiForMonitor = hShcore ? (GetDpiForMonitorProc)GetProcAddress(hShcore, "GetDpiForMonitor") : NULL;
+
+	SetProcessDpiAwarenessContextProc SetContext = (SetProcessDpiAwarenessContextProc)GetProcAddress(hUser32, "SetProcessDpiAwarenessContext");
+	if (SetContext && SetContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2_)) {
+		wprintf(L"Per-monitor DPI awareness (v2) enabled.\r\n");
+		return;
+	}
+
+	SetProcessDpiAwarenessProc SetAwareness = hShcore ? (SetProcessDpiAwarenessProc)GetProcAddress(hShcore, "SetProcessDpiAwareness") : NULL;
+	if (SetAwareness && SUCCEEDED(SetAwareness(PROCESS_PER_MONITOR_DPI_AWARE_))) {
+		wprintf(L"Per-monitor DPI awareness enabled.\r\n");
+		return;
+	}
+
+	// Vista and 7 only know one DPI for the whole desktop, which is still better than being stretched
+	SetProcessDPIAwareProc SetAware = (SetProcessDPIAwareProc)GetProcAddress(hUser32, "SetProcessDPIAware");
+	if (SetAware && SetAware()) {
+		wprintf(L"System DPI awareness enabled.\r\n");
+		return;
+	}
+
+	yellow();
+	wprintf(L"DPI awareness is unavailable, so the clock is drawn at %d DPI everywhere.\r\n", GetSystemDpi());
+	reset();
+}
+
+int GetSystemDpi(void) {
+	HDC hdc = GetDC(NULL);
+	int dpi = hdc ? GetDeviceCaps(hdc, LOGPIXELSX) : DPI_DEFAULT;
+	if (hdc) {
+		ReleaseDC(NULL, hdc);
+	}
+	return NormalizeDpi(dpi);
+}
+
+int GetWindowDpi(HWND hwnd) {
+	if (pGetDpiForWindow) {
+		UINT dpi = pGetDpiForWindow(hwnd);
+		if (dpi) return (int)dpi;
+	}
+
+	UINT dpiX, dpiY;
+	if (pGetDpiForMonitor && SUCCEEDED(pGetDpiForMonitor(MonitorFromWindow(hwnd, MONITOR_DEFAULTTONEAREST), MDT_EFFECTIVE_DPI_, &dpiX, &dpiY))) {
+		return (int)dpiX;
+	}
+	return GetSystemDpi();
+}
+
+void ApplyDpiChange(HWND hwnd, LPARAM lParam) {
+	const RECT* suggested = (const RECT*)lParam;
+	SetWindowPos(hwnd, NULL, suggested->left, suggested->top, suggested->right - suggested->left, suggested->bottom - suggested->top, SWP_NOZORDER | SWP_NOACTIVATE);
+}
+
+HFONT GetDialogFont(int dpi) {
+	if (!dialogFonts.build) {
+		InitDpiScaleCache(&dialogFonts, CreateDialogFont, DeleteDialogFont, NULL);
+	}
+	return (HFONT)GetDpiScaleResources(&dialogFonts, dpi);
+}
+
+void FreeDialogFonts(void) {
+	if (dialogFonts.build) {
+		FreeDpiScaleCache(&dialogFonts);
+	}
+}
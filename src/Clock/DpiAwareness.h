@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_DPI_AWARENESS_H__
+#define __CLOCK_DPI_AWARENESS_H__
+
+#include "Clock.h"
+#include "DpiScale.h"
+
+#define WM_DPICHANGED_ 0x02E0 // WM_DPICHANGED from the Windows 8.1 SDK
+
+void EnableDpiAwareness(void); // Tells Windows the clock scales itself for each monitor, with whichever API this version has, so it's never stretched as a bitmap. Call before creating any window
+int GetSystemDpi(void); // DPI of the primary monitor. Windows before 8.1 reports this for every monitor
+int GetWindowDpi(HWND); // DPI of the monitor a window is on
+void ApplyDpiChange(HWND, LPARAM); // Moves and sizes a window to the rectangle Windows suggests in WM_DPICHANGED
+HFONT GetDialogFont(int); // The settings and about windows' font at a DPI. Each scale's is created once and kept, so dragging a window between monitors doesn't create one per move. UI thread only
+void FreeDialogFonts(void); // Deletes every dialog font. No window may still be using one
+
+#endif // !__CLOCK_DPI_AWARENESS_H__
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "DpiScale.h"
+
+#include <string.h>
+
+int NormalizeDpi(int dpi) {
+	return dpi > 0 ? dpi : DPI_DEFAULT;
+}
+
+int ScaleForDpi(int value, int dpi) {
+	// Same rounding as MulDiv, so sizes match what Windows computes for the window frame
+	long long scaled = (long long)value * NormalizeDpi(dpi);
+	return (int)(scaled >= 0 ? (scaled + DPI_DEFAULT / 2) / DPI_DEFAULT : (scaled - DPI_DEFAULT / 2) / DPI_DEFAULT);
+}
+
+void InitDpiScaleCache(DpiScaleCache* cache, DpiBuildProc build, DpiFreeProc release, void* context) {
+	memset(cache, 0, sizeof(*cache));
+	cache->build = build;
+	cache->free = release;
+	cache->context = context;
+}
+
+void* GetDpiScaleResources(DpiScaleCache* cache, int dpi) {
+	dpi = NormalizeDpi(dpi);
+	cache->useCount++;
+
+	DpiScaleSlot* slot = NULL;
+	for (int i = 0; i < DPI_SCALE_SLOTS; i++) {
+		if (cache->slots[i].dpi == dpi) {
+			cache->slots[i].lastUsed = cache->useCount;
+			cache->reused++;
+			return cache->slots[i].resources;
+		}
+
+		// An empty slot if there is one, otherwise the one used longest ago
+		if (!slot || (slot->dpi && (!cache->slots[i].dpi || cache->slots[i].lastUsed < slot->lastUsed))) {
+			slot = &cache->slots[i];
+		}
+	}
+
+	void* resources = cache->build(dpi, cache->context);
+	if (!resources) return NULL;
+
+	if (slot->dpi) {
+		cache->free(slot->resources, cache->context);
+		cache->evicted++;
+	}
+	slot->dpi = dpi;
+	slot->resources = resources;
+	slot->lastUsed = cache->useCount;
+	cache->built++;
+	return resources;
+}
+
+void FreeDpiScaleCache(DpiScaleCache* cache) {
+	for (int i = 0; i < DPI_SCALE_SLOTS; i++) {
+		if (cache->slots[i].dpi) {
+			cache->free(cache->slots[i].resources, cache->context);
+		}
+	}
+	InitDpiScaleCache(cache, cache->build, cache->free, cache->context);
+}
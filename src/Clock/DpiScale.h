@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_DPI_SCALE_H__
+#define __CLOCK_DPI_SCALE_H__
+
+// Sizes for the DPI of the monitor a window is on, and a cache of whatever has to be built separately for each scale.
+// On a desk with monitors at different scales, the clock gets its own set of resources for each one it has been on. Moving back to a monitor picks its
+// set up again instead of rasterizing everything anew. Only the least recently used scale is thrown away, and only when more scales than DPI_SCALE_SLOTS are in use.
+
+#define DPI_DEFAULT 96 // The DPI every size in the code was picked for, 100% in the display settings
+#define DPI_SCALE_SLOTS 4 // Scales whose resources are kept at once
+
+typedef void* (*DpiBuildProc)(int, void*); // Builds the resources for a DPI. Takes the DPI and the cache's context. Returns NULL if they couldn't be built
+typedef void (*DpiFreeProc)(void*, void*); // Releases resources the build proc returned. Takes them and the cache's context
+
+typedef struct __DpiScaleSlot {
+	int dpi; // 0 for an empty slot
+	void* resources;
+	unsigned long lastUsed;
+} DpiScaleSlot;
+
+typedef struct __DpiScaleCache {
+	DpiScaleSlot slots[DPI_SCALE_SLOTS];
+	DpiBuildProc build;
+	DpiFreeProc free;
+	void* context;
+	unsigned long useCount;
+	long built; // Scales built, how many times a kept one was picked up again, and how many were thrown away to make room
+	long reused;
+	long evicted;
+} DpiScaleCache;
+
+int ScaleForDpi(int, int); // Scales a size in 96 DPI pixels to a DPI, rounded to the nearest pixel. A DPI of 0 or less counts as 96
+int NormalizeDpi(int); // Returns the DPI, or 96 if it's 0 or less, as Windows versions without per-monitor DPI report
+void InitDpiScaleCache(DpiScaleCache*, DpiBuildProc, DpiFreeProc, void*); // Empties the cache and sets how resources are built and released, with the context passed to both
+void* GetDpiScaleResources(DpiScaleCache*, int); // Returns the resources for a DPI, building them if they aren't kept. The pointer stays valid until DPI_SCALE_SLOTS other scales have been asked for since. Returns NULL if they couldn't be built
+void FreeDpiScaleCache(DpiScaleCache*); // Releases every scale's resources
+
+#endif // !__CLOCK_DPI_SCALE_H__
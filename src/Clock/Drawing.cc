@@ -16,85 +16,340 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+
 #include "Drawing.h"
+#include "Colors.h"
 #include <GdiPlus.h>
 
 using namespace Gdiplus;
 
+// DrawImage used to start GDI+, copy the resource into a new stream, decode the PNG and throw it all away on every WM_PAINT of the about window.
+// GDI+ is now started once for the process, and each image is decoded and scaled to the size it's drawn at once. Drawing it is a single AlphaBlend.
+// The background image works the same way, except it comes from a file and is kept decoded, so a resize only has to scale it again.
+
 static ULONG_PTR gdiplusToken;
+static BOOL isStarted = FALSE;
 
-void DrawImage(HDC hdc, int x, int y, int width, int height, int resourceId) {
-	HRSRC hResInfo;
-	HGLOBAL hResData;
-	void* pResData;
+static CRITICAL_SECTION cacheLock; // The cache can be used from the render thread as well as the UI thread
+static CachedImage cache[IMAGE_CACHE_SIZE];
+static DWORD lastUsed[IMAGE_CACHE_SIZE];
+static DWORD useCount = 0;
+
+static Gdiplus::Bitmap* fileSource; // The decoded image file, NULL if it couldn't be read
+static WCHAR fileSourcePath[MAX_PATH]; // Path fileSource was decoded from. A file that failed isn't tried again until the path changes
+static CachedImage fileImage; // fileSource scaled to the size it was last asked for
+
+BOOL StartupGDIPlus(void) {
+	if (isStarted) {
+		return TRUE;
+	}
 
-	// Initialize GDI+
 	GdiplusStartupInput gpsi;
-	GdiplusStartup(&gdiplusToken, &gpsi, NULL);
+	if (GdiplusStartup(&gdiplusToken, &gpsi, NULL) != Ok) {
+		red();
+		wprintf(L"Failed to start GDI+. Images won't be drawn.\r\n");
+		reset();
+		return FALSE;
+	}
 
-	// Load the resource data
-	hResInfo = FindResource(NULL, MAKEINTRESOURCE(resourceId), RT_RCDATA);
-	if (!hResInfo) {
-		MessageBox(NULL, L"Failed to find resource.", L"Error", MB_OK | MB_ICONERROR);
-		GdiplusShutdown(gdiplusToken);
-		return;
+	InitializeCriticalSection(&cacheLock);
+	isStarted = TRUE;
+	return TRUE;
+}
+
+static void FreeCachedImage(CachedImage* image) {
+	if (image->hBitmap) {
+		DeleteObject(image->hBitmap);
 	}
+	ZeroMemory(image, sizeof(*image));
+}
 
-	hResData = LoadResource(NULL, hResInfo);
-	if (!hResData) {
-		MessageBox(NULL, L"Failed to load resource.", L"Error", MB_OK | MB_ICONERROR);
-		GdiplusShutdown(gdiplusToken);
+void ShutdownGDIPlus(void) {
+	if (!isStarted) {
 		return;
 	}
 
-	pResData = LockResource(hResData);
+	for (int i = 0; i < IMAGE_CACHE_SIZE; i++) {
+		FreeCachedImage(&cache[i]);
+	}
+	FreeCachedImage(&fileImage);
+	delete fileSource;
+	fileSource = NULL;
+	fileSourcePath[0] = L'\0';
+	DeleteCriticalSection(&cacheLock);
+	GdiplusShutdown(gdiplusToken);
+	isStarted = FALSE;
+}
+
+// A read-only stream over memory that someone else owns, so GDI+ can decode straight from a resource or a mapped file.
+// CreateStreamOnHGlobal needs its own copy of the data, and SHCreateMemStream makes one as well.
+class MemoryStream : public IStream {
+public:
+	MemoryStream(const void* data, ULONG size) : refs(1), data((const BYTE*)data), size(size), position(0) {}
+
+	// IUnknown
+	STDMETHODIMP QueryInterface(REFIID riid, void** ppv) {
+		if (riid == IID_IUnknown || riid == IID_IStream || riid == IID_ISequentialStream) {
+			*ppv = static_cast<IStream*>(this);
+			AddRef();
+			return S_OK;
+		}
+		*ppv = NULL;
+		return E_NOINTERFACE;
+	}
+	STDMETHODIMP_(ULONG) AddRef() { return InterlockedIncrement(&refs); }
+	STDMETHODIMP_(ULONG) Release() {
+		LONG count = InterlockedDecrement(&refs);
+		if (count == 0) delete this;
+		return count;
+	}
+
+	// ISequentialStream
+	STDMETHODIMP Read(void* pv, ULONG cb, ULONG* pcbRead) {
+		ULONGLONG remaining = position < size ? size - position : 0;
+		ULONG count = (ULONG)min((ULONGLONG)cb, remaining);
+		memcpy(pv, data + position, count);
+		position += count;
+		if (pcbRead) *pcbRead = count;
+		return count == cb ? S_OK : S_FALSE;
+	}
+	STDMETHODIMP Write(const void*, ULONG, ULONG*) { return STG_E_ACCESSDENIED; }
+
+	// IStream
+	STDMETHODIMP Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) {
+		LONGLONG base = origin == STREAM_SEEK_SET ? 0 : origin == STREAM_SEEK_CUR ? (LONGLONG)position : origin == STREAM_SEEK_END ? (LONGLONG)size : -1;
+		if (base < 0 || base + move.QuadPart < 0) {
+			return STG_E_INVALIDFUNCTION;
+		}
+		position = (ULONGLONG)(base + move.QuadPart);
+		if (newPosition) newPosition->QuadPart = position;
+		return S_OK;
+	}
+	STDMETHODIMP SetSize(ULARGE_INTEGER) { return STG_E_ACCESSDENIED; }
+	STDMETHODIMP CopyTo(IStream*, ULARGE_INTEGER, ULARGE_INTEGER*, ULARGE_INTEGER*) { return E_NOTIMPL; }
+	STDMETHODIMP Commit(DWORD) { return S_OK; }
+	STDMETHODIMP Revert() { return S_OK; }
+	STDMETHODIMP LockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) { return STG_E_INVALIDFUNCTION; }
+	STDMETHODIMP UnlockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) { return STG_E_INVALIDFUNCTION; }
+	STDMETHODIMP Stat(STATSTG* stat, DWORD) {
+		ZeroMemory(stat, sizeof(*stat));
+		stat->type = STGTY_STREAM;
+		stat->cbSize.QuadPart = size;
+		stat->grfMode = STGM_READ;
+		return S_OK;
+	}
+	STDMETHODIMP Clone(IStream**) { return E_NOTIMPL; }
+
+private:
+	volatile LONG refs;
+	const BYTE* data;
+	ULONGLONG size;
+	ULONGLONG position; // May be past the end after a seek, in which case reads return nothing
+};
+
+// Decodes a PNG from the RCDATA resources. The caller deletes the bitmap.
+static Gdiplus::Bitmap* DecodeResource(int resourceId) {
+	HRSRC hResInfo = FindResource(NULL, MAKEINTRESOURCE(resourceId), RT_RCDATA);
+	HGLOBAL hResData = hResInfo ? LoadResource(NULL, hResInfo) : NULL;
+	void* pResData = hResData ? LockResource(hResData) : NULL;
 	if (!pResData) {
-		MessageBox(NULL, L"Failed to lock resource.", L"Error", MB_OK | MB_ICONERROR);
-		GdiplusShutdown(gdiplusToken);
-		return;
+		red();
+		wprintf(L"Failed to load image resource %d! GetLastError: 0x%x\r\n", resourceId, GetLastError());
+		reset();
+		return NULL;
 	}
 
-    // Create a stream from the resource data
-    IStream* pStream = NULL;
-    HRESULT hr = CreateStreamOnHGlobal(NULL, TRUE, &pStream);
-    if (FAILED(hr)) {
-        MessageBox(NULL, L"Failed to create stream.", L"Error", MB_OK | MB_ICONERROR);
-        GdiplusShutdown(gdiplusToken);
-        return;
-    }
-
-    // Write resource data to the stream
-    ULONG written;
-    hr = pStream->Write(pResData, SizeofResource(NULL, hResInfo), &written);
-    if (FAILED(hr)) {
-        MessageBox(NULL, L"Failed to write to stream.", L"Error", MB_OK | MB_ICONERROR);
-        pStream->Release();
-        GdiplusShutdown(gdiplusToken);
-        return;
-    }
-
-    // Load the image from the stream
-    Gdiplus::Bitmap* pBitmap = Gdiplus::Bitmap::FromStream(pStream);
-    pStream->Release();
-
-    if (pBitmap->GetLastStatus() != Gdiplus::Ok) {
-        MessageBox(NULL, L"Failed to load PNG from resource.", L"Error", MB_OK | MB_ICONERROR);
-        delete pBitmap;
-        GdiplusShutdown(gdiplusToken);
-        return;
-    }
-
-    // Set up the graphics object
-    Gdiplus::Graphics graphics(hdc);
-    graphics.SetInterpolationMode(Gdiplus::InterpolationModeHighQualityBicubic);
-
-    // Draw the image stretched to the given width and height at position (x, y)
-    graphics.DrawImage(pBitmap, x, y, width, height);
-
-    // Cleanup
-    delete pBitmap;
+	// Resources stay loaded for the life of the process, so GDI+ can keep reading from them
+	IStream* pStream = new MemoryStream(pResData, SizeofResource(NULL, hResInfo));
+	Gdiplus::Bitmap* pBitmap = Gdiplus::Bitmap::FromStream(pStream);
+	pStream->Release();
+
+	if (!pBitmap || pBitmap->GetLastStatus() != Gdiplus::Ok) {
+		red();
+		wprintf(L"Failed to decode image resource %d!\r\n", resourceId);
+		reset();
+		delete pBitmap;
+		return NULL;
+	}
+
+	return pBitmap;
 }
 
-void ShutdownGDIPlus() {
-	GdiplusShutdown(gdiplusToken);
-}
\ No newline at end of file
+// Decodes an image file straight from a mapped view of it, into a bitmap of its own so the view can be unmapped afterwards.
+static Gdiplus::Bitmap* DecodeFile(const WCHAR* path) {
+	Gdiplus::Bitmap* pBitmap = NULL;
+
+	HANDLE hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		red();
+		wprintf(L"Failed to open the background image '%s'! GetLastError: 0x%x\r\n", path, GetLastError());
+		reset();
+		return NULL;
+	}
+
+	DWORD size = GetFileSize(hFile, NULL);
+	HANDLE hMapping = size && size != INVALID_FILE_SIZE ? CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	const void* view = hMapping ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+
+	if (view) {
+		IStream* pStream = new MemoryStream(view, size);
+		Gdiplus::Bitmap* pEncoded = Gdiplus::Bitmap::FromStream(pStream);
+		if (pEncoded && pEncoded->GetLastStatus() == Gdiplus::Ok) {
+			// GDI+ may decode lazily from the stream, so draw it once into a bitmap that owns its pixels before the view goes away
+			pBitmap = new Gdiplus::Bitmap(pEncoded->GetWidth(), pEncoded->GetHeight(), PixelFormat32bppPARGB);
+			Gdiplus::Graphics graphics(pBitmap);
+			graphics.DrawImage(pEncoded, 0, 0, pEncoded->GetWidth(), pEncoded->GetHeight());
+		}
+		delete pEncoded; // Releases GDI+'s reference to the stream
+		pStream->Release();
+		UnmapViewOfFile(view);
+	}
+
+	if (hMapping) CloseHandle(hMapping);
+	CloseHandle(hFile);
+
+	if (!pBitmap || pBitmap->GetLastStatus() != Gdiplus::Ok) {
+		red();
+		wprintf(L"Failed to decode the background image '%s'!\r\n", path);
+		reset();
+		delete pBitmap;
+		return NULL;
+	}
+
+	return pBitmap;
+}
+
+// Scales a decoded image into a new DIB. Stretched to the exact size, or scaled to cover it with the overflow cropped evenly and the aspect ratio kept.
+static BOOL ScaleImage(CachedImage* image, Gdiplus::Bitmap* pSource, int width, int height, BOOL cover) {
+	BITMAPINFO bmi;
+	ZeroMemory(&bmi, sizeof(bmi));
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth = width;
+	bmi.bmiHeader.biHeight = -height; // Negative for top-down rows
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 32;
+	bmi.bmiHeader.biCompression = BI_RGB;
+
+	void* pixels = NULL;
+	HBITMAP hBitmap = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &pixels, NULL, 0);
+	if (!hBitmap) {
+		return FALSE;
+	}
+
+	{
+		// Scale straight into the DIB's memory. Premultiplied ARGB is the layout AlphaBlend expects
+		Gdiplus::Bitmap target(width, height, width * 4, PixelFormat32bppPARGB, (BYTE*)pixels);
+		Gdiplus::Graphics graphics(&target);
+		graphics.SetInterpolationMode(Gdiplus::InterpolationModeHighQualityBicubic);
+		graphics.SetPixelOffsetMode(Gdiplus::PixelOffsetModeHalf);
+
+		if (cover) {
+			graphics.Clear(Gdiplus::Color(255, 0, 0, 0)); // Backgrounds are opaque, so anything transparent ends up over black
+			Gdiplus::REAL scale = max((Gdiplus::REAL)width / pSource->GetWidth(), (Gdiplus::REAL)height / pSource->GetHeight());
+			Gdiplus::REAL scaledWidth = pSource->GetWidth() * scale, scaledHeight = pSource->GetHeight() * scale;
+			graphics.DrawImage(pSource, Gdiplus::RectF((width - scaledWidth) / 2, (height - scaledHeight) / 2, scaledWidth, scaledHeight));
+		}
+		else {
+			graphics.Clear(Gdiplus::Color(0, 0, 0, 0));
+			graphics.DrawImage(pSource, 0, 0, width, height);
+		}
+	}
+
+	image->width = width;
+	image->height = height;
+	image->hBitmap = hBitmap;
+	image->pixels = (uint32_t*)pixels;
+	return TRUE;
+}
+
+// Decodes a resource and scales it into a new DIB.
+static BOOL LoadCachedImage(CachedImage* image, int resourceId, int width, int height) {
+	Gdiplus::Bitmap* pSource = DecodeResource(resourceId);
+	if (!pSource) {
+		return FALSE;
+	}
+
+	BOOL result = ScaleImage(image, pSource, width, height, FALSE);
+	image->resourceId = resourceId;
+	delete pSource;
+	return result;
+}
+
+// Returns a resource image scaled to the given size, decoding it if it isn't cached yet. NULL on failure.
+// The caller holds cacheLock for as long as it uses the image, since another caller may evict the slot as soon as it's released.
+static const CachedImage* FindCachedImage(int resourceId, int width, int height) {
+	// Look for the image, remembering the least recently used slot in case it isn't there
+	CachedImage* result = NULL;
+	int oldest = 0;
+	for (int i = 0; i < IMAGE_CACHE_SIZE; i++) {
+		if (cache[i].hBitmap && cache[i].resourceId == resourceId && cache[i].width == width && cache[i].height == height) {
+			result = &cache[i];
+			lastUsed[i] = ++useCount;
+			break;
+		}
+		if (!cache[i].hBitmap || (cache[oldest].hBitmap && lastUsed[i] < lastUsed[oldest])) {
+			oldest = i;
+		}
+	}
+
+	if (!result) {
+		FreeCachedImage(&cache[oldest]);
+		if (LoadCachedImage(&cache[oldest], resourceId, width, height)) {
+			result = &cache[oldest];
+			lastUsed[oldest] = ++useCount;
+		}
+	}
+
+	return result;
+}
+
+const CachedImage* GetScaledImageFile(const WCHAR* path, int width, int height) {
+	if (!isStarted || width <= 0 || height <= 0) {
+		return NULL;
+	}
+
+	EnterCriticalSection(&cacheLock);
+
+	// Only a new path is decoded, so a missing or broken file isn't opened and logged again on every resize
+	if (wcsncmp(path, fileSourcePath, MAX_PATH - 1) != 0) {
+		FreeCachedImage(&fileImage);
+		delete fileSource;
+		fileSource = DecodeFile(path);
+		wcsncpy(fileSourcePath, path, MAX_PATH - 1);
+	}
+
+	const CachedImage* result = NULL;
+	if (fileSource) {
+		if (!fileImage.hBitmap || fileImage.width != width || fileImage.height != height) {
+			FreeCachedImage(&fileImage);
+			ScaleImage(&fileImage, fileSource, width, height, TRUE);
+		}
+		result = fileImage.hBitmap ? &fileImage : NULL;
+	}
+
+	LeaveCriticalSection(&cacheLock);
+	return result;
+}
+
+void DrawImage(HDC hdc, int x, int y, int width, int height, int resourceId) {
+	if (!isStarted || width <= 0 || height <= 0) {
+		return;
+	}
+
+	HDC hMemDC = CreateCompatibleDC(hdc);
+	if (!hMemDC) {
+		return;
+	}
+
+	EnterCriticalSection(&cacheLock);
+	const CachedImage* image = FindCachedImage(resourceId, width, height);
+	if (image) {
+		HBITMAP hOldBitmap = (HBITMAP)SelectObject(hMemDC, image->hBitmap);
+		BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+		AlphaBlend(hdc, x, y, width, height, hMemDC, 0, 0, width, height, blend);
+		SelectObject(hMemDC, hOldBitmap);
+	}
+	LeaveCriticalSection(&cacheLock);
+
+	DeleteDC(hMemDC);
+}
@@ -16,17 +16,32 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+
 #ifndef __CLOCK_DRAWING_H__
 #define __CLOCK_DRAWING_H__
 
 #include "Windows.h"
+#include <stdint.h>
+
+#define IMAGE_CACHE_SIZE 8 // Decoded images kept at once. The least recently used one is dropped to make room
+
+// A PNG from the RCDATA resources, decoded and scaled once
+typedef struct __CachedImage {
+	int resourceId;
+	int width;
+	int height;
+	HBITMAP hBitmap; // 32-bit top-down DIB with premultiplied alpha, ready for AlphaBlend
+	uint32_t* pixels; // The DIB's pixels, in the same layout as a Framebuffer's
+} CachedImage;
 
 #ifdef __cplusplus
 extern "C" { // Make sure to link the functions as C functions, because it uses GDI+.
 #endif
 
-	void DrawImage(HDC, int, int, int, int, int); // Draw an image using GDI+. Pulls from RCDATA.
-	void ShutdownGDIPlus();
+	BOOL StartupGDIPlus(void); // Starts GDI+ for the whole process. Call once before anything else in here
+	void ShutdownGDIPlus(void); // Frees the image cache and shuts GDI+ down
+	const CachedImage* GetScaledImageFile(const WCHAR*, int, int); // Returns a PNG, BMP or JPEG file scaled to cover the given width and height. The file is decoded once per path, even if that fails, and scaled again only when the size changes. Stays valid until it's asked for at another size or ShutdownGDIPlus
+	void DrawImage(HDC, int, int, int, int, int); // AlphaBlends a PNG from RCDATA, decoded and scaled once and then kept in the image cache. Takes the position, the size and the resource ID
 
 #ifdef __cplusplus
 }
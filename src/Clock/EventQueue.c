@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "EventQueue.h"
+#include "TrayIcon.h"
+#include "Colors.h"
+
+// Worker threads (NTP, GPS) used to show a MessageBox when something went wrong, which blocked them until someone clicked OK.
+// Now they post here instead. The lock is only held to copy a message in or out, and the UI is woken with PostMessage, which never waits.
+
+static CRITICAL_SECTION queueLock;
+static ClockEvent queue[EVENT_QUEUE_SIZE];
+static int queueHead = 0; // Next event to read
+static int queueCount = 0;
+static unsigned long droppedEvents = 0;
+static BOOL needsClear = FALSE; // Set once an event has been queued, so a run of successful syncs only clears the status once
+
+// Recently queued messages, for deduplication. Protected by queueLock as well.
+typedef struct __EventHistory {
+	DWORD hash;
+	DWORD lastTick;
+	unsigned long suppressed; // Repeats swallowed since the message was last shown
+} EventHistory;
+
+static EventHistory history[EVENT_HISTORY_SIZE];
+
+// Status line state. Only touched on the UI thread.
+static WCHAR statusText[EVENT_MESSAGE_LENGTH];
+static int statusSeverity = CLOCK_EVENT_INFO;
+static DWORD statusTick = 0;
+static BOOL hasStatus = FALSE;
+
+// FNV-1a. Only used to tell messages apart.
+static DWORD HashMessage(LPCWSTR message) {
+	DWORD hash = 2166136261u;
+	for (; *message; message++) {
+		hash = (hash ^ (DWORD)*message) * 16777619u;
+	}
+	return hash;
+}
+
+// Returns TRUE if the message should be queued. Must be called with queueLock held.
+static BOOL PassesRateLimit(LPCWSTR message, unsigned long* pSuppressed) {
+	DWORD hash = HashMessage(message);
+	DWORD now = GetTickCount();
+	EventHistory* oldest = &history[0];
+
+	for (int i = 0; i < EVENT_HISTORY_SIZE; i++) {
+		if (history[i].hash == hash && history[i].lastTick != 0) {
+			if (now - history[i].lastTick < EVENT_RATE_LIMIT_MS) {
+				history[i].suppressed++;
+				return FALSE;
+			}
+
+			*pSuppressed = history[i].suppressed;
+			history[i].suppressed = 0;
+			history[i].lastTick = now;
+			return TRUE;
+		}
+
+		if (history[i].lastTick == 0 || (now - history[i].lastTick) > (now - oldest->lastTick)) {
+			oldest = &history[i];
+		}
+	}
+
+	// New message. Take over the least recently used slot.
+	oldest->hash = hash;
+	oldest->lastTick = now;
+	oldest->suppressed = 0;
+	*pSuppressed = 0;
+	return TRUE;
+}
+
+// Adds an event to the queue and wakes the UI thread if it was idle.
+static void QueueEvent(int severity, LPCWSTR message, BOOL rateLimited) {
+	BOOL wake = FALSE;
+	unsigned long suppressed = 0;
+
+	EnterCriticalSection(&queueLock);
+
+	if (!rateLimited || PassesRateLimit(message, &suppressed)) {
+		if (queueCount < EVENT_QUEUE_SIZE) {
+			ClockEvent* event = &queue[(queueHead + queueCount) % EVENT_QUEUE_SIZE];
+			event->severity = severity;
+			if (suppressed > 0) {
+				swprintf(event->message, EVENT_MESSAGE_LENGTH, L"%s (repeated %lu times)", message, suppressed + 1);
+			}
+			else {
+				wcsncpy(event->message, message, EVENT_MESSAGE_LENGTH - 1);
+				event->message[EVENT_MESSAGE_LENGTH - 1] = L'\0';
+			}
+
+			wake = (queueCount == 0);
+			queueCount++;
+			needsClear = (severity != CLOCK_EVENT_CLEAR);
+		}
+		else {
+			droppedEvents++;
+		}
+	}
+
+	LeaveCriticalSection(&queueLock);
+
+	// Before the main window exists there's nothing to wake. WM_CREATE drains the queue instead.
+	if (wake && g_hWndMain) {
+		PostMessage(g_hWndMain, WM_CLOCK_EVENT, 0, 0);
+	}
+}
+
+void InitEventQueue(void) {
+	InitializeCriticalSection(&queueLock);
+}
+
+void PostClockEvent(int severity, LPCWSTR lpszFormat, ...) {
+	WCHAR message[EVENT_MESSAGE_LENGTH];
+	va_list args;
+	va_start(args, lpszFormat);
+	vswprintf(message, EVENT_MESSAGE_LENGTH, lpszFormat, args);
+	va_end(args);
+
+	// Still log everything to the console, including the repeats that don't make it to the screen
+	if (severity == CLOCK_EVENT_ERROR) red();
+	else if (severity == CLOCK_EVENT_WARNING) yellow();
+	wprintf(L"%s\r\n", message);
+	reset();
+
+	QueueEvent(severity, message, TRUE);
+}
+
+void ClearClockStatus(void) {
+	// Called after every successful sync, so most of the time there's nothing to clear
+	EnterCriticalSection(&queueLock);
+	BOOL clear = needsClear;
+	LeaveCriticalSection(&queueLock);
+
+	if (clear) {
+		QueueEvent(CLOCK_EVENT_CLEAR, L"", FALSE);
+	}
+}
+
+void DispatchClockEvents(void) {
+	ClockEvent event;
+
+	for (;;) {
+		EnterCriticalSection(&queueLock);
+		if (queueCount == 0) {
+			unsigned long dropped = droppedEvents;
+			droppedEvents = 0;
+			LeaveCriticalSection(&queueLock);
+
+			if (dropped > 0) {
+				yellow();
+				wprintf(L"Event queue was full, %lu events were not shown.\r\n", dropped);
+				reset();
+			}
+			break;
+		}
+		event = queue[queueHead];
+		queueHead = (queueHead + 1) % EVENT_QUEUE_SIZE;
+		queueCount--;
+
+		// The status line is read by the render thread, so it's updated under the lock too
+		if (event.severity == CLOCK_EVENT_CLEAR) {
+			hasStatus = FALSE;
+			LeaveCriticalSection(&queueLock);
+			continue;
+		}
+
+		wcscpy(statusText, event.message);
+		statusSeverity = event.severity;
+		statusTick = GetTickCount();
+		hasStatus = TRUE;
+		LeaveCriticalSection(&queueLock);
+
+		if (g_Config.TrayIconEnabled) {
+			ShowTrayNotification(L"XPClock", event.message, event.severity);
+		}
+	}
+}
+
+BOOL GetClockStatus(WCHAR* buffer, size_t bufferSize, int* pSeverity) {
+	EnterCriticalSection(&queueLock);
+	if (hasStatus && GetTickCount() - statusTick > EVENT_STATUS_MS) {
+		hasStatus = FALSE;
+	}
+
+	BOOL result = hasStatus;
+	if (result) {
+		wcsncpy(buffer, statusText, bufferSize - 1);
+		buffer[bufferSize - 1] = L'\0';
+		if (pSeverity) *pSeverity = statusSeverity;
+	}
+	LeaveCriticalSection(&queueLock);
+
+	return result;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_EVENT_QUEUE_H__
+#define __CLOCK_EVENT_QUEUE_H__
+
+#include "Clock.h"
+
+#define WM_CLOCK_EVENT (WM_APP + 1) // Posted to the main window when the queue goes from empty to non-empty
+
+#define EVENT_QUEUE_SIZE		16 // Events waiting for the UI thread. Further events are dropped until it catches up.
+#define EVENT_MESSAGE_LENGTH	256
+#define EVENT_RATE_LIMIT_MS		300000 // The same message is shown at most once every 5 minutes
+#define EVENT_HISTORY_SIZE		8 // Distinct messages remembered for the rate limit
+#define EVENT_STATUS_MS			60000 // How long the status line stays on the clock after the last event
+
+// Severity of an event. Decides the tray balloon icon and the status line color.
+#define CLOCK_EVENT_INFO	0
+#define CLOCK_EVENT_WARNING	1
+#define CLOCK_EVENT_ERROR	2
+#define CLOCK_EVENT_CLEAR	3 // Not shown. Clears the status line, e.g. after a successful sync.
+
+typedef struct __ClockEvent {
+	int severity;
+	WCHAR message[EVENT_MESSAGE_LENGTH];
+} ClockEvent;
+
+void InitEventQueue(void); // Must be called before any worker thread is started
+void PostClockEvent(int, LPCWSTR, ...); // Queues a formatted message from any thread. Never waits on the UI thread.
+void ClearClockStatus(void); // Queues a CLOCK_EVENT_CLEAR. Call when the problem that caused earlier events is gone.
+void DispatchClockEvents(void); // Drains the queue on the UI thread and shows the events as tray balloons and as the status line
+BOOL GetClockStatus(WCHAR*, size_t, int*); // Copies the current status line and its severity. Returns FALSE if there's nothing to show. Safe to call from any thread.
+
+#endif // !__CLOCK_EVENT_QUEUE_H__
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "FontFit.h"
+#include "Colors.h"
+
+// The clock font used to be created once at 48 px, so it looked tiny full screen on a big monitor. Now the largest size that fits is picked with
+// a binary search over a fixed ladder of sizes. Each size's font is created once, and the extent of each format's widest string at each size is
+// measured once, so resizing and toggling full screen only search the cached table after the first time.
+// Only the render thread calls in here, so nothing is locked.
+
+typedef struct __FontBucket {
+	int height;
+	HFONT hFont; // NULL until the size is first needed
+	SIZE extents[FONT_FIT_KEYS]; // Extent of the widest sample per key. cx is -1 until measured
+} FontBucket;
+
+static FontBucket buckets[FONT_FIT_BUCKETS];
+static WCHAR cachedFace[LF_FACESIZE];
+static FontFitStats stats;
+
+// Forgets every font and measurement, e.g. when the face changes.
+static void ResetBuckets(void) {
+	FreeFontFit();
+
+	int height = FONT_FIT_MIN_HEIGHT;
+	for (int i = 0; i < FONT_FIT_BUCKETS; i++) {
+		buckets[i].height = height;
+		for (int key = 0; key < FONT_FIT_KEYS; key++) {
+			buckets[i].extents[key].cx = -1;
+		}
+		height = max(height + 1, height * 9 / 8);
+	}
+}
+
+static HFONT GetBucketFont(FontBucket* bucket, const WCHAR* face) {
+	if (!bucket->hFont) {
+		bucket->hFont = CreateFont(bucket->height, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH, face);
+		if (bucket->hFont) {
+			stats.fontsCreated++;
+		}
+	}
+	return bucket->hFont;
+}
+
+// Measures the widest of the samples with the bucket's font, with every '0' replaced by the widest digit.
+static SIZE MeasureBucket(HDC hdc, FontBucket* bucket, const WCHAR* face, int key, const WCHAR* const* samples, int sampleCount) {
+	SIZE* extent = &bucket->extents[key];
+	if (extent->cx >= 0) {
+		return *extent;
+	}
+
+	extent->cx = 0;
+	extent->cy = 0;
+
+	HFONT hFont = GetBucketFont(bucket, face);
+	if (!hFont) {
+		return *extent;
+	}
+
+	HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
+
+	WCHAR widest = L'0';
+	int widestWidth = 0;
+	for (WCHAR digit = L'0'; digit <= L'9'; digit++) {
+		SIZE size;
+		if (GetTextExtentPoint32W(hdc, &digit, 1, &size) && size.cx > widestWidth) {
+			widest = digit;
+			widestWidth = size.cx;
+		}
+	}
+
+	for (int i = 0; i < sampleCount; i++) {
+		WCHAR text[64];
+		int length = 0;
+		for (; samples[i][length] && length < 63; length++) {
+			text[length] = samples[i][length] == L'0' ? widest : samples[i][length];
+		}
+
+		SIZE size;
+		if (GetTextExtentPoint32W(hdc, text, length, &size)) {
+			extent->cx = max(extent->cx, size.cx);
+			extent->cy = max(extent->cy, size.cy);
+		}
+		stats.measurements++;
+	}
+
+	SelectObject(hdc, hOldFont);
+	return *extent;
+}
+
+HFONT FitClockFont(HDC hdc, const WCHAR* face, int key, const WCHAR* const* samples, int sampleCount, int width, int height) {
+	stats.fits++;
+	if (key < 0 || key >= FONT_FIT_KEYS) {
+		key = 0;
+	}
+
+	if (!buckets[0].height || wcsncmp(face, cachedFace, LF_FACESIZE - 1) != 0) {
+		ResetBuckets();
+		wcsncpy(cachedFace, face, LF_FACESIZE - 1);
+	}
+
+	int maxWidth = width * FONT_FIT_MARGIN / 100;
+	int maxHeight = height * FONT_FIT_MARGIN / 100;
+
+	// Extents grow with the height, so the largest bucket that fits is found by bisection. The smallest is used if nothing fits
+	int low = 0, high = FONT_FIT_BUCKETS - 1;
+	while (low < high) {
+		int middle = (low + high + 1) / 2;
+		SIZE extent = MeasureBucket(hdc, &buckets[middle], face, key, samples, sampleCount);
+		if (extent.cx > 0 && extent.cx <= maxWidth && extent.cy <= maxHeight) {
+			low = middle;
+		}
+		else {
+			high = middle - 1;
+		}
+	}
+
+	return GetBucketFont(&buckets[low], face);
+}
+
+void FreeFontFit(void) {
+	for (int i = 0; i < FONT_FIT_BUCKETS; i++) {
+		if (buckets[i].hFont) {
+			DeleteObject(buckets[i].hFont);
+			buckets[i].hFont = NULL;
+		}
+	}
+}
+
+void GetFontFitStats(FontFitStats* out) {
+	*out = stats;
+}
+
+void PrintFontFitStats(void) {
+	blue();
+	wprintf(L"Font fitting: %ld fits, %ld samples measured, %ld fonts created.\r\n", stats.fits, stats.measurements, stats.fontsCreated);
+	reset();
+}
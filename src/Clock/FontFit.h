@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __CLOCK_FONT_FIT_H__
+#define __CLOCK_FONT_FIT_H__
+
+#include "Clock.h"
+
+#define FONT_FIT_BUCKETS	40 // Number of font sizes the clock can pick from
+#define FONT_FIT_MIN_HEIGHT	12 // Smallest font height. Each bucket after it is about 1/8 taller than the one before
+#define FONT_FIT_MARGIN		90 // Percentage of the client area's width and height the text may fill
+#define FONT_FIT_KEYS		4 // Number of display formats metrics are cached for
+
+typedef struct __FontFitStats {
+	LONG fits; // Calls to FitClockFont
+	LONG measurements; // Samples measured with GetTextExtentPoint32W. Stays flat once every size a window has been is cached
+	LONG fontsCreated; // Never more than FONT_FIT_BUCKETS per face
+} FontFitStats;
+
+HFONT FitClockFont(HDC, const WCHAR*, int, const WCHAR* const*, int, int, int); // Returns the largest font of a face whose widest sample fits the given width and height. Takes a DC to measure with, the face, a cache key for the samples (the display format), the samples and their count, then the width and height. '0' in a sample stands for the widest digit. The font belongs to the cache
+void FreeFontFit(void); // Deletes every font the cache created. Nothing may have one selected
+void GetFontFitStats(FontFitStats*); // Copies the statistics
+void PrintFontFitStats(void); // Logs the statistics to the console
+
+#endif // !__CLOCK_FONT_FIT_H__
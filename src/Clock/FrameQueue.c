@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "FrameQueue.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// Each framebuffer counts the queue entries pointing at it, plus one while it's being drawn. Only framebuffers with no references are handed out,
+// so the writer never reads one that's being drawn over. The queue entries are just framebuffer indices, written in order.
+// XP has no condition variables, so on Windows the two sides wake each other with auto-reset events. Each event only ever has one thread waiting on it,
+// and a wakeup sent while nobody waits stays set, so none are lost.
+
+#define SIGNAL_QUEUED	0 // Set by the drawing thread when it queues a frame or closes the queue
+#define SIGNAL_WRITTEN	1 // Set by the writer when it's done with a frame or fails
+
+#ifdef _WIN32
+typedef HANDLE QueueThread;
+#else
+typedef pthread_t QueueThread;
+#endif
+
+struct __FrameQueue {
+	Framebuffer frames[FRAME_QUEUE_MAX_FRAMES];
+	int frameCount;
+	int references[FRAME_QUEUE_MAX_FRAMES];
+	int entries[FRAME_QUEUE_MAX_ENTRIES]; // Ring of framebuffer indices waiting to be written
+	int head;
+	int count;
+	int last; // Framebuffer submitted last, -1 before the first
+	int closing;
+	int failed;
+	long written;
+	FrameWriteProc write;
+	void* context;
+	FrameQueueStats stats;
+	QueueThread thread;
+#ifdef _WIN32
+	CRITICAL_SECTION lock;
+	HANDLE signals[2];
+#else
+	pthread_mutex_t lock;
+	pthread_cond_t signals[2];
+#endif
+};
+
+#ifdef _WIN32
+static int InitQueueLock(FrameQueue* queue) {
+	queue->signals[SIGNAL_QUEUED] = CreateEventW(NULL, FALSE, FALSE, NULL);
+	queue->signals[SIGNAL_WRITTEN] = CreateEventW(NULL, FALSE, FALSE, NULL);
+	if (!queue->signals[SIGNAL_QUEUED] || !queue->signals[SIGNAL_WRITTEN]) {
+		if (queue->signals[SIGNAL_QUEUED]) CloseHandle(queue->signals[SIGNAL_QUEUED]);
+		if (queue->signals[SIGNAL_WRITTEN]) CloseHandle(queue->signals[SIGNAL_WRITTEN]);
+		return 0;
+	}
+	InitializeCriticalSection(&queue->lock);
+	return 1;
+}
+
+static void FreeQueueLock(FrameQueue* queue) {
+	DeleteCriticalSection(&queue->lock);
+	CloseHandle(queue->signals[SIGNAL_QUEUED]);
+	CloseHandle(queue->signals[SIGNAL_WRITTEN]);
+}
+
+static void LockQueue(FrameQueue* queue) {
+	EnterCriticalSection(&queue->lock);
+}
+
+static void UnlockQueue(FrameQueue* queue) {
+	LeaveCriticalSection(&queue->lock);
+}
+
+// Called with the lock held and returns with it held again. May return without the signal having been sent, so callers check again in a loop
+static void WaitQueue(FrameQueue* queue, int signal) {
+	LeaveCriticalSection(&queue->lock);
+	WaitForSingleObject(queue->signals[signal], INFINITE);
+	EnterCriticalSection(&queue->lock);
+}
+
+static void SignalQueue(FrameQueue* queue, int signal) {
+	SetEvent(queue->signals[signal]);
+}
+#else
+static int InitQueueLock(FrameQueue* queue) {
+	if (pthread_mutex_init(&queue->lock, NULL) != 0) return 0;
+	if (pthread_cond_init(&queue->signals[SIGNAL_QUEUED], NULL) != 0) {
+		pthread_mutex_destroy(&queue->lock);
+		return 0;
+	}
+	if (pthread_cond_init(&queue->signals[SIGNAL_WRITTEN], NULL) != 0) {
+		pthread_cond_destroy(&queue->signals[SIGNAL_QUEUED]);
+		pthread_mutex_destroy(&queue->lock);
+		return 0;
+	}
+	return 1;
+}
+
+static void FreeQueueLock(FrameQueue* queue) {
+	pthread_cond_destroy(&queue->signals[SIGNAL_QUEUED]);
+	pthread_cond_destroy(&queue->signals[SIGNAL_WRITTEN]);
+	pthread_mutex_destroy(&queue->lock);
+}
+
+static void LockQueue(FrameQueue* queue) {
+	pthread_mutex_lock(&queue->lock);
+}
+
+static void UnlockQueue(FrameQueue* queue) {
+	pthread_mutex_unlock(&queue->lock);
+}
+
+static void WaitQueue(FrameQueue* queue, int signal) {
+	pthread_cond_wait(&queue->signals[signal], &queue->lock);
+}
+
+static void SignalQueue(FrameQueue* queue, int signal) {
+	pthread_cond_signal(&queue->signals[signal]);
+}
+#endif
+
+// Writes frames in order until the queue is closed and empty or a write fails. The lock is only held to take an entry and to hand it back
+static void WriteQueuedFrames(FrameQueue* queue) {
+	LockQueue(queue);
+	for (;;) {
+		while (queue->count == 0 && !queue->closing) {
+			WaitQueue(queue, SIGNAL_QUEUED);
+		}
+		if (queue->count == 0) break;
+
+		int index = queue->entries[queue->head];
+		long number = queue->written;
+		UnlockQueue(queue);
+
+		int result = queue->write(&queue->frames[index], number, queue->context);
+
+		LockQueue(queue);
+		queue->references[index]--;
+		queue->head = (queue->head + 1) % FRAME_QUEUE_MAX_ENTRIES;
+		queue->count--;
+		if (result) {
+			queue->written++;
+		}
+		else {
+			queue->failed = 1;
+		}
+		SignalQueue(queue, SIGNAL_WRITTEN);
+		if (!result) break;
+	}
+	UnlockQueue(queue);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI WriterThread(LPVOID parameter) {
+	WriteQueuedFrames((FrameQueue*)parameter);
+	return 0;
+}
+#else
+static void* WriterThread(void* parameter) {
+	WriteQueuedFrames((FrameQueue*)parameter);
+	return NULL;
+}
+#endif
+
+// Adds an entry for a framebuffer, waiting for room if the writer is behind. Called with the lock held. The caller has already counted the reference
+static int PushFrame(FrameQueue* queue, int index) {
+	if (queue->count == FRAME_QUEUE_MAX_ENTRIES && !queue->failed) {
+		queue->stats.stalls++;
+		while (queue->count == FRAME_QUEUE_MAX_ENTRIES && !queue->failed) {
+			WaitQueue(queue, SIGNAL_WRITTEN);
+		}
+	}
+	if (queue->failed) {
+		queue->references[index]--;
+		return 0;
+	}
+
+	queue->entries[(queue->head + queue->count) % FRAME_QUEUE_MAX_ENTRIES] = index;
+	queue->count++;
+	queue->last = index;
+	SignalQueue(queue, SIGNAL_QUEUED);
+	return 1;
+}
+
+FrameQueue* CreateFrameQueue(int width, int height, int frameCount, FrameWriteProc write, void* context) {
+	if (frameCount < 2) frameCount = 2;
+	if (frameCount > FRAME_QUEUE_MAX_FRAMES) frameCount = FRAME_QUEUE_MAX_FRAMES;
+
+	FrameQueue* queue = (FrameQueue*)calloc(1, sizeof(FrameQueue));
+	if (!queue) return NULL;
+
+	for (int i = 0; i < frameCount; i++) {
+		if (!InitFramebuffer(&queue->frames[i], width, height)) {
+			for (int j = 0; j < i; j++) {
+				FreeFramebuffer(&queue->frames[j]);
+			}
+			free(queue);
+			return NULL;
+		}
+	}
+	queue->frameCount = frameCount;
+	queue->last = -1;
+	queue->write = write;
+	queue->context = context;
+
+	if (!InitQueueLock(queue)) {
+		for (int i = 0; i < frameCount; i++) {
+			FreeFramebuffer(&queue->frames[i]);
+		}
+		free(queue);
+		return NULL;
+	}
+
+#ifdef _WIN32
+	queue->thread = CreateThread(NULL, 0, WriterThread, queue, 0, NULL);
+	int started = queue->thread != NULL;
+#else
+	int started = pthread_create(&queue->thread, NULL, WriterThread, queue) == 0;
+#endif
+	if (!started) {
+		FreeQueueLock(queue);
+		for (int i = 0; i < frameCount; i++) {
+			FreeFramebuffer(&queue->frames[i]);
+		}
+		free(queue);
+		return NULL;
+	}
+
+	return queue;
+}
+
+Framebuffer* AcquireFrame(FrameQueue* queue) {
+	LockQueue(queue);
+	int index = -1, waited = 0;
+	while (!queue->failed) {
+		for (int i = 0; i < queue->frameCount; i++) {
+			if (queue->references[i] == 0) {
+				index = i;
+				break;
+			}
+		}
+		if (index >= 0) break;
+
+		if (!waited) {
+			queue->stats.stalls++;
+			waited = 1;
+		}
+		WaitQueue(queue, SIGNAL_WRITTEN);
+	}
+
+	if (index >= 0 && !queue->failed) {
+		queue->references[index] = 1; // Held until it's submitted, and then by its entry
+	}
+	else {
+		index = -1;
+	}
+	UnlockQueue(queue);
+	return index >= 0 ? &queue->frames[index] : NULL;
+}
+
+int SubmitFrame(FrameQueue* queue, Framebuffer* frame) {
+	LockQueue(queue);
+	int result = PushFrame(queue, (int)(frame - queue->frames));
+	if (result) queue->stats.drawn++;
+	UnlockQueue(queue);
+	return result;
+}
+
+int RepeatFrame(FrameQueue* queue) {
+	LockQueue(queue);
+	int result = 0;
+	if (queue->last >= 0) {
+		queue->references[queue->last]++;
+		result = PushFrame(queue, queue->last);
+		if (result) queue->stats.repeated++;
+	}
+	UnlockQueue(queue);
+	return result;
+}
+
+int CloseFrameQueue(FrameQueue* queue, FrameQueueStats* stats) {
+	if (!queue) return 0;
+
+	LockQueue(queue);
+	queue->closing = 1;
+	SignalQueue(queue, SIGNAL_QUEUED);
+	UnlockQueue(queue);
+
+#ifdef _WIN32
+	WaitForSingleObject(queue->thread, INFINITE);
+	CloseHandle(queue->thread);
+#else
+	pthread_join(queue->thread, NULL);
+#endif
+
+	int result = !queue->failed;
+	queue->stats.written = queue->written;
+	if (stats) *stats = queue->stats;
+
+	FreeQueueLock(queue);
+	for (int i = 0; i < queue->frameCount; i++) {
+		FreeFramebuffer(&queue->frames[i]);
+	}
+	free(queue);
+	return result;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __CLOCK_FRAME_QUEUE_H__
+#define __CLOCK_FRAME_QUEUE_H__
+
+// A ring of framebuffers between a thread that draws frames and one that writes them out, for the headless renderer.
+// Frames are drawn straight into the ring and written straight out of it, so nothing is copied on the way. A frame that's the same as the last one,
+// which is most of them when the clock only changes once a second, is queued again by reference instead of being drawn or copied.
+// It uses Win32 threads on Windows and pthreads anywhere else.
+
+#include "Framebuffer.h"
+
+#define FRAME_QUEUE_MAX_FRAMES	8 // Framebuffers in the ring
+#define FRAME_QUEUE_MAX_ENTRIES	64 // Frames waiting to be written, counting repeats
+
+typedef struct __FrameQueue FrameQueue;
+
+typedef int (*FrameWriteProc)(const Framebuffer*, long, void*); // Writes a frame out. Takes the frame, its number from 0 and the queue's context. Returns 0 on failure, which stops the queue
+
+typedef struct __FrameQueueStats {
+	long drawn; // Frames handed out by AcquireFrame and submitted
+	long repeated; // Frames queued again with RepeatFrame
+	long written;
+	long stalls; // Times the drawing thread had to wait for the writer
+} FrameQueueStats;
+
+FrameQueue* CreateFrameQueue(int, int, int, FrameWriteProc, void*); // Allocates the ring and starts the writer. Takes the width, height, number of framebuffers (2 to FRAME_QUEUE_MAX_FRAMES), the write proc and its context. Returns NULL on failure
+Framebuffer* AcquireFrame(FrameQueue*); // Waits for a framebuffer that isn't queued and returns it to be drawn in full. Returns NULL once a write has failed
+int SubmitFrame(FrameQueue*, Framebuffer*); // Queues the acquired framebuffer to be written. Returns 0 once a write has failed
+int RepeatFrame(FrameQueue*); // Queues the last submitted frame again. Returns 0 once a write has failed or if nothing was submitted yet
+int CloseFrameQueue(FrameQueue*, FrameQueueStats*); // Waits for every queued frame to be written, stops the writer and frees the ring. Optionally copies the statistics. Returns 0 if any write failed
+
+#endif // !__CLOCK_FRAME_QUEUE_H__
@@ -0,0 +1,800 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Framebuffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Only the inner loops (filling a span, blending a span through coverage, one row of a box blur and one row of a line's coverage) have SIMD versions. Everything else is clipping and bookkeeping.
+// All kernel sets produce bit-identical output, so golden images don't depend on the machine they were made on.
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define FRAMEBUFFER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FRAMEBUFFER_TARGET(x)
+#else
+#include <cpuid.h>
+#define FRAMEBUFFER_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+typedef void (*FillSpanProc)(uint32_t*, int, uint32_t);
+typedef void (*BlendSpanProc)(uint32_t*, const uint8_t*, int, uint32_t);
+typedef void (*BlurRowProc)(uint16_t*, const uint8_t*, const uint8_t*, uint8_t*, int, uint16_t, uint16_t);
+
+// A line as the coverage kernels see it: its start, the vector to its end, the start's half width and how much that grows along the line
+typedef struct __LineShape {
+	float x, y;
+	float dx, dy;
+	float invLengthSquared; // 0 for a dot
+	float radius, radiusStep;
+} LineShape;
+
+typedef void (*LineRowProc)(uint8_t*, int, int, float, const LineShape*);
+
+static int kernelSet = -1; // Picked on first use. CreateTilePool makes sure that happens before any worker draws
+static FillSpanProc FillSpan;
+static BlendSpanProc BlendSpan;
+static BlurRowProc BlurRow;
+static LineRowProc LineRow;
+
+// (c * a + d * (255 - a)) / 255, rounded. Exact for every input, and cheap in 16-bit lanes.
+static uint32_t BlendChannel(uint32_t c, uint32_t d, uint32_t a) {
+	uint32_t t = c * a + d * (255 - a) + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+static void FillSpanScalar(uint32_t* dst, int count, uint32_t color) {
+	for (int i = 0; i < count; i++) {
+		dst[i] = color;
+	}
+}
+
+static void BlendSpanScalar(uint32_t* dst, const uint8_t* coverage, int count, uint32_t color) {
+	for (int i = 0; i < count; i++) {
+		uint32_t a = coverage[i];
+		if (a == 0) continue;
+		if (a == 255) {
+			dst[i] = color;
+			continue;
+		}
+
+		uint32_t d = dst[i];
+		dst[i] = (BlendChannel(color >> 24, d >> 24, a) << 24) | (BlendChannel((color >> 16) & 0xFF, (d >> 16) & 0xFF, a) << 16) |
+			(BlendChannel((color >> 8) & 0xFF, (d >> 8) & 0xFF, a) << 8) | BlendChannel(color & 0xFF, d & 0xFF, a);
+	}
+}
+
+// One step of a vertical box blur. 'sums' holds the running total of each column's window. The row entering the window is added,
+// the average written out, then the row leaving it is subtracted. Averages are (sum + bias) * scale >> 16, which fits 16-bit lanes for radii up to FRAMEBUFFER_MAX_BLUR.
+static void BlurRowScalar(uint16_t* sums, const uint8_t* entering, const uint8_t* leaving, uint8_t* out, int count, uint16_t scale, uint16_t bias) {
+	for (int i = 0; i < count; i++) {
+		uint32_t sum = sums[i] + entering[i];
+		out[i] = (uint8_t)(((sum + bias) * scale) >> 16);
+		sums[i] = (uint16_t)(sum - leaving[i]);
+	}
+}
+
+// Coverage of 'count' pixels of a line, starting at column x of the row whose centers are at py. Each pixel center is projected onto the line,
+// and the coverage is how far inside the line's half width at that point it lies, over one pixel. The SIMD versions do the same float operations in the same order.
+static void LineRowScalar(uint8_t* out, int count, int x, float py, const LineShape* line) {
+	float ry = py - line->y;
+	for (int i = 0; i < count; i++) {
+		float rx = (float)(x + i) + 0.5f - line->x;
+		float t = (rx * line->dx + ry * line->dy) * line->invLengthSquared;
+		t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+		float qx = rx - t * line->dx, qy = ry - t * line->dy;
+		float v = line->radius + t * line->radiusStep - sqrtf(qx * qx + qy * qy) + 0.5f;
+		v = v < 0.0f ? 0.0f : v > 1.0f ? 1.0f : v;
+		out[i] = (uint8_t)(int)(v * 255.0f + 0.5f);
+	}
+}
+
+#ifdef FRAMEBUFFER_X86
+FRAMEBUFFER_TARGET("sse2")
+static void FillSpanSSE2(uint32_t* dst, int count, uint32_t color) {
+	__m128i value = _mm_set1_epi32((int)color);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_si128((__m128i*)(dst + i), value);
+	}
+	FillSpanScalar(dst + i, count - i, color);
+}
+
+// Blends 8 channels (two pixels) held in 16-bit lanes
+FRAMEBUFFER_TARGET("sse2")
+static __m128i BlendLanesSSE2(__m128i color, __m128i d, __m128i a) {
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(color, a), _mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(255), a)));
+	t = _mm_add_epi16(t, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+FRAMEBUFFER_TARGET("sse2")
+static void BlendSpanSSE2(uint32_t* dst, const uint8_t* coverage, int count, uint32_t color) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i colorLanes = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), zero);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		uint32_t four;
+		memcpy(&four, coverage + i, 4);
+		if (four == 0) continue;
+		if (four == 0xFFFFFFFF) {
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_set1_epi32((int)color));
+			continue;
+		}
+
+		// Spread each pixel's coverage over its four channels
+		__m128i a = _mm_cvtsi32_si128((int)four);
+		a = _mm_unpacklo_epi8(a, a);
+		a = _mm_unpacklo_epi16(a, a);
+
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+		__m128i low = BlendLanesSSE2(colorLanes, _mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(a, zero));
+		__m128i high = BlendLanesSSE2(colorLanes, _mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(a, zero));
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(low, high));
+	}
+	BlendSpanScalar(dst + i, coverage + i, count - i, color);
+}
+
+// 16 columns at a time. The sums are kept in the same unpacked order they're computed in, which is only ever read back by this kernel
+FRAMEBUFFER_TARGET("sse2")
+static void BlurRowSSE2(uint16_t* sums, const uint8_t* entering, const uint8_t* leaving, uint8_t* out, int count, uint16_t scale, uint16_t bias) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i scaleLanes = _mm_set1_epi16((short)scale);
+	__m128i biasLanes = _mm_set1_epi16((short)bias);
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i in = _mm_loadu_si128((const __m128i*)(entering + i));
+		__m128i off = _mm_loadu_si128((const __m128i*)(leaving + i));
+		__m128i low = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(sums + i)), _mm_unpacklo_epi8(in, zero));
+		__m128i high = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(sums + i + 8)), _mm_unpackhi_epi8(in, zero));
+
+		__m128i outLow = _mm_mulhi_epu16(_mm_add_epi16(low, biasLanes), scaleLanes);
+		__m128i outHigh = _mm_mulhi_epu16(_mm_add_epi16(high, biasLanes), scaleLanes);
+		_mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(outLow, outHigh));
+
+		_mm_storeu_si128((__m128i*)(sums + i), _mm_sub_epi16(low, _mm_unpacklo_epi8(off, zero)));
+		_mm_storeu_si128((__m128i*)(sums + i + 8), _mm_sub_epi16(high, _mm_unpackhi_epi8(off, zero)));
+	}
+	BlurRowScalar(sums + i, entering + i, leaving + i, out + i, count - i, scale, bias);
+}
+
+FRAMEBUFFER_TARGET("sse2")
+static void LineRowSSE2(uint8_t* out, int count, int x, float py, const LineShape* line) {
+	__m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f);
+	__m128 lineX = _mm_set1_ps(line->x), dx = _mm_set1_ps(line->dx), dy = _mm_set1_ps(line->dy);
+	__m128 ry = _mm_set1_ps(py - line->y);
+	__m128 ryDy = _mm_mul_ps(ry, dy);
+	__m128 inv = _mm_set1_ps(line->invLengthSquared), radius = _mm_set1_ps(line->radius), step = _mm_set1_ps(line->radiusStep);
+	__m128i columns = _mm_add_epi32(_mm_set1_epi32(x), _mm_setr_epi32(0, 1, 2, 3));
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 rx = _mm_sub_ps(_mm_add_ps(_mm_cvtepi32_ps(columns), half), lineX);
+		__m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(rx, dx), ryDy), inv);
+		t = _mm_min_ps(_mm_max_ps(t, zero), one);
+		__m128 qx = _mm_sub_ps(rx, _mm_mul_ps(t, dx)), qy = _mm_sub_ps(ry, _mm_mul_ps(t, dy));
+		__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)));
+		__m128 v = _mm_add_ps(_mm_sub_ps(_mm_add_ps(radius, _mm_mul_ps(t, step)), distance), half);
+		v = _mm_min_ps(_mm_max_ps(v, zero), one);
+
+		__m128i bytes = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), half));
+		bytes = _mm_packus_epi16(_mm_packs_epi32(bytes, bytes), bytes);
+		uint32_t four = (uint32_t)_mm_cvtsi128_si32(bytes);
+		memcpy(out + i, &four, 4);
+		columns = _mm_add_epi32(columns, _mm_set1_epi32(4));
+	}
+	LineRowScalar(out + i, count - i, x + i, py, line);
+}
+
+FRAMEBUFFER_TARGET("avx2")
+static void FillSpanAVX2(uint32_t* dst, int count, uint32_t color) {
+	__m256i value = _mm256_set1_epi32((int)color);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_si256((__m256i*)(dst + i), value);
+	}
+	FillSpanScalar(dst + i, count - i, color);
+}
+
+FRAMEBUFFER_TARGET("avx2")
+static __m256i BlendLanesAVX2(__m256i color, __m256i d, __m256i a) {
+	__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(color, a), _mm256_mullo_epi16(d, _mm256_sub_epi16(_mm256_set1_epi16(255), a)));
+	t = _mm256_add_epi16(t, _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+FRAMEBUFFER_TARGET("avx2")
+static void BlendSpanAVX2(uint32_t* dst, const uint8_t* coverage, int count, uint32_t color) {
+	__m256i zero = _mm256_setzero_si256();
+	__m256i colorLanes = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)color), zero);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		uint64_t eight;
+		memcpy(&eight, coverage + i, 8);
+		if (eight == 0) continue;
+		if (eight == UINT64_MAX) {
+			_mm256_storeu_si256((__m256i*)(dst + i), _mm256_set1_epi32((int)color));
+			continue;
+		}
+
+		// Widen each coverage byte to a 32-bit lane, then copy it into all four bytes of the lane
+		__m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(coverage + i)));
+		a = _mm256_mullo_epi32(a, _mm256_set1_epi32(0x01010101));
+
+		// The unpacks and the pack all work within 128-bit halves, so the pixel order comes back out unchanged
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+		__m256i low = BlendLanesAVX2(colorLanes, _mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(a, zero));
+		__m256i high = BlendLanesAVX2(colorLanes, _mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(a, zero));
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(low, high));
+	}
+	BlendSpanScalar(dst + i, coverage + i, count - i, color);
+}
+
+// 32 columns at a time. The unpacks work within 128-bit halves, so the sums are stored out of order, but the pack puts the averages back in order
+FRAMEBUFFER_TARGET("avx2")
+static void BlurRowAVX2(uint16_t* sums, const uint8_t* entering, const uint8_t* leaving, uint8_t* out, int count, uint16_t scale, uint16_t bias) {
+	__m256i zero = _mm256_setzero_si256();
+	__m256i scaleLanes = _mm256_set1_epi16((short)scale);
+	__m256i biasLanes = _mm256_set1_epi16((short)bias);
+	int i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256i in = _mm256_loadu_si256((const __m256i*)(entering + i));
+		__m256i off = _mm256_loadu_si256((const __m256i*)(leaving + i));
+		__m256i low = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(sums + i)), _mm256_unpacklo_epi8(in, zero));
+		__m256i high = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(sums + i + 16)), _mm256_unpackhi_epi8(in, zero));
+
+		__m256i outLow = _mm256_mulhi_epu16(_mm256_add_epi16(low, biasLanes), scaleLanes);
+		__m256i outHigh = _mm256_mulhi_epu16(_mm256_add_epi16(high, biasLanes), scaleLanes);
+		_mm256_storeu_si256((__m256i*)(out + i), _mm256_packus_epi16(outLow, outHigh));
+
+		_mm256_storeu_si256((__m256i*)(sums + i), _mm256_sub_epi16(low, _mm256_unpacklo_epi8(off, zero)));
+		_mm256_storeu_si256((__m256i*)(sums + i + 16), _mm256_sub_epi16(high, _mm256_unpackhi_epi8(off, zero)));
+	}
+	BlurRowScalar(sums + i, entering + i, leaving + i, out + i, count - i, scale, bias);
+}
+
+FRAMEBUFFER_TARGET("avx2")
+static void LineRowAVX2(uint8_t* out, int count, int x, float py, const LineShape* line) {
+	__m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), half = _mm256_set1_ps(0.5f);
+	__m256 lineX = _mm256_set1_ps(line->x), dx = _mm256_set1_ps(line->dx), dy = _mm256_set1_ps(line->dy);
+	__m256 ry = _mm256_set1_ps(py - line->y);
+	__m256 ryDy = _mm256_mul_ps(ry, dy);
+	__m256 inv = _mm256_set1_ps(line->invLengthSquared), radius = _mm256_set1_ps(line->radius), step = _mm256_set1_ps(line->radiusStep);
+	__m256i columns = _mm256_add_epi32(_mm256_set1_epi32(x), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		// Kept to separate multiplies and adds rather than FMA, so the result matches the other kernel sets bit for bit
+		__m256 rx = _mm256_sub_ps(_mm256_add_ps(_mm256_cvtepi32_ps(columns), half), lineX);
+		__m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(rx, dx), ryDy), inv);
+		t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+		__m256 qx = _mm256_sub_ps(rx, _mm256_mul_ps(t, dx)), qy = _mm256_sub_ps(ry, _mm256_mul_ps(t, dy));
+		__m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(qx, qx), _mm256_mul_ps(qy, qy)));
+		__m256 v = _mm256_add_ps(_mm256_sub_ps(_mm256_add_ps(radius, _mm256_mul_ps(t, step)), distance), half);
+		v = _mm256_min_ps(_mm256_max_ps(v, zero), one);
+
+		// The packs work within 128-bit halves, so the two halves' bytes end up in the low 4 bytes of each
+		__m256i words = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(255.0f)), half));
+		__m128i bytes = _mm_packs_epi32(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+		bytes = _mm_packus_epi16(bytes, bytes);
+		_mm_storel_epi64((__m128i*)(out + i), bytes);
+		columns = _mm256_add_epi32(columns, _mm256_set1_epi32(8));
+	}
+	LineRowSSE2(out + i, count - i, x + i, py, line); // Rows across a hand are short, so the last few pixels are worth another four at a time
+}
+
+// Returns the best kernel set the CPU and OS support. AVX2 also needs the OS to save the YMM registers (OSXSAVE and XCR0).
+static int DetectKernels(void) {
+	unsigned int regs1[4] = { 0 }, regs7[4] = { 0 };
+#ifdef _MSC_VER
+	__cpuid((int*)regs1, 1);
+	__cpuidex((int*)regs7, 7, 0);
+#else
+	if (!__get_cpuid(1, &regs1[0], &regs1[1], &regs1[2], &regs1[3])) return FRAMEBUFFER_KERNELS_SCALAR;
+	__cpuid_count(7, 0, regs7[0], regs7[1], regs7[2], regs7[3]);
+#endif
+
+	if (!(regs1[3] & (1u << 26))) return FRAMEBUFFER_KERNELS_SCALAR;
+
+	if ((regs1[2] & (1u << 27)) && (regs1[2] & (1u << 28))) {
+#ifdef _MSC_VER
+		unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned int xcr0Low, xcr0High;
+		__asm__ volatile ("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+		unsigned long long xcr0 = ((unsigned long long)xcr0High << 32) | xcr0Low;
+#endif
+		if ((xcr0 & 6) == 6 && (regs7[1] & (1u << 5))) {
+			return FRAMEBUFFER_KERNELS_AVX2;
+		}
+	}
+
+	return FRAMEBUFFER_KERNELS_SSE2;
+}
+#else
+static int DetectKernels(void) {
+	return FRAMEBUFFER_KERNELS_SCALAR;
+}
+#endif
+
+int FramebufferSetKernels(int requested) {
+	int best = DetectKernels();
+	int set = requested < best ? requested : best;
+	if (set < FRAMEBUFFER_KERNELS_SCALAR) set = FRAMEBUFFER_KERNELS_SCALAR;
+
+	switch (set) {
+#ifdef FRAMEBUFFER_X86
+	case FRAMEBUFFER_KERNELS_AVX2:
+		FillSpan = FillSpanAVX2;
+		BlendSpan = BlendSpanAVX2;
+		BlurRow = BlurRowAVX2;
+		LineRow = LineRowAVX2;
+		break;
+	case FRAMEBUFFER_KERNELS_SSE2:
+		FillSpan = FillSpanSSE2;
+		BlendSpan = BlendSpanSSE2;
+		BlurRow = BlurRowSSE2;
+		LineRow = LineRowSSE2;
+		break;
+#endif
+	default:
+		FillSpan = FillSpanScalar;
+		BlendSpan = BlendSpanScalar;
+		BlurRow = BlurRowScalar;
+		LineRow = LineRowScalar;
+		break;
+	}
+
+	kernelSet = set;
+	return set;
+}
+
+int FramebufferGetKernels(void) {
+	if (kernelSet < 0) {
+		FramebufferSetKernels(FRAMEBUFFER_KERNELS_AVX2);
+	}
+	return kernelSet;
+}
+
+const char* FramebufferKernelName(int set) {
+	switch (set) {
+	case FRAMEBUFFER_KERNELS_AVX2: return "avx2";
+	case FRAMEBUFFER_KERNELS_SSE2: return "sse2";
+	default: return "scalar";
+	}
+}
+
+int InitFramebuffer(Framebuffer* fb, int width, int height) {
+	memset(fb, 0, sizeof(*fb));
+	if (width <= 0 || height <= 0) return 0;
+
+	fb->pixels = (uint32_t*)calloc((size_t)width * height, sizeof(uint32_t));
+	if (!fb->pixels) return 0;
+
+	fb->width = width;
+	fb->height = height;
+	fb->stride = width;
+	fb->ownsPixels = 1;
+	FramebufferFill(fb, NULL, FRAMEBUFFER_RGB(0, 0, 0));
+	return 1;
+}
+
+void WrapFramebuffer(Framebuffer* fb, void* pixels, int width, int height, int stride) {
+	fb->pixels = (uint32_t*)pixels;
+	fb->width = pixels ? width : 0;
+	fb->height = pixels ? height : 0;
+	fb->stride = stride;
+	fb->ownsPixels = 0;
+}
+
+void FreeFramebuffer(Framebuffer* fb) {
+	if (fb->ownsPixels) {
+		free(fb->pixels);
+	}
+	memset(fb, 0, sizeof(*fb));
+}
+
+// Intersects a rectangle (or the whole framebuffer for NULL) with the framebuffer. Returns 0 if nothing is left.
+static int ClipToFramebuffer(const Framebuffer* fb, const FramebufferRect* rect, FramebufferRect* out) {
+	out->left = 0;
+	out->top = 0;
+	out->right = fb->width;
+	out->bottom = fb->height;
+
+	if (rect) {
+		if (rect->left > out->left) out->left = rect->left;
+		if (rect->top > out->top) out->top = rect->top;
+		if (rect->right < out->right) out->right = rect->right;
+		if (rect->bottom < out->bottom) out->bottom = rect->bottom;
+	}
+
+	return fb->pixels && out->left < out->right && out->top < out->bottom;
+}
+
+void FramebufferFill(Framebuffer* fb, const FramebufferRect* rect, uint32_t color) {
+	FramebufferRect area;
+	if (!ClipToFramebuffer(fb, rect, &area)) return;
+
+	FramebufferGetKernels();
+	for (int y = area.top; y < area.bottom; y++) {
+		FillSpan(fb->pixels + (size_t)y * fb->stride + area.left, area.right - area.left, color);
+	}
+}
+
+void FramebufferFillGradient(Framebuffer* fb, const FramebufferRect* rect, const FramebufferRect* clip, uint32_t top, uint32_t bottom) {
+	FramebufferRect full = { 0, 0, fb->width, fb->height };
+	if (!rect) rect = &full;
+
+	FramebufferRect clipped, area;
+	if (!ClipToFramebuffer(fb, rect, &clipped) || !ClipToFramebuffer(fb, clip, &area)) return;
+	if (clipped.left > area.left) area.left = clipped.left;
+	if (clipped.top > area.top) area.top = clipped.top;
+	if (clipped.right < area.right) area.right = clipped.right;
+	if (clipped.bottom < area.bottom) area.bottom = clipped.bottom;
+	if (area.left >= area.right || area.top >= area.bottom) return;
+
+	// Each row is one color, so the gradient is just a fill per row. The interpolation runs over the whole rectangle even if part of it is clipped off
+	int height = rect->bottom - rect->top;
+	FramebufferGetKernels();
+	for (int y = area.top; y < area.bottom; y++) {
+		int t = y - rect->top, u = height - t;
+		uint32_t color = 0;
+		for (int shift = 0; shift < 32; shift += 8) {
+			uint32_t channel = (((top >> shift) & 0xFF) * u + ((bottom >> shift) & 0xFF) * t) / height;
+			color |= channel << shift;
+		}
+		FillSpan(fb->pixels + (size_t)y * fb->stride + area.left, area.right - area.left, color);
+	}
+}
+
+void FramebufferCopy(Framebuffer* dst, const Framebuffer* src, const FramebufferRect* rect) {
+	FramebufferRect clipped, area;
+	if (!ClipToFramebuffer(dst, rect, &clipped) || !ClipToFramebuffer(src, &clipped, &area)) return;
+
+	for (int y = area.top; y < area.bottom; y++) {
+		memcpy(dst->pixels + (size_t)y * dst->stride + area.left, src->pixels + (size_t)y * src->stride + area.left, (size_t)(area.right - area.left) * sizeof(uint32_t));
+	}
+}
+
+void FramebufferBlendMask(Framebuffer* fb, int x, int y, const uint8_t* mask, int maskStride, int width, int height, uint32_t color, const FramebufferRect* clip) {
+	FramebufferRect area;
+	if (!ClipToFramebuffer(fb, clip, &area)) return;
+
+	int x0 = x > area.left ? x : area.left;
+	int y0 = y > area.top ? y : area.top;
+	int x1 = x + width < area.right ? x + width : area.right;
+	int y1 = y + height < area.bottom ? y + height : area.bottom;
+	if (x0 >= x1 || y0 >= y1) return;
+
+	FramebufferGetKernels();
+	for (int row = y0; row < y1; row++) {
+		BlendSpan(fb->pixels + (size_t)row * fb->stride + x0, mask + (size_t)(row - y) * maskStride + (x0 - x), x1 - x0, color);
+	}
+}
+
+void FramebufferDrawLine(Framebuffer* fb, float x0, float y0, float x1, float y1, float r0, float r1, uint32_t color, const FramebufferRect* clip) {
+	FramebufferRect area;
+	if (!ClipToFramebuffer(fb, clip, &area)) return;
+
+	// Anything with coverage lies within the larger half width and half a pixel of the line
+	float reach = (r0 > r1 ? r0 : r1) + 0.5f;
+	float left = (x0 < x1 ? x0 : x1) - reach, right = (x0 > x1 ? x0 : x1) + reach;
+	float top = (y0 < y1 ? y0 : y1) - reach, bottom = (y0 > y1 ? y0 : y1) + reach;
+	if (left > area.left) area.left = (int)floorf(left);
+	if (top > area.top) area.top = (int)floorf(top);
+	if (right < area.right) area.right = (int)ceilf(right);
+	if (bottom < area.bottom) area.bottom = (int)ceilf(bottom);
+	if (area.left >= area.right || area.top >= area.bottom) return;
+
+	LineShape line;
+	line.x = x0;
+	line.y = y0;
+	line.dx = x1 - x0;
+	line.dy = y1 - y0;
+	float lengthSquared = line.dx * line.dx + line.dy * line.dy;
+	line.invLengthSquared = lengthSquared > 0.0f ? 1.0f / lengthSquared : 0.0f;
+	line.radius = r0;
+	line.radiusStep = r1 - r0;
+
+	// Along a slanted line each row only crosses a short run of its box: the columns within 'reach' of the line through both ends.
+	// Only that run is covered and blended, so a long diagonal line costs about as much as a straight one
+	float length = sqrtf(lengthSquared);
+	float normalX = length > 0.0f ? -line.dy / length : 0.0f, normalY = length > 0.0f ? line.dx / length : 0.0f;
+	int isSlanted = normalX > 0.001f || normalX < -0.001f;
+
+	uint8_t coverage[256];
+	FramebufferGetKernels();
+	for (int y = area.top; y < area.bottom; y++) {
+		float py = (float)y + 0.5f;
+		int start = area.left, end = area.right;
+		if (isSlanted) {
+			// Solve normalX * (px - x0) + normalY * (py - y0) = +-reach for px, the pixel centers at the edges of the band
+			float center = x0 - normalY * (py - y0) / normalX;
+			float spread = reach / (normalX < 0.0f ? -normalX : normalX);
+			float bandStart = floorf(center - spread - 0.5f), bandEnd = ceilf(center + spread + 0.5f);
+			if (bandStart > (float)start) start = bandStart < (float)end ? (int)bandStart : end;
+			if (bandEnd < (float)end) end = bandEnd > (float)start ? (int)bandEnd : start;
+		}
+
+		uint32_t* dst = fb->pixels + (size_t)y * fb->stride;
+		for (int x = start; x < end; x += 256) {
+			int count = end - x < 256 ? end - x : 256;
+			LineRow(coverage, count, x, py, &line);
+			BlendSpan(dst + x, coverage, count, color);
+		}
+	}
+}
+
+// Box blurs every column of a mask from 'src' into 'dst'. Outside the mask counts as empty. 'zeros' is a row of zeros and 'sums' a row of scratch, both 'width' long.
+static void BlurColumns(const uint8_t* src, uint8_t* dst, int width, int height, int radius, const uint8_t* zeros, uint16_t* sums) {
+	uint16_t scale = (uint16_t)(65536 / (radius * 2 + 1)); // Rounded down, so a full window of 255 never comes out as 256
+	uint16_t bias = (uint16_t)radius;
+
+	// Fill the window with the rows above the first output. The averages written for them are thrown away
+	memset(sums, 0, (size_t)width * sizeof(uint16_t));
+	for (int y = 0; y < radius && y < height; y++) {
+		BlurRow(sums, src + (size_t)y * width, zeros, dst, width, scale, bias);
+	}
+
+	for (int y = 0; y < height; y++) {
+		const uint8_t* entering = y + radius < height ? src + (size_t)(y + radius) * width : zeros;
+		const uint8_t* leaving = y - radius >= 0 ? src + (size_t)(y - radius) * width : zeros;
+		BlurRow(sums, entering, leaving, dst + (size_t)y * width, width, scale, bias);
+	}
+}
+
+static void TransposeBlockScalar(const uint8_t* src, int srcStride, uint8_t* dst, int dstStride, int width, int height) {
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			dst[(size_t)x * dstStride + y] = src[(size_t)y * srcStride + x];
+		}
+	}
+}
+
+#ifdef FRAMEBUFFER_X86
+// Transposes a 16x16 block of bytes in registers: four rounds of interleaving, each doubling the size of the units that are in place
+FRAMEBUFFER_TARGET("sse2")
+static void TransposeBlockSSE2(const uint8_t* src, int srcStride, uint8_t* dst, int dstStride) {
+	__m128i rows[16], next[16];
+	for (int i = 0; i < 16; i++) {
+		rows[i] = _mm_loadu_si128((const __m128i*)(src + (size_t)i * srcStride));
+	}
+
+	for (int i = 0; i < 8; i++) {
+		next[i * 2] = _mm_unpacklo_epi8(rows[i * 2], rows[i * 2 + 1]);
+		next[i * 2 + 1] = _mm_unpackhi_epi8(rows[i * 2], rows[i * 2 + 1]);
+	}
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 2; j++) {
+			rows[i * 4 + j * 2] = _mm_unpacklo_epi16(next[i * 4 + j], next[i * 4 + j + 2]);
+			rows[i * 4 + j * 2 + 1] = _mm_unpackhi_epi16(next[i * 4 + j], next[i * 4 + j + 2]);
+		}
+	}
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 4; j++) {
+			next[i * 8 + j * 2] = _mm_unpacklo_epi32(rows[i * 8 + j], rows[i * 8 + j + 4]);
+			next[i * 8 + j * 2 + 1] = _mm_unpackhi_epi32(rows[i * 8 + j], rows[i * 8 + j + 4]);
+		}
+	}
+	for (int j = 0; j < 8; j++) {
+		rows[j * 2] = _mm_unpacklo_epi64(next[j], next[j + 8]);
+		rows[j * 2 + 1] = _mm_unpackhi_epi64(next[j], next[j + 8]);
+	}
+
+	for (int i = 0; i < 16; i++) {
+		_mm_storeu_si128((__m128i*)(dst + (size_t)i * dstStride), rows[i]);
+	}
+}
+#endif
+
+// Transposes a width x height mask into a height x width one, in 16x16 blocks so both sides stay in cache.
+static void TransposeMask(const uint8_t* src, uint8_t* dst, int width, int height) {
+	for (int by = 0; by < height; by += 16) {
+		for (int bx = 0; bx < width; bx += 16) {
+			int blockWidth = width - bx < 16 ? width - bx : 16;
+			int blockHeight = height - by < 16 ? height - by : 16;
+			const uint8_t* from = src + (size_t)by * width + bx;
+			uint8_t* to = dst + (size_t)bx * height + by;
+#ifdef FRAMEBUFFER_X86
+			if (kernelSet >= FRAMEBUFFER_KERNELS_SSE2 && blockWidth == 16 && blockHeight == 16) {
+				TransposeBlockSSE2(from, width, to, height);
+				continue;
+			}
+#endif
+			TransposeBlockScalar(from, width, to, height, blockWidth, blockHeight);
+		}
+	}
+}
+
+int FramebufferBlurMask(uint8_t* mask, int width, int height, int stride, int radius, int passes) {
+	if (width <= 0 || height <= 0 || radius <= 0 || passes <= 0) return 1;
+	if (radius > FRAMEBUFFER_MAX_BLUR) radius = FRAMEBUFFER_MAX_BLUR;
+
+	// Both passes run down columns, so rows are contiguous for the SIMD kernels. The horizontal one runs on a transposed copy
+	size_t size = (size_t)width * height;
+	int longest = width > height ? width : height;
+	uint8_t* a = (uint8_t*)malloc(size);
+	uint8_t* b = (uint8_t*)malloc(size);
+	uint8_t* zeros = (uint8_t*)calloc((size_t)longest, 1);
+	uint16_t* sums = (uint16_t*)malloc((size_t)longest * sizeof(uint16_t));
+	int result = a && b && zeros && sums;
+
+	if (result) {
+		FramebufferGetKernels();
+		for (int y = 0; y < height; y++) {
+			memcpy(a + (size_t)y * width, mask + (size_t)y * stride, width);
+		}
+
+		for (int i = 0; i < passes; i++) {
+			BlurColumns(a, b, width, height, radius, zeros, sums);
+			uint8_t* swap = a; a = b; b = swap;
+		}
+
+		TransposeMask(a, b, width, height);
+		for (int i = 0; i < passes; i++) {
+			BlurColumns(b, a, height, width, radius, zeros, sums);
+			uint8_t* swap = a; a = b; b = swap;
+		}
+		TransposeMask(b, a, height, width);
+
+		for (int y = 0; y < height; y++) {
+			memcpy(mask + (size_t)y * stride, a + (size_t)y * width, width);
+		}
+	}
+
+	free(a);
+	free(b);
+	free(zeros);
+	free(sums);
+	return result;
+}
+
+int WriteFramebufferPPM(const Framebuffer* fb, const char* path) {
+	FILE* file = fopen(path, "wb");
+	if (!file) return 0;
+
+	fprintf(file, "P6\n%d %d\n255\n", fb->width, fb->height);
+
+	uint8_t* row = (uint8_t*)malloc((size_t)fb->width * 3 + 1);
+	int result = row != NULL;
+	for (int y = 0; result && y < fb->height; y++) {
+		const uint32_t* src = fb->pixels + (size_t)y * fb->stride;
+		for (int x = 0; x < fb->width; x++) {
+			row[x * 3] = (uint8_t)(src[x] >> 16);
+			row[x * 3 + 1] = (uint8_t)(src[x] >> 8);
+			row[x * 3 + 2] = (uint8_t)src[x];
+		}
+		result = fwrite(row, 3, (size_t)fb->width, file) == (size_t)fb->width;
+	}
+
+	free(row);
+	return fclose(file) == 0 && result;
+}
+
+static uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t length) {
+	static uint32_t table[256];
+	if (!table[1]) {
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++) {
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			table[n] = c;
+		}
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < length; i++) {
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void PutBigEndian(uint8_t* p, uint32_t value) {
+	p[0] = (uint8_t)(value >> 24);
+	p[1] = (uint8_t)(value >> 16);
+	p[2] = (uint8_t)(value >> 8);
+	p[3] = (uint8_t)value;
+}
+
+static int WriteChunk(FILE* file, const char* type, const uint8_t* data, uint32_t length) {
+	uint8_t header[8], footer[4];
+	PutBigEndian(header, length);
+	memcpy(header + 4, type, 4);
+	PutBigEndian(footer, Crc32(Crc32(0, header + 4, 4), data, length));
+
+	return fwrite(header, 1, 8, file) == 8 && (length == 0 || fwrite(data, 1, length, file) == length) && fwrite(footer, 1, 4, file) == 4;
+}
+
+// The image data is a zlib stream of "stored" deflate blocks, which needs no compressor. The files are bigger than they could be, but they're only for tests and profiling.
+int WriteFramebufferPNG(const Framebuffer* fb, const char* path) {
+	size_t rowBytes = (size_t)fb->width * 3 + 1; // Filter type byte, then RGB
+	size_t rawSize = rowBytes * fb->height;
+	size_t blocks = (rawSize + 65534) / 65535;
+	if (blocks == 0) blocks = 1;
+	size_t idatSize = 2 + blocks * 5 + rawSize + 4;
+	if (idatSize > 0x7FFFFFFF) return 0;
+
+	uint8_t* raw = (uint8_t*)malloc(rawSize ? rawSize : 1);
+	uint8_t* idat = (uint8_t*)malloc(idatSize);
+	if (!raw || !idat) {
+		free(raw);
+		free(idat);
+		return 0;
+	}
+
+	for (int y = 0; y < fb->height; y++) {
+		uint8_t* dst = raw + y * rowBytes;
+		const uint32_t* src = fb->pixels + (size_t)y * fb->stride;
+		*dst++ = 0;
+		for (int x = 0; x < fb->width; x++) {
+			*dst++ = (uint8_t)(src[x] >> 16);
+			*dst++ = (uint8_t)(src[x] >> 8);
+			*dst++ = (uint8_t)src[x];
+		}
+	}
+
+	uint8_t* p = idat;
+	*p++ = 0x78; // Deflate with a 32K window
+	*p++ = 0x01; // No preset dictionary, fastest level. Makes the header a multiple of 31
+	uint32_t adlerA = 1, adlerB = 0;
+	size_t offset = 0;
+	for (size_t i = 0; i < blocks; i++) {
+		size_t length = rawSize - offset < 65535 ? rawSize - offset : 65535;
+		*p++ = (uint8_t)(i == blocks - 1); // BFINAL, BTYPE = stored
+		*p++ = (uint8_t)length;
+		*p++ = (uint8_t)(length >> 8);
+		*p++ = (uint8_t)~length;
+		*p++ = (uint8_t)(~length >> 8);
+		memcpy(p, raw + offset, length);
+		p += length;
+
+		for (size_t j = 0; j < length; j++) {
+			adlerA = (adlerA + raw[offset + j]) % 65521;
+			adlerB = (adlerB + adlerA) % 65521;
+		}
+		offset += length;
+	}
+	PutBigEndian(p, (adlerB << 16) | adlerA);
+
+	uint8_t ihdr[13];
+	PutBigEndian(ihdr, (uint32_t)fb->width);
+	PutBigEndian(ihdr + 4, (uint32_t)fb->height);
+	ihdr[8] = 8; // Bits per channel
+	ihdr[9] = 2; // Truecolor
+	ihdr[10] = 0; // Deflate
+	ihdr[11] = 0; // Adaptive filtering
+	ihdr[12] = 0; // Not interlaced
+
+	int result = 0;
+	FILE* file = fopen(path, "wb");
+	if (file) {
+		static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		result = fwrite(signature, 1, 8, file) == 8 && WriteChunk(file, "IHDR", ihdr, 13) &&
+			WriteChunk(file, "IDAT", idat, (uint32_t)idatSize) && WriteChunk(file, "IEND", NULL, 0);
+		result = (fclose(file) == 0) && result;
+	}
+
+	free(raw);
+	free(idat);
+	return result;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_FRAMEBUFFER_H__
+#define __CLOCK_FRAMEBUFFER_H__
+
+// A 32-bit BGRA pixel buffer and the CPU drawing routines that work on it.
+// On Windows the framebuffer wraps the render surface's DIB section and GDI only copies it to the window,
+// anywhere else it owns its memory and can be written out as PPM or PNG, which is what the headless tools use.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FRAMEBUFFER_RGB(r, g, b) (0xFF000000u | ((uint32_t)(r) << 16) | ((uint32_t)(g) << 8) | (uint32_t)(b)) // Opaque pixel in the framebuffer's byte order (B, G, R, A in memory)
+
+// Kernel sets, best last. FramebufferSetKernels can force a lower one so the outputs can be compared against each other.
+#define FRAMEBUFFER_KERNELS_SCALAR	0
+#define FRAMEBUFFER_KERNELS_SSE2	1
+#define FRAMEBUFFER_KERNELS_AVX2	2
+
+#define FRAMEBUFFER_MAX_BLUR 127 // Largest box blur radius. The window's sum has to fit a 16-bit lane
+
+typedef struct __Framebuffer {
+	uint32_t* pixels;
+	int width;
+	int height;
+	int stride; // Pixels between the start of two rows
+	int ownsPixels; // Set when the pixels were allocated by InitFramebuffer
+} Framebuffer;
+
+// Same layout as a Win32 RECT: right and bottom are exclusive
+typedef struct __FramebufferRect {
+	int32_t left;
+	int32_t top;
+	int32_t right;
+	int32_t bottom;
+} FramebufferRect;
+
+int InitFramebuffer(Framebuffer*, int, int); // Allocates a width x height framebuffer cleared to black. Returns 0 if out of memory
+void WrapFramebuffer(Framebuffer*, void*, int, int, int); // Points a framebuffer at pixels owned by someone else. Takes the pixels, width, height and stride in pixels
+void FreeFramebuffer(Framebuffer*); // Releases the pixels if the framebuffer owns them
+
+void FramebufferFill(Framebuffer*, const FramebufferRect*, uint32_t); // Fills a rectangle with a solid color. A NULL rectangle fills everything
+void FramebufferFillGradient(Framebuffer*, const FramebufferRect*, const FramebufferRect*, uint32_t, uint32_t); // Fills a rectangle with a vertical gradient from the first color at the top to the second at the bottom. Only the part inside the optional clip rectangle is drawn, so the gradient can be drawn in pieces
+void FramebufferCopy(Framebuffer*, const Framebuffer*, const FramebufferRect*); // Copies a rectangle from another framebuffer of the same size
+void FramebufferBlendMask(Framebuffer*, int, int, const uint8_t*, int, int, int, uint32_t, const FramebufferRect*); // Blends a color through 8-bit coverage. Takes the position, the mask with its stride, width and height, the color and an optional clip rectangle
+void FramebufferDrawLine(Framebuffer*, float, float, float, float, float, float, uint32_t, const FramebufferRect*); // Draws an anti-aliased line with round ends. Takes both ends, the half width at each end so the line can taper, the color and an optional clip rectangle
+int FramebufferBlurMask(uint8_t*, int, int, int, int, int); // Box blurs an 8-bit mask in place in both directions. Takes the mask, its width, height and stride, the radius and the number of passes (3 is close to a Gaussian). Returns 0 if out of memory
+
+int FramebufferGetKernels(void); // The kernel set in use. The best one the CPU supports unless overridden. Picks it on the first call, which isn't thread-safe
+int FramebufferSetKernels(int); // Forces a kernel set. Falls back to the best supported one below it and returns what was picked
+const char* FramebufferKernelName(int); // "scalar", "sse2" or "avx2"
+
+int WriteFramebufferPPM(const Framebuffer*, const char*); // Saves the framebuffer as a binary PPM. Returns 0 on failure
+int WriteFramebufferPNG(const Framebuffer*, const char*); // Saves the framebuffer as an uncompressed 24-bit PNG. Returns 0 on failure
+
+#endif // !__CLOCK_FRAMEBUFFER_H__
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "GPSClient.h"
+#include "NMEAParser.h"
+#include "NTPClient.h"
+#include "EventQueue.h"
+#include "Colors.h"
+
+DWORD g_tidGPSThread; // Thread ID for the GPS reader thread
+HANDLE g_hGPSThread; // Handle for the thread itself.
+
+static DWORD lastPPSTick = 0; // GetTickCount at the last rising edge of the PPS signal on the DCD line
+static BOOL hasPPS = FALSE;
+static BOOL lostPPS = FALSE; // Set while the pulses have stopped, so the warning stays up until they come back
+
+// Callback for the NMEA parser. Runs on the GPS thread.
+static void OnGPSTime(const NMEATime* time, void* context) {
+	UNREFERENCED_PARAMETER(context);
+
+	DWORD now = GetTickCount();
+
+	if (g_GPSConfig.usePPS && hasPPS) {
+		if (now - lastPPSTick < GPS_PPS_TIMEOUT_MS) {
+			// The sentence for second N is sent after the pulse that marks the start of second N.
+			// Pin the top-of-second sentence to the edge instead of to when it arrived, which removes the serial latency.
+			// The other sentences of a 5/10 Hz stream would only add jitter, so they're skipped.
+			if (time->milliseconds == 0 && now - lastPPSTick < 1000) {
+				SetReferenceTime(time->seconds, 0, lastPPSTick);
+				lostPPS = FALSE;
+				ClearClockStatus();
+			}
+			return;
+		}
+
+		// The sentences still come but the pulses stopped, e.g. the cable was pulled or the receiver lost its fix. Fall back to the sentences until edges come back
+		hasPPS = FALSE;
+		lostPPS = TRUE;
+		PostClockEvent(CLOCK_EVENT_WARNING, L"Lost the PPS signal from the GPS receiver. Timing the clock from its sentences until the signal comes back.");
+	}
+
+	SetReferenceTime(time->seconds, time->milliseconds, now);
+	if (!lostPPS) {
+		ClearClockStatus();
+	}
+}
+
+// Opens and configures a serial port. Returns INVALID_HANDLE_VALUE on failure.
+static HANDLE OpenSerialPort(const wchar_t* device) {
+	// The \\.\ prefix is required for COM10 and above and harmless for the rest
+	wchar_t path[MAX_PATH];
+	swprintf(path, MAX_PATH, L"\\\\.\\%s", device);
+
+	HANDLE hPort = CreateFileW(path, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+	if (hPort == INVALID_HANDLE_VALUE) {
+		return INVALID_HANDLE_VALUE;
+	}
+
+	DCB dcb;
+	ZeroMemory(&dcb, sizeof(dcb));
+	dcb.DCBlength = sizeof(dcb);
+	GetCommState(hPort, &dcb);
+	dcb.BaudRate = g_GPSConfig.baudRate;
+	dcb.ByteSize = 8;
+	dcb.Parity = NOPARITY;
+	dcb.StopBits = ONESTOPBIT;
+	dcb.fBinary = TRUE;
+	dcb.fDtrControl = DTR_CONTROL_ENABLE; // Some USB receivers don't send anything until DTR is raised
+
+	if (!SetCommState(hPort, &dcb)) {
+		CloseHandle(hPort);
+		return INVALID_HANDLE_VALUE;
+	}
+
+	// Make ReadFile return immediately with whatever is in the driver's queue. We wait on comm events instead.
+	COMMTIMEOUTS timeouts;
+	ZeroMemory(&timeouts, sizeof(timeouts));
+	timeouts.ReadIntervalTimeout = MAXDWORD;
+	SetCommTimeouts(hPort, &timeouts);
+
+	SetCommMask(hPort, EV_RXCHAR | (g_GPSConfig.usePPS ? EV_RLSD : 0));
+	PurgeComm(hPort, PURGE_RXCLEAR);
+
+	return hPort;
+}
+
+// Reads everything currently queued on the port into the parser.
+static BOOL DrainSerialPort(HANDLE hPort, OVERLAPPED* pOverlapped, NMEAParser* parser) {
+	char buffer[GPS_READ_BUFFER];
+
+	for (;;) {
+		DWORD read = 0;
+		ResetEvent(pOverlapped->hEvent);
+
+		if (!ReadFile(hPort, buffer, sizeof(buffer), &read, pOverlapped)) {
+			if (GetLastError() != ERROR_IO_PENDING || !GetOverlappedResult(hPort, pOverlapped, &read, TRUE)) {
+				return FALSE;
+			}
+		}
+
+		if (read == 0) {
+			return TRUE;
+		}
+
+		NMEAFeed(parser, buffer, read);
+	}
+}
+
+// Reads from a serial port, waking up for received characters and, if enabled, for PPS edges on the DCD line.
+static void ReadSerial(HANDLE hPort, NMEAParser* parser) {
+	OVERLAPPED ov;
+	ZeroMemory(&ov, sizeof(ov));
+	ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!ov.hEvent) {
+		return;
+	}
+
+	for (;;) {
+		DWORD mask = 0;
+		DWORD unused = 0;
+		ResetEvent(ov.hEvent);
+
+		if (!WaitCommEvent(hPort, &mask, &ov)) {
+			if (GetLastError() != ERROR_IO_PENDING || !GetOverlappedResult(hPort, &ov, &unused, TRUE)) {
+				break;
+			}
+		}
+
+		if (mask & EV_RLSD) {
+			DWORD modemStatus = 0;
+			if (GetCommModemStatus(hPort, &modemStatus) && (modemStatus & MS_RLSD_ON)) {
+				lastPPSTick = GetTickCount();
+				hasPPS = TRUE;
+			}
+		}
+
+		if ((mask & EV_RXCHAR) && !DrainSerialPort(hPort, &ov, parser)) {
+			break;
+		}
+	}
+
+	CloseHandle(ov.hEvent);
+}
+
+// Reads from a file or named pipe. Used for replaying a captured NMEA log.
+static void ReadStream(HANDLE hFile, NMEAParser* parser) {
+	char buffer[GPS_READ_BUFFER];
+	DWORD read = 0;
+
+	while (ReadFile(hFile, buffer, sizeof(buffer), &read, NULL) && read > 0) {
+		NMEAFeed(parser, buffer, read);
+	}
+}
+
+DWORD WINAPI GPSThread(LPVOID lpParam) {
+	UNREFERENCED_PARAMETER(lpParam);
+
+	const wchar_t* device = g_GPSConfig.device ? g_GPSConfig.device : L"COM1";
+	BOOL isSerial = (_wcsnicmp(device, L"COM", 3) == 0);
+
+	blue();
+	wprintf(L"Starting GPS reader on '%s' (%s, %lu baud, PPS %s).\r\n", device, isSerial ? L"serial" : L"file", g_GPSConfig.baudRate, g_GPSConfig.usePPS ? L"on" : L"off");
+	reset();
+
+	NMEAParser parser; // Lives on this thread's stack for its whole lifetime. Nothing is allocated per sentence.
+	NMEAInit(&parser, OnGPSTime, NULL);
+
+	for (;;) {
+		HANDLE hDevice = isSerial ? OpenSerialPort(device) : CreateFileW(device, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+		if (hDevice == INVALID_HANDLE_VALUE) {
+			PostClockEvent(CLOCK_EVENT_ERROR, L"Error getting GPS time: could not open '%s' (0x%x). Please check that the receiver is plugged in and that the device name and baud rate in the settings are correct.", device, GetLastError());
+			if (!isSerial) {
+				return 1;
+			}
+
+			// USB receivers come and go, so keep trying
+			Sleep(GPS_REOPEN_MS);
+			continue;
+		}
+
+		if (isSerial) {
+			ReadSerial(hDevice, &parser);
+		}
+		else {
+			ReadStream(hDevice, &parser);
+		}
+
+		wprintf(L"GPS reader stopped. Sentences: %lu, checksum errors: %lu, timestamps: %lu\r\n", parser.sentences, parser.checksumErrors, parser.timestamps);
+		CloseHandle(hDevice);
+
+		// A replay ends at the end of the file. A serial port only stops if the receiver went away.
+		if (!isSerial) {
+			return 0;
+		}
+
+		PostClockEvent(CLOCK_EVENT_WARNING, L"Lost the GPS receiver on '%s'. Reconnecting.", device);
+		hasPPS = FALSE;
+		lostPPS = FALSE;
+		Sleep(GPS_REOPEN_MS);
+	}
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_GPS_CLIENT_H__
+#define __CLOCK_GPS_CLIENT_H__
+
+#include "Clock.h"
+#include "Config.h"
+
+#define GPS_READ_BUFFER 512 // Bytes read from the receiver per ReadFile. A 10 Hz RMC+ZDA stream is well under 2 KB a second.
+#define GPS_REOPEN_MS 10000 // How long to wait before trying to open the receiver again after it failed or was unplugged
+#define GPS_PPS_TIMEOUT_MS 1500 // A pulse older than this means the PPS line went quiet, and the sentences time the clock until edges come back
+
+extern DWORD g_tidGPSThread; // Thread ID for the GPS reader thread
+extern HANDLE g_hGPSThread; // Handle for the thread itself.
+
+DWORD WINAPI GPSThread(LPVOID); // Reads NMEA sentences from the configured serial port (or file/pipe for replays) and feeds them into the adjusted time. See NMEAParser.c
+
+#endif // !__CLOCK_GPS_CLIENT_H__
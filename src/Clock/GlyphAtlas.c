@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "GlyphAtlas.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int IsDigit(wchar_t ch) {
+	return ch >= L'0' && ch <= L'9';
+}
+
+int BuildGlyphAtlas(GlyphAtlas* atlas, const GlyphBackend* backend, const wchar_t* charset) {
+	memset(atlas, 0, sizeof(*atlas));
+
+	GlyphFontMetrics metrics;
+	backend->GetMetrics(backend->context, &metrics);
+	if (metrics.lineHeight <= 0 || metrics.maxAdvance <= 0) {
+		return 0;
+	}
+
+	// Leave room on both sides for glyphs that ink outside their advance (italics, wide strokes)
+	int pad = metrics.lineHeight / 4 + 1;
+	int cellWidth = metrics.maxAdvance + pad * 2;
+	int cellHeight = metrics.lineHeight;
+	size_t count = wcslen(charset);
+	if (count > GLYPH_ATLAS_MAX_GLYPHS) {
+		count = GLYPH_ATLAS_MAX_GLYPHS;
+	}
+
+	// Worst case every glyph fills its cell. Trimmed afterwards by only copying the inked area.
+	uint8_t* cells = (uint8_t*)calloc(count, (size_t)cellWidth * cellHeight);
+	if (!cells) {
+		return 0;
+	}
+
+	int atlasWidth = 0;
+	for (size_t i = 0; i < count; i++) {
+		uint8_t* cell = cells + i * (size_t)cellWidth * cellHeight;
+		AtlasGlyph* glyph = &atlas->glyphs[i];
+		glyph->ch = charset[i];
+		glyph->advance = backend->Rasterize(backend->context, charset[i], cell, cellWidth, cellHeight, pad);
+
+		// Find the inked area
+		int left = cellWidth, right = -1, top = cellHeight, bottom = -1;
+		for (int y = 0; y < cellHeight; y++) {
+			for (int x = 0; x < cellWidth; x++) {
+				if (cell[y * cellWidth + x]) {
+					if (x < left) left = x;
+					if (x > right) right = x;
+					if (y < top) top = y;
+					if (y > bottom) bottom = y;
+				}
+			}
+		}
+
+		if (right < 0) {
+			// Nothing inked (space)
+			glyph->width = glyph->height = 0;
+			continue;
+		}
+
+		glyph->width = right - left + 1;
+		glyph->height = bottom - top + 1;
+		glyph->offsetX = left - pad;
+		glyph->offsetY = top;
+		glyph->atlasX = atlasWidth;
+		atlasWidth += glyph->width + 1; // One pixel gutter so nothing bleeds between glyphs if the atlas is ever filtered
+
+		if (IsDigit(glyph->ch) && glyph->advance > atlas->digitAdvance) {
+			atlas->digitAdvance = glyph->advance;
+		}
+	}
+
+	atlas->glyphCount = (int)count;
+	atlas->lineHeight = cellHeight;
+	atlas->width = atlasWidth > 0 ? atlasWidth : 1;
+	atlas->height = cellHeight;
+	atlas->pixels = (uint8_t*)calloc((size_t)atlas->width * atlas->height, 1);
+	if (!atlas->pixels) {
+		free(cells);
+		return 0;
+	}
+
+	for (int i = 0; i < atlas->glyphCount; i++) {
+		const AtlasGlyph* glyph = &atlas->glyphs[i];
+		const uint8_t* cell = cells + i * (size_t)cellWidth * cellHeight;
+		for (int y = 0; y < glyph->height; y++) {
+			memcpy(atlas->pixels + (size_t)y * atlas->width + glyph->atlasX,
+				cell + (size_t)(glyph->offsetY + y) * cellWidth + glyph->offsetX + pad, (size_t)glyph->width);
+		}
+	}
+
+	free(cells);
+	return 1;
+}
+
+void FreeGlyphAtlas(GlyphAtlas* atlas) {
+	free(atlas->pixels);
+	memset(atlas, 0, sizeof(*atlas));
+}
+
+const AtlasGlyph* FindAtlasGlyph(const GlyphAtlas* atlas, wchar_t ch) {
+	for (int i = 0; i < atlas->glyphCount; i++) {
+		if (atlas->glyphs[i].ch == ch) {
+			return &atlas->glyphs[i];
+		}
+	}
+	return NULL;
+}
+
+int GlyphRunAdvance(const GlyphAtlas* atlas, wchar_t ch) {
+	if (IsDigit(ch)) {
+		return atlas->digitAdvance;
+	}
+
+	const AtlasGlyph* glyph = FindAtlasGlyph(atlas, ch);
+	return glyph ? glyph->advance : atlas->digitAdvance / 2;
+}
+
+int MeasureGlyphRun(const GlyphAtlas* atlas, const wchar_t* text, int length) {
+	int width = 0;
+	for (int i = 0; i < length; i++) {
+		width += GlyphRunAdvance(atlas, text[i]);
+	}
+	return width;
+}
+
+void DrawGlyphRun(const GlyphAtlas* atlas, Framebuffer* fb, const wchar_t* text, int length, int x, int y, uint32_t color, const FramebufferRect* clip) {
+	int penX = x;
+
+	for (int i = 0; i < length; i++) {
+		const AtlasGlyph* glyph = FindAtlasGlyph(atlas, text[i]);
+		int advance = GlyphRunAdvance(atlas, text[i]);
+
+		if (glyph && glyph->width > 0) {
+			// Digits are centered in their tabular cell
+			int cellOffset = IsDigit(text[i]) ? (advance - glyph->advance) / 2 : 0;
+			FramebufferBlendMask(fb, penX + cellOffset + glyph->offsetX, y + glyph->offsetY, atlas->pixels + glyph->atlasX, atlas->width, glyph->width, glyph->height, color, clip);
+		}
+
+		penX += advance;
+	}
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_GLYPH_ATLAS_H__
+#define __CLOCK_GLYPH_ATLAS_H__
+
+// Pre-rasterized glyphs for everything the clock can show.
+// The glyphs come from a backend: GDI on Windows (GlyphBackendGDI.c) or the built-in stroke font (StrokeFont.c) anywhere.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+#include "Framebuffer.h"
+
+#define GLYPH_ATLAS_CHARSET L"0123456789:-. APM" // Every character the display formats can produce
+#define GLYPH_ATLAS_MAX_GLYPHS 32
+
+// Font-wide metrics reported by a backend, in pixels
+typedef struct __GlyphFontMetrics {
+	int lineHeight; // Height of a line of text. Glyphs are rasterized into cells this tall
+	int maxAdvance; // Widest advance in the font. Glyphs are rasterized into cells wide enough for this plus some overhang
+} GlyphFontMetrics;
+
+// A rasterizer for the atlas. Rasterize draws one character as 8-bit coverage into a zeroed cell (stride = cell width)
+// with the pen at (penX, 0), where 0 is the top of the line, and returns its advance width.
+typedef struct __GlyphBackend {
+	void* context;
+	void (*GetMetrics)(void*, GlyphFontMetrics*);
+	int (*Rasterize)(void*, wchar_t, uint8_t*, int, int, int);
+} GlyphBackend;
+
+typedef struct __AtlasGlyph {
+	wchar_t ch;
+	int atlasX; // Left edge of the glyph in the atlas. All glyphs share one row
+	int width; // Size of the inked area
+	int height;
+	int offsetX; // Where the inked area starts, relative to the pen position
+	int offsetY; // Relative to the top of the line
+	int advance;
+} AtlasGlyph;
+
+typedef struct __GlyphAtlas {
+	AtlasGlyph glyphs[GLYPH_ATLAS_MAX_GLYPHS];
+	int glyphCount;
+	int lineHeight;
+	int digitAdvance; // Widest digit. Every digit is laid out in a cell this wide so the text doesn't shift as the digits change
+	uint8_t* pixels; // 8-bit coverage, 'width' bytes per row
+	int width;
+	int height;
+} GlyphAtlas;
+
+int BuildGlyphAtlas(GlyphAtlas*, const GlyphBackend*, const wchar_t*); // Rasterizes the characters of the charset into the atlas. Returns 0 on failure
+void FreeGlyphAtlas(GlyphAtlas*); // Releases the atlas' pixels
+const AtlasGlyph* FindAtlasGlyph(const GlyphAtlas*, wchar_t); // Returns NULL if the character isn't in the atlas
+int GlyphRunAdvance(const GlyphAtlas*, wchar_t); // Advance of one character with tabular digits
+int MeasureGlyphRun(const GlyphAtlas*, const wchar_t*, int); // Width of the first n characters of a string with tabular digits
+void DrawGlyphRun(const GlyphAtlas*, Framebuffer*, const wchar_t*, int, int, int, uint32_t, const FramebufferRect*); // Blends a string into a framebuffer. Takes the string and its length, the position of the top left of the line, the color and an optional clip rectangle
+
+#endif // !__CLOCK_GLYPH_ATLAS_H__
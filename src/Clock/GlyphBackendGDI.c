@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "GlyphBackendGDI.h"
+#include "Colors.h"
+
+// Glyphs are drawn white on black into a 32 bpp DIB section with the user's font, and the brightness of each pixel is taken as its coverage.
+// This only runs when the atlas is built, never per frame.
+
+static void GetGDIMetrics(void* context, GlyphFontMetrics* metrics) {
+	GDIGlyphBackend* gdi = (GDIGlyphBackend*)context;
+
+	TEXTMETRICW tm;
+	GetTextMetricsW(gdi->hDC, &tm);
+	metrics->lineHeight = tm.tmHeight;
+	metrics->maxAdvance = tm.tmMaxCharWidth;
+}
+
+static BOOL EnsureScratch(GDIGlyphBackend* gdi, int width, int height) {
+	if (gdi->hBitmap && gdi->width >= width && gdi->height >= height) {
+		return TRUE;
+	}
+
+	if (gdi->hBitmap) {
+		SelectObject(gdi->hDC, gdi->hOldBitmap);
+		DeleteObject(gdi->hBitmap);
+		gdi->hBitmap = NULL;
+	}
+
+	BITMAPINFO bmi;
+	ZeroMemory(&bmi, sizeof(bmi));
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth = width;
+	bmi.bmiHeader.biHeight = -height;
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 32;
+	bmi.bmiHeader.biCompression = BI_RGB;
+
+	gdi->hBitmap = CreateDIBSection(gdi->hDC, &bmi, DIB_RGB_COLORS, (void**)&gdi->pixels, NULL, 0);
+	if (!gdi->hBitmap) {
+		return FALSE;
+	}
+
+	gdi->hOldBitmap = (HBITMAP)SelectObject(gdi->hDC, gdi->hBitmap);
+	gdi->width = width;
+	gdi->height = height;
+	return TRUE;
+}
+
+static int RasterizeGDIGlyph(void* context, wchar_t ch, uint8_t* cell, int cellWidth, int cellHeight, int penX) {
+	GDIGlyphBackend* gdi = (GDIGlyphBackend*)context;
+
+	SIZE size = { 0, 0 };
+	GetTextExtentPoint32W(gdi->hDC, &ch, 1, &size);
+
+	if (!EnsureScratch(gdi, cellWidth, cellHeight)) {
+		return size.cx;
+	}
+
+	RECT rect = { 0, 0, gdi->width, gdi->height };
+	FillRect(gdi->hDC, &rect, (HBRUSH)GetStockObject(BLACK_BRUSH));
+	TextOutW(gdi->hDC, penX, 0, &ch, 1);
+	GdiFlush();
+
+	for (int y = 0; y < cellHeight; y++) {
+		const uint32_t* row = gdi->pixels + (size_t)y * gdi->width;
+		for (int x = 0; x < cellWidth; x++) {
+			// ClearType renders colored fringes, so average the channels with extra weight on green
+			uint32_t p = row[x];
+			cell[y * cellWidth + x] = (uint8_t)((((p >> 16) & 0xFF) + ((p >> 8) & 0xFF) * 2 + (p & 0xFF)) / 4);
+		}
+	}
+
+	return size.cx;
+}
+
+BOOL CreateGDIGlyphBackend(GDIGlyphBackend* gdi, HFONT hFont, GlyphBackend* backend) {
+	ZeroMemory(gdi, sizeof(*gdi));
+
+	gdi->hDC = CreateCompatibleDC(NULL);
+	if (!gdi->hDC) {
+		return FALSE;
+	}
+
+	gdi->hFont = hFont;
+	gdi->hOldFont = (HFONT)SelectObject(gdi->hDC, hFont);
+	SetBkMode(gdi->hDC, TRANSPARENT);
+	SetTextColor(gdi->hDC, RGB(255, 255, 255));
+
+	backend->context = gdi;
+	backend->GetMetrics = GetGDIMetrics;
+	backend->Rasterize = RasterizeGDIGlyph;
+	return TRUE;
+}
+
+void DestroyGDIGlyphBackend(GDIGlyphBackend* gdi) {
+	if (gdi->hBitmap) {
+		SelectObject(gdi->hDC, gdi->hOldBitmap);
+		DeleteObject(gdi->hBitmap);
+	}
+
+	if (gdi->hDC) {
+		SelectObject(gdi->hDC, gdi->hOldFont);
+		DeleteDC(gdi->hDC);
+	}
+
+	ZeroMemory(gdi, sizeof(*gdi));
+}
+
+BOOL BuildGDIGlyphAtlas(GlyphAtlas* atlas, HFONT hFont) {
+	GDIGlyphBackend gdi;
+	GlyphBackend backend;
+	if (!hFont || !CreateGDIGlyphBackend(&gdi, hFont, &backend)) {
+		return FALSE;
+	}
+
+	BOOL result = BuildGlyphAtlas(atlas, &backend, GLYPH_ATLAS_CHARSET);
+	DestroyGDIGlyphBackend(&gdi);
+
+	if (result) {
+		wprintf(L"Built glyph atlas: %d glyphs, %dx%d pixels, digit cell %d pixels.\r\n", atlas->glyphCount, atlas->width, atlas->height, atlas->digitAdvance);
+	}
+	else {
+		yellow();
+		wprintf(L"Failed to build the glyph atlas. Falling back to TextOutW.\r\n");
+		reset();
+	}
+
+	return result;
+}
+
+BOOL BuildGDISdfAtlas(SdfAtlas* sdf, const WCHAR* face) {
+	// One font at the reference size is enough for every size the text is drawn at. It's antialiased rather than ClearType, since the fringes would end up in the distances
+	HFONT hFont = CreateFont(SDF_REFERENCE_HEIGHT, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH, face);
+	GDIGlyphBackend gdi;
+	GlyphBackend backend;
+	if (!hFont || !CreateGDIGlyphBackend(&gdi, hFont, &backend)) {
+		if (hFont) DeleteObject(hFont);
+		return FALSE;
+	}
+
+	BOOL result = BuildSdfAtlas(sdf, &backend, GLYPH_ATLAS_CHARSET);
+	DestroyGDIGlyphBackend(&gdi);
+	DeleteObject(hFont);
+
+	if (result) {
+		wprintf(L"Built distance field atlas: %d glyphs, %dx%d pixels, spread %d pixels.\r\n", sdf->atlas.glyphCount, sdf->atlas.width, sdf->atlas.height, sdf->spread);
+	}
+	else {
+		yellow();
+		wprintf(L"Failed to build the distance field atlas. Falling back to the glyph atlas.\r\n");
+		reset();
+	}
+
+	return result;
+}
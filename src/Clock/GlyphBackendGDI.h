@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_GLYPH_BACKEND_GDI_H__
+#define __CLOCK_GLYPH_BACKEND_GDI_H__
+
+#include "Clock.h"
+#include "GlyphAtlas.h"
+#include "SdfAtlas.h"
+
+// State for rasterizing glyphs of an HFONT through GDI
+typedef struct __GDIGlyphBackend {
+	HFONT hFont;
+	HDC hDC;
+	HBITMAP hBitmap;
+	HBITMAP hOldBitmap;
+	HFONT hOldFont;
+	uint32_t* pixels;
+	int width;
+	int height;
+} GDIGlyphBackend;
+
+BOOL CreateGDIGlyphBackend(GDIGlyphBackend*, HFONT, GlyphBackend*); // Sets up a glyph backend for the font. The font must stay alive until DestroyGDIGlyphBackend
+void DestroyGDIGlyphBackend(GDIGlyphBackend*); // Releases the DC and bitmap used for rasterizing
+BOOL BuildGDIGlyphAtlas(GlyphAtlas*, HFONT); // Builds an atlas for the clock's characters from a font in one call
+BOOL BuildGDISdfAtlas(SdfAtlas*, const WCHAR*); // Builds a distance field atlas for the clock's characters from a font face at SDF_REFERENCE_HEIGHT
+
+#endif // !__CLOCK_GLYPH_BACKEND_GDI_H__
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Gradient.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GRADIENT_PI 3.14159265358979323846f
+
+// Thresholds for the ordered dither, in 1/16ths of one 8-bit step
+static const uint8_t bayer[4][4] = {
+	{ 0, 8, 2, 10 },
+	{ 12, 4, 14, 6 },
+	{ 3, 11, 1, 9 },
+	{ 15, 7, 13, 5 },
+};
+
+void InitGradient(Gradient* gradient, uint32_t top, uint32_t bottom) {
+	memset(gradient, 0, sizeof(*gradient));
+	AddGradientStop(gradient, 0.0f, top);
+	AddGradientStop(gradient, 1.0f, bottom);
+}
+
+int AddGradientStop(Gradient* gradient, float position, uint32_t color) {
+	if (gradient->stopCount == GRADIENT_MAX_STOPS) {
+		return 0;
+	}
+
+	int i = gradient->stopCount++;
+	for (; i > 0 && gradient->stops[i - 1].position > position; i--) {
+		gradient->stops[i] = gradient->stops[i - 1];
+	}
+	gradient->stops[i].position = position;
+	gradient->stops[i].color = color;
+	return 1;
+}
+
+uint32_t ShiftHue(uint32_t color, float degrees) {
+	if (degrees == 0.0f) {
+		return color;
+	}
+
+	// Rotate the color around the gray axis. Cheaper than going through HSV, and close enough for a slowly drifting background
+	float r = (float)((color >> 16) & 0xFF), g = (float)((color >> 8) & 0xFF), b = (float)(color & 0xFF);
+	float c = cosf(degrees * GRADIENT_PI / 180.0f), s = sinf(degrees * GRADIENT_PI / 180.0f);
+	float k = (1.0f - c) / 3.0f, q = sqrtf(1.0f / 3.0f) * s;
+
+	float channels[3] = {
+		r * (c + k) + g * (k - q) + b * (k + q),
+		r * (k + q) + g * (c + k) + b * (k - q),
+		r * (k - q) + g * (k + q) + b * (c + k),
+	};
+
+	uint32_t result = color & 0xFF000000u;
+	for (int i = 0; i < 3; i++) {
+		float value = channels[i] < 0.0f ? 0.0f : channels[i] > 255.0f ? 255.0f : channels[i];
+		result |= (uint32_t)(value + 0.5f) << (16 - 8 * i);
+	}
+	return result;
+}
+
+static int SameGradient(const Gradient* a, const Gradient* b) {
+	if (a->stopCount != b->stopCount || a->angle != b->angle || a->hueShift != b->hueShift || a->dither != b->dither) {
+		return 0;
+	}
+	for (int i = 0; i < a->stopCount; i++) {
+		if (a->stops[i].position != b->stops[i].position || a->stops[i].color != b->stops[i].color) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Fills the tables by interpolating between the stops. Each entry is the color at the middle of its pixel.
+static void FillColors(GradientLUT* lut) {
+	const Gradient* gradient = &lut->gradient;
+
+	uint32_t stopColors[GRADIENT_MAX_STOPS];
+	for (int i = 0; i < gradient->stopCount; i++) {
+		stopColors[i] = ShiftHue(gradient->stops[i].color, gradient->hueShift);
+	}
+
+	int tables = gradient->dither ? 16 : 1;
+	int stop = 0;
+	for (int i = 0; i < lut->length; i++) {
+		float t = (i + 0.5f) / lut->length;
+		while (stop + 1 < gradient->stopCount && gradient->stops[stop + 1].position <= t) {
+			stop++;
+		}
+
+		uint32_t from = stopColors[stop], to = stopColors[stop];
+		float f = 0.0f;
+		if (stop + 1 < gradient->stopCount && t > gradient->stops[stop].position) {
+			to = stopColors[stop + 1];
+			float span = gradient->stops[stop + 1].position - gradient->stops[stop].position;
+			f = span > 0.0f ? (t - gradient->stops[stop].position) / span : 1.0f;
+		}
+
+		// 8.8 fixed point, so the dither thresholds can be added before dropping the fraction
+		uint32_t channels[3];
+		for (int channel = 0; channel < 3; channel++) {
+			float a = (float)((from >> (8 * channel)) & 0xFF), b = (float)((to >> (8 * channel)) & 0xFF);
+			channels[channel] = (uint32_t)((a + (b - a) * f) * 256.0f);
+		}
+
+		for (int table = 0; table < tables; table++) {
+			uint32_t threshold = gradient->dither ? table * 16 + 8 : 128;
+			uint32_t color = 0xFF000000u;
+			for (int channel = 0; channel < 3; channel++) {
+				uint32_t value = (channels[channel] + threshold) >> 8;
+				color |= (value > 255 ? 255 : value) << (8 * channel);
+			}
+			lut->colors[(size_t)table * lut->length + i] = color;
+		}
+	}
+}
+
+int UpdateGradientLUT(GradientLUT* lut, const Gradient* gradient, int width, int height) {
+	if (lut->colors && lut->width == width && lut->height == height && SameGradient(&lut->gradient, gradient)) {
+		return 0;
+	}
+	if (gradient->stopCount == 0 || width <= 0 || height <= 0) {
+		return 0;
+	}
+
+	// Project every pixel onto the gradient's direction. The table covers the distance between the two corners furthest apart along it
+	float radians = gradient->angle * GRADIENT_PI / 180.0f;
+	float dx = sinf(radians), dy = cosf(radians);
+	if (fabsf(dx) < 1e-6f) dx = 0.0f;
+	if (fabsf(dy) < 1e-6f) dy = 0.0f;
+	float start = (dx < 0.0f ? width * dx : 0.0f) + (dy < 0.0f ? height * dy : 0.0f);
+	int length = (int)ceilf(fabsf(width * dx) + fabsf(height * dy));
+	if (length < 1) length = 1;
+
+	int tables = gradient->dither ? 16 : 1;
+	if (length != lut->length || tables != (lut->gradient.dither ? 16 : 1) || !lut->colors) {
+		uint32_t* colors = (uint32_t*)malloc((size_t)length * tables * sizeof(uint32_t));
+		if (!colors) {
+			return 0;
+		}
+		free(lut->colors);
+		lut->colors = colors;
+		lut->length = length;
+	}
+
+	lut->gradient = *gradient;
+	lut->width = width;
+	lut->height = height;
+	lut->stepX = (int32_t)(dx * 65536.0f);
+	lut->stepY = (int32_t)(dy * 65536.0f);
+	lut->origin = (int32_t)((0.5f * dx + 0.5f * dy - start) * 65536.0f);
+	FillColors(lut);
+	return 1;
+}
+
+void FreeGradientLUT(GradientLUT* lut) {
+	free(lut->colors);
+	memset(lut, 0, sizeof(*lut));
+}
+
+// Draws one row of the gradient from the tables.
+static void DrawRow(const GradientLUT* lut, uint32_t* row, int x0, int x1, int y) {
+	int32_t position = lut->origin + x0 * lut->stepX + y * lut->stepY;
+	int last = lut->length - 1;
+
+	if (!lut->gradient.dither) {
+		for (int x = x0; x < x1; x++, position += lut->stepX) {
+			int index = position >> 16;
+			row[x - x0] = lut->colors[index < 0 ? 0 : index > last ? last : index];
+		}
+		return;
+	}
+
+	// The threshold only depends on x & 3 within a row, so pick the four tables once
+	const uint32_t* tables[4];
+	for (int i = 0; i < 4; i++) {
+		tables[i] = lut->colors + (size_t)bayer[y & 3][i] * lut->length;
+	}
+
+	for (int x = x0; x < x1; x++, position += lut->stepX) {
+		int index = position >> 16;
+		row[x - x0] = tables[x & 3][index < 0 ? 0 : index > last ? last : index];
+	}
+}
+
+void DrawGradient(const GradientLUT* lut, Framebuffer* fb, const FramebufferRect* clip) {
+	if (!lut->colors) return;
+
+	FramebufferRect area = { 0, 0, fb->width, fb->height };
+	if (clip) {
+		if (clip->left > area.left) area.left = clip->left;
+		if (clip->top > area.top) area.top = clip->top;
+		if (clip->right < area.right) area.right = clip->right;
+		if (clip->bottom < area.bottom) area.bottom = clip->bottom;
+	}
+	if (area.left >= area.right || area.top >= area.bottom) return;
+
+	// A horizontal gradient repeats every row, or every fourth row with dithering, so most rows are copies. A vertical one without dithering is a fill per row
+	int period = lut->gradient.dither ? 4 : 1;
+	for (int y = area.top; y < area.bottom; y++) {
+		uint32_t* row = fb->pixels + (size_t)y * fb->stride + area.left;
+		if (lut->stepY == 0 && y - area.top >= period) {
+			memcpy(row, row - (size_t)period * fb->stride, (size_t)(area.right - area.left) * sizeof(uint32_t));
+		}
+		else if (lut->stepX == 0 && !lut->gradient.dither) {
+			FramebufferRect span = { area.left, y, area.right, y + 1 };
+			int index = (lut->origin + y * lut->stepY) >> 16;
+			FramebufferFill(fb, &span, lut->colors[index < 0 ? 0 : index > lut->length - 1 ? lut->length - 1 : index]);
+		}
+		else {
+			DrawRow(lut, row, area.left, area.right, y);
+		}
+	}
+}
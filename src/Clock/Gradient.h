@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __CLOCK_GRADIENT_H__
+#define __CLOCK_GRADIENT_H__
+
+// Gradients with any number of stops at any angle, drawn from a lookup table with one color per pixel along the gradient's direction.
+// The table is only rebuilt when the gradient or the size changes, so a frame costs one table read per pixel.
+
+#include "Framebuffer.h"
+
+#define GRADIENT_MAX_STOPS 8
+
+typedef struct __GradientStop {
+	float position; // 0 at the start of the gradient, 1 at the end
+	uint32_t color; // FRAMEBUFFER_RGB
+} GradientStop;
+
+typedef struct __Gradient {
+	GradientStop stops[GRADIENT_MAX_STOPS]; // In order of position
+	int stopCount;
+	float angle; // Degrees clockwise. 0 runs from top to bottom, 90 from left to right
+	float hueShift; // Degrees added to the hue of every stop
+	int dither; // Adds a 4x4 ordered dither so wide, subtle gradients don't band
+} Gradient;
+
+typedef struct __GradientLUT {
+	Gradient gradient; // What the table was built for
+	int width;
+	int height;
+	uint32_t* colors; // 'length' colors, rounded. With dithering there are 16 tables one after the other instead, one per dither threshold
+	int length;
+	int32_t stepX; // How far along the table one pixel to the right moves, 16.16 fixed point
+	int32_t stepY; // Same for one pixel down
+	int32_t origin; // Position of the center of the top left pixel
+} GradientLUT;
+
+void InitGradient(Gradient*, uint32_t, uint32_t); // A vertical gradient between two colors
+int AddGradientStop(Gradient*, float, uint32_t); // Inserts a stop in position order. Returns 0 if the gradient is full
+int UpdateGradientLUT(GradientLUT*, const Gradient*, int, int); // Rebuilds the table if the gradient or the width and height changed. Returns 1 if it was rebuilt
+void FreeGradientLUT(GradientLUT*); // Releases the table
+void DrawGradient(const GradientLUT*, Framebuffer*, const FramebufferRect*); // Fills the framebuffer with the gradient. Only the part inside the optional clip rectangle is drawn, so it can be drawn in tiles
+uint32_t ShiftHue(uint32_t, float); // Rotates a color's hue by some degrees, keeping its lightness and saturation
+
+#endif // !__CLOCK_GRADIENT_H__
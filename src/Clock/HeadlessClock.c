@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "HeadlessClock.h"
+#include "DisplayModel.h"
+#include "SegmentDisplay.h"
+#include "TilePool.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#define HEADLESS_TEXT_MARGIN 90 // Percentage of the frame's width and height the text may fill, the same as the clock's FONT_FIT_MARGIN
+
+// What every tile of a frame needs. Tiles only read it
+typedef struct __HeadlessFrame {
+	Framebuffer* fb;
+	const HeadlessOptions* options;
+	const GradientLUT* gradient;
+	const SdfAtlas* sdf;
+	const SegmentDisplay* segments; // Drawn instead of the atlas when set
+	SdfStyle style;
+	const wchar_t* text;
+	int length;
+	int x; // Top left of the text
+	int y;
+} HeadlessFrame;
+
+// Where the writer puts the frames: a file or stdout for raw pixels, or NULL for a PNG sequence named by the options' path
+typedef struct __HeadlessOutput {
+	const HeadlessOptions* options;
+	FILE* file;
+} HeadlessOutput;
+
+static int ClampColor(int value) {
+	return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+// A PNG path needs exactly one %d for the frame number, optionally with a zero padded width such as %05d
+static int IsFramePattern(const char* path) {
+	int conversions = 0;
+	for (const char* p = path; *p; p++) {
+		if (*p != '%') continue;
+		p++;
+		if (*p == '0') p++;
+		while (*p >= '0' && *p <= '9') p++;
+		if (*p != 'd') return 0;
+		conversions++;
+	}
+	return conversions == 1;
+}
+
+static double GetWallTime(void) {
+	struct timespec now;
+	timespec_get(&now, TIME_UTC);
+	return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+static void SleepUntil(double when) {
+	double wait = when - GetWallTime();
+	if (wait <= 0.0) return;
+
+#ifdef _WIN32
+	Sleep((DWORD)(wait * 1000.0));
+#else
+	struct timespec delay = { (time_t)wait, (long)((wait - (time_t)wait) * 1000000000.0) };
+	nanosleep(&delay, NULL);
+#endif
+}
+
+void InitHeadlessOptions(HeadlessOptions* options) {
+	memset(options, 0, sizeof(*options));
+	options->width = 1920;
+	options->height = 1080;
+	options->fps = 30;
+	options->format = _HIDE_DATE_24_HOUR_FORMAT_;
+	options->segmentStyle = SEGMENT_STYLE_NONE;
+	options->useGradient = 1;
+	InitGradient(&options->gradient, FRAMEBUFFER_RGB(255, 0, 0), FRAMEBUFFER_RGB(0, 0, 0));
+	options->background = FRAMEBUFFER_RGB(0, 0, 0);
+	options->textColor = FRAMEBUFFER_RGB(255, 255, 255);
+	options->output = HEADLESS_OUTPUT_RAW;
+	strcpy(options->path, "-");
+	options->buffers = 4;
+}
+
+int ParseHeadlessOption(HeadlessOptions* options, int argc, char** argv, int* index) {
+	const char* option = argv[*index];
+	if (strcmp(option, "-l") == 0) {
+		options->live = 1;
+		(*index)++;
+		return 1;
+	}
+	if (strcmp(option, "-d") == 0) {
+		options->gradient.dither = 1;
+		(*index)++;
+		return 1;
+	}
+
+	// Everything else takes a value
+	if (option[0] != '-' || option[1] == '\0' || option[2] != '\0' || !strchr("srntfycgahjbo", option[1])) return 0;
+	if (*index + 1 >= argc) return -1;
+	const char* value = argv[*index + 1];
+	*index += 2;
+
+	switch (option[1]) {
+	case 's':
+		return sscanf(value, "%dx%d", &options->width, &options->height) == 2 && options->width > 0 && options->height > 0 ? 1 : -1;
+	case 'r':
+		options->fps = atoi(value);
+		return options->fps > 0 && options->fps <= 1000 ? 1 : -1;
+	case 'n':
+		options->frames = atol(value);
+		return options->frames >= 0 ? 1 : -1;
+	case 't': {
+		// Local time, like the clock shows
+		struct tm local;
+		memset(&local, 0, sizeof(local));
+		if (sscanf(value, "%d-%d-%d %d:%d:%d", &local.tm_year, &local.tm_mon, &local.tm_mday, &local.tm_hour, &local.tm_min, &local.tm_sec) != 6) return -1;
+		local.tm_year -= 1900;
+		local.tm_mon--;
+		local.tm_isdst = -1;
+		time_t start = mktime(&local);
+		if (start == (time_t)-1) return -1;
+		options->start = (double)start;
+		return 1;
+	}
+	case 'f':
+		options->format = atoi(value);
+		return options->format >= _SHOW_DATE_24_HOUR_FORMAT_ && options->format <= _HIDE_DATE_12_HOUR_FORMAT_ ? 1 : -1;
+	case 'y':
+		options->segmentStyle = strcmp(value, "seven") == 0 ? SEGMENT_STYLE_SEVEN : strcmp(value, "matrix") == 0 ? SEGMENT_STYLE_MATRIX : -1;
+		return options->segmentStyle >= 0 ? 1 : -1;
+	case 'c':
+		return LoadHeadlessColors(options, value) ? 1 : -1;
+	case 'g':
+		options->useGradient = atoi(value) != 0;
+		return 1;
+	case 'a':
+		options->gradient.angle = (float)fmod(atof(value), 360.0);
+		return 1;
+	case 'h':
+		options->hueSpeed = (float)atof(value);
+		return 1;
+	case 'j':
+		options->threads = atoi(value);
+		return options->threads >= 0 ? 1 : -1;
+	case 'b':
+		options->buffers = atoi(value);
+		return options->buffers >= 2 && options->buffers <= FRAME_QUEUE_MAX_FRAMES ? 1 : -1;
+	case 'o': {
+		size_t length = strlen(value);
+		if (length == 0 || length >= sizeof(options->path)) return -1;
+		strcpy(options->path, value);
+		options->output = length > 4 && strcmp(value + length - 4, ".png") == 0 ? HEADLESS_OUTPUT_PNG : HEADLESS_OUTPUT_RAW;
+		return options->output == HEADLESS_OUTPUT_RAW || IsFramePattern(value) ? 1 : -1;
+	}
+	}
+	return -1;
+}
+
+int LoadHeadlessColors(HeadlessOptions* options, const char* path) {
+	FILE* file = fopen(path, "r");
+	if (!file) return 0;
+
+	// The first two lines are always the first two colors, even if one doesn't parse. Any further lines are more stops, with an optional position in percent
+	uint32_t colors[GRADIENT_MAX_STOPS];
+	int positions[GRADIENT_MAX_STOPS];
+	int count = 0, r, g, b, position;
+	char line[128];
+	while (count < GRADIENT_MAX_STOPS && fgets(line, sizeof(line), file)) {
+		int fields = sscanf(line, "( %d, %d, %d ) %d%%", &r, &g, &b, &position);
+		if (fields < 3) {
+			if (count >= 2) continue;
+			r = g = b = 0;
+		}
+		colors[count] = FRAMEBUFFER_RGB(ClampColor(r), ClampColor(g), ClampColor(b));
+		positions[count++] = fields == 4 ? (position < 0 ? 0 : position > 100 ? 100 : position) : -1;
+	}
+	fclose(file);
+
+	while (count < 2) {
+		colors[count] = FRAMEBUFFER_RGB(0, 0, 0);
+		positions[count++] = -1;
+	}
+
+	options->background = colors[0];
+	options->gradient.stopCount = 0;
+	for (int i = 0; i < count; i++) {
+		AddGradientStop(&options->gradient, positions[i] >= 0 ? positions[i] / 100.0f : (float)i / (count - 1), colors[i]);
+	}
+	return 1;
+}
+
+static void DrawHeadlessTile(const FramebufferRect* tile, void* context) {
+	const HeadlessFrame* frame = (const HeadlessFrame*)context;
+	if (frame->options->useGradient) {
+		DrawGradient(frame->gradient, frame->fb, tile);
+	}
+	else {
+		FramebufferFill(frame->fb, tile, frame->options->background);
+	}
+
+	if (frame->segments) {
+		DrawSegmentText(frame->segments, frame->fb, frame->text, frame->length, frame->x, frame->y, frame->options->textColor, 1, tile);
+	}
+	else {
+		DrawSdfRun(frame->sdf, frame->fb, frame->text, frame->length, (float)frame->x, (float)frame->y, &frame->style, tile);
+	}
+}
+
+static int WriteHeadlessFrame(const Framebuffer* fb, long number, void* context) {
+	HeadlessOutput* output = (HeadlessOutput*)context;
+	if (output->file) {
+		// The queue's framebuffers own their pixels, so the rows are packed and already in B, G, R, A order. They go out as they are
+		size_t count = (size_t)fb->width * fb->height;
+		if (fwrite(fb->pixels, sizeof(uint32_t), count, output->file) != count) return 0;
+		return !output->options->live || fflush(output->file) == 0;
+	}
+
+	char path[sizeof(output->options->path) + 32];
+	snprintf(path, sizeof(path), output->options->path, number);
+	return WriteFramebufferPNG(fb, path);
+}
+
+// Writes the time a number of seconds since 1970 shows in the options' format
+static void FormatHeadlessTime(const HeadlessOptions* options, double when, wchar_t* buffer, size_t bufferSize) {
+	time_t seconds = (time_t)floor(when);
+	const struct tm* local = localtime(&seconds); // Only ever called from the drawing thread
+	if (!local) {
+		buffer[0] = L'\0';
+		return;
+	}
+	FormatDisplayTime(buffer, bufferSize, options->format, local->tm_year + 1900, local->tm_mon + 1, local->tm_mday, local->tm_hour, local->tm_min, local->tm_sec);
+}
+
+int RunHeadlessClock(const HeadlessOptions* options, const SdfAtlas* sdf, FrameQueueStats* stats) {
+	const int width = options->width, height = options->height;
+	HeadlessFrame frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.options = options;
+	frame.sdf = sdf;
+
+	// The text is sized once for the widest string the format can produce, so it doesn't change size as the digits do
+	const wchar_t* samples[2];
+	int sampleCount = GetDisplayFormatSamples(options->format, samples);
+	SegmentDisplay segments = { 0 };
+	if (options->segmentStyle != SEGMENT_STYLE_NONE) {
+		int segmentHeight = FitSegmentHeight(options->segmentStyle, samples, sampleCount, width * HEADLESS_TEXT_MARGIN / 100, height * HEADLESS_TEXT_MARGIN / 100);
+		for (int i = 0; i < sampleCount; i++) {
+			if (!SegmentDisplayCovers(samples[i])) {
+				fprintf(stderr, "The format can't be shown with segments\n");
+				return 0;
+			}
+		}
+		if (!InitSegmentDisplay(&segments, options->segmentStyle, segmentHeight)) {
+			fprintf(stderr, "Out of memory for the segments\n");
+			return 0;
+		}
+		frame.segments = &segments;
+	}
+	else {
+		float size = FitSdfHeight(sdf, samples, sampleCount, width * HEADLESS_TEXT_MARGIN / 100, height * HEADLESS_TEXT_MARGIN / 100);
+		frame.style.size = size > 1.0f ? size : 1.0f;
+		frame.style.color = options->textColor;
+	}
+
+	Gradient gradient = options->gradient;
+	GradientLUT lut = { 0 };
+	frame.gradient = &lut;
+	if (options->useGradient && !UpdateGradientLUT(&lut, &gradient, width, height)) {
+		fprintf(stderr, "Out of memory for the gradient\n");
+		FreeSegmentDisplay(&segments);
+		return 0;
+	}
+
+	HeadlessOutput output = { options, NULL };
+	if (options->output == HEADLESS_OUTPUT_RAW) {
+		if (strcmp(options->path, "-") == 0) {
+			output.file = options->stream ? options->stream : stdout;
+#ifdef _WIN32
+			if (_fileno(output.file) < 0) {
+				// The clock is a GUI program, so it only has a stdout when it's redirected
+				fprintf(stderr, "stdout isn't redirected. Pipe the output somewhere or pass -o\n");
+				FreeGradientLUT(&lut);
+				FreeSegmentDisplay(&segments);
+				return 0;
+			}
+			_setmode(_fileno(output.file), _O_BINARY); // Text mode would turn every 0x0A byte into two
+#endif
+		}
+		else {
+			output.file = fopen(options->path, "wb");
+			if (!output.file) {
+				fprintf(stderr, "%s: could not open\n", options->path);
+				FreeGradientLUT(&lut);
+				FreeSegmentDisplay(&segments);
+				return 0;
+			}
+		}
+	}
+
+	FrameQueue* queue = CreateFrameQueue(width, height, options->buffers, WriteHeadlessFrame, &output);
+	TilePool* pool = queue ? CreateTilePool(options->threads) : NULL;
+	if (!pool) {
+		fprintf(stderr, "Out of memory for %d frames of %dx%d\n", options->buffers, width, height);
+		CloseFrameQueue(queue, NULL);
+		if (output.file && strcmp(options->path, "-") != 0) fclose(output.file);
+		FreeGradientLUT(&lut);
+		FreeSegmentDisplay(&segments);
+		return 0;
+	}
+
+	double wallStart = GetWallTime();
+	double start = options->start > 0.0 ? options->start : wallStart;
+	wchar_t text[DISPLAY_TEXT_LENGTH], shown[DISPLAY_TEXT_LENGTH] = L"";
+	FramebufferRect all = { 0, 0, width, height };
+	for (long number = 0; options->frames == 0 || number < options->frames; number++) {
+		double offset = (double)number / options->fps;
+		if (options->live) SleepUntil(wallStart + offset);
+
+		// Most frames show the same second as the one before, so they're queued again without being drawn. Only a new second or a new hue draws one
+		FormatHeadlessTime(options, start + offset, text, DISPLAY_TEXT_LENGTH);
+		int changed = number == 0 || wcscmp(text, shown) != 0;
+		if (options->useGradient && options->hueSpeed != 0.0f) {
+			gradient.hueShift = (float)fmod(floor(offset * options->hueSpeed / 60.0), 360.0);
+			if (UpdateGradientLUT(&lut, &gradient, width, height)) changed = 1;
+		}
+
+		if (!changed) {
+			if (!RepeatFrame(queue)) break;
+			continue;
+		}
+
+		Framebuffer* fb = AcquireFrame(queue);
+		if (!fb) break;
+
+		wcscpy(shown, text);
+		frame.fb = fb;
+		frame.text = shown;
+		frame.length = (int)wcslen(shown);
+		if (frame.segments) {
+			frame.x = (width - MeasureSegmentText(&segments, shown, frame.length)) / 2;
+			frame.y = (height - segments.height) / 2;
+		}
+		else {
+			frame.x = (int)floorf((width - MeasureSdfRun(sdf, shown, frame.length, frame.style.size)) / 2.0f);
+			frame.y = (int)floorf((height - frame.style.size) / 2.0f);
+		}
+		RunTiles(pool, &all, 256, 64, DrawHeadlessTile, &frame);
+
+		if (!SubmitFrame(queue, fb)) break;
+	}
+
+	FrameQueueStats queueStats;
+	int result = CloseFrameQueue(queue, &queueStats);
+	if (!result && options->frames == 0 && queueStats.written > 0) {
+		result = 1; // Without a frame count, the output being closed is how it ends
+	}
+	if (stats) *stats = queueStats;
+
+	DestroyTilePool(pool);
+	if (output.file && strcmp(options->path, "-") != 0) {
+		if (fclose(output.file) != 0) result = 0;
+	}
+	else if (output.file) {
+		fflush(output.file);
+	}
+	FreeGradientLUT(&lut);
+	FreeSegmentDisplay(&segments);
+	return result;
+}
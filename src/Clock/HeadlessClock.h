@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __CLOCK_HEADLESS_CLOCK_H__
+#define __CLOCK_HEADLESS_CLOCK_H__
+
+// Draws the clock into frames for a video pipeline instead of a window: raw BGRA on stdout or in a file, or a numbered PNG sequence,
+// at a fixed size and frame rate. Frame n shows the time n / fps seconds after the start, so the output is the same no matter how fast it's drawn.
+// On Windows this runs as 'XPClock.exe --render ...' with the configuration from the registry. Anywhere else src/Tools/RenderClock.c runs it.
+
+#include "Framebuffer.h"
+#include "Gradient.h"
+#include "SdfAtlas.h"
+#include "FrameQueue.h"
+
+#include <stdio.h>
+
+#define HEADLESS_OUTPUT_RAW	0 // Every frame's pixels one after the other, 4 bytes each in B, G, R, A order with alpha 255
+#define HEADLESS_OUTPUT_PNG	1 // One PNG file per frame
+
+#define HEADLESS_OPTIONS_USAGE "[-s WIDTHxHEIGHT] [-r FPS] [-n FRAMES] [-l] [-t \"YYYY-MM-DD HH:MM:SS\"] [-f FORMAT] [-y seven|matrix] [-c COLORFILE] [-g 0|1] [-a DEGREES] [-h DEGREES] [-d] [-j THREADS] [-b FRAMES] [-o -|out.bgra|frame%05d.png]"
+
+typedef struct __HeadlessOptions {
+	int width;
+	int height;
+	int fps;
+	long frames; // 0 to keep going until the output is closed
+	int live; // Waits for each frame's time before drawing it, for encoders that take a live feed
+	double start; // Time of the first frame in seconds since 1970, 0 for now
+	int format; // One of the display formats in DisplayModel.h
+	int segmentStyle; // SEGMENT_STYLE_NONE draws the text from the distance field atlas
+	int useGradient;
+	Gradient gradient; // The background when useGradient is set
+	uint32_t background; // Otherwise the background's color
+	float hueSpeed; // Degrees per minute the gradient's hue drifts by
+	uint32_t textColor;
+	int output;
+	char path[260]; // "-" for the stream. A PNG sequence needs one %d in it for the frame number
+	FILE* stream; // Where raw frames go with a path of "-". NULL for stdout
+	int threads; // Drawing threads, 0 for one per processor
+	int buffers; // Framebuffers in the queue to the writer
+} HeadlessOptions;
+
+void InitHeadlessOptions(HeadlessOptions*); // 1920x1080 at 30 fps to stdout, 24-hour time over the clock's default red to black gradient
+int ParseHeadlessOption(HeadlessOptions*, int, char**, int*); // Takes the option at argv[*index] and its value, moving the index past what it used. Returns 1 if it was taken, 0 if it isn't a headless option and -1 if its value is bad
+int LoadHeadlessColors(HeadlessOptions*, const char*); // Reads the background from a color file in the same format as clock.col. Returns 0 if it can't be opened
+int RunHeadlessClock(const HeadlessOptions*, const SdfAtlas*, FrameQueueStats*); // Draws and writes every frame. The atlas is only used without segments. Optionally copies the queue's statistics. Returns 0 on failure
+
+#endif // !__CLOCK_HEADLESS_CLOCK_H__
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "HistoryLog.h"
+
+#include <string.h>
+
+// Maps signed values to unsigned so small negative numbers stay small: 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+static uint64_t ZigZag(int64_t value) {
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t UnZigZag(uint64_t value) {
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// LEB128: 7 bits per byte, high bit set on every byte but the last.
+static size_t PutVarint(uint8_t* out, uint64_t value) {
+	size_t length = 0;
+	while (value >= 0x80) {
+		out[length++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	out[length++] = (uint8_t)value;
+	return length;
+}
+
+// Returns 0 if the data ends in the middle of the varint.
+static size_t GetVarint(const uint8_t* data, size_t length, uint64_t* value) {
+	*value = 0;
+	for (size_t i = 0; i < length && i < 10; i++) {
+		*value |= (uint64_t)(data[i] & 0x7F) << (7 * i);
+		if (!(data[i] & 0x80)) {
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+size_t HistoryWriteHeader(uint8_t* out) {
+	memcpy(out, HISTORY_MAGIC, 4);
+	out[4] = HISTORY_VERSION;
+	return HISTORY_HEADER_SIZE;
+}
+
+size_t HistoryEncodeBlock(const HistoryRecord* records, size_t count, uint8_t* out, size_t outSize) {
+	if (count == 0 || outSize < HISTORY_MAX_BLOCK_HEADER + count * HISTORY_MAX_RECORD_SIZE) {
+		return 0;
+	}
+
+	size_t length = 0;
+	out[length++] = 'B';
+	length += PutVarint(out + length, count);
+
+	HistoryRecord previous;
+	memset(&previous, 0, sizeof(previous));
+
+	for (size_t i = 0; i < count; i++) {
+		const HistoryRecord* record = &records[i];
+		int serverChanged = (i == 0 || record->server != previous.server);
+
+		length += PutVarint(out + length, (ZigZag(record->time - previous.time) << 1) | (uint64_t)serverChanged);
+		length += PutVarint(out + length, ZigZag((int64_t)record->offset - previous.offset));
+		length += PutVarint(out + length, ZigZag((int64_t)record->delay - previous.delay));
+		length += PutVarint(out + length, ZigZag((int64_t)record->jitter - previous.jitter));
+
+		if (serverChanged) {
+			memcpy(out + length, &record->server, 4);
+			length += 4;
+		}
+
+		previous = *record;
+	}
+
+	return length;
+}
+
+long HistoryDecode(const uint8_t* data, size_t length, HistoryRecordCallback callback, void* context) {
+	if (length < HISTORY_HEADER_SIZE || memcmp(data, HISTORY_MAGIC, 4) != 0 || data[4] != HISTORY_VERSION) {
+		return -1;
+	}
+
+	long decoded = 0;
+	size_t pos = HISTORY_HEADER_SIZE;
+
+	while (pos < length && data[pos] == 'B') {
+		uint64_t count, value;
+		size_t used = GetVarint(data + pos + 1, length - pos - 1, &count);
+		if (!used) break;
+		pos += 1 + used;
+
+		HistoryRecord record;
+		memset(&record, 0, sizeof(record));
+
+		for (uint64_t i = 0; i < count; i++) {
+			int64_t deltas[4];
+			int serverChanged = 0;
+
+			for (int field = 0; field < 4; field++) {
+				used = GetVarint(data + pos, length - pos, &value);
+				if (!used) return decoded;
+				pos += used;
+
+				if (field == 0) {
+					serverChanged = (int)(value & 1);
+					value >>= 1;
+				}
+				deltas[field] = UnZigZag(value);
+			}
+
+			record.time += deltas[0];
+			record.offset += (int32_t)deltas[1];
+			record.delay += (int32_t)deltas[2];
+			record.jitter += (int32_t)deltas[3];
+
+			if (serverChanged) {
+				if (length - pos < 4) return decoded;
+				memcpy(&record.server, data + pos, 4);
+				pos += 4;
+			}
+
+			decoded++;
+			if (callback) {
+				callback(&record, context);
+			}
+		}
+	}
+
+	return decoded;
+}
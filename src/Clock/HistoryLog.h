@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_HISTORY_LOG_H__
+#define __CLOCK_HISTORY_LOG_H__
+
+// Encoder and decoder for the sync history file. Free of Windows headers so the dump tool in src/Tools can build it anywhere.
+//
+// File layout:
+//   "XPCH" + version byte
+//   Any number of blocks, one per flush:
+//     'B', varint record count, then the records
+// Each record is stored as the difference to the previous record in the same block (the first one against zero), so a block can be decoded on its own.
+//   varint (zigzag(time delta) << 1 | server changed)
+//   zigzag varint offset delta, delay delta, jitter delta
+//   4 byte server address, only if it changed
+// A steady clock syncing every few minutes comes out at around 6 bytes per record.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HISTORY_MAGIC "XPCH"
+#define HISTORY_VERSION 1
+#define HISTORY_HEADER_SIZE 5
+#define HISTORY_MAX_RECORD_SIZE 32 // Worst case for one encoded record (10 + 3 * 5 + 4 bytes, rounded up)
+#define HISTORY_MAX_BLOCK_HEADER 6 // Marker plus the varint count
+
+// One sync sample. Times are in milliseconds.
+typedef struct __HistoryRecord {
+	int64_t time; // When the sample was taken, in milliseconds since the Unix epoch (server time)
+	int32_t offset; // Server clock minus local clock
+	int32_t delay; // Round trip delay
+	int32_t jitter; // Smoothed variation of the offset between samples (RFC 5905 section 10)
+	uint32_t server; // IPv4 address of the server, in network order
+} HistoryRecord;
+
+typedef void (*HistoryRecordCallback)(const HistoryRecord*, void*); // Called by HistoryDecode for every record, oldest first
+
+size_t HistoryWriteHeader(uint8_t*); // Writes the file header. The buffer must hold HISTORY_HEADER_SIZE bytes
+size_t HistoryEncodeBlock(const HistoryRecord*, size_t, uint8_t*, size_t); // Encodes records as one block. Returns the encoded size, or 0 if the buffer is too small
+long HistoryDecode(const uint8_t*, size_t, HistoryRecordCallback, void*); // Decodes a whole file. Returns the number of records, or -1 if the header is wrong. A block cut short by a crash ends the decode without an error
+
+#endif // !__CLOCK_HISTORY_LOG_H__
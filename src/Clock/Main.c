@@ -2,11 +2,120 @@
 #include "Instance.h"
 #include "Colors.h"
 #include "NTPClient.h"
+#include "GPSClient.h"
+#include "NTPBroadcast.h"
+#include "EventQueue.h"
+#include "SyncHistory.h"
+#include "Drawing.h"
 #include "AboutWindow.h"
+#include "DpiAwareness.h"
+#include "HeadlessClock.h"
+#include "GlyphBackendGDI.h"
+#include "SegmentDisplay.h"
+
+#include <io.h>
+#include <wctype.h>
+
+// Draws the clock into frames for a video pipeline instead of a window. The registry settings are the defaults and the options after --render
+// override them, see HeadlessClock.h. Returns the process' exit code.
+static int RunHeadless(void) {
+	HeadlessOptions options;
+	InitHeadlessOptions(&options);
+
+	// The clock logs to stdout, which is where the frames go. The frames get a copy of it to themselves and the log goes to stderr instead
+	if (_fileno(stdout) >= 0) {
+		int frames = _dup(_fileno(stdout));
+		options.stream = frames >= 0 ? _fdopen(frames, "wb") : NULL;
+		if (_fileno(stderr) >= 0) {
+			_dup2(_fileno(stderr), _fileno(stdout));
+		}
+		else {
+			freopen("NUL", "w", stdout);
+		}
+	}
+	options.format = GetDisplayFormat();
+	options.threads = (int)GetRenderThreads();
+	DWORD style = GetDisplayStyle();
+	if (style == SEGMENT_STYLE_SEVEN || style == SEGMENT_STYLE_MATRIX) {
+		options.segmentStyle = (int)style;
+	}
+
+	// The same background the clock picks in UpdateBackgroundGradient and FillBackground. A background image isn't drawn
+	g_Config.Gradient = GradientUsed();
+	g_Config.CustomColor = CustomColor();
+	GetGradientOptions(&g_Config);
+	options.useGradient = g_Config.Gradient;
+	if (g_Config.CustomColor) {
+		ParseCustomColor();
+		options.background = FRAMEBUFFER_RGB(GetRValue(g_bgColor), GetGValue(g_bgColor), GetBValue(g_bgColor));
+		if (g_Gradient.stopCount >= 2) {
+			options.gradient = g_Gradient;
+		}
+		else {
+			InitGradient(&options.gradient,
+				FRAMEBUFFER_RGB(g_GradientColor.tvColor1.Red >> 8, g_GradientColor.tvColor1.Green >> 8, g_GradientColor.tvColor1.Blue >> 8),
+				FRAMEBUFFER_RGB(g_GradientColor.tvColor2.Red >> 8, g_GradientColor.tvColor2.Green >> 8, g_GradientColor.tvColor2.Blue >> 8));
+		}
+	}
+	options.gradient.angle = (float)(g_Config.GradientAngle % 360);
+	options.gradient.dither = g_Config.GradientDither;
+	options.hueSpeed = (float)g_Config.GradientHueSpeed;
+
+	// The options are parsed as narrow strings so they're the same on every platform. argv[1] is --render itself
+	int argc = 0;
+	LPWSTR* wideArgv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (!wideArgv) return 1;
+
+	char** argv = (char**)calloc(argc, sizeof(char*));
+	BOOL valid = argv != NULL;
+	for (int i = 0; valid && i < argc; i++) {
+		int size = WideCharToMultiByte(CP_ACP, 0, wideArgv[i], -1, NULL, 0, NULL, NULL);
+		argv[i] = (char*)malloc(size > 0 ? size : 1);
+		valid = argv[i] != NULL && WideCharToMultiByte(CP_ACP, 0, wideArgv[i], -1, argv[i], size, NULL, NULL) > 0;
+	}
+	LocalFree(wideArgv);
+
+	for (int i = 2; valid && i < argc; ) {
+		int option = i;
+		int parsed = ParseHeadlessOption(&options, argc, argv, &i);
+		if (parsed <= 0) {
+			fprintf(stderr, "%s %s\nUsage: XPClock.exe --render %s\n", parsed < 0 ? "Bad value for" : "Unknown option", argv[option], HEADLESS_OPTIONS_USAGE);
+			valid = FALSE;
+		}
+	}
+
+	int result = 1;
+	if (valid) {
+		// The configured font, turned into a distance field once and scaled to whatever fits the frame
+		SdfAtlas sdf = { 0 };
+		if (options.segmentStyle == SEGMENT_STYLE_NONE && !BuildGDISdfAtlas(&sdf, GetCustomFont())) {
+			fprintf(stderr, "Failed to build the distance field atlas for the font\n");
+		}
+		else {
+			FrameQueueStats stats;
+			if (RunHeadlessClock(&options, &sdf, &stats)) {
+				fprintf(stderr, "%ld frames of %dx%d written: %ld drawn, %ld repeated\n", stats.written, options.width, options.height, stats.drawn, stats.repeated);
+				result = 0;
+			}
+		}
+		FreeSdfAtlas(&sdf);
+	}
+
+	for (int i = 0; argv && i < argc; i++) {
+		free(argv[i]);
+	}
+	free(argv);
+	return result;
+}
 
 int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow) {
 	UNREFERENCED_PARAMETER(hPrevInstance); // https://learn.microsoft.com/en-us/archive/msdn-magazine/2005/may/c-at-work-unreferenced-parameters-adding-task-bar-commands
-	UNREFERENCED_PARAMETER(lpCmdLine);
+
+	// 'XPClock.exe --render ...' draws frames for a video pipeline and exits. It opens no window, so it can run next to the clock
+	// The option has to be a word on its own, so '--renderer' or '--render-foo' still start the clock
+	if (lpCmdLine && wcsncmp(lpCmdLine, L"--render", 8) == 0 && (lpCmdLine[8] == L'\0' || iswspace(lpCmdLine[8]))) {
+		return RunHeadless();
+	}
 
 	CheckInstance(); // Check if another instance of the application is already running
 
@@ -38,6 +147,12 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 		return GetLastError();
 	}
 
+	// Before any window exists, including the tray icon's, since the awareness can't be changed once one does
+	EnableDpiAwareness();
+
+	// GDI+ decodes the images. Started once here rather than on every paint
+	StartupGDIPlus();
+
 	// Register the window class and show the window.
 	wprintf(L"Registered main class.\r\n");
 
@@ -74,6 +189,9 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 		DispatchMessage(&msg);
 	}
 
+	FlushSyncHistory(); // Every way out of the loop ends here, including Escape and the tray menu
+	ShutdownGDIPlus();
+
 	return 0;
 }
 
@@ -87,9 +205,8 @@ BOOL InitInstance(HINSTANCE hInstance, int nCmdShow) {
 	g_szMainFont = GetCustomFont();
 	wprintf(L"Setting up fonts with font name: '%s' \r\n", g_szMainFont);
 
-	// Create the fonts
-	g_hfMainFont = CreateFont(48, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH, g_szMainFont);
-	g_hfBtnFont = CreateFont(16, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH, g_szMainFont);
+	// Create the font, at the primary monitor's scale. The settings and about windows get theirs for whichever monitor they're on, see GetDialogFont
+	g_hfMainFont = CreateFont(ScaleForDpi(48, GetSystemDpi()), 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, DEFAULT_QUALITY, DEFAULT_PITCH, g_szMainFont);
 
 	// Set config structure values to prevent repeated system calls
 	wprintf(L"Parsing configuration from registry...\r\n");
@@ -100,6 +217,8 @@ BOOL InitInstance(HINSTANCE hInstance, int nCmdShow) {
 	g_Config.ConsoleEnabled = ConsoleEnabled();
 	g_Config.TrayIconEnabled = TrayIconEnabled();
 	g_Config.MenuEnabled = MenuEnabled();
+	GetGradientOptions(&g_Config);
+	GetTextEffectOptions(&g_Config);
 
 	if (g_Config.MenuEnabled) {
 		g_hMenu = LoadMenu(hInstance, MAKEINTRESOURCE(IDR_MAINMENU));
@@ -117,6 +236,7 @@ BOOL InitInstance(HINSTANCE hInstance, int nCmdShow) {
 
 	wprintf(L"Parsing time config...\r\n");
 	GetTimeConfig(&g_TimeConfig);
+	GetGPSConfig(&g_GPSConfig);
 	g_nTimeZone = GetTimeZone();
 	wprintf(L"g_TimeConfig (%p) parsed successfully.\r\n", &g_TimeConfig);
 
@@ -126,7 +246,10 @@ BOOL InitInstance(HINSTANCE hInstance, int nCmdShow) {
 		ParseCustomColor();
 	}
 
-	if (g_TimeConfig.ts == 1) {
+	InitEventQueue(); // Before any worker thread can post to it
+	InitSyncHistory();
+
+	if (g_TimeConfig.ts == _TIME_SOURCE_NTP_) {
 		wprintf(L"Creating NTP sync thread.\r\n");
 		g_hNTPThread = CreateThread(NULL, 0, NTPThread, NULL, 0, &g_tidNTPThread);
 		if (!g_hNTPThread) {
@@ -137,6 +260,28 @@ BOOL InitInstance(HINSTANCE hInstance, int nCmdShow) {
 			return FALSE;
 		}
 	}
+	else if (g_TimeConfig.ts == _TIME_SOURCE_NTP_BROADCAST_) {
+		wprintf(L"Creating NTP broadcast listener thread.\r\n");
+		g_hNTPThread = CreateThread(NULL, 0, NTPBroadcastThread, NULL, 0, &g_tidNTPThread);
+		if (!g_hNTPThread) {
+			red();
+			wprintf(L"Failed to create NTP broadcast thread! GetLastError: 0x%x\r\n", GetLastError());
+			reset();
+			MessageBox(NULL, L"Failed to create NTP broadcast thread!", L"Error", MB_OK | MB_ICONERROR);
+			return FALSE;
+		}
+	}
+	else if (g_TimeConfig.ts == _TIME_SOURCE_GPS_) {
+		wprintf(L"Creating GPS reader thread.\r\n");
+		g_hGPSThread = CreateThread(NULL, 0, GPSThread, NULL, 0, &g_tidGPSThread);
+		if (!g_hGPSThread) {
+			red();
+			wprintf(L"Failed to create GPS reader thread! GetLastError: 0x%x\r\n", GetLastError());
+			reset();
+			MessageBox(NULL, L"Failed to create GPS reader thread!", L"Error", MB_OK | MB_ICONERROR);
+			return FALSE;
+		}
+	}
 
 	// Create the main window and show it.
 	if (!CreateClock()) {
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "Motion.h"
+
+#include <math.h>
+
+void InitBounceMotion(BounceMotion* motion, float x, float y, float speed) {
+	motion->x = motion->previousX = x;
+	motion->y = motion->previousY = y;
+	motion->dx = motion->dy = speed / sqrtf(2.0f);
+	motion->accumulator = 0.0;
+	motion->bounces = 0;
+}
+
+void SetBounceSpeed(BounceMotion* motion, float speed) {
+	float current = sqrtf(motion->dx * motion->dx + motion->dy * motion->dy);
+	if (current <= 0.0f) {
+		motion->dx = motion->dy = speed / sqrtf(2.0f);
+		return;
+	}
+
+	motion->dx *= speed / current;
+	motion->dy *= speed / current;
+}
+
+// Moves one coordinate and reflects it off either edge. A box bigger than the window is pinned to 0.
+static float BounceAxis(float position, float* velocity, float limit, unsigned long* bounces) {
+	if (limit <= 0.0f) {
+		return 0.0f;
+	}
+
+	position += *velocity * (float)MOTION_STEP;
+	if (position < 0.0f) {
+		position = -position;
+		*velocity = fabsf(*velocity);
+		(*bounces)++;
+	}
+	else if (position > limit) {
+		position = 2.0f * limit - position;
+		*velocity = -fabsf(*velocity);
+		(*bounces)++;
+	}
+
+	// A step can overshoot past the far edge if the window just shrank
+	if (position < 0.0f) position = 0.0f;
+	if (position > limit) position = limit;
+	return position;
+}
+
+void AdvanceBounceMotion(BounceMotion* motion, double elapsed, float limitX, float limitY) {
+	if (elapsed > MOTION_MAX_ELAPSED) {
+		elapsed = MOTION_MAX_ELAPSED;
+	}
+	if (elapsed > 0.0) {
+		motion->accumulator += elapsed;
+	}
+
+	while (motion->accumulator >= MOTION_STEP) {
+		motion->previousX = motion->x;
+		motion->previousY = motion->y;
+		motion->x = BounceAxis(motion->x, &motion->dx, limitX, &motion->bounces);
+		motion->y = BounceAxis(motion->y, &motion->dy, limitY, &motion->bounces);
+		motion->accumulator -= MOTION_STEP;
+	}
+}
+
+void GetBouncePosition(const BounceMotion* motion, float* x, float* y) {
+	float t = (float)(motion->accumulator / MOTION_STEP);
+	*x = motion->previousX + (motion->x - motion->previousX) * t;
+	*y = motion->previousY + (motion->y - motion->previousY) * t;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __CLOCK_MOTION_H__
+#define __CLOCK_MOTION_H__
+
+// The DVD logo's bounce, stepped at a fixed rate from elapsed time instead of once per frame, so its speed doesn't depend on how often the window is drawn.
+// Positions are kept as floats, and the position drawn is interpolated between the last two steps so the motion stays smooth at any frame rate.
+
+#define MOTION_STEP			(1.0 / 240.0) // Seconds per physics step
+#define MOTION_MAX_ELAPSED	0.25 // Longest time advanced in one call. Longer stalls (a suspended machine, a debugger break) are dropped
+#define MOTION_DEFAULT_SPEED	120.0f // Pixels per second
+
+typedef struct __BounceMotion {
+	float x; // Top left after the latest step
+	float y;
+	float previousX; // Top left after the step before, for interpolation
+	float previousY;
+	float dx; // Velocity in pixels per second
+	float dy;
+	double accumulator; // Time not yet stepped, always less than MOTION_STEP
+	unsigned long bounces;
+} BounceMotion;
+
+void InitBounceMotion(BounceMotion*, float, float, float); // Places the box and sets it moving diagonally down and right at the given speed in pixels per second
+void SetBounceSpeed(BounceMotion*, float); // Changes the speed and keeps the direction
+void AdvanceBounceMotion(BounceMotion*, double, float, float); // Steps the motion by the elapsed seconds, bouncing off 0 and the given furthest x and y the box's top left can reach
+void GetBouncePosition(const BounceMotion*, float*, float*); // Returns the position to draw, interpolated between the last two steps
+
+#endif // !__CLOCK_MOTION_H__
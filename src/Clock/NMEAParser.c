@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "NMEAParser.h"
+
+#include <string.h>
+
+// Parser states
+#define NMEA_STATE_IDLE		0 // Waiting for a '$'
+#define NMEA_STATE_FIELDS	1 // Inside a sentence, reading comma separated fields
+#define NMEA_STATE_CHECKSUM	2 // Reading the two hex digits after '*'
+
+// Reads exactly 'count' decimal digits from a string. Returns -1 if any of them isn't a digit.
+static int ParseDigits(const char* p, int count) {
+	int value = 0;
+	for (int i = 0; i < count; i++) {
+		if (p[i] < '0' || p[i] > '9') return -1;
+		value = value * 10 + (p[i] - '0');
+	}
+	return value;
+}
+
+static int HexValue(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+// Parses 'hhmmss' with an optional fraction ('hhmmss.s' up to 'hhmmss.sss').
+static void ParseTimeField(NMEAParser* parser) {
+	if (parser->fieldLength < 6) return;
+
+	parser->hour = ParseDigits(parser->field, 2);
+	parser->minute = ParseDigits(parser->field + 2, 2);
+	parser->second = ParseDigits(parser->field + 4, 2);
+	parser->millisecond = 0;
+
+	if (parser->fieldLength > 7 && parser->field[6] == '.') {
+		int scale = 100;
+		for (int i = 7; i < parser->fieldLength && scale > 0; i++, scale /= 10) {
+			if (parser->field[i] < '0' || parser->field[i] > '9') break;
+			parser->millisecond += (parser->field[i] - '0') * scale;
+		}
+	}
+}
+
+// Called whenever a ',' or '*' closes the current field.
+static void EndField(NMEAParser* parser) {
+	parser->field[parser->fieldLength] = '\0';
+
+	if (parser->fieldIndex == 0) {
+		// The address field is the talker ID followed by the sentence type. We accept any talker (GP, GN, GL, ...)
+		parser->sentence = 0;
+		if (parser->fieldLength >= 5) {
+			const char* type = parser->field + parser->fieldLength - 3;
+			if (memcmp(type, "RMC", 3) == 0) parser->sentence = 'R';
+			else if (memcmp(type, "ZDA", 3) == 0) parser->sentence = 'Z';
+		}
+	}
+	else if (parser->sentence == 'R') {
+		// $--RMC,hhmmss.ss,A,llll.ll,a,yyyyy.yy,a,x.x,x.x,ddmmyy,x.x,a*hh
+		switch (parser->fieldIndex) {
+		case 1:
+			ParseTimeField(parser);
+			break;
+		case 2:
+			parser->valid = (parser->fieldLength == 1 && parser->field[0] == 'A');
+			break;
+		case 9:
+			if (parser->fieldLength == 6) {
+				parser->day = ParseDigits(parser->field, 2);
+				parser->month = ParseDigits(parser->field + 2, 2);
+				parser->year = ParseDigits(parser->field + 4, 2);
+				if (parser->year >= 0) parser->year += (parser->year < 80) ? 2000 : 1900; // RMC only carries two year digits, so pivot on 1980 (the GPS epoch)
+			}
+			break;
+		}
+	}
+	else if (parser->sentence == 'Z') {
+		// $--ZDA,hhmmss.ss,dd,mm,yyyy,xx,yy*hh
+		switch (parser->fieldIndex) {
+		case 1:
+			ParseTimeField(parser);
+			parser->valid = (parser->fieldLength >= 6);
+			break;
+		case 2:
+			parser->day = (parser->fieldLength == 2) ? ParseDigits(parser->field, 2) : -1;
+			break;
+		case 3:
+			parser->month = (parser->fieldLength == 2) ? ParseDigits(parser->field, 2) : -1;
+			break;
+		case 4:
+			parser->year = (parser->fieldLength == 4) ? ParseDigits(parser->field, 4) : -1;
+			break;
+		}
+	}
+
+	parser->fieldIndex++;
+	parser->fieldLength = 0;
+}
+
+static void BeginSentence(NMEAParser* parser) {
+	parser->state = NMEA_STATE_FIELDS;
+	parser->checksum = 0;
+	parser->expected = 0;
+	parser->hexDigits = 0;
+	parser->fieldIndex = 0;
+	parser->fieldLength = 0;
+	parser->sentence = 0;
+	parser->hour = parser->minute = parser->second = -1;
+	parser->millisecond = 0;
+	parser->day = parser->month = parser->year = -1;
+	parser->valid = 0;
+}
+
+// Called once the checksum digits have been read. Returns 1 if a timestamp was handed to the callback.
+static int EndSentence(NMEAParser* parser) {
+	parser->state = NMEA_STATE_IDLE;
+	parser->sentences++;
+
+	if (parser->checksum != parser->expected) {
+		parser->checksumErrors++;
+		return 0;
+	}
+
+	if (!parser->sentence || !parser->valid) return 0;
+
+	if (parser->hour < 0 || parser->hour > 23 || parser->minute < 0 || parser->minute > 59 || parser->second < 0 || parser->second > 60 ||
+		parser->day < 1 || parser->day > 31 || parser->month < 1 || parser->month > 12 || parser->year < 1970) {
+		return 0;
+	}
+
+	NMEATime time;
+	time.seconds = NMEAMakeTime(parser->year, parser->month, parser->day, parser->hour, parser->minute, parser->second);
+	time.milliseconds = (unsigned int)parser->millisecond;
+	time.type = parser->sentence;
+
+	parser->timestamps++;
+	if (parser->callback) {
+		parser->callback(&time, parser->context);
+	}
+
+	return 1;
+}
+
+void NMEAInit(NMEAParser* parser, NMEATimeCallback callback, void* context) {
+	memset(parser, 0, sizeof(*parser));
+	parser->state = NMEA_STATE_IDLE;
+	parser->callback = callback;
+	parser->context = context;
+}
+
+size_t NMEAFeed(NMEAParser* parser, const char* data, size_t length) {
+	size_t decoded = 0;
+
+	for (size_t i = 0; i < length; i++) {
+		char c = data[i];
+
+		// A '$' always starts a new sentence, even if the previous one was cut off by the receiver.
+		if (c == '$') {
+			BeginSentence(parser);
+			continue;
+		}
+
+		switch (parser->state) {
+		case NMEA_STATE_FIELDS:
+			if (c == '\r' || c == '\n') {
+				// Sentence ended without a checksum. We don't trust those for time.
+				parser->state = NMEA_STATE_IDLE;
+				parser->sentences++;
+				parser->checksumErrors++;
+			}
+			else if (c == '*') {
+				EndField(parser);
+				parser->state = NMEA_STATE_CHECKSUM;
+			}
+			else {
+				parser->checksum ^= (uint8_t)c;
+				if (c == ',') {
+					EndField(parser);
+				}
+				else if (parser->fieldLength < NMEA_MAX_FIELD) {
+					parser->field[parser->fieldLength++] = c;
+				}
+			}
+			break;
+		case NMEA_STATE_CHECKSUM: {
+			int value = HexValue(c);
+			if (value < 0) {
+				parser->state = NMEA_STATE_IDLE;
+				parser->sentences++;
+				parser->checksumErrors++;
+				break;
+			}
+			parser->expected = (uint8_t)((parser->expected << 4) | value);
+			if (++parser->hexDigits == 2) {
+				decoded += EndSentence(parser);
+			}
+			break;
+		}
+		default:
+			break; // Line noise between sentences
+		}
+	}
+
+	return decoded;
+}
+
+time_t NMEAMakeTime(int year, int month, int day, int hour, int minute, int second) {
+	// Days from civil, see http://howardhinnant.github.io/date_algorithms.html
+	year -= month <= 2;
+	int era = (year >= 0 ? year : year - 399) / 400;
+	int yoe = year - era * 400;
+	int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	long long days = (long long)era * 146097 + doe - 719468;
+
+	return (time_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_NMEA_PARSER_H__
+#define __CLOCK_NMEA_PARSER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define NMEA_MAX_FIELD 16 // Longest field we care about is 'hhmmss.sss'. Anything longer is truncated, which is fine for the fields we don't read.
+
+// A decoded timestamp from an RMC or ZDA sentence. Always UTC.
+typedef struct __NMEATime {
+	time_t seconds; // Seconds since the Unix epoch
+	unsigned int milliseconds; // Fractional part of the time field, for 5/10 Hz receivers
+	char type; // 'R' for RMC, 'Z' for ZDA
+} NMEATime;
+
+typedef void (*NMEATimeCallback)(const NMEATime*, void*); // Called from NMEAFeed whenever a sentence with a valid checksum and a valid time is decoded
+
+// Incremental parser state.
+// The parser works byte by byte, so sentences split across reads are handled without buffering the whole sentence or allocating anything.
+typedef struct __NMEAParser {
+	int state; // Internal state. See NMEAParser.c
+	uint8_t checksum; // Running XOR of every byte between '$' and '*'
+	uint8_t expected; // Checksum read from the two hex digits after '*'
+	int hexDigits; // How many checksum digits have been read
+	int fieldIndex; // Index of the field currently being read. Field 0 is the address ('GPRMC', 'GNZDA', ...)
+	int fieldLength;
+	char field[NMEA_MAX_FIELD + 1]; // Scratch space for the current field
+	char sentence; // 'R' for RMC, 'Z' for ZDA, 0 for anything else
+
+	// Values collected from the fields of the current sentence. Only committed once the checksum matches.
+	int hour, minute, second, millisecond;
+	int day, month, year;
+	int valid;
+
+	// Statistics. Useful for checking the serial link from the console.
+	unsigned long sentences;
+	unsigned long checksumErrors;
+	unsigned long timestamps;
+
+	NMEATimeCallback callback;
+	void* context;
+} NMEAParser;
+
+void NMEAInit(NMEAParser*, NMEATimeCallback, void*); // Resets the parser and sets the callback that receives the decoded timestamps
+size_t NMEAFeed(NMEAParser*, const char*, size_t); // Feeds raw bytes from the receiver into the parser. Returns the number of timestamps decoded from this chunk
+time_t NMEAMakeTime(int, int, int, int, int, int); // Converts a UTC calendar date into a time_t without depending on the C runtime's time zone handling
+
+#endif // !__CLOCK_NMEA_PARSER_H__
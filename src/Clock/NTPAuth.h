@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_NTP_AUTH_H__
+#define __CLOCK_NTP_AUTH_H__
+
+#include "Clock.h"
+#include "Sha.h"
+
+#define NTP_MAX_KEYS		64 // Maximum number of keys read from the key file
+#define NTP_MAX_KEY_LENGTH	64 // Longest secret accepted. ntpd itself limits ASCII keys to 20 characters.
+#define NTP_MAX_MAC_LENGTH	(4 + SHA256_DIGEST_SIZE) // Key ID followed by the largest digest
+
+// Digest types, as written in the second column of the key file
+#define NTP_KEY_SHA1	1
+#define NTP_KEY_SHA256	2
+
+// One symmetric key from an ntp.keys style file: '<id> <type> <secret>'
+typedef struct __NTPKey {
+	uint32_t id;
+	int type;
+	uint8_t secret[NTP_MAX_KEY_LENGTH];
+	size_t length;
+} NTPKey;
+
+int LoadNTPKeys(const wchar_t*); // Loads the key file. Returns the number of keys read, or -1 if the file couldn't be opened
+const NTPKey* FindNTPKey(uint32_t); // Returns the key with the given ID, or NULL if it wasn't in the key file
+size_t GetNTPMacLength(const NTPKey*); // Size of the MAC trailer (key ID + digest) for a key
+size_t AppendNTPMac(const NTPKey*, uint8_t*, size_t); // Appends the MAC for the first 'size_t' bytes of the packet. Returns the new packet length
+BOOL VerifyNTPMac(const NTPKey*, const uint8_t*, size_t); // Checks the MAC trailer of a received packet. The length includes the trailer
+
+#endif // !__CLOCK_NTP_AUTH_H__
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "NTPBroadcast.h"
+#include "EventQueue.h"
+#include "SyncHistory.h"
+#include "Colors.h"
+
+// Broadcast client mode (RFC 5905 section 3). The server sends one mode 5 packet per interval to a broadcast or multicast address
+// and every display on the segment picks it up, so the number of displays doesn't change the traffic.
+// A broadcast packet only carries the server's transmit time, so the network delay is measured once with a normal exchange and added to every packet.
+
+static WCHAR* multicastGroup = NULL; // Read once, since GetNTPMulticastGroup allocates a new copy on every call
+
+// Checks a broadcast packet. Returns NULL if it is usable, or the reason it was dropped.
+static const wchar_t* ValidateBroadcast(const uint8_t* packet, int length, const struct sockaddr_in* from, uint32_t server, const NTPKey* key) {
+	if (length < 48) {
+		return L"packet too short";
+	}
+
+	// Only follow the server we calibrated against. Anyone on the segment can send broadcasts.
+	if (from->sin_addr.s_addr != server) {
+		return L"not from the calibrated server";
+	}
+
+	if ((packet[0] & 0x07) != NTP_MODE_BROADCAST) {
+		return L"not a broadcast packet";
+	}
+
+	if ((packet[0] >> 6) == 3 || packet[1] == 0) {
+		return L"server is not synchronized";
+	}
+
+	if (key && ((size_t)length != 48 + GetNTPMacLength(key) || !VerifyNTPMac(key, packet, (size_t)length))) {
+		return L"authentication failed";
+	}
+
+	return NULL;
+}
+
+// Creates the listening socket and joins the multicast group if one is configured.
+static SOCKET OpenBroadcastSocket(void) {
+	SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock == INVALID_SOCKET) {
+		return INVALID_SOCKET;
+	}
+
+	// Other NTP software on the machine may already have the port
+	BOOL reuse = TRUE;
+	setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+	struct sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(g_TimeConfig.port);
+
+	if (bind(sock, (struct sockaddr*)&local, sizeof(local)) == SOCKET_ERROR) {
+		closesocket(sock);
+		return INVALID_SOCKET;
+	}
+
+	// Broadcasts arrive on any socket bound to the port. Multicast needs the group to be joined.
+	if (!multicastGroup) {
+		multicastGroup = GetNTPMulticastGroup();
+	}
+	const WCHAR* group = multicastGroup;
+	if (group[0]) {
+		char groupBuf[64];
+		wcstombs(groupBuf, group, sizeof(groupBuf));
+
+		struct ip_mreq mreq;
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.imr_multiaddr.s_addr = inet_addr(groupBuf);
+		mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+
+		if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&mreq, sizeof(mreq)) == SOCKET_ERROR) {
+			yellow();
+			wprintf(L"Failed to join multicast group %s (0x%x). Only broadcasts will be received.\r\n", group, WSAGetLastError());
+			reset();
+		}
+		else {
+			wprintf(L"Joined NTP multicast group %s.\r\n", group);
+		}
+	}
+
+	return sock;
+}
+
+// Checks a valid broadcast's transmit time against the last one accepted. Authentication alone doesn't stop someone on the segment from capturing a broadcast
+// and sending it again later to set every display back, so each one has to be strictly newer than the last and close to where the local clock says the server should be.
+// Returns NULL if it is usable, or the reason it was dropped.
+static const wchar_t* CheckBroadcastTime(int64_t transmit, int64_t lastTransmit, int64_t arrival, int64_t referenceTime, DWORD referenceTick, DWORD tick) {
+	if (transmit <= lastTransmit) {
+		return L"not newer than the last accepted broadcast (replayed?)";
+	}
+
+	int64_t projected = referenceTime + (DWORD)(tick - referenceTick);
+	if (arrival > projected + NTP_BROADCAST_MAX_STEP_MS || arrival < projected - NTP_BROADCAST_MAX_STEP_MS) {
+		return L"too far from the projected time";
+	}
+
+	return NULL;
+}
+
+// Listens for broadcasts until the socket fails or none has been accepted for NTP_BROADCAST_TIMEOUT_MS. Returns FALSE if listening couldn't start at all.
+static BOOL ListenForBroadcasts(const NTPSample* calibration, int64_t oneWayDelay, const NTPKey* key) {
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+		PostClockEvent(CLOCK_EVENT_ERROR, L"Error listening for NTP broadcasts: WSA Startup Failed (0x%x)", WSAGetLastError());
+		return FALSE;
+	}
+
+	SOCKET sock = OpenBroadcastSocket();
+	if (sock == INVALID_SOCKET) {
+		PostClockEvent(CLOCK_EVENT_ERROR, L"Error listening for NTP broadcasts on port %u (0x%x)", g_TimeConfig.port, WSAGetLastError());
+		WSACleanup();
+		return FALSE;
+	}
+
+	// Wake up now and then even if nothing arrives, so a server that stopped broadcasting or a broken multicast route is noticed
+	DWORD timeout = NTP_BROADCAST_TIMEOUT_MS;
+	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+	// The calibration exchange is the first accepted time. Broadcasts sent before it can't be newer than its transmit time
+	int64_t lastTransmit = calibration->serverTime - oneWayDelay;
+	int64_t referenceTime = calibration->serverTime;
+	DWORD referenceTick = calibration->tick;
+
+	unsigned char packet[48 + NTP_MAX_MAC_LENGTH + 16];
+	for (;;) {
+		struct sockaddr_in from;
+		int fromSize = sizeof(from);
+		int received = recvfrom(sock, (char*)packet, sizeof(packet), 0, (struct sockaddr*)&from, &fromSize);
+		DWORD tick = GetTickCount();
+		int64_t localTime = GetLocalNTPMs();
+		if (received == SOCKET_ERROR && WSAGetLastError() != WSAETIMEDOUT) {
+			PostClockEvent(CLOCK_EVENT_WARNING, L"NTP broadcast receive failed (0x%x). Recalibrating.", WSAGetLastError());
+			break;
+		}
+
+		// Dropped packets don't count, or a stream of bad ones would keep the thread from ever recalibrating
+		if (tick - referenceTick >= NTP_BROADCAST_TIMEOUT_MS) {
+			PostClockEvent(CLOCK_EVENT_WARNING, L"No usable NTP broadcast from the server for %lu seconds. Recalibrating.", (tick - referenceTick) / 1000);
+			break;
+		}
+		if (received == SOCKET_ERROR) {
+			continue;
+		}
+
+		const wchar_t* reason = ValidateBroadcast(packet, received, &from, calibration->source, key);
+		int64_t transmit = NTPTimestampToMs(&packet[40]);
+		if (!reason) {
+			reason = CheckBroadcastTime(transmit, lastTransmit, transmit + oneWayDelay, referenceTime, referenceTick, tick);
+		}
+		if (reason) {
+			yellow();
+			wprintf(L"Dropped NTP broadcast from %S: %s\r\n", inet_ntoa(from.sin_addr), reason);
+			reset();
+			continue;
+		}
+
+		lastTransmit = transmit;
+		referenceTime = transmit + oneWayDelay;
+		referenceTick = tick;
+		ApplyNTPTime(referenceTime, tick);
+		ClearClockStatus();
+
+		// Broadcasts are samples like any other for the history. There's no round trip, so the calibrated one-way delay stands in for the delay
+		NTPSample sample;
+		sample.offset = referenceTime - localTime;
+		sample.delay = oneWayDelay;
+		sample.serverTime = referenceTime;
+		sample.tick = tick;
+		sample.source = calibration->source;
+		RecordSyncSample(&sample);
+	}
+
+	closesocket(sock);
+	WSACleanup();
+	return TRUE;
+}
+
+DWORD WINAPI NTPBroadcastThread(LPVOID lpParam) {
+	UNREFERENCED_PARAMETER(lpParam);
+
+	for (;;) {
+		// Calibrate the one-way delay with a normal exchange. This also gives us the time straight away instead of waiting for the first broadcast.
+		NTPSample calibration;
+		while (!QueryNTPServer(&calibration)) {
+			Sleep(NTP_CALIBRATION_RETRY_MS);
+		}
+
+		int64_t oneWayDelay = calibration.delay / 2;
+		ApplyNTPTime(calibration.serverTime, calibration.tick);
+		ClearClockStatus();
+
+		blue();
+		wprintf(L"NTP broadcast client calibrated. One-way delay: %lld ms. Listening on port %u.\r\n", oneWayDelay, g_TimeConfig.port);
+		reset();
+
+		const NTPKey* key = NULL;
+		if (!GetConfiguredNTPKey(&key) || !ListenForBroadcasts(&calibration, oneWayDelay, key)) {
+			Sleep(NTP_CALIBRATION_RETRY_MS);
+		}
+	}
+}
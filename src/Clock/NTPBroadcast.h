@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_NTP_BROADCAST_H__
+#define __CLOCK_NTP_BROADCAST_H__
+
+#include "Clock.h"
+#include "NTPClient.h"
+
+#define NTP_MODE_BROADCAST 5
+#define NTP_CALIBRATION_RETRY_MS 30000 // How long to wait before retrying the unicast calibration if the server can't be reached
+#define NTP_BROADCAST_TIMEOUT_MS 192000 // How long to go without an accepted broadcast before recalibrating. Three of ntpd's default 64 second broadcast intervals
+#define NTP_BROADCAST_MAX_STEP_MS 10000 // Furthest a broadcast may be from the time projected since the last accepted one. A server that really stepped further is picked up by the recalibration
+
+DWORD WINAPI NTPBroadcastThread(LPVOID); // Calibrates the one-way delay with one unicast exchange, then follows the server's broadcast/multicast packets passively
+
+#endif // !__CLOCK_NTP_BROADCAST_H__
@@ -17,13 +17,85 @@
  */
 
 #include "NTPClient.h"
+#include "NTPAuth.h"
+#include "EventQueue.h"
+#include "SyncHistory.h"
 #include "Colors.h"
 
 #pragma warning(disable : 4244)
 
+// The reference time is written by whichever thread syncs (GPS, unicast or broadcast) and read by the render thread up to 60 times a second.
+// The three values are published together under a sequence counter: it's odd while a write is in progress, and a reader that sees it odd or changed
+// reads again, so it never mixes a new tick with an old second. Writers take referenceWriter first so two of them can't interleave.
 static time_t lastNTPTime = 0;
+static unsigned int lastNTPMillis = 0; // Sub-second part of lastNTPTime. GPS receivers running at 5/10 Hz report fractions.
 static DWORD lastSyncTick = 0;
 static BOOL isNTPInitialized = FALSE;
+static volatile LONG referenceSequence = 0;
+static volatile LONG referenceWriter = 0;
+static BOOL areKeysLoaded = FALSE; // The key file is read once, on the first sync that needs it
+static WCHAR* keyFile = NULL; // Path the keys were read from. Read from the registry with them and kept for error messages, since GetNTPKeyFile allocates a new copy on every call
+
+// Writes the current system time as a 64-bit NTP timestamp (seconds since 1900 + 32-bit fraction, big endian).
+// The low bits of the fraction are below the resolution of the system clock, so they are filled from the performance counter to make every request unique.
+static void GetNTPTimestamp(uint8_t* out) {
+	FILETIME ft;
+	GetSystemTimeAsFileTime(&ft);
+
+	ULARGE_INTEGER now;
+	now.LowPart = ft.dwLowDateTime;
+	now.HighPart = ft.dwHighDateTime;
+
+	// FILETIME counts 100ns intervals since 1601. NTP counts seconds since 1900.
+	uint32_t seconds = (uint32_t)(now.QuadPart / 10000000ULL - 11644473600ULL + NTP_TIMESTAMP_DELTA);
+	uint32_t fraction = (uint32_t)(((now.QuadPart % 10000000ULL) << 32) / 10000000ULL);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	fraction = (fraction & 0xFFFFFF00) | (counter.LowPart & 0xFF);
+
+	seconds = htonl(seconds);
+	fraction = htonl(fraction);
+	memcpy(out, &seconds, sizeof(seconds));
+	memcpy(out + 4, &fraction, sizeof(fraction));
+}
+
+// Checks that a reply really answers our request. Returns NULL if it does, or the reason it was rejected.
+static const wchar_t* ValidateNTPReply(const uint8_t* reply, int length, const struct sockaddr_in* from, const struct sockaddr_in* server, const uint8_t* transmit, const NTPKey* key) {
+	if (length < 48) {
+		return L"packet too short";
+	}
+
+	if (from->sin_addr.s_addr != server->sin_addr.s_addr || from->sin_port != server->sin_port) {
+		return L"unexpected source address";
+	}
+
+	if ((reply[0] & 0x07) != 4) {
+		return L"not a server reply";
+	}
+
+	if ((reply[0] >> 6) == 3) {
+		return L"server is not synchronized";
+	}
+
+	if (reply[1] == 0) {
+		return L"kiss-o'-death from server";
+	}
+
+	// The server copies our transmit timestamp into the originate field. A reply that doesn't carry it wasn't sent for this request.
+	if (memcmp(reply + 24, transmit, 8) != 0) {
+		return L"originate timestamp does not match the request";
+	}
+
+	if (key) {
+		// Extension fields aren't supported, so an authenticated reply is exactly the header plus the MAC.
+		if ((size_t)length != 48 + GetNTPMacLength(key) || !VerifyNTPMac(key, reply, (size_t)length)) {
+			return L"authentication failed";
+		}
+	}
+
+	return NULL;
+}
 
 int PingNTPServer(const TimeConfig* config) {
 	if (!config || !config->address || config->port == 0) {
@@ -96,26 +168,62 @@ int PingNTPServer(const TimeConfig* config) {
 	return ret;
 }
 
-void GetNTPDateTime(void) {
-	blue();
-	wprintf(L"Syncing NTP time.\r\n");
-	reset();
+BOOL GetConfiguredNTPKey(const NTPKey** ppKey) {
+	*ppKey = NULL;
+
+	DWORD keyId = GetNTPKeyID();
+	if (keyId == 0) {
+		return TRUE; // Authentication is off
+	}
 
+	if (!areKeysLoaded) {
+		keyFile = GetNTPKeyFile();
+		LoadNTPKeys(keyFile);
+		areKeysLoaded = TRUE;
+	}
+
+	*ppKey = FindNTPKey(keyId);
+	if (!*ppKey) {
+		PostClockEvent(CLOCK_EVENT_ERROR, L"Error getting network time: key %lu was not found in the key file '%s'. Please check the NTPKeyID and NTPKeyFile registry values.", keyId, keyFile);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+int64_t NTPTimestampToMs(const uint8_t* timestamp) {
+	uint32_t seconds, fraction;
+	memcpy(&seconds, timestamp, sizeof(seconds));
+	memcpy(&fraction, timestamp + 4, sizeof(fraction));
+
+	return (int64_t)ntohl(seconds) * 1000 + (((uint64_t)ntohl(fraction) * 1000) >> 32);
+}
+
+int64_t GetLocalNTPMs(void) {
+	FILETIME ft;
+	GetSystemTimeAsFileTime(&ft);
+
+	ULARGE_INTEGER now;
+	now.LowPart = ft.dwLowDateTime;
+	now.HighPart = ft.dwHighDateTime;
+
+	return (int64_t)(now.QuadPart / 10000ULL) - 11644473600000LL + (int64_t)NTP_TIMESTAMP_DELTA * 1000;
+}
+
+BOOL QueryNTPServer(NTPSample* sample) {
 	WSADATA wsaData;
 	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-		g_bGetTime = FALSE;
-		FormattedMessageBox(NULL, L"Error getting network time: WSA Startup Failed (0x%x)", L"Error", MB_OK | MB_ICONERROR, WSAGetLastError());
-		return;
+		PostClockEvent(CLOCK_EVENT_ERROR, L"Error getting network time: WSA Startup Failed (0x%x)", WSAGetLastError());
+		return FALSE;
 	}
 
 	struct sockaddr_in serverAddr;
 	struct hostent* server;
 	SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
 	if (sock == INVALID_SOCKET) {
-		g_bGetTime = FALSE;
-		FormattedMessageBox(NULL, L"Error getting network time: socket error (0x%x)", L"Error", MB_OK | MB_ICONERROR, WSAGetLastError());
+		PostClockEvent(CLOCK_EVENT_ERROR, L"Error getting network time: socket error (0x%x)", WSAGetLastError());
 		WSACleanup();
-		return;
+		return FALSE;
 	}
 
 	char serverBuf[256];
@@ -123,12 +231,22 @@ void GetNTPDateTime(void) {
 
 	server = gethostbyname(serverBuf);
 	if (!server) {
-		g_bGetTime = FALSE;
+		int error = WSAGetLastError();
+		closesocket(sock);
+		WSACleanup();
+		PostClockEvent(CLOCK_EVENT_ERROR, L"Error getting network time: host not found: %s (0x%x). Please check your internet connection and the server address.", g_TimeConfig.address, error);
+		return FALSE;
+	}
+
+	// Without a timeout, a lost packet would hang the sync thread forever
+	DWORD timeout = TIMEOUT_MS;
+	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
 
+	const NTPKey* key = NULL;
+	if (!GetConfiguredNTPKey(&key)) {
 		closesocket(sock);
 		WSACleanup();
-		FormattedMessageBox(NULL, L"Error getting network time: Host not found: %s\r\nWSAGetLastError: 0x%x\r\n\r\nPlease ensure you are connected to the internet and the address you are trying to connect to is valid and your computer can connect to it in general or switch to system time.", L"Error", MB_OK | MB_ICONERROR, WSAGetLastError());
-		return;
+		return FALSE;
 	}
 
 	memset(&serverAddr, 0, sizeof(serverAddr));
@@ -136,57 +254,197 @@ void GetNTPDateTime(void) {
 	memcpy(&serverAddr.sin_addr.s_addr, server->h_addr, server->h_length);
 	serverAddr.sin_port = htons(g_TimeConfig.port);
 
-	unsigned char ntpPacket[48] = { 0 };
+	unsigned char ntpPacket[48 + NTP_MAX_MAC_LENGTH] = { 0 };
 	ntpPacket[0] = 0x1B; // LI=0, Version=3, Mode=3 (Client)
 
-	if (sendto(sock, (char*)ntpPacket, sizeof(ntpPacket), 0, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-		g_bGetTime = FALSE;
-		FormattedMessageBox(NULL, L"Error getting network time: send failed (0x%x)", L"Error", MB_OK | MB_ICONERROR, WSAGetLastError());
+	// Our transmit timestamp doubles as a nonce. See ValidateNTPReply.
+	uint8_t transmit[8];
+	GetNTPTimestamp(transmit);
+	memcpy(&ntpPacket[40], transmit, sizeof(transmit));
+
+	size_t packetLength = key ? AppendNTPMac(key, ntpPacket, 48) : 48;
+
+	if (sendto(sock, (char*)ntpPacket, (int)packetLength, 0, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+		PostClockEvent(CLOCK_EVENT_ERROR, L"Error getting network time: send failed (0x%x)", WSAGetLastError());
 		closesocket(sock);
 		WSACleanup();
-		return;
+		return FALSE;
 	}
 
-	struct sockaddr_in recvAddr;
-	int recvAddrSize = sizeof(recvAddr);
-	if (recvfrom(sock, (char*)ntpPacket, sizeof(ntpPacket), 0, (struct sockaddr*)&recvAddr, &recvAddrSize) == SOCKET_ERROR) {
-		g_bGetTime = FALSE;
-		FormattedMessageBox(NULL, L"Error getting network time: recieve failed (0x%x)", L"Error", MB_OK | MB_ICONERROR, WSAGetLastError());
-		closesocket(sock);
-		WSACleanup();
-		return;
+	// Keep reading until a reply that matches the request arrives. Anything else on the socket (other hosts, stale replies, forgeries) is dropped.
+	unsigned char reply[48 + NTP_MAX_MAC_LENGTH + 16];
+	DWORD start = GetTickCount();
+	for (;;) {
+		struct sockaddr_in recvAddr;
+		int recvAddrSize = sizeof(recvAddr);
+		int received = recvfrom(sock, (char*)reply, sizeof(reply), 0, (struct sockaddr*)&recvAddr, &recvAddrSize);
+		if (received == SOCKET_ERROR) {
+			PostClockEvent(CLOCK_EVENT_ERROR, L"Error getting network time: no reply from %s (0x%x)", g_TimeConfig.address, WSAGetLastError());
+			closesocket(sock);
+			WSACleanup();
+			return FALSE;
+		}
+
+		sample->tick = GetTickCount();
+		int64_t t4 = GetLocalNTPMs();
+
+		const wchar_t* reason = ValidateNTPReply(reply, received, &recvAddr, &serverAddr, transmit, key);
+		if (!reason) {
+			// Standard on-wire calculation (RFC 5905 section 8)
+			int64_t t1 = NTPTimestampToMs(transmit);
+			int64_t t2 = NTPTimestampToMs(&reply[32]);
+			int64_t t3 = NTPTimestampToMs(&reply[40]);
+
+			sample->delay = (t4 - t1) - (t3 - t2);
+			if (sample->delay < 0) sample->delay = 0; // Clock granularity can make very fast exchanges come out slightly negative
+			sample->offset = ((t2 - t1) + (t3 - t4)) / 2;
+			sample->serverTime = t3 + sample->delay / 2;
+			sample->source = serverAddr.sin_addr.s_addr;
+			break;
+		}
+
+		yellow();
+		wprintf(L"Dropped NTP reply from %S:%u: %s\r\n", inet_ntoa(recvAddr.sin_addr), ntohs(recvAddr.sin_port), reason);
+		reset();
+
+		if (GetTickCount() - start >= TIMEOUT_MS) {
+			PostClockEvent(CLOCK_EVENT_ERROR, L"Error getting network time: no valid reply from %s (%s)", g_TimeConfig.address, reason);
+			closesocket(sock);
+			WSACleanup();
+			return FALSE;
+		}
 	}
 
 	closesocket(sock);
 	WSACleanup();
 
-	uint32_t seconds;
-	memcpy(&seconds, &ntpPacket[40], sizeof(seconds));
-	seconds = ntohl(seconds) - NTP_TIMESTAMP_DELTA;
+	wprintf(L"NTP sample: offset %lld ms, delay %lld ms.\r\n", sample->offset, sample->delay);
+	RecordSyncSample(sample);
+	return TRUE;
+}
+
+BOOL GetNTPDateTime(void) {
+	blue();
+	wprintf(L"Syncing NTP time.\r\n");
+	reset();
 
-	SetNTPTime((time_t)seconds);
+	// On failure the clock keeps running from the last good sync (or the system clock if there never was one)
+	NTPSample sample;
+	if (!QueryNTPServer(&sample)) {
+		return FALSE;
+	}
+
+	ApplyNTPTime(sample.serverTime, sample.tick);
+	ClearClockStatus();
+	return TRUE;
+}
+
+void ApplyNTPTime(int64_t serverTime, DWORD tick) {
+	int64_t unixMs = serverTime - (int64_t)NTP_TIMESTAMP_DELTA * 1000;
+	SetReferenceTime((time_t)(unixMs / 1000), (unsigned int)(unixMs % 1000), tick);
 }
 
 void SetNTPTime(time_t ntpTime) {
-	lastNTPTime = ntpTime;
-	lastSyncTick = GetTickCount();
+	SetReferenceTime(ntpTime, 0, GetTickCount());
+}
+
+void SetReferenceTime(time_t seconds, unsigned int milliseconds, DWORD tick) {
+	while (InterlockedCompareExchange(&referenceWriter, 1, 0) != 0) {
+		SwitchToThread();
+	}
+
+	InterlockedIncrement(&referenceSequence); // Odd: readers wait
+	lastNTPTime = seconds;
+	lastNTPMillis = milliseconds;
+	lastSyncTick = tick;
 	isNTPInitialized = TRUE;
+	InterlockedIncrement(&referenceSequence); // Even again: the new values are complete
+
+	InterlockedExchange(&referenceWriter, 0);
+}
+
+// Copies the reference time as one consistent set. Returns FALSE if no sync has happened yet
+static BOOL ReadReferenceTime(time_t* seconds, unsigned int* milliseconds, DWORD* tick) {
+	for (;;) {
+		LONG sequence = referenceSequence;
+		if (sequence & 1) {
+			YieldProcessor();
+			continue;
+		}
+		MemoryBarrier();
+
+		BOOL initialized = isNTPInitialized;
+		*seconds = lastNTPTime;
+		*milliseconds = lastNTPMillis;
+		*tick = lastSyncTick;
+
+		MemoryBarrier();
+		if (referenceSequence == sequence) {
+			return initialized;
+		}
+	}
 }
 
 void GetAdjustedTime(struct tm* outputTm) {
-	if (!isNTPInitialized) {
+	time_t referenceTime;
+	unsigned int referenceMillis;
+	DWORD referenceTick;
+	if (!ReadReferenceTime(&referenceTime, &referenceMillis, &referenceTick)) {
 		time_t now = time(NULL);
 		*outputTm = *gmtime(&now);
 		return;
 	}
 
 	// Calculate elapsed time since last sync
-	DWORD elapsed = GetTickCount() - lastSyncTick;
-	time_t adjustedTime = lastNTPTime + (elapsed / 1000); // ms to seconds
+	DWORD elapsed = GetTickCount() - referenceTick + referenceMillis;
+	time_t adjustedTime = referenceTime + (elapsed / 1000); // ms to seconds
 
 	*outputTm = *gmtime(&adjustedTime);
 }
 
+// Returns the selected time zone's offset from UTC in seconds, parsed from its "UTC±hh:mm" name. 0 if no time zone is selected.
+static int GetTimeZoneOffset(void) {
+	if (g_nTimeZone < 0 || g_nTimeZone >= 39) return 0;
+
+	const wchar_t* tzString = g_szTimeZones[g_nTimeZone];
+	int hours = 0, minutes = 0, sign = 1;
+
+	const wchar_t* p = wcsstr(tzString, L"UTC");
+	if (p) {
+		p += 3; // Move past "UTC"
+
+		// Check for ± sign
+		if (*p == L'−' || *p == L'-') { sign = -1; p++; }
+		else if (*p == L'+') { sign = 1; p++; }
+
+		// Read hours and minutes
+		swscanf(p, L"%d:%d", &hours, &minutes);
+	}
+
+	return sign * ((hours * 60 + minutes) * 60);
+}
+
+double GetAdjustedSecondsOfDay(void) {
+	time_t adjustedTime, referenceTime;
+	unsigned int referenceMillis;
+	DWORD millis, referenceTick;
+	if (!ReadReferenceTime(&referenceTime, &referenceMillis, &referenceTick)) {
+		SYSTEMTIME st;
+		GetSystemTime(&st);
+		adjustedTime = st.wHour * 3600 + st.wMinute * 60 + st.wSecond;
+		millis = st.wMilliseconds;
+	}
+	else {
+		DWORD elapsed = GetTickCount() - referenceTick + referenceMillis;
+		adjustedTime = referenceTime + (elapsed / 1000);
+		millis = elapsed % 1000;
+	}
+
+	long long seconds = ((long long)adjustedTime + GetTimeZoneOffset()) % 86400;
+	if (seconds < 0) seconds += 86400;
+	return (double)seconds + millis / 1000.0;
+}
+
 void OutputNTPTime(WCHAR* buffer, size_t bufferSize) {
 	if (!buffer) return;
 	
@@ -194,24 +452,8 @@ void OutputNTPTime(WCHAR* buffer, size_t bufferSize) {
 	GetAdjustedTime(&timeinfo);
 
 	if (g_nTimeZone >= 0 && g_nTimeZone < 39) {
-		const wchar_t* tzString = g_szTimeZones[g_nTimeZone];
-		int hours = 0, minutes = 0, sign = 1;
-
-		const wchar_t* p = wcsstr(tzString, L"UTC");
-		if (p) {
-			p += 3; // Move past "UTC"
-
-			// Check for ± sign
-			if (*p == L'−' || *p == L'-') { sign = -1; p++; }
-			else if (*p == L'+') { sign = 1; p++; }
-
-			// Read hours and minutes
-			swscanf(p, L"%d:%d", &hours, &minutes);
-		}
-
-		// Convert offset to minutes and adjust the time
 		time_t rawTime = _mkgmtime(&timeinfo); // Convert struct tm to UTC time
-		rawTime += sign * ((hours * 60 + minutes) * 60); // Apply offset in seconds
+		rawTime += GetTimeZoneOffset(); // Apply offset in seconds
 		gmtime_s(&timeinfo, &rawTime); // Convert back to struct tm
 	}
 
@@ -257,8 +499,16 @@ void OutputNTPTime(WCHAR* buffer, size_t bufferSize) {
 
 DWORD WINAPI NTPThread(LPVOID lpParam) {
 	UNREFERENCED_PARAMETER(lpParam);
+	DWORD retryDelay = NTP_RETRY_MIN_MS;
 	while (1) {
-		GetNTPDateTime();
-		Sleep(g_TimeConfig.syncInterval);
+		if (GetNTPDateTime()) {
+			retryDelay = NTP_RETRY_MIN_MS;
+			Sleep(g_TimeConfig.syncInterval);
+			continue;
+		}
+
+		// Retry sooner than the sync interval, backing off so an unreachable server isn't hammered
+		Sleep(min(retryDelay, g_TimeConfig.syncInterval));
+		retryDelay = min(retryDelay * 2, NTP_RETRY_MAX_MS);
 	}
 }
\ No newline at end of file
@@ -21,14 +21,33 @@
 
 #include "Clock.h"
 #include "Config.h"
+#include "NTPAuth.h"
 
 #define NTP_TIMESTAMP_DELTA 2208988800UL
 #define TIMEOUT_MS 5000 // Give the server 5 seconds to respond
+#define NTP_RETRY_MIN_MS 15000 // First retry after a failed sync
+#define NTP_RETRY_MAX_MS 600000 // Retries back off up to 10 minutes (or the sync interval, if that is shorter)
+
+// Result of one client/server exchange. All times are in milliseconds, and absolute times are counted from 1900 like NTP does.
+typedef struct __NTPSample {
+	int64_t offset; // Server clock minus local clock
+	int64_t delay; // Round trip delay, minus the time the server spent processing
+	int64_t serverTime; // Best estimate of the server's time at the moment the reply arrived
+	DWORD tick; // GetTickCount when the reply arrived
+	uint32_t source; // IPv4 address of the server, in network order
+} NTPSample;
 
 int PingNTPServer(const TimeConfig*); // Checks that the address is a valid address and the PC can reach it
-void GetNTPDateTime(); // Gets the current time from the NTP server
+BOOL GetNTPDateTime(void); // Gets the current time from the NTP server. Returns FALSE if the sync failed. Errors are posted to the event queue.
+BOOL QueryNTPServer(NTPSample*); // Does one validated exchange with the configured server. Returns FALSE if no valid reply arrived
+BOOL GetConfiguredNTPKey(const NTPKey**); // Looks up the key set by NTPKeyID. Sets NULL if authentication is off. Returns FALSE if the key is missing from the key file
+int64_t NTPTimestampToMs(const uint8_t*); // Converts a 64-bit on-wire NTP timestamp to milliseconds since 1900
+int64_t GetLocalNTPMs(void); // Current system time in milliseconds since 1900, the same scale as NTPTimestampToMs
+void ApplyNTPTime(int64_t, DWORD); // Sets the internal time from a server time in milliseconds since 1900, valid at the given tick
 void SetNTPTime(time_t); // Sets the internal time to a specific time_t
+void SetReferenceTime(time_t, unsigned int, DWORD); // Sets the internal time from any time source (NTP, GPS). Takes the seconds, the milliseconds and the GetTickCount value the time was valid at
 void GetAdjustedTime(struct tm*); // Gets the current time adjusted for local offsets. Prevents the clock from pulling from NTP every time the it needs to be called.
+double GetAdjustedSecondsOfDay(void); // Seconds since midnight in the selected time zone, with the milliseconds as the fraction. Used for the analog face's sweeping second hand
 void OutputNTPTime(WCHAR*, size_t); // Outputs the current time from the NTP time source, exactly the same as the system time in Clock.c
 DWORD WINAPI NTPThread(LPVOID); // Thread to update the time periodically. Uses the user-defined interval in the config.
 
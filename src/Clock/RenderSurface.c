@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "RenderSurface.h"
+#include "Colors.h"
+
+// RenderText used to create a memory DC and a bitmap on every WM_DRAWITEM and never deleted the custom color brush,
+// which leaked a GDI handle per frame until the process hit the 10,000 handle limit. The surface keeps them around instead.
+
+RenderSurface g_RenderSurface;
+static RenderCounters counters;
+
+static void ReleaseBitmap(RenderSurface* surface) {
+	if (!surface->hBitmap) return;
+
+	SelectObject(surface->hMemDC, surface->hOldBitmap);
+	DeleteObject(surface->hBitmap);
+	InterlockedIncrement(&counters.bitmapsDeleted);
+
+	surface->hBitmap = NULL;
+	surface->hOldBitmap = NULL;
+	surface->pixels = NULL;
+	surface->width = 0;
+	surface->height = 0;
+	WrapFramebuffer(&surface->framebuffer, NULL, 0, 0, 0);
+}
+
+BOOL PrepareRenderSurface(RenderSurface* surface, HDC hdc, int width, int height) {
+	if (width <= 0 || height <= 0) {
+		return FALSE;
+	}
+
+	if (surface->hBitmap && surface->width == width && surface->height == height) {
+		return TRUE;
+	}
+
+	if (!surface->hMemDC) {
+		surface->hMemDC = CreateCompatibleDC(hdc);
+		if (!surface->hMemDC) {
+			return FALSE;
+		}
+		InterlockedIncrement(&counters.dcsCreated);
+		SetBkMode(surface->hMemDC, TRANSPARENT);
+	}
+
+	ReleaseBitmap(surface);
+
+	BITMAPINFO bmi;
+	ZeroMemory(&bmi, sizeof(bmi));
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth = width;
+	bmi.bmiHeader.biHeight = -height; // Negative for top-down rows
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 32;
+	bmi.bmiHeader.biCompression = BI_RGB;
+
+	surface->hBitmap = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &surface->pixels, NULL, 0);
+	if (!surface->hBitmap) {
+		red();
+		wprintf(L"Failed to create the %dx%d back buffer! GetLastError: 0x%x\r\n", width, height, GetLastError());
+		reset();
+		return FALSE;
+	}
+	InterlockedIncrement(&counters.bitmapsCreated);
+	InterlockedIncrement(&counters.recreations);
+
+	surface->hOldBitmap = (HBITMAP)SelectObject(surface->hMemDC, surface->hBitmap);
+	surface->width = width;
+	surface->height = height;
+	WrapFramebuffer(&surface->framebuffer, surface->pixels, width, height, width);
+	return TRUE;
+}
+
+void SelectRenderFont(RenderSurface* surface, HFONT hFont) {
+	if (!hFont || hFont == surface->hFont) return;
+
+	HFONT hPrevious = (HFONT)SelectObject(surface->hMemDC, hFont);
+	if (!surface->hOldFont) {
+		surface->hOldFont = hPrevious; // Keep the DC's original font to put back before the DC is deleted
+	}
+	surface->hFont = hFont;
+}
+
+HBRUSH GetRenderBrush(RenderSurface* surface, COLORREF color) {
+	if (surface->hBrush && surface->brushColor == color) {
+		return surface->hBrush;
+	}
+
+	if (surface->hBrush) {
+		DeleteObject(surface->hBrush);
+		InterlockedIncrement(&counters.brushesDeleted);
+	}
+
+	surface->hBrush = CreateSolidBrush(color);
+	surface->brushColor = color;
+	if (surface->hBrush) {
+		InterlockedIncrement(&counters.brushesCreated);
+	}
+	return surface->hBrush;
+}
+
+void ResetRenderSurface(RenderSurface* surface) {
+	ReleaseBitmap(surface);
+
+	if (surface->hMemDC) {
+		if (surface->hOldFont) {
+			SelectObject(surface->hMemDC, surface->hOldFont);
+		}
+		DeleteDC(surface->hMemDC);
+		InterlockedIncrement(&counters.dcsDeleted);
+	}
+
+	if (surface->hBrush) {
+		DeleteObject(surface->hBrush);
+		InterlockedIncrement(&counters.brushesDeleted);
+	}
+
+	ZeroMemory(surface, sizeof(*surface));
+}
+
+void GetRenderCounters(RenderCounters* out) {
+	*out = counters;
+}
+
+void PrintRenderCounters(void) {
+	RenderCounters c;
+	GetRenderCounters(&c);
+
+	blue();
+	wprintf(L"Render surfaces: %ld rebuilds. DCs %ld/%ld, bitmaps %ld/%ld, brushes %ld/%ld (created/deleted). Process GDI objects: %lu. Framebuffer kernels: %S\r\n",
+		c.recreations, c.dcsCreated, c.dcsDeleted, c.bitmapsCreated, c.bitmapsDeleted, c.brushesCreated, c.brushesDeleted,
+		GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS), FramebufferKernelName(FramebufferGetKernels()));
+	reset();
+}
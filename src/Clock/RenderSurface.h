@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_RENDER_SURFACE_H__
+#define __CLOCK_RENDER_SURFACE_H__
+
+#include "Clock.h"
+#include "Framebuffer.h"
+
+// The back buffer the clock is drawn into before it is copied to the window.
+// Everything here lives across frames and is only recreated when the size changes or the display settings do.
+typedef struct __RenderSurface {
+	HDC hMemDC;
+	HBITMAP hBitmap; // 32 bpp top-down DIB section, so the pixels can also be written directly
+	HBITMAP hOldBitmap;
+	void* pixels; // Points into the DIB section. Rows are width * 4 bytes apart.
+	Framebuffer framebuffer; // The same pixels, for the CPU drawing routines in Framebuffer.c. Call GdiFlush before using it after drawing with GDI
+	int width;
+	int height;
+	HBRUSH hBrush; // Cached solid brush for the custom background color
+	COLORREF brushColor;
+	HFONT hFont; // Font currently selected into hMemDC
+	HFONT hOldFont;
+} RenderSurface;
+
+// GDI object bookkeeping for the render surface. Created minus deleted should stay flat no matter how long the clock runs.
+typedef struct __RenderCounters {
+	LONG dcsCreated;
+	LONG dcsDeleted;
+	LONG bitmapsCreated;
+	LONG bitmapsDeleted;
+	LONG brushesCreated;
+	LONG brushesDeleted;
+	LONG recreations; // Times a surface had to be rebuilt (resize, display change)
+} RenderCounters;
+
+extern RenderSurface g_RenderSurface; // The back buffer the compositor builds frames in. See Compositor.c
+
+BOOL PrepareRenderSurface(RenderSurface*, HDC, int, int); // Makes sure the surface matches the given size, rebuilding it only if it doesn't
+void SelectRenderFont(RenderSurface*, HFONT); // Selects a font into the surface, skipping the call if it's already selected
+HBRUSH GetRenderBrush(RenderSurface*, COLORREF); // Returns a solid brush of the given color. The brush is owned by the surface, don't delete it
+void ResetRenderSurface(RenderSurface*); // Releases everything. The next PrepareRenderSurface rebuilds it. Used on exit and on theme or display changes
+void GetRenderCounters(RenderCounters*); // Copies the counters
+void PrintRenderCounters(void); // Logs the counters and the process' GDI object count to the console
+
+#endif // !__CLOCK_RENDER_SURFACE_H__
@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "RenderThread.h"
+#include "Colors.h"
+
+// The clock used to be formatted, laid out and composited on the UI thread from WM_TIMER, so it froze whenever the UI thread was busy:
+// a modal message box, the settings window opening or a window drag. Now a thread of its own builds every frame with the compositor
+// and hands it over through three buffers. The UI thread only copies the newest one to the window when Windows asks it to paint.
+//
+// The handoff is lock-free. Each side owns one buffer, and the third is swapped in and out of 'shared' with InterlockedExchange.
+// The render thread swaps in each finished frame with the fresh bit set. The UI thread swaps it out only if the bit is set, so
+// neither side ever waits for the other. Frames the UI thread never picked up are simply replaced.
+//
+// The compositor still draws into one back buffer (g_RenderSurface) and only redraws what changed. Before a handoff buffer is reused,
+// the rectangles that changed since it last held a frame are copied into it from there, so a frame costs about as much as before.
+
+#define SHARED_INDEX_MASK	0x3
+#define SHARED_FRESH		0x4 // Set while the buffer in 'shared' holds a frame the UI thread hasn't seen
+
+typedef struct __RenderBuffer {
+	RenderSurface surface;
+	LONG frame; // Number of the frame the buffer holds, -1 if it doesn't hold one yet
+} RenderBuffer;
+
+typedef struct __FrameDamage {
+	int count;
+	RECT rects[COMPOSITOR_MAX_DIRTY];
+} FrameDamage;
+
+static RenderBuffer buffers[RENDER_BUFFER_COUNT];
+static volatile LONG shared = 2; // Index of the buffer between the two threads, plus SHARED_FRESH
+static int back = 1; // Only touched by the render thread
+static int front = 0; // Only touched by the UI thread
+static volatile LONG presenting = FALSE; // Set by the UI thread while it reads a buffer
+static volatile LONG resizing = FALSE; // Set by the render thread while it reallocates the buffers
+
+static FrameDamage damageHistory[RENDER_DAMAGE_HISTORY];
+static LONG frameNumber = 0;
+
+static HANDLE hRenderThread = NULL;
+static DWORD renderThreadId = 0;
+static HANDLE hStopEvent = NULL;
+static HANDLE hWakeEvent = NULL; // Wakes the thread early for a resize or reset
+static volatile LONG requestedSize = 0; // MAKELONG(width, height) of a pending resize, 0 if there's none
+static volatile LONG resetRequested = FALSE;
+static volatile LONG suspendReasons = 0; // RENDER_SUSPEND_ flags
+static HWND hWndTarget;
+static DWORD frameInterval;
+static RenderFrameProc FrameProc;
+static RenderThreadStats stats;
+
+// dwmapi is loaded by hand since XP doesn't have it
+typedef HRESULT(WINAPI* DwmIsCompositionEnabledProc)(BOOL*);
+static HMODULE hDwmApi;
+static DwmIsCompositionEnabledProc pDwmIsCompositionEnabled;
+
+static void ReleaseBuffers(void) {
+	for (int i = 0; i < RENDER_BUFFER_COUNT; i++) {
+		ResetRenderSurface(&buffers[i].surface);
+		buffers[i].frame = -1;
+	}
+}
+
+// The UI thread may be halfway through presenting from one of the buffers, so wait for it to finish before they are freed or reallocated.
+// It won't start again until EndBufferChange clears 'resizing'.
+static void BeginBufferChange(void) {
+	InterlockedExchange(&resizing, TRUE);
+	while (presenting) {
+		SwitchToThread();
+	}
+}
+
+static void EndBufferChange(void) {
+	InterlockedExchange(&resizing, FALSE);
+}
+
+// Resizes the compositor and the handoff buffers.
+static BOOL ResizeBuffers(int width, int height) {
+	BeginBufferChange();
+
+	HDC hdc = GetDC(hWndTarget);
+	BOOL result = ResizeCompositor(hWndTarget, width, height);
+	for (int i = 0; i < RENDER_BUFFER_COUNT; i++) {
+		result = result && PrepareRenderSurface(&buffers[i].surface, hdc, width, height);
+		buffers[i].frame = -1;
+	}
+	ReleaseDC(hWndTarget, hdc);
+
+	EndBufferChange();
+	return result;
+}
+
+// Brings the back buffer up to the frame just composited, hands it to the UI thread and invalidates what changed.
+// The window is only invalidated once the frame can be picked up, so a paint can't slip in between and show the old frame for good.
+static void PublishFrame(const RECT* damage, int count) {
+	frameNumber++;
+	FrameDamage* history = &damageHistory[frameNumber % RENDER_DAMAGE_HISTORY];
+	history->count = count;
+	memcpy(history->rects, damage, count * sizeof(RECT));
+
+	RenderBuffer* buffer = &buffers[back];
+	if (!buffer->surface.hMemDC) {
+		return;
+	}
+
+	GdiFlush(); // The status line is drawn with GDI
+	if (buffer->frame < 0 || frameNumber - buffer->frame > RENDER_DAMAGE_HISTORY) {
+		FramebufferCopy(&buffer->surface.framebuffer, &g_RenderSurface.framebuffer, NULL);
+	}
+	else {
+		for (LONG frame = buffer->frame + 1; frame <= frameNumber; frame++) {
+			const FrameDamage* missed = &damageHistory[frame % RENDER_DAMAGE_HISTORY];
+			for (int i = 0; i < missed->count; i++) {
+				FramebufferCopy(&buffer->surface.framebuffer, &g_RenderSurface.framebuffer, (const FramebufferRect*)&missed->rects[i]);
+			}
+		}
+	}
+	buffer->frame = frameNumber;
+
+	LONG previous = InterlockedExchange(&shared, back | SHARED_FRESH);
+	if (previous & SHARED_FRESH) {
+		InterlockedIncrement(&stats.framesDropped);
+	}
+	back = previous & SHARED_INDEX_MASK;
+
+	for (int i = 0; i < count; i++) {
+		InvalidateRect(hWndTarget, &damage[i], FALSE);
+	}
+}
+
+// Returns whether other windows cover the clock completely. Only works without desktop composition: under DWM every window is drawn off screen,
+// so its clip box is never empty. Minimizing and locking are reported by the UI thread either way.
+static BOOL IsTargetOccluded(void) {
+	BOOL composited = FALSE;
+	if (pDwmIsCompositionEnabled && SUCCEEDED(pDwmIsCompositionEnabled(&composited)) && composited) {
+		return FALSE;
+	}
+
+	HDC hdc = GetDC(hWndTarget);
+	if (!hdc) {
+		return FALSE;
+	}
+
+	RECT clip;
+	int region = GetClipBox(hdc, &clip);
+	ReleaseDC(hWndTarget, hdc);
+	return region == NULLREGION;
+}
+
+static DWORD WINAPI RenderThreadProc(LPVOID lpParam) {
+	UNREFERENCED_PARAMETER(lpParam);
+
+	LARGE_INTEGER frequency, now, start, end;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	LONGLONG period = frequency.QuadPart * frameInterval / 1000;
+	LONGLONG nextTick = now.QuadPart;
+	int width = 0, height = 0;
+
+	BOOL wasSuspended = FALSE;
+	BOOL rebuilt = FALSE; // Kept across suspended wakeups until a frame has been laid out
+	DWORD lastProbe = GetTickCount() - RENDER_OCCLUSION_PROBE;
+
+	HANDLE handles[2] = { hStopEvent, hWakeEvent };
+	for (;;) {
+		// Ticks are scheduled from a fixed start rather than from when the last one finished, so the cadence doesn't drift
+		QueryPerformanceCounter(&now);
+		DWORD wait = nextTick > now.QuadPart ? (DWORD)((nextTick - now.QuadPart) * 1000 / frequency.QuadPart) : 0;
+
+		// While hidden, sleep until the UI thread says otherwise. A covered window has to be checked now and then, since nothing says when it's uncovered
+		LONG reasons = suspendReasons;
+		if (reasons & ~RENDER_SUSPEND_OCCLUDED) {
+			wait = INFINITE;
+		}
+		else if (reasons) {
+			wait = RENDER_OCCLUSION_PROBE;
+		}
+
+		DWORD result = WaitForMultipleObjects(2, handles, FALSE, wait);
+		if (result == WAIT_OBJECT_0) {
+			break;
+		}
+		BOOL isTick = (result != WAIT_OBJECT_0 + 1);
+		InterlockedIncrement(&stats.wakeups);
+		if (reasons) {
+			InterlockedIncrement(&stats.hiddenWakeups);
+		}
+
+		if (InterlockedExchange(&resetRequested, FALSE)) {
+			BeginBufferChange();
+			ResetCompositor();
+			ReleaseBuffers();
+			EndBufferChange();
+			if (width > 0 && height > 0) {
+				InterlockedCompareExchange(&requestedSize, MAKELONG(width, height), 0);
+			}
+		}
+
+		LONG size = InterlockedExchange(&requestedSize, 0);
+		if (size) {
+			width = LOWORD(size);
+			height = HIWORD(size);
+			rebuilt |= ResizeBuffers(width, height);
+		}
+
+		// Probing takes a DC, so it's done once per RENDER_OCCLUSION_PROBE rather than every frame. A covered window is only woken by the probe timeout
+		DWORD tick = GetTickCount();
+		if (!(suspendReasons & ~RENDER_SUSPEND_OCCLUDED) && ((reasons && isTick) || tick - lastProbe >= RENDER_OCCLUSION_PROBE)) {
+			lastProbe = tick;
+			SetRenderSuspended(RENDER_SUSPEND_OCCLUDED, IsTargetOccluded());
+		}
+		if (suspendReasons) {
+			if (!wasSuspended) {
+				wasSuspended = TRUE;
+				InterlockedIncrement(&stats.suspensions);
+			}
+			continue;
+		}
+		if (wasSuspended) {
+			// Draw the catch-up frame right away and carry on ticking from here
+			wasSuspended = FALSE;
+			QueryPerformanceCounter(&now);
+			nextTick = now.QuadPart;
+			InterlockedIncrement(&stats.resumes);
+		}
+
+		QueryPerformanceCounter(&start);
+		FrameProc(rebuilt);
+		rebuilt = FALSE;
+
+		RECT damage[COMPOSITOR_MAX_DIRTY];
+		int count = CompositeFrame(damage, COMPOSITOR_MAX_DIRTY);
+		if (count > 0) {
+			PublishFrame(damage, count);
+			InterlockedIncrement(&stats.framesRendered);
+		}
+		QueryPerformanceCounter(&end);
+
+		LONG micros = (LONG)((end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart);
+		if (micros > stats.worstFrameMicroseconds) {
+			stats.worstFrameMicroseconds = micros;
+		}
+
+		if (isTick) {
+			nextTick += period;
+			if (end.QuadPart - nextTick > period * RENDER_LATE_RESET) {
+				// Don't try to make up for a long stall (a suspended VM, a debugger break) with a burst of frames
+				nextTick = end.QuadPart + period;
+				InterlockedIncrement(&stats.lateTicks);
+			}
+		}
+	}
+
+	return 0;
+}
+
+BOOL StartRenderThread(HWND hwnd, DWORD interval, RenderFrameProc proc) {
+	hWndTarget = hwnd;
+	frameInterval = interval;
+	FrameProc = proc;
+	for (int i = 0; i < RENDER_BUFFER_COUNT; i++) {
+		buffers[i].frame = -1;
+	}
+
+	hDwmApi = LoadLibraryW(L"dwmapi.dll");
+	pDwmIsCompositionEnabled = hDwmApi ? (DwmIsCompositionEnabledProc)GetProcAddress(hDwmApi, "DwmIsCompositionEnabled") : NULL;
+
+	hStopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+	hWakeEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+	if (hStopEvent && hWakeEvent) {
+		hRenderThread = CreateThread(NULL, 0, RenderThreadProc, NULL, 0, &renderThreadId);
+	}
+
+	if (!hRenderThread) {
+		red();
+		wprintf(L"Failed to create the render thread! GetLastError: 0x%x\r\n", GetLastError());
+		reset();
+		StopRenderThread();
+		return FALSE;
+	}
+
+	wprintf(L"Render thread started, drawing every %lu ms.\r\n", interval);
+	return TRUE;
+}
+
+void StopRenderThread(void) {
+	if (hRenderThread) {
+		SetEvent(hStopEvent);
+		WaitForSingleObject(hRenderThread, INFINITE);
+		CloseHandle(hRenderThread);
+		hRenderThread = NULL;
+	}
+
+	if (hStopEvent) {
+		CloseHandle(hStopEvent);
+		hStopEvent = NULL;
+	}
+	if (hWakeEvent) {
+		CloseHandle(hWakeEvent);
+		hWakeEvent = NULL;
+	}
+
+	pDwmIsCompositionEnabled = NULL;
+	if (hDwmApi) {
+		FreeLibrary(hDwmApi);
+		hDwmApi = NULL;
+	}
+
+	ReleaseBuffers();
+}
+
+void RequestRenderResize(int width, int height) {
+	if (width <= 0 || height <= 0 || !hWakeEvent) {
+		return;
+	}
+
+	InterlockedExchange(&requestedSize, MAKELONG(width, height));
+	SetEvent(hWakeEvent);
+}
+
+void RequestRenderReset(void) {
+	if (!hWakeEvent) {
+		return;
+	}
+
+	InterlockedExchange(&resetRequested, TRUE);
+	SetEvent(hWakeEvent);
+}
+
+void SetRenderSuspended(LONG reason, BOOL suspended) {
+	LONG previous;
+	if (suspended) {
+		previous = InterlockedOr(&suspendReasons, reason);
+	}
+	else {
+		previous = InterlockedAnd(&suspendReasons, ~reason);
+	}
+
+	// Wake the thread so it goes to sleep for good, or draws its catch-up frame. The render thread doesn't need to wake itself
+	if (((previous & reason) != 0) != (suspended != FALSE) && hWakeEvent && GetCurrentThreadId() != renderThreadId) {
+		SetEvent(hWakeEvent);
+	}
+}
+
+void PresentRenderFrame(HDC hdc) {
+	// Announce the read before checking for a resize. Both are full barriers, so either the render thread sees 'presenting' and waits, or we see 'resizing' and skip this paint.
+	// A resize invalidates the whole window once it's done anyway.
+	InterlockedExchange(&presenting, TRUE);
+	if (suspendReasons & RENDER_SUSPEND_OCCLUDED) {
+		SetRenderSuspended(RENDER_SUSPEND_OCCLUDED, FALSE); // Windows only asks for a paint once part of the window can be seen again
+	}
+	if (!resizing) {
+		if (shared & SHARED_FRESH) {
+			front = InterlockedExchange(&shared, front) & SHARED_INDEX_MASK;
+			InterlockedIncrement(&stats.framesPresented);
+		}
+
+		const RenderBuffer* buffer = &buffers[front];
+		RECT clip, surfaceRect = { 0, 0, buffer->surface.width, buffer->surface.height };
+		if (buffer->frame >= 0 && buffer->surface.hMemDC && GetClipBox(hdc, &clip) != NULLREGION && IntersectRect(&clip, &clip, &surfaceRect)) {
+			BitBlt(hdc, clip.left, clip.top, clip.right - clip.left, clip.bottom - clip.top, buffer->surface.hMemDC, clip.left, clip.top, SRCCOPY);
+		}
+	}
+	InterlockedExchange(&presenting, FALSE);
+}
+
+void GetRenderThreadStats(RenderThreadStats* out) {
+	*out = stats;
+
+	FILETIME creation, exit, kernel, user;
+	if (hRenderThread && GetThreadTimes(hRenderThread, &creation, &exit, &kernel, &user)) {
+		ULARGE_INTEGER k = { kernel.dwLowDateTime, kernel.dwHighDateTime }, u = { user.dwLowDateTime, user.dwHighDateTime };
+		out->cpuMilliseconds = (LONG)((k.QuadPart + u.QuadPart) / 10000); // FILETIMEs count 100 ns intervals
+	}
+}
+
+void PrintRenderThreadStats(void) {
+	blue();
+	RenderThreadStats current;
+	GetRenderThreadStats(&current);
+	wprintf(L"Render thread: %ld frames rendered, %ld presented, %ld dropped, %ld late ticks. Slowest frame took %ld us.\r\n",
+		current.framesRendered, current.framesPresented, current.framesDropped, current.lateTicks, current.worstFrameMicroseconds);
+	wprintf(L"Render thread: %ld wakeups (%ld while hidden), suspended %ld times, %ld catch-up frames. %ld ms of CPU time.\r\n",
+		current.wakeups, current.hiddenWakeups, current.suspensions, current.resumes, current.cpuMilliseconds);
+	reset();
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_RENDER_THREAD_H__
+#define __CLOCK_RENDER_THREAD_H__
+
+#include "Clock.h"
+#include "Compositor.h"
+
+#define RENDER_BUFFER_COUNT 3 // One being drawn, one on screen and the newest finished frame waiting in between
+#define RENDER_DAMAGE_HISTORY 4 // Frames of dirty rectangles remembered for bringing an older buffer up to date
+#define RENDER_LATE_RESET 4 // Intervals the thread can fall behind before it gives up catching up and starts counting from now
+#define RENDER_OCCLUSION_PROBE 1000 // Milliseconds between checks of whether a covered window can be seen again
+
+// Reasons for not drawing. While any is set the thread sleeps, and it draws one frame to catch up once they're all cleared
+#define RENDER_SUSPEND_MINIMIZED	0x1
+#define RENDER_SUSPEND_LOCKED		0x2 // The session is locked or its console disconnected
+#define RENDER_SUSPEND_OCCLUDED		0x4 // Other windows cover the clock completely. Detected by the render thread itself, and only without desktop composition
+
+typedef void (*RenderFrameProc)(BOOL); // Updates the layers for the next frame. TRUE when the back buffer was just rebuilt and everything has to be laid out again. Called on the render thread
+
+typedef struct __RenderThreadStats {
+	LONG framesRendered; // Frames that changed something
+	LONG framesPresented; // Frames the UI thread picked up
+	LONG framesDropped; // Frames replaced by a newer one before the UI thread got to them, e.g. while it was blocked
+	LONG lateTicks; // Ticks that started more than RENDER_LATE_RESET intervals late
+	LONG worstFrameMicroseconds; // Longest time spent building one frame
+	LONG wakeups; // Times the thread woke up for any reason
+	LONG hiddenWakeups; // Wakeups while drawing was suspended. Only the occlusion probe should cause these
+	LONG suspensions; // Times drawing was suspended
+	LONG resumes; // Catch-up frames drawn after a suspension
+	LONG cpuMilliseconds; // Kernel and user time the thread has used
+} RenderThreadStats;
+
+BOOL StartRenderThread(HWND, DWORD, RenderFrameProc); // Starts drawing frames for a window every given number of milliseconds
+void StopRenderThread(void); // Stops the thread and releases its buffers. Call before releasing anything the frame proc uses
+void RequestRenderResize(int, int); // Asks the render thread to resize the back buffers. Returns right away
+void RequestRenderReset(void); // Asks the render thread to rebuild every buffer, e.g. after a display or theme change
+void SetRenderSuspended(LONG, BOOL); // Sets or clears one of the RENDER_SUSPEND_ reasons. Returns right away
+void PresentRenderFrame(HDC); // Copies the newest finished frame to the window. Never waits on the render thread. Called from WM_DRAWITEM
+void GetRenderThreadStats(RenderThreadStats*); // Copies the statistics
+void PrintRenderThreadStats(void); // Logs the statistics to the console
+
+#endif // !__CLOCK_RENDER_THREAD_H__
@@ -0,0 +1,460 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "SdfAtlas.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define SDF_FAR 1e20f
+#define SDF_SUBSTEP_BITS 4
+#define SDF_SUBSTEPS (1 << SDF_SUBSTEP_BITS)
+#define SDF_LEVELS (256 * SDF_SUBSTEPS)
+#define SDF_RAMP_SLOTS 8 // Size and style combinations whose ramps are kept. The clock and its dial use a couple at a time, more stay around while the window is resized
+#define SDF_STACK_MASKS 1536 // Mask rows for glyphs up to a third of this wide come from the stack
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION RampLock;
+#define InitRampLock(l) (InitializeCriticalSection(l), 1)
+#define FreeRampLock(l) DeleteCriticalSection(l)
+#define LockRamps(l) EnterCriticalSection(l)
+#define UnlockRamps(l) LeaveCriticalSection(l)
+#else
+typedef pthread_mutex_t RampLock;
+#define InitRampLock(l) (pthread_mutex_init((l), NULL) == 0)
+#define FreeRampLock(l) pthread_mutex_destroy(l)
+#define LockRamps(l) pthread_mutex_lock(l)
+#define UnlockRamps(l) pthread_mutex_unlock(l)
+#endif
+
+// Coverage for every field value with SDF_SUBSTEPS fractions between whole values, so the per-pixel work is a bilinear sample and a table lookup
+typedef struct __SdfRamps {
+	uint8_t fill[SDF_LEVELS];
+	uint8_t outline[SDF_LEVELS];
+	uint8_t glow[SDF_LEVELS];
+	int hasOutline;
+	int hasGlow;
+
+	// What the ramps were built for. Colors don't matter, they're applied when blending
+	float size;
+	float outlineWidth;
+	float glowRadius;
+	int users; // Draws using the ramps right now. Only a slot nobody is using is rebuilt for another style
+	unsigned int lastUsed;
+} SdfRamps;
+
+// The ramps take a few thousand float operations to build, far more than a tile of text takes to draw, so they're built once per size and style.
+// Every tile of a frame draws with the same style, so the lock is only held for a lookup unless the size just changed.
+struct __SdfRampCache {
+	RampLock lock;
+	SdfRamps slots[SDF_RAMP_SLOTS];
+	unsigned int useCount;
+};
+
+static int IsDigit(wchar_t ch) {
+	return ch >= L'0' && ch <= L'9';
+}
+
+// One dimensional squared distance transform (Felzenszwalb and Huttenlocher). 'f' holds 0 at feature pixels and SDF_FAR elsewhere,
+// 'd' receives the squared distance to the nearest feature. 'v' and 'z' are scratch space for n and n + 1 entries.
+static void DistanceTransform1D(const float* f, float* d, int* v, float* z, int n) {
+	int k = 0;
+	v[0] = 0;
+	z[0] = -SDF_FAR;
+	z[1] = SDF_FAR;
+
+	for (int q = 1; q < n; q++) {
+		float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+		while (s <= z[k]) {
+			k--;
+			s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = SDF_FAR;
+	}
+
+	k = 0;
+	for (int q = 0; q < n; q++) {
+		while (z[k + 1] < q) {
+			k++;
+		}
+		d[q] = (float)(q - v[k]) * (q - v[k]) + f[v[k]];
+	}
+}
+
+// Squared distance from every pixel to the nearest pixel whose 'inside' matches 'feature'. Columns first, then rows.
+static void DistanceTransform2D(const uint8_t* inside, int feature, float* out, int width, int height, float* f, float* d, int* v, float* z) {
+	for (int i = 0; i < width * height; i++) {
+		out[i] = inside[i] == feature ? 0.0f : SDF_FAR;
+	}
+
+	for (int x = 0; x < width; x++) {
+		for (int y = 0; y < height; y++) f[y] = out[y * width + x];
+		DistanceTransform1D(f, d, v, z, height);
+		for (int y = 0; y < height; y++) out[y * width + x] = d[y];
+	}
+
+	for (int y = 0; y < height; y++) {
+		memcpy(f, out + (size_t)y * width, width * sizeof(float));
+		DistanceTransform1D(f, out + (size_t)y * width, v, z, width);
+	}
+}
+
+// Turns one glyph's coverage into distances. 'coverage' is the glyph's box grown by the spread, 'out' is written with the same layout.
+static int BuildGlyphField(const uint8_t* coverage, uint8_t* out, int width, int height, int spread) {
+	size_t count = (size_t)width * height;
+	int longest = width > height ? width : height;
+	uint8_t* inside = (uint8_t*)malloc(count);
+	float* toInside = (float*)malloc(count * sizeof(float));
+	float* toOutside = (float*)malloc(count * sizeof(float));
+	float* f = (float*)malloc(longest * sizeof(float));
+	float* d = (float*)malloc(longest * sizeof(float));
+	float* z = (float*)malloc((longest + 1) * sizeof(float));
+	int* v = (int*)malloc(longest * sizeof(int));
+	int result = inside && toInside && toOutside && f && d && z && v;
+
+	if (result) {
+		for (size_t i = 0; i < count; i++) {
+			inside[i] = coverage[i] >= 128;
+		}
+		DistanceTransform2D(inside, 1, toInside, width, height, f, d, v, z);
+		DistanceTransform2D(inside, 0, toOutside, width, height, f, d, v, z);
+
+		for (size_t i = 0; i < count; i++) {
+			// The outline lies halfway between the centers of an inside and an outside pixel. Partly covered pixels know better where it is
+			float distance;
+			if (coverage[i] > 0 && coverage[i] < 255) {
+				distance = coverage[i] / 255.0f - 0.5f;
+			}
+			else if (inside[i]) {
+				distance = sqrtf(toOutside[i]) - 0.5f;
+			}
+			else {
+				distance = 0.5f - sqrtf(toInside[i]);
+			}
+
+			float value = 128.0f + distance * 127.0f / spread;
+			out[i] = (uint8_t)(value < 0.0f ? 0.0f : value > 255.0f ? 255.0f : value + 0.5f);
+		}
+	}
+
+	free(inside);
+	free(toInside);
+	free(toOutside);
+	free(f);
+	free(d);
+	free(z);
+	free(v);
+	return result;
+}
+
+int BuildSdfAtlas(SdfAtlas* sdf, const GlyphBackend* backend, const wchar_t* charset) {
+	memset(sdf, 0, sizeof(*sdf));
+
+	GlyphAtlas coverage;
+	if (!BuildGlyphAtlas(&coverage, backend, charset)) {
+		return 0;
+	}
+
+	// Same glyphs, each grown by the spread on every side so the distances have room to fall off
+	int spread = SDF_SPREAD * coverage.lineHeight / SDF_REFERENCE_HEIGHT;
+	if (spread < 1) spread = 1;
+
+	GlyphAtlas* atlas = &sdf->atlas;
+	*atlas = coverage;
+	atlas->pixels = NULL;
+	atlas->width = 0;
+	atlas->height = 0;
+	for (int i = 0; i < atlas->glyphCount; i++) {
+		AtlasGlyph* glyph = &atlas->glyphs[i];
+		if (glyph->width == 0) continue;
+
+		glyph->atlasX = atlas->width;
+		glyph->offsetX -= spread;
+		glyph->offsetY -= spread;
+		glyph->width += spread * 2;
+		glyph->height += spread * 2;
+		atlas->width += glyph->width + 1;
+		if (glyph->height > atlas->height) atlas->height = glyph->height;
+	}
+	if (atlas->width == 0) atlas->width = 1;
+	if (atlas->height == 0) atlas->height = 1;
+
+	atlas->pixels = (uint8_t*)calloc((size_t)atlas->width * atlas->height, 1);
+	int result = atlas->pixels != NULL;
+	for (int i = 0; result && i < atlas->glyphCount; i++) {
+		const AtlasGlyph* source = &coverage.glyphs[i];
+		const AtlasGlyph* glyph = &atlas->glyphs[i];
+		if (glyph->width == 0) continue;
+
+		// Copy the coverage into a padded box, build the field in place and copy it into the atlas
+		uint8_t* box = (uint8_t*)calloc((size_t)glyph->width * glyph->height, 2);
+		if (!box) {
+			result = 0;
+			break;
+		}
+		uint8_t* field = box + (size_t)glyph->width * glyph->height;
+		for (int y = 0; y < source->height; y++) {
+			memcpy(box + (size_t)(y + spread) * glyph->width + spread, coverage.pixels + (size_t)y * coverage.width + source->atlasX, source->width);
+		}
+
+		result = BuildGlyphField(box, field, glyph->width, glyph->height, spread);
+		for (int y = 0; result && y < glyph->height; y++) {
+			memcpy(atlas->pixels + (size_t)y * atlas->width + glyph->atlasX, field + (size_t)y * glyph->width, glyph->width);
+		}
+		free(box);
+	}
+
+	FreeGlyphAtlas(&coverage);
+	if (!result) {
+		FreeSdfAtlas(sdf);
+		return 0;
+	}
+
+	sdf->spread = spread;
+
+	// Without a cache every draw builds its own ramps, which is slower but still correct
+	sdf->ramps = (struct __SdfRampCache*)calloc(1, sizeof(struct __SdfRampCache));
+	if (sdf->ramps && !InitRampLock(&sdf->ramps->lock)) {
+		free(sdf->ramps);
+		sdf->ramps = NULL;
+	}
+	return 1;
+}
+
+void FreeSdfAtlas(SdfAtlas* sdf) {
+	FreeGlyphAtlas(&sdf->atlas);
+	sdf->spread = 0;
+	if (sdf->ramps) {
+		FreeRampLock(&sdf->ramps->lock);
+		free(sdf->ramps);
+		sdf->ramps = NULL;
+	}
+}
+
+float MeasureSdfRun(const SdfAtlas* sdf, const wchar_t* text, int length, float size) {
+	if (sdf->atlas.lineHeight <= 0) return 0.0f;
+	return MeasureGlyphRun(&sdf->atlas, text, length) * size / sdf->atlas.lineHeight;
+}
+
+float FitSdfHeight(const SdfAtlas* sdf, const wchar_t* const* samples, int sampleCount, int width, int height) {
+	// Text width grows in proportion to its height, so no fonts are needed
+	float widest = 0.0f;
+	for (int i = 0; i < sampleCount; i++) {
+		float sampleWidth = MeasureSdfRun(sdf, samples[i], (int)wcslen(samples[i]), 1.0f); // Digits are tabular, so '0' is as wide as any of them
+		if (sampleWidth > widest) widest = sampleWidth;
+	}
+
+	float size = (float)height;
+	if (widest > 0.0f && width / widest < size) {
+		size = width / widest;
+	}
+	return floorf(size);
+}
+
+static uint8_t ToCoverage(float value) {
+	return (uint8_t)(value <= 0.0f ? 0 : value >= 1.0f ? 255 : (int)(value * 255.0f + 0.5f));
+}
+
+static void BuildSdfRamps(SdfRamps* ramps, const SdfAtlas* sdf, float scale, const SdfStyle* style) {
+	// Distances in the atlas are in atlas pixels. One atlas pixel is 'scale' pixels on screen
+	float unit = sdf->spread * scale / 127.0f;
+
+	// Nothing beyond the spread is stored, so an outline or glow wider than that would stop short with a hard edge at the glyph's box
+	float reach = sdf->spread * scale - 1.0f;
+	float outlineWidth = style->outlineWidth < reach ? style->outlineWidth : reach;
+	float glowRadius = style->glowRadius < reach - outlineWidth ? style->glowRadius : reach - outlineWidth;
+	if (outlineWidth < 0.0f) outlineWidth = 0.0f;
+
+	ramps->size = style->size;
+	ramps->outlineWidth = style->outlineWidth;
+	ramps->glowRadius = style->glowRadius;
+	ramps->hasOutline = outlineWidth > 0.0f;
+	ramps->hasGlow = glowRadius > 0.0f;
+	for (int i = 0; i < SDF_LEVELS; i++) {
+		float distance = ((float)i / SDF_SUBSTEPS - 128.0f) * unit; // Screen pixels, positive inside
+		ramps->fill[i] = ToCoverage(distance + 0.5f);
+		ramps->outline[i] = ramps->hasOutline ? ToCoverage(distance + outlineWidth + 0.5f) : 0;
+
+		float falloff = ramps->hasGlow ? 1.0f + (distance + outlineWidth) / glowRadius : 0.0f;
+		ramps->glow[i] = falloff > 0.0f ? ToCoverage(falloff * falloff) : 0;
+	}
+}
+
+// Returns the cached ramps for a style, building them into the least recently used free slot if they aren't there.
+// Returns NULL if every slot is in use by other draws, and the caller builds its own. Pair with ReleaseSdfRamps.
+static const SdfRamps* AcquireSdfRamps(const SdfAtlas* sdf, float scale, const SdfStyle* style) {
+	struct __SdfRampCache* cache = sdf->ramps;
+	if (!cache) return NULL;
+
+	LockRamps(&cache->lock);
+	SdfRamps* found = NULL;
+	SdfRamps* oldest = NULL;
+	for (int i = 0; i < SDF_RAMP_SLOTS; i++) {
+		SdfRamps* slot = &cache->slots[i];
+		if (slot->lastUsed && slot->size == style->size && slot->outlineWidth == style->outlineWidth && slot->glowRadius == style->glowRadius) {
+			found = slot;
+			break;
+		}
+		if (!slot->users && (!oldest || slot->lastUsed < oldest->lastUsed)) {
+			oldest = slot;
+		}
+	}
+
+	if (!found && oldest) {
+		BuildSdfRamps(oldest, sdf, scale, style);
+		found = oldest;
+	}
+	if (found) {
+		found->users++;
+		found->lastUsed = ++cache->useCount;
+	}
+	UnlockRamps(&cache->lock);
+	return found;
+}
+
+static void ReleaseSdfRamps(const SdfAtlas* sdf, const SdfRamps* ramps) {
+	LockRamps(&sdf->ramps->lock);
+	((SdfRamps*)ramps)->users--;
+	UnlockRamps(&sdf->ramps->lock);
+}
+
+// Draws one glyph scaled by 'scale', with its box's top left at (left, top). Each row is turned into up to three coverage masks
+// (glow, outline, fill), which are blended in that order with the framebuffer's span routines.
+// The field is sampled bilinearly in 16.16 fixed point. Samples outside the box repeat its edge, which is as far from the glyph as the field reaches.
+static void DrawSdfGlyph(const SdfAtlas* sdf, const AtlasGlyph* glyph, Framebuffer* fb, float left, float top, float scale, const SdfRamps* ramps, const SdfStyle* style, const FramebufferRect* clip, uint8_t* masks) {
+	FramebufferRect area = { 0, 0, fb->width, fb->height };
+	if (clip) {
+		if (clip->left > area.left) area.left = clip->left;
+		if (clip->top > area.top) area.top = clip->top;
+		if (clip->right < area.right) area.right = clip->right;
+		if (clip->bottom < area.bottom) area.bottom = clip->bottom;
+	}
+
+	int x0 = (int)floorf(left), y0 = (int)floorf(top);
+	int x1 = (int)ceilf(left + glyph->width * scale), y1 = (int)ceilf(top + glyph->height * scale);
+	if (x0 < area.left) x0 = area.left;
+	if (y0 < area.top) y0 = area.top;
+	if (x1 > area.right) x1 = area.right;
+	if (y1 > area.bottom) y1 = area.bottom;
+	if (x0 >= x1 || y0 >= y1) return;
+
+	int width = x1 - x0;
+	uint8_t* glow = masks;
+	uint8_t* outline = masks + width;
+	uint8_t* fill = masks + width * 2;
+	int lastColumn = glyph->width - 1;
+	int32_t step = (int32_t)(65536.0f / scale);
+	int32_t startX = (int32_t)floorf(((x0 + 0.5f - left) / scale - 0.5f) * 65536.0f);
+	FramebufferRect row = { x0, 0, x1, 0 };
+
+	for (int y = y0; y < y1; y++) {
+		float sy = (y + 0.5f - top) / scale - 0.5f;
+		int above = (int)floorf(sy);
+		int fy = (int)((sy - above) * 256.0f);
+		int below = above + 1;
+		if (above < 0) above = 0; else if (above >= glyph->height) above = glyph->height - 1;
+		if (below < 0) below = 0; else if (below >= glyph->height) below = glyph->height - 1;
+		const uint8_t* row0 = sdf->atlas.pixels + (size_t)above * sdf->atlas.width + glyph->atlasX;
+		const uint8_t* row1 = sdf->atlas.pixels + (size_t)below * sdf->atlas.width + glyph->atlasX;
+
+		int anyGlow = 0, anyOutline = 0, anyFill = 0;
+		int32_t sx = startX;
+		for (int i = 0; i < width; i++, sx += step) {
+			int column = sx >> 16; // Floors negative positions too, as every compiler the clock is built with shifts arithmetically
+			int fx = (sx >> 8) & 0xFF;
+			int next = column + 1;
+			if (column < 0) column = 0; else if (column > lastColumn) column = lastColumn;
+			if (next < 0) next = 0; else if (next > lastColumn) next = lastColumn;
+
+			int topValue = row0[column] * (256 - fx) + row0[next] * fx;
+			int bottomValue = row1[column] * (256 - fx) + row1[next] * fx;
+			int level = (topValue * (256 - fy) + bottomValue * fy) >> (16 - SDF_SUBSTEP_BITS);
+
+			fill[i] = ramps->fill[level];
+			outline[i] = ramps->outline[level];
+			glow[i] = ramps->glow[level];
+			anyFill |= fill[i];
+			anyOutline |= outline[i];
+			anyGlow |= glow[i];
+		}
+
+		row.top = y;
+		row.bottom = y + 1;
+		if (anyGlow) FramebufferBlendMask(fb, x0, y, glow, width, width, 1, style->glowColor, &row);
+		if (anyOutline) FramebufferBlendMask(fb, x0, y, outline, width, width, 1, style->outlineColor, &row);
+		if (anyFill) FramebufferBlendMask(fb, x0, y, fill, width, width, 1, style->color, &row);
+	}
+}
+
+void DrawSdfRun(const SdfAtlas* sdf, Framebuffer* fb, const wchar_t* text, int length, float x, float y, const SdfStyle* style, const FramebufferRect* clip) {
+	const GlyphAtlas* atlas = &sdf->atlas;
+	if (!atlas->pixels || atlas->lineHeight <= 0 || style->size <= 0.0f) return;
+
+	float scale = style->size / atlas->lineHeight;
+
+	// Room for three mask rows as wide as the widest glyph
+	int widest = 0;
+	for (int i = 0; i < atlas->glyphCount; i++) {
+		if (atlas->glyphs[i].width > widest) widest = atlas->glyphs[i].width;
+	}
+	size_t maskSize = (size_t)((int)ceilf(widest * scale) + 2) * 3;
+	uint8_t stackMasks[SDF_STACK_MASKS];
+	uint8_t* masks = maskSize <= sizeof(stackMasks) ? stackMasks : (uint8_t*)malloc(maskSize);
+	if (!masks) return;
+
+	const SdfRamps* ramps = AcquireSdfRamps(sdf, scale, style);
+	SdfRamps* ownRamps = NULL;
+	if (!ramps) {
+		ownRamps = (SdfRamps*)malloc(sizeof(SdfRamps));
+		if (!ownRamps) {
+			if (masks != stackMasks) free(masks);
+			return;
+		}
+		BuildSdfRamps(ownRamps, sdf, scale, style);
+		ramps = ownRamps;
+	}
+
+	float penX = x;
+	for (int i = 0; i < length; i++) {
+		const AtlasGlyph* glyph = FindAtlasGlyph(atlas, text[i]);
+		int advance = GlyphRunAdvance(atlas, text[i]);
+
+		if (glyph && glyph->width > 0) {
+			// Digits are centered in their tabular cell
+			float cellOffset = IsDigit(text[i]) ? (advance - glyph->advance) / 2.0f : 0.0f;
+			DrawSdfGlyph(sdf, glyph, fb, penX + (cellOffset + glyph->offsetX) * scale, y + glyph->offsetY * scale, scale, ramps, style, clip, masks);
+		}
+
+		penX += advance * scale;
+	}
+
+	if (ownRamps) free(ownRamps);
+	else ReleaseSdfRamps(sdf, ramps);
+	if (masks != stackMasks) free(masks);
+}
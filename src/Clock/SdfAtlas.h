@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __CLOCK_SDF_ATLAS_H__
+#define __CLOCK_SDF_ATLAS_H__
+
+// Glyphs stored as signed distance fields instead of coverage, so one atlas built at a single size draws crisp text at any size,
+// and an outline or glow is just a different threshold on the same distances.
+
+#include "GlyphAtlas.h"
+
+#define SDF_REFERENCE_HEIGHT 64 // Line height the glyphs are rasterized at before being turned into distances
+#define SDF_SPREAD 8 // Furthest distance stored, in pixels at the reference height. Outlines and glows can't reach further than this scaled up
+
+// The glyphs share GlyphAtlas' layout. Each glyph's box is grown by the spread on every side, and its pixels hold distances:
+// 128 on the outline of the glyph, 255 at 'spread' pixels inside it and 0 at 'spread' pixels outside.
+typedef struct __SdfAtlas {
+	GlyphAtlas atlas;
+	int spread;
+	struct __SdfRampCache* ramps; // Lookup ramps for the sizes and styles drawn lately, shared by every thread drawing from the atlas
+} SdfAtlas;
+
+// How to draw a run of text. Sizes are in pixels at the size the text is drawn
+typedef struct __SdfStyle {
+	float size; // Line height
+	uint32_t color;
+	float outlineWidth; // 0 for no outline
+	uint32_t outlineColor;
+	float glowRadius; // 0 for no glow
+	uint32_t glowColor;
+} SdfStyle;
+
+int BuildSdfAtlas(SdfAtlas*, const GlyphBackend*, const wchar_t*); // Rasterizes the charset with a backend set up for SDF_REFERENCE_HEIGHT and turns it into distances. Returns 0 on failure
+void FreeSdfAtlas(SdfAtlas*); // Releases the atlas' pixels and ramps. Nothing may be drawing from it
+float MeasureSdfRun(const SdfAtlas*, const wchar_t*, int, float); // Width of the first n characters of a string drawn with a line height, with tabular digits
+float FitSdfHeight(const SdfAtlas*, const wchar_t* const*, int, int, int); // Returns the largest whole-pixel line height at which every sample fits a width and height. Takes the samples and their count, then the width and height
+void DrawSdfRun(const SdfAtlas*, Framebuffer*, const wchar_t*, int, float, float, const SdfStyle*, const FramebufferRect*); // Blends a string into a framebuffer. Takes the string and its length, the position of the top left of the line, the style and an optional clip rectangle
+
+#endif // !__CLOCK_SDF_ATLAS_H__
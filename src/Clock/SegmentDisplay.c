@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "SegmentDisplay.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Segments a to g are bits 0 to 6: top, upper right, lower right, bottom, lower left, upper left, middle
+typedef struct __SegmentGlyph {
+	wchar_t ch;
+	uint8_t segments;
+	uint8_t rows[7]; // Dot-matrix rows, top to bottom. Wide cells use the low 5 bits, narrow cells the low 2, leftmost dot highest
+} SegmentGlyph;
+
+static const SegmentGlyph glyphs[] = {
+	{ L'0', 0x3F, { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+	{ L'1', 0x06, { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+	{ L'2', 0x5B, { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+	{ L'3', 0x4F, { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+	{ L'4', 0x66, { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+	{ L'5', 0x6D, { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+	{ L'6', 0x7D, { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+	{ L'7', 0x07, { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+	{ L'8', 0x7F, { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+	{ L'9', 0x6F, { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+	{ L'A', 0x77, { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 } },
+	{ L'P', 0x73, { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+	{ L'M', 0x37, { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } }, // Seven segments can't make an M, so it's drawn as an arch like most clock radios do
+	{ L'-', 0x40, { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+	{ L':', 0x03, { 0x00, 0x03, 0x03, 0x00, 0x03, 0x03, 0x00 } }, // Narrow cells use the two dots as their "segments"
+	{ L'.', 0x02, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x03 } },
+	{ L' ', 0x00, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+};
+
+static const SegmentGlyph* FindSegmentGlyph(wchar_t ch) {
+	for (size_t i = 0; i < sizeof(glyphs) / sizeof(glyphs[0]); i++) {
+		if (glyphs[i].ch == ch) return &glyphs[i];
+	}
+	return NULL;
+}
+
+static int IsNarrow(wchar_t ch) {
+	return ch == L':' || ch == L'.' || ch == L' ';
+}
+
+static FramebufferRect MakeRect(int left, int top, int right, int bottom) {
+	FramebufferRect rect = { left, top, right, bottom };
+	return rect;
+}
+
+// Cell widths for a style and height. Everything else is laid out inside them
+static void GetCellWidths(int style, int height, int* wide, int* narrow) {
+	if (style == SEGMENT_STYLE_MATRIX) {
+		int pitch = height / 7 > 0 ? height / 7 : 1;
+		*wide = pitch * 6; // Five dots and a blank column between characters
+		*narrow = pitch * 3;
+	}
+	else {
+		*wide = height * 2 / 3;
+		*narrow = height / 4 > 2 ? height / 4 : 2;
+	}
+}
+
+// Seven segments as plain rectangles with a small gap at each corner, so the segments read as separate bars
+static void LayOutSevenSegments(SegmentDisplay* display) {
+	int height = display->height;
+	int thickness = height / 10 > 1 ? height / 10 : 1;
+	int gap = thickness / 4 > 1 ? thickness / 4 : 1;
+	int margin = height / 6; // Space between neighbouring cells
+	int left = margin / 2, right = display->wideWidth - (margin - margin / 2);
+	int middle = height / 2;
+
+	FramebufferRect* s = display->wideShapes;
+	s[0] = MakeRect(left + thickness + gap, 0, right - thickness - gap, thickness);
+	s[1] = MakeRect(right - thickness, gap, right, middle - gap);
+	s[2] = MakeRect(right - thickness, middle + gap, right, height - gap);
+	s[3] = MakeRect(left + thickness + gap, height - thickness, right - thickness - gap, height);
+	s[4] = MakeRect(left, middle + gap, left + thickness, height - gap);
+	s[5] = MakeRect(left, gap, left + thickness, middle - gap);
+	s[6] = MakeRect(left + thickness + gap, middle - thickness / 2, right - thickness - gap, middle - thickness / 2 + thickness);
+	display->wideShapeCount = 7;
+
+	// A colon is two square dots, a full stop is the lower one
+	int dot = thickness * 5 / 4 > 1 ? thickness * 5 / 4 : 1;
+	int dotLeft = (display->narrowWidth - dot) / 2;
+	int upperTop = height * 3 / 10 - dot / 2, lowerTop = height * 7 / 10 - dot / 2;
+	display->narrowShapes[0] = MakeRect(dotLeft, upperTop, dotLeft + dot, upperTop + dot);
+	display->narrowShapes[1] = MakeRect(dotLeft, lowerTop, dotLeft + dot, lowerTop + dot);
+	display->narrowShapeCount = 2;
+}
+
+// Square dots on a grid 'height / 7' apart, centred vertically
+static void LayOutMatrix(SegmentDisplay* display) {
+	int pitch = display->height / 7 > 0 ? display->height / 7 : 1;
+	int dot = pitch * 4 / 5 > 0 ? pitch * 4 / 5 : 1;
+	int top = (display->height - pitch * 7) / 2;
+	int left = pitch / 2; // Half the blank column on each side
+
+	display->wideShapeCount = 0;
+	display->narrowShapeCount = 0;
+	for (int row = 0; row < 7; row++) {
+		int y = top + row * pitch + (pitch - dot) / 2;
+		for (int column = 0; column < 5; column++) {
+			int x = left + column * pitch + (pitch - dot) / 2;
+			display->wideShapes[display->wideShapeCount++] = MakeRect(x, y, x + dot, y + dot);
+		}
+		for (int column = 0; column < 2; column++) {
+			int x = left + column * pitch + (pitch - dot) / 2;
+			display->narrowShapes[display->narrowShapeCount++] = MakeRect(x, y, x + dot, y + dot);
+		}
+	}
+}
+
+// Fills every shape of a cell into a mask at the ghost level
+static uint8_t* BuildGhost(const FramebufferRect* shapes, int count, int width, int height) {
+	uint8_t* ghost = (uint8_t*)calloc((size_t)width * height, 1);
+	if (!ghost) return NULL;
+
+	for (int i = 0; i < count; i++) {
+		for (int y = shapes[i].top; y < shapes[i].bottom; y++) {
+			memset(ghost + (size_t)y * width + shapes[i].left, SEGMENT_GHOST_LEVEL, shapes[i].right - shapes[i].left);
+		}
+	}
+	return ghost;
+}
+
+int InitSegmentDisplay(SegmentDisplay* display, int style, int height) {
+	memset(display, 0, sizeof(*display));
+	if (height < 7) height = 7;
+
+	display->style = style;
+	display->height = height;
+	GetCellWidths(style, height, &display->wideWidth, &display->narrowWidth);
+
+	if (style == SEGMENT_STYLE_MATRIX) {
+		LayOutMatrix(display);
+	}
+	else {
+		LayOutSevenSegments(display);
+	}
+
+	display->wideGhost = BuildGhost(display->wideShapes, display->wideShapeCount, display->wideWidth, height);
+	display->narrowGhost = BuildGhost(display->narrowShapes, display->narrowShapeCount, display->narrowWidth, height);
+	if (!display->wideGhost || !display->narrowGhost) {
+		FreeSegmentDisplay(display);
+		return 0;
+	}
+	return 1;
+}
+
+void FreeSegmentDisplay(SegmentDisplay* display) {
+	free(display->wideGhost);
+	free(display->narrowGhost);
+	memset(display, 0, sizeof(*display));
+}
+
+int SegmentDisplayCovers(const wchar_t* text) {
+	for (; *text; text++) {
+		if (!FindSegmentGlyph(*text)) return 0;
+	}
+	return 1;
+}
+
+static int MeasureCells(int wide, int narrow, const wchar_t* text, int length) {
+	int width = 0;
+	for (int i = 0; i < length; i++) {
+		width += IsNarrow(text[i]) ? narrow : wide;
+	}
+	return width;
+}
+
+int FitSegmentHeight(int style, const wchar_t* const* samples, int sampleCount, int width, int height) {
+	// Cell widths only ever grow with the height, so bisect for the tallest that fits
+	int low = 7, high = height > 7 ? height : 7;
+	while (low < high) {
+		int middle = (low + high + 1) / 2;
+		int wide, narrow, fits = 1;
+		GetCellWidths(style, middle, &wide, &narrow);
+		for (int i = 0; i < sampleCount && fits; i++) {
+			fits = MeasureCells(wide, narrow, samples[i], (int)wcslen(samples[i])) <= width;
+		}
+
+		if (fits) {
+			low = middle;
+		}
+		else {
+			high = middle - 1;
+		}
+	}
+	return low;
+}
+
+int MeasureSegmentText(const SegmentDisplay* display, const wchar_t* text, int length) {
+	return MeasureCells(display->wideWidth, display->narrowWidth, text, length);
+}
+
+// Fills a shape of the cell at (x, y), clipped to the clip rectangle
+static void FillShape(Framebuffer* fb, const FramebufferRect* shape, int x, int y, uint32_t color, const FramebufferRect* clip) {
+	FramebufferRect rect = { shape->left + x, shape->top + y, shape->right + x, shape->bottom + y };
+	if (clip) {
+		if (clip->left > rect.left) rect.left = clip->left;
+		if (clip->top > rect.top) rect.top = clip->top;
+		if (clip->right < rect.right) rect.right = clip->right;
+		if (clip->bottom < rect.bottom) rect.bottom = clip->bottom;
+		if (rect.left >= rect.right || rect.top >= rect.bottom) return;
+	}
+	FramebufferFill(fb, &rect, color);
+}
+
+void DrawSegmentText(const SegmentDisplay* display, Framebuffer* fb, const wchar_t* text, int length, int x, int y, uint32_t color, int ghost, const FramebufferRect* clip) {
+	if (!display->wideGhost) return;
+
+	int penX = x;
+	for (int i = 0; i < length; i++) {
+		const SegmentGlyph* glyph = FindSegmentGlyph(text[i]);
+		int narrow = IsNarrow(text[i]);
+		int cellWidth = narrow ? display->narrowWidth : display->wideWidth;
+
+		// Skip cells entirely outside the clip rectangle, which is most of them when only the seconds changed
+		if (glyph && (!clip || (penX < clip->right && penX + cellWidth > clip->left && y < clip->bottom && y + display->height > clip->top))) {
+			const FramebufferRect* shapes = narrow ? display->narrowShapes : display->wideShapes;
+
+			if (ghost && text[i] != L' ') {
+				FramebufferBlendMask(fb, penX, y, narrow ? display->narrowGhost : display->wideGhost, cellWidth, cellWidth, display->height, color, clip);
+			}
+
+			if (display->style == SEGMENT_STYLE_MATRIX) {
+				int columns = narrow ? 2 : 5;
+				for (int row = 0; row < 7; row++) {
+					for (int column = 0; column < columns; column++) {
+						if (glyph->rows[row] & (1 << (columns - 1 - column))) {
+							FillShape(fb, &shapes[row * columns + column], penX, y, color, clip);
+						}
+					}
+				}
+			}
+			else {
+				int count = narrow ? display->narrowShapeCount : display->wideShapeCount;
+				for (int segment = 0; segment < count; segment++) {
+					if (glyph->segments & (1 << segment)) {
+						FillShape(fb, &shapes[segment], penX, y, color, clip);
+					}
+				}
+			}
+		}
+
+		penX += cellWidth;
+	}
+}
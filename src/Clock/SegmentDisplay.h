@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __CLOCK_SEGMENT_DISPLAY_H__
+#define __CLOCK_SEGMENT_DISPLAY_H__
+
+// Digits drawn as seven-segment or 5x7 dot-matrix shapes, for machines where text through a font is too slow.
+// The shapes are worked out once per size, and the unlit segments (the "ghost" of a real display) are kept as a mask for each kind of cell,
+// so drawing the text is a masked blend per cell and a few rectangle fills for the lit segments.
+
+#include <wchar.h>
+
+#include "Framebuffer.h"
+
+#define SEGMENT_STYLE_NONE		0 // Draw the text with a font
+#define SEGMENT_STYLE_SEVEN		1
+#define SEGMENT_STYLE_MATRIX	2
+
+#define SEGMENT_MAX_SHAPES 35 // Most rectangles one character can need: every dot of the matrix
+#define SEGMENT_GHOST_LEVEL 36 // Coverage of the unlit segments, about 1/7 of the lit color
+
+// A character is drawn in a wide cell (digits, letters, '-') or a narrow one (':', '.', ' ').
+// Each shape is a rectangle relative to the top left of its cell
+typedef struct __SegmentDisplay {
+	int style;
+	int height;
+	int wideWidth;
+	int narrowWidth;
+	FramebufferRect wideShapes[SEGMENT_MAX_SHAPES]; // The seven segments a to g, or the 5x7 dots row by row
+	int wideShapeCount;
+	FramebufferRect narrowShapes[SEGMENT_MAX_SHAPES]; // Two dots for a seven-segment colon, or the 2x7 dots row by row
+	int narrowShapeCount;
+	uint8_t* wideGhost; // Every shape of a wide cell at SEGMENT_GHOST_LEVEL, 'wideWidth' bytes per row
+	uint8_t* narrowGhost;
+} SegmentDisplay;
+
+int InitSegmentDisplay(SegmentDisplay*, int, int); // Works out the shapes and ghost masks for a style and a character height in pixels. Returns 0 if out of memory
+void FreeSegmentDisplay(SegmentDisplay*); // Releases the ghost masks
+int SegmentDisplayCovers(const wchar_t*); // Returns whether every character of a string can be shown
+int FitSegmentHeight(int, const wchar_t* const*, int, int, int); // Returns the tallest character height at which every sample fits a width and height. Takes the style, the samples and their count, then the width and height
+int MeasureSegmentText(const SegmentDisplay*, const wchar_t*, int); // Width of the first n characters of a string
+void DrawSegmentText(const SegmentDisplay*, Framebuffer*, const wchar_t*, int, int, int, uint32_t, int, const FramebufferRect*); // Draws a string with its top left at the given position. Takes the color, whether to draw the ghost and an optional clip rectangle
+
+#endif // !__CLOCK_SEGMENT_DISPLAY_H__
@@ -18,12 +18,26 @@
 
 #include "SettingsWindow.h"
 #include "NTPClient.h"
+#include "SyncHistory.h"
+#include "DpiAwareness.h"
 
 #pragma warning(disable : 4024)
 #pragma warning(disable : 4047)
 
 #define szCLASS L"ClockSettingsWndClass"
 
+static int settingsDpi = DPI_DEFAULT; // DPI of the monitor the window is on. Every size below is in 96 DPI pixels and scaled to this
+static HFONT settingsFont; // The dialog font for settingsDpi. Owned by GetDialogFont
+
+static int Scale(int value) {
+	return ScaleForDpi(value, settingsDpi);
+}
+
+static BOOL CALLBACK SetChildFont(HWND hwnd, LPARAM lParam) {
+	SendMessage(hwnd, WM_SETFONT, (WPARAM)lParam, (LPARAM)TRUE);
+	return TRUE;
+}
+
 const wchar_t* g_szTimeZones[] = {
 	L"UTC−12:00 - Baker Island Time (BIT)",
 	L"UTC−11:00 - Samoa Standard Time (SST)",
@@ -86,7 +100,8 @@ ATOM RegisterSettingsClass(HINSTANCE hInstance) {
 BOOL InitSettings(void) {
 	RegisterSettingsClass(g_hInst);
 
-	g_hWndSettings = CreateWindow(szCLASS, L"Settings", WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU, CW_USEDEFAULT, CW_USEDEFAULT, 450, 330, NULL, NULL, g_hInst, NULL);
+	settingsDpi = GetSystemDpi(); // It's centered on the primary monitor
+	g_hWndSettings = CreateWindow(szCLASS, L"Settings", WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU, CW_USEDEFAULT, CW_USEDEFAULT, Scale(450), Scale(390), NULL, NULL, g_hInst, NULL);
 	if (!g_hWndSettings) {
 		return FALSE;
 	}
@@ -100,25 +115,25 @@ BOOL InitSettings(void) {
 void CreateSettingsControls(HWND hwnd) {
 	// Long and messy control creation code
 	g_hWndSettingsSaveBtn = CreateWindow(WC_BUTTON, L"Save", BS_PUSHBUTTON | WS_TABSTOP | WS_CHILD | WS_VISIBLE, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_SAVE_BTN_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsSaveBtn, WM_SETFONT, (WPARAM)g_hfBtnFont, TRUE);
+	SendMessage(g_hWndSettingsSaveBtn, WM_SETFONT, (WPARAM)settingsFont, TRUE);
 
 	g_hWndSettingsGradientCheck = CreateWindow(WC_BUTTON, L"Enable gradient", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_GRADIENT_CHECK_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsGradientCheck, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsGradientCheck, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 	SendMessage(g_hWndSettingsGradientCheck, BM_SETCHECK, g_Config.Gradient ? BST_CHECKED : BST_UNCHECKED, 0);
 
 	g_hWndSettingsDvdLogoCheck = CreateWindow(WC_BUTTON, L"DVD logo", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_DVDLOGO_CHECK_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsDvdLogoCheck, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsDvdLogoCheck, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 	SendMessage(g_hWndSettingsDvdLogoCheck, BM_SETCHECK, g_Config.DVDLogo ? BST_CHECKED : BST_UNCHECKED, 0);
 
 	g_hWndSettingsCustomColorsCheck = CreateWindow(WC_BUTTON, L"Use custom colors", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 10, 70, 200, 30, hwnd, (HMENU)SETTINGS_CUSTOMCOLORS_CHECK_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsCustomColorsCheck, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsCustomColorsCheck, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 	SendMessage(g_hWndSettingsCustomColorsCheck, BM_SETCHECK, g_Config.CustomColor ? BST_CHECKED : BST_UNCHECKED, 0);
 
 	g_hWndSettingsFontPickerBtn = CreateWindow(WC_BUTTON, L"Pick font", WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_FONTPICKER_BTN_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsFontPickerBtn, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsFontPickerBtn, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 
 	g_hWndSettingsFileText = CreateWindowEx(WS_EX_CLIENTEDGE | WS_EX_LEFT | WS_EX_LTRREADING | WS_EX_RIGHTSCROLLBAR, WC_EDIT, L"", ES_LEFT | WS_CHILD | WS_OVERLAPPED | WS_VISIBLE | ES_AUTOHSCROLL | ES_READONLY, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_FILETEXT_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsFileText, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsFileText, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 
 	// Check for the file path if the user has one set.
 	wchar_t buffer[MAX_PATH];
@@ -135,10 +150,10 @@ void CreateSettingsControls(HWND hwnd) {
 	SetWindowText(g_hWndSettingsFileText, buffer);
 
 	g_hWndSettingsBrowseBtn = CreateWindow(WC_BUTTON, L"Browse", WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_BROWSE_BTN_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsBrowseBtn, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsBrowseBtn, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 
 	g_hWndSettingsFontText = CreateWindow(WC_STATIC, L"Font: ", WS_VISIBLE | WS_CHILD, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_FONTTEXT_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsFontText, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsFontText, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 
 	// Check the user's font. Returns Arial if the user doesn't have one set
 	wchar_t fontBuffer[256];
@@ -150,25 +165,27 @@ void CreateSettingsControls(HWND hwnd) {
 	SetWindowText(g_hWndSettingsFontText, out);
 
 	g_hWndDropDownTimeSource = CreateWindow(WC_COMBOBOX, L"", CBS_DROPDOWNLIST | WS_CHILD | WS_VISIBLE, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_TIME_SOURCE_DROPDOWN_ID, g_hInst, NULL);
-	SendMessage(g_hWndDropDownTimeSource, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndDropDownTimeSource, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 	SendMessage(g_hWndDropDownTimeSource, CB_ADDSTRING, 0, (LPARAM)L"Local (System Time)");
 	SendMessage(g_hWndDropDownTimeSource, CB_ADDSTRING, 1, (LPARAM)L"Network (NTP)");
+	SendMessage(g_hWndDropDownTimeSource, CB_ADDSTRING, 2, (LPARAM)L"GPS receiver (NMEA)");
+	SendMessage(g_hWndDropDownTimeSource, CB_ADDSTRING, 3, (LPARAM)L"Network (NTP broadcast)");
 	SendMessage(g_hWndDropDownTimeSource, CB_SETCURSEL, g_TimeConfig.ts, 0); // Make the user's preference persistent
 	
 	g_hWndSettingsAddressLabel = CreateWindow(WC_STATIC, L"Address: ", WS_VISIBLE | WS_CHILD, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_ADDRESS_LABEL_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsAddressLabel, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsAddressLabel, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 
 	g_hWndSettingsAddressEdit = CreateWindowEx(WS_EX_CLIENTEDGE | WS_EX_LEFT | WS_EX_LTRREADING | WS_EX_RIGHTSCROLLBAR, WC_EDIT, L"", ES_LEFT | WS_CHILD | WS_OVERLAPPED | WS_VISIBLE | ES_AUTOHSCROLL, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_ADDRESS_EDIT_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsAddressEdit, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsAddressEdit, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 	ZeroMemory(buffer, sizeof(buffer));
 	wcscpy(buffer, g_TimeConfig.address);
 	SetWindowText(g_hWndSettingsAddressEdit, buffer);
 
 	g_hWndSettingsPortLabel = CreateWindow(WC_STATIC, L"Port: ", WS_VISIBLE | WS_CHILD, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_PORT_LABEL_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsPortLabel, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsPortLabel, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 
 	g_hWndSettingsPortEdit = CreateWindowEx(WS_EX_CLIENTEDGE | WS_EX_LEFT | WS_EX_LTRREADING | WS_EX_RIGHTSCROLLBAR, WC_EDIT, L"", ES_LEFT | WS_CHILD | WS_OVERLAPPED | WS_VISIBLE | ES_AUTOHSCROLL | ES_NUMBER, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_PORT_EDIT_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsPortEdit, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsPortEdit, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 	ZeroMemory(buffer, sizeof(buffer));
 	_itow(g_TimeConfig.port, buffer, 10);
 	SetWindowText(g_hWndSettingsPortEdit, buffer);
@@ -181,52 +198,64 @@ void CreateSettingsControls(HWND hwnd) {
 	SendMessage(g_hWndSettingsPortEdit, EM_SETLIMITTEXT, 5, 0);
 
 	g_hWndSettingsSyncLabel = CreateWindow(WC_STATIC, L"Sync (ms):", WS_VISIBLE | WS_CHILD, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_SYNC_LABEL_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsSyncLabel, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsSyncLabel, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 
 	g_hWndSettingsSyncText = CreateWindowEx(WS_EX_CLIENTEDGE | WS_EX_LEFT | WS_EX_LTRREADING | WS_EX_RIGHTSCROLLBAR, WC_EDIT, L"", ES_LEFT | WS_CHILD | WS_OVERLAPPED | WS_VISIBLE | ES_AUTOHSCROLL | ES_NUMBER, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_SYNC_TEXT_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsSyncText, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsSyncText, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 	_itow(g_TimeConfig.syncInterval, buffer, 10);
 	SetWindowText(g_hWndSettingsSyncText, buffer);
 	ZeroMemory(buffer, sizeof(buffer));
 
 	g_hWndSettingsTimeZoneLabel = CreateWindow(WC_STATIC, L"Time zone:", WS_VISIBLE | WS_CHILD, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_TIMEZONE_LABEL_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsTimeZoneLabel, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsTimeZoneLabel, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 
 	g_hWndSettingsTimeZoneCombo = CreateWindow(WC_COMBOBOX, NULL, CBS_DROPDOWNLIST | WS_CHILD | WS_VISIBLE, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_TIMEZONE_COMBO_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsTimeZoneCombo, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsTimeZoneCombo, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 	for (int i = 0; i < _countof(g_szTimeZones); ++i) {
 		SendMessage(g_hWndSettingsTimeZoneCombo, CB_ADDSTRING, 0, (LPARAM)g_szTimeZones[i]);
 	}
 	SendMessage(g_hWndSettingsTimeZoneCombo, CB_SETCURSEL, GetTimeZone(), 0);
 
 	g_hWndSettingsConsoleCheck = CreateWindow(WC_BUTTON, L"Enable console logging", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_CONSOLE_CHECK_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsConsoleCheck, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsConsoleCheck, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 	SendMessage(g_hWndSettingsConsoleCheck, BM_SETCHECK, g_Config.ConsoleEnabled ? BST_CHECKED : BST_UNCHECKED, 0);
 
 	g_hWndSettingsTrayIconCheck = CreateWindow(WC_BUTTON, L"Enable tray icon", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_CONSOLE_CHECK_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsTrayIconCheck, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsTrayIconCheck, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 	SendMessage(g_hWndSettingsTrayIconCheck, BM_SETCHECK, g_Config.TrayIconEnabled ? BST_CHECKED : BST_UNCHECKED, 0);
 
 	g_hWndSettingsMenuCheck = CreateWindow(WC_BUTTON, L"Show menu in main window", WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_MENU_CHECK_ID, g_hInst, NULL);
-	SendMessage(g_hWndSettingsMenuCheck, WM_SETFONT, g_hfBtnFont, (LPARAM)TRUE);
+	SendMessage(g_hWndSettingsMenuCheck, WM_SETFONT, settingsFont, (LPARAM)TRUE);
 	SendMessage(g_hWndSettingsMenuCheck, BM_SETCHECK, g_Config.MenuEnabled ? BST_CHECKED : BST_UNCHECKED, 0);
 
-	// By default, set everything to disabled
-	EnableWindow(g_hWndSettingsTimeZoneCombo, FALSE);
-	EnableWindow(g_hWndSettingsAddressEdit, FALSE);
-	EnableWindow(g_hWndSettingsPortEdit, FALSE);
-	EnableWindow(g_hWndSettingsPortBtn, FALSE);
-	EnableWindow(g_hWndSettingsSyncText, FALSE);
+	g_hWndSettingsHistoryGraph = CreateWindow(WC_STATIC, NULL, WS_VISIBLE | WS_CHILD | SS_OWNERDRAW, 0, 0, 0, 0, hwnd, (HMENU)SETTINGS_HISTORY_GRAPH_ID, g_hInst, NULL);
+
+	// Fill the shared address and port boxes for the saved source, and enable what it uses
+	UpdateTimeSourceControls(g_TimeConfig.ts);
 }
 
 LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 	switch (msg) {
 	case WM_CREATE: {
 		EnableWindow(g_hWndMain, FALSE);
+		settingsDpi = GetWindowDpi(hwnd);
+		settingsFont = GetDialogFont(settingsDpi);
 		CreateSettingsControls(hwnd);
 		CenterWindow(hwnd, NULL);
+		SetTimer(hwnd, SETTINGS_HISTORY_TIMER_ID, 5000, NULL);
 	}
 		break;
+	case WM_TIMER:
+		if (wParam == SETTINGS_HISTORY_TIMER_ID) {
+			InvalidateRect(g_hWndSettingsHistoryGraph, NULL, FALSE);
+		}
+		break;
+	case WM_DRAWITEM:
+		if (wParam == SETTINGS_HISTORY_GRAPH_ID) {
+			DrawSyncHistoryGraph((LPDRAWITEMSTRUCT)lParam);
+			return TRUE;
+		}
+		break;
 	case WM_COMMAND:
 		if (LOWORD(wParam) == SETTINGS_SAVE_BTN_ID) {
 			// Get the user's choices, even if they're not changed from before
@@ -241,7 +270,7 @@ LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPar
 			g_TimeConfig.ts = sel;
 
 			// Don't ping the server or update these settings if it's not necessary
-			if (sel == 1) {
+			if (sel == _TIME_SOURCE_NTP_ || sel == _TIME_SOURCE_NTP_BROADCAST_) {
 				wchar_t buf[256];
 				ZeroMemory(buf, sizeof(buf));
 
@@ -266,6 +295,20 @@ LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPar
 					return 1;
 				}
 			}
+			else if (sel == _TIME_SOURCE_GPS_) {
+				wchar_t buf[MAX_PATH];
+				ZeroMemory(buf, sizeof(buf));
+
+				GetWindowText(g_hWndSettingsAddressEdit, buf, sizeof(buf) / sizeof(wchar_t));
+				free(g_GPSConfig.device);
+				g_GPSConfig.device = _wcsdup(buf);
+
+				ZeroMemory(buf, sizeof(buf));
+				GetWindowText(g_hWndSettingsPortEdit, buf, sizeof(buf) / sizeof(wchar_t));
+				g_GPSConfig.baudRate = (DWORD)_wtoi(buf);
+
+				SetGPSConfig(&g_GPSConfig);
+			}
 
 			SetTimeZone((int)SendMessage(g_hWndSettingsTimeZoneCombo, CB_GETCURSEL, 0, 0));
 			SetTimeConfig(&g_TimeConfig);
@@ -282,20 +325,7 @@ LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPar
 			int sel = SendMessage(g_hWndDropDownTimeSource, CB_GETCURSEL, 0, 0);
 
 			// Enable specific controls based off of the user selection
-			if (sel == 1) {
-				EnableWindow(g_hWndSettingsAddressEdit, TRUE);
-				EnableWindow(g_hWndSettingsPortEdit, TRUE);
-				EnableWindow(g_hWndSettingsPortBtn, TRUE);
-				EnableWindow(g_hWndSettingsSyncText, TRUE);
-				EnableWindow(g_hWndSettingsTimeZoneCombo, TRUE);
-			}
-			else {
-				EnableWindow(g_hWndSettingsAddressEdit, FALSE);
-				EnableWindow(g_hWndSettingsPortEdit, FALSE);
-				EnableWindow(g_hWndSettingsPortBtn, FALSE);
-				EnableWindow(g_hWndSettingsSyncText, FALSE);
-				EnableWindow(g_hWndSettingsTimeZoneCombo, FALSE);
-			}
+			UpdateTimeSourceControls(sel);
 		} 
 		break;
 	case WM_KEYDOWN:
@@ -303,10 +333,18 @@ LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPar
 			DestroyWindow(hwnd);
 		}
 		break;
+	case WM_DPICHANGED_:
+		// Dragged onto a monitor with another scale. The new size lays the controls out again, see SizeSettingsControls
+		settingsDpi = LOWORD(wParam);
+		settingsFont = GetDialogFont(settingsDpi);
+		EnumChildWindows(hwnd, SetChildFont, (LPARAM)settingsFont);
+		ApplyDpiChange(hwnd, lParam);
+		break;
 	case WM_SIZE:
 		SizeSettingsControls(hwnd); // Windows automatically calls this when the window is created, but I use it to size and position the controls. It's not in the creation code because it's cleaner this way.
 		break;
 	case WM_DESTROY:
+		KillTimer(hwnd, SETTINGS_HISTORY_TIMER_ID);
 		EnableWindow(g_hWndMain, TRUE);
 		SetForegroundWindow(g_hWndMain);
 		DestroyWindow(hwnd);
@@ -324,43 +362,136 @@ void SizeSettingsControls(HWND hwnd) {
 	RECT rc;
 	GetClientRect(hwnd, &rc);
 
-	SetWindowPos(g_hWndSettingsSaveBtn, NULL, rc.right - 110, rc.bottom - 40, 100, 30, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsGradientCheck, NULL, rc.left + 10, rc.top + 10, 125, 30, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsDvdLogoCheck, NULL, rc.left + 10, rc.top + 40, 125, 30, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsCustomColorsCheck, NULL, rc.left + 10, rc.top + 70, 135, 30, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsFontText, NULL, rc.left + 12, rc.bottom - 55, 100, 15, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsFontPickerBtn, NULL, rc.left + 10, rc.bottom - 40, 100, 30, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsFileText, NULL, rc.left + 10, rc.bottom - 90, rc.right - 130, 30, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsBrowseBtn, NULL, rc.right - 110, rc.bottom - 90, 100, 30, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndDropDownTimeSource, NULL, rc.left + 200, rc.top + 10, rc.right - 210, 30, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsAddressLabel, NULL, rc.left + 200, rc.top + 40, 100, 30, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsAddressEdit, NULL, rc.left + 200, rc.top + 55, rc.right - 210, 20, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsPortLabel, NULL, rc.left + 200, rc.top + 78, 125, 20, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsPortEdit, NULL, rc.left + 200, rc.top + 95, 80, 20, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsSyncLabel, NULL, rc.left + 290, rc.top + 78, 115, 20, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsSyncText, NULL, rc.left + 290, rc.top + 95, rc.right - 300, 20, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsTimeZoneLabel, NULL, rc.left + 10, rc.top + 130, 120, 15, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsTimeZoneCombo, NULL, rc.left + 10, rc.top + 145, rc.right - 20, 20, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsConsoleCheck, NULL, rc.left + 10, rc.bottom - 125, 160, 30, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsTrayIconCheck, NULL, rc.left + 170, rc.bottom - 125, 120, 30, SWP_NOACTIVATE | SWP_NOZORDER);
-	SetWindowPos(g_hWndSettingsMenuCheck, NULL, rc.left + 10, rc.top + 100, 178, 30, SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsSaveBtn, NULL, rc.right - Scale(110), rc.bottom - Scale(40), Scale(100), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsGradientCheck, NULL, rc.left + Scale(10), rc.top + Scale(10), Scale(125), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsDvdLogoCheck, NULL, rc.left + Scale(10), rc.top + Scale(40), Scale(125), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsCustomColorsCheck, NULL, rc.left + Scale(10), rc.top + Scale(70), Scale(135), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsFontText, NULL, rc.left + Scale(12), rc.bottom - Scale(55), Scale(100), Scale(15), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsFontPickerBtn, NULL, rc.left + Scale(10), rc.bottom - Scale(40), Scale(100), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsFileText, NULL, rc.left + Scale(10), rc.bottom - Scale(90), rc.right - Scale(130), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsBrowseBtn, NULL, rc.right - Scale(110), rc.bottom - Scale(90), Scale(100), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndDropDownTimeSource, NULL, rc.left + Scale(200), rc.top + Scale(10), rc.right - Scale(210), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsAddressLabel, NULL, rc.left + Scale(200), rc.top + Scale(40), Scale(100), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsAddressEdit, NULL, rc.left + Scale(200), rc.top + Scale(55), rc.right - Scale(210), Scale(20), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsPortLabel, NULL, rc.left + Scale(200), rc.top + Scale(78), Scale(125), Scale(20), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsPortEdit, NULL, rc.left + Scale(200), rc.top + Scale(95), Scale(80), Scale(20), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsSyncLabel, NULL, rc.left + Scale(290), rc.top + Scale(78), Scale(115), Scale(20), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsSyncText, NULL, rc.left + Scale(290), rc.top + Scale(95), rc.right - Scale(300), Scale(20), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsTimeZoneLabel, NULL, rc.left + Scale(10), rc.top + Scale(130), Scale(120), Scale(15), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsTimeZoneCombo, NULL, rc.left + Scale(10), rc.top + Scale(145), rc.right - Scale(20), Scale(20), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsConsoleCheck, NULL, rc.left + Scale(10), rc.bottom - Scale(125), Scale(160), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsTrayIconCheck, NULL, rc.left + Scale(170), rc.bottom - Scale(125), Scale(120), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsMenuCheck, NULL, rc.left + Scale(10), rc.top + Scale(100), Scale(178), Scale(30), SWP_NOACTIVATE | SWP_NOZORDER);
+	SetWindowPos(g_hWndSettingsHistoryGraph, NULL, rc.left + Scale(10), rc.top + Scale(175), rc.right - Scale(20), rc.bottom - Scale(305), SWP_NOACTIVATE | SWP_NOZORDER);
 
 	SendMessage(g_hWndSettingsPortBtn, UDM_SETBUDDY, (WPARAM)g_hWndSettingsPortEdit, 0);
 
-	int sel = SendMessage(g_hWndDropDownTimeSource, CB_GETCURSEL, 0, 0);
+	EnableTimeSourceControls(SendMessage(g_hWndDropDownTimeSource, CB_GETCURSEL, 0, 0));
+}
+
+void EnableTimeSourceControls(int sel) {
+	if (sel == _TIME_SOURCE_GPS_) {
+		SetWindowText(g_hWndSettingsAddressLabel, L"Device: ");
+		SetWindowText(g_hWndSettingsPortLabel, L"Baud rate: ");
+	}
+	else {
+		SetWindowText(g_hWndSettingsAddressLabel, L"Address: ");
+		SetWindowText(g_hWndSettingsPortLabel, L"Port: ");
+	}
+
+	BOOL bExternal = (sel != _TIME_SOURCE_SYSTEM_);
+	EnableWindow(g_hWndSettingsAddressEdit, bExternal);
+	EnableWindow(g_hWndSettingsPortEdit, bExternal);
+	EnableWindow(g_hWndSettingsPortBtn, bExternal);
+	EnableWindow(g_hWndSettingsSyncText, sel == _TIME_SOURCE_NTP_); // The receiver pushes time on its own, so there is no sync interval
+	EnableWindow(g_hWndSettingsTimeZoneCombo, bExternal);
+}
 
-	if (sel == 1) {
-		EnableWindow(g_hWndSettingsAddressEdit, TRUE);
-		EnableWindow(g_hWndSettingsPortEdit, TRUE);
-		EnableWindow(g_hWndSettingsPortBtn, TRUE);
-		EnableWindow(g_hWndSettingsSyncText, TRUE);
-		EnableWindow(g_hWndSettingsTimeZoneCombo, TRUE);
+void UpdateTimeSourceControls(int sel) {
+	// The address and port boxes are shared between the network and GPS sources to keep the window the same size.
+	// For GPS they hold the device name (COM3) and the baud rate.
+	wchar_t buffer[MAX_PATH];
+	ZeroMemory(buffer, sizeof(buffer));
+
+	if (sel == _TIME_SOURCE_GPS_) {
+		SetWindowText(g_hWndSettingsAddressEdit, g_GPSConfig.device);
+		SendMessage(g_hWndSettingsPortBtn, UDM_SETRANGE32, (WPARAM)300, (LPARAM)921600);
+		SendMessage(g_hWndSettingsPortBtn, UDM_SETPOS32, 0, (LPARAM)g_GPSConfig.baudRate);
+		SendMessage(g_hWndSettingsPortEdit, EM_SETLIMITTEXT, 6, 0);
+		_ultow(g_GPSConfig.baudRate, buffer, 10);
+		SetWindowText(g_hWndSettingsPortEdit, buffer);
 	}
 	else {
-		EnableWindow(g_hWndSettingsAddressEdit, FALSE);
-		EnableWindow(g_hWndSettingsPortEdit, FALSE);
-		EnableWindow(g_hWndSettingsPortBtn, FALSE);
-		EnableWindow(g_hWndSettingsSyncText, FALSE);
-		EnableWindow(g_hWndSettingsTimeZoneCombo, FALSE);
+		SetWindowText(g_hWndSettingsAddressEdit, g_TimeConfig.address);
+		SendMessage(g_hWndSettingsPortBtn, UDM_SETRANGE32, (WPARAM)1, (LPARAM)65535);
+		SendMessage(g_hWndSettingsPortBtn, UDM_SETPOS32, 0, (LPARAM)g_TimeConfig.port);
+		SendMessage(g_hWndSettingsPortEdit, EM_SETLIMITTEXT, 5, 0);
+		_itow(g_TimeConfig.port, buffer, 10);
+		SetWindowText(g_hWndSettingsPortEdit, buffer);
+	}
+
+	EnableTimeSourceControls(sel);
+}
+
+void DrawSyncHistoryGraph(LPDRAWITEMSTRUCT pDIS) {
+	HDC hdc = pDIS->hDC;
+	RECT rect = pDIS->rcItem;
+
+	FillRect(hdc, &rect, GetSysColorBrush(COLOR_WINDOW));
+	FrameRect(hdc, &rect, GetSysColorBrush(COLOR_BTNSHADOW));
+
+	SetBkMode(hdc, TRANSPARENT);
+	SetTextColor(hdc, GetSysColor(COLOR_GRAYTEXT));
+	HFONT hOldFont = (HFONT)SelectObject(hdc, settingsFont);
+
+	// One sample per pixel column at most
+	static HistoryRecord records[HISTORY_RING_SIZE];
+	int width = rect.right - rect.left - 2;
+	size_t count = GetSyncHistory(records, width > 0 ? min((size_t)width, HISTORY_RING_SIZE) : 0);
+
+	RECT textRect = rect;
+	InflateRect(&textRect, -Scale(4), -Scale(2));
+
+	if (count == 0) {
+		DrawText(hdc, L"No NTP samples yet", -1, &textRect, DT_LEFT | DT_TOP | DT_SINGLELINE);
+		SelectObject(hdc, hOldFont);
+		return;
+	}
+
+	// Symmetric scale around zero so the sign of the offset is obvious at a glance
+	int32_t maxOffset = 1;
+	for (size_t i = 0; i < count; i++) {
+		int32_t magnitude = records[i].offset < 0 ? -records[i].offset : records[i].offset;
+		if (magnitude > maxOffset) maxOffset = magnitude;
 	}
-}
\ No newline at end of file
+
+	int top = rect.top + 2;
+	int height = rect.bottom - rect.top - 4;
+	int zeroY = top + height / 2;
+
+	HPEN hAxisPen = CreatePen(PS_DOT, 1, GetSysColor(COLOR_BTNSHADOW));
+	HPEN hLinePen = CreatePen(PS_SOLID, 1, GetSysColor(COLOR_HIGHLIGHT));
+	HPEN hOldPen = (HPEN)SelectObject(hdc, hAxisPen);
+
+	MoveToEx(hdc, rect.left + 1, zeroY, NULL);
+	LineTo(hdc, rect.right - 1, zeroY);
+
+	SelectObject(hdc, hLinePen);
+	for (size_t i = 0; i < count; i++) {
+		int x = rect.right - 2 - (int)(count - 1 - i) * width / (int)count;
+		int y = zeroY - (int)((int64_t)records[i].offset * (height / 2) / maxOffset);
+		if (i == 0) MoveToEx(hdc, x, y, NULL);
+		else LineTo(hdc, x, y);
+	}
+
+	SelectObject(hdc, hOldPen);
+	DeleteObject(hAxisPen);
+	DeleteObject(hLinePen);
+
+	const HistoryRecord* last = &records[count - 1];
+	wchar_t label[128];
+	swprintf(label, 128, L"Offset %ld ms, delay %ld ms, jitter %ld ms (\u00B1%ld ms, %u samples)", (long)last->offset, (long)last->delay, (long)last->jitter, (long)maxOffset, (unsigned)count);
+	DrawText(hdc, label, -1, &textRect, DT_LEFT | DT_TOP | DT_SINGLELINE | DT_END_ELLIPSIS);
+
+	SelectObject(hdc, hOldFont);
+}
@@ -44,6 +44,9 @@
 #define SETTINGS_TRAYICON_CHECK_ID		0x1014
 #define SETTINGS_CONSOLE_CHECK_ID		0x1015
 #define SETTINGS_MENU_CHECK_ID			0x1016
+#define SETTINGS_HISTORY_GRAPH_ID		0x1017
+
+#define SETTINGS_HISTORY_TIMER_ID		0x2001 // Redraws the sync history graph while the window is open
 
 // Window handles for the controls
 // Not adding comments here because there are so much
@@ -71,6 +74,7 @@ HWND g_hWndSettingsTimeZoneCombo;
 HWND g_hWndSettingsTrayIconCheck;
 HWND g_hWndSettingsConsoleCheck;
 HWND g_hWndSettingsMenuCheck;
+HWND g_hWndSettingsHistoryGraph;
 
 extern const wchar_t* g_szTimeZones[]; // Constant string array for every time zone. Defined in SettingsWindow because it is loaded into the combo box but it is also used in the NTP client
 
@@ -79,5 +83,8 @@ BOOL InitSettings(void); // Does the same as InitInstance, except for settings.
 void CreateSettingsControls(HWND); // Creates and draws the controls for the settings window.
 LRESULT CALLBACK SettingsWndProc(HWND, UINT, WPARAM, LPARAM); // Same as above, but, it's for, you guessed it, the settings sub-window! 
 void SizeSettingsControls(HWND); // Re-implemented this because it works better and separates the creation code from location code.
+void DrawSyncHistoryGraph(LPDRAWITEMSTRUCT); // Draws a sparkline of the recent NTP offsets from the sync history ring
+void UpdateTimeSourceControls(int); // Fills the address and port boxes with the saved values for the selected source, then calls EnableTimeSourceControls. Network uses address/port, GPS uses device/baud rate.
+void EnableTimeSourceControls(int); // Enables and relabels the time source controls based off of the selected source, without touching what's typed in them
 
 #endif // !__CLOCK_SETTINGSWINDOW_H__
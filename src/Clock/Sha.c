@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Sha.h"
+
+#include <string.h>
+
+// Both hashes are specified in FIPS 180-4. An NTP MAC covers at most 48 bytes of header plus the key, so this is two blocks per packet.
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static uint32_t ReadBE32(const uint8_t* p) {
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void WriteBE32(uint8_t* p, uint32_t value) {
+	p[0] = (uint8_t)(value >> 24);
+	p[1] = (uint8_t)(value >> 16);
+	p[2] = (uint8_t)(value >> 8);
+	p[3] = (uint8_t)value;
+}
+
+// Appends the 0x80 terminator and the big endian bit length. Shared by both hashes since they pad the same way.
+static void PadBlock(uint8_t* buffer, size_t* used, uint64_t length, void (*transform)(void*, const uint8_t*), void* context) {
+	uint64_t bits = length * 8;
+
+	buffer[(*used)++] = 0x80;
+	if (*used > 56) {
+		memset(buffer + *used, 0, 64 - *used);
+		transform(context, buffer);
+		*used = 0;
+	}
+	memset(buffer + *used, 0, 56 - *used);
+
+	WriteBE32(buffer + 56, (uint32_t)(bits >> 32));
+	WriteBE32(buffer + 60, (uint32_t)bits);
+	transform(context, buffer);
+}
+
+#pragma region SHA-1
+static void SHA1Transform(void* context, const uint8_t* block) {
+	SHA1Context* ctx = (SHA1Context*)context;
+	uint32_t w[80];
+
+	for (int i = 0; i < 16; i++) {
+		w[i] = ReadBE32(block + i * 4);
+	}
+	for (int i = 16; i < 80; i++) {
+		w[i] = ROL32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+	}
+
+	uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3], e = ctx->state[4];
+
+	for (int i = 0; i < 80; i++) {
+		uint32_t f, k;
+		if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+		else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+		else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+		else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+		uint32_t temp = ROL32(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = ROL32(b, 30);
+		b = a;
+		a = temp;
+	}
+
+	ctx->state[0] += a;
+	ctx->state[1] += b;
+	ctx->state[2] += c;
+	ctx->state[3] += d;
+	ctx->state[4] += e;
+}
+
+void SHA1Init(SHA1Context* ctx) {
+	ctx->state[0] = 0x67452301;
+	ctx->state[1] = 0xEFCDAB89;
+	ctx->state[2] = 0x98BADCFE;
+	ctx->state[3] = 0x10325476;
+	ctx->state[4] = 0xC3D2E1F0;
+	ctx->length = 0;
+	ctx->used = 0;
+}
+
+void SHA1Update(SHA1Context* ctx, const void* data, size_t length) {
+	const uint8_t* p = (const uint8_t*)data;
+	ctx->length += length;
+
+	while (length > 0) {
+		size_t chunk = 64 - ctx->used;
+		if (chunk > length) chunk = length;
+
+		memcpy(ctx->buffer + ctx->used, p, chunk);
+		ctx->used += chunk;
+		p += chunk;
+		length -= chunk;
+
+		if (ctx->used == 64) {
+			SHA1Transform(ctx, ctx->buffer);
+			ctx->used = 0;
+		}
+	}
+}
+
+void SHA1Final(SHA1Context* ctx, uint8_t* digest) {
+	PadBlock(ctx->buffer, &ctx->used, ctx->length, SHA1Transform, ctx);
+	for (int i = 0; i < 5; i++) {
+		WriteBE32(digest + i * 4, ctx->state[i]);
+	}
+}
+#pragma endregion
+
+#pragma region SHA-256
+static const uint32_t k256[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void SHA256Transform(void* context, const uint8_t* block) {
+	SHA256Context* ctx = (SHA256Context*)context;
+	uint32_t w[64];
+
+	for (int i = 0; i < 16; i++) {
+		w[i] = ReadBE32(block + i * 4);
+	}
+	for (int i = 16; i < 64; i++) {
+		uint32_t s0 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3];
+	uint32_t e = ctx->state[4], f = ctx->state[5], g = ctx->state[6], h = ctx->state[7];
+
+	for (int i = 0; i < 64; i++) {
+		uint32_t S1 = ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25);
+		uint32_t ch = (e & f) ^ (~e & g);
+		uint32_t temp1 = h + S1 + ch + k256[i] + w[i];
+		uint32_t S0 = ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22);
+		uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		uint32_t temp2 = S0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + temp1;
+		d = c;
+		c = b;
+		b = a;
+		a = temp1 + temp2;
+	}
+
+	ctx->state[0] += a;
+	ctx->state[1] += b;
+	ctx->state[2] += c;
+	ctx->state[3] += d;
+	ctx->state[4] += e;
+	ctx->state[5] += f;
+	ctx->state[6] += g;
+	ctx->state[7] += h;
+}
+
+void SHA256Init(SHA256Context* ctx) {
+	ctx->state[0] = 0x6a09e667;
+	ctx->state[1] = 0xbb67ae85;
+	ctx->state[2] = 0x3c6ef372;
+	ctx->state[3] = 0xa54ff53a;
+	ctx->state[4] = 0x510e527f;
+	ctx->state[5] = 0x9b05688c;
+	ctx->state[6] = 0x1f83d9ab;
+	ctx->state[7] = 0x5be0cd19;
+	ctx->length = 0;
+	ctx->used = 0;
+}
+
+void SHA256Update(SHA256Context* ctx, const void* data, size_t length) {
+	const uint8_t* p = (const uint8_t*)data;
+	ctx->length += length;
+
+	while (length > 0) {
+		size_t chunk = 64 - ctx->used;
+		if (chunk > length) chunk = length;
+
+		memcpy(ctx->buffer + ctx->used, p, chunk);
+		ctx->used += chunk;
+		p += chunk;
+		length -= chunk;
+
+		if (ctx->used == 64) {
+			SHA256Transform(ctx, ctx->buffer);
+			ctx->used = 0;
+		}
+	}
+}
+
+void SHA256Final(SHA256Context* ctx, uint8_t* digest) {
+	PadBlock(ctx->buffer, &ctx->used, ctx->length, SHA256Transform, ctx);
+	for (int i = 0; i < 8; i++) {
+		WriteBE32(digest + i * 4, ctx->state[i]);
+	}
+}
+#pragma endregion
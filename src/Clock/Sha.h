@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_SHA_H__
+#define __CLOCK_SHA_H__
+
+// Small SHA-1 and SHA-256 implementations for NTP packet authentication.
+// CryptoAPI only gained SHA-256 in XP SP3, so these are built in to keep XP SP2 working.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA1_DIGEST_SIZE	20
+#define SHA256_DIGEST_SIZE	32
+
+typedef struct __SHA1Context {
+	uint32_t state[5];
+	uint64_t length; // Total message length in bytes
+	uint8_t buffer[64];
+	size_t used; // Bytes waiting in buffer
+} SHA1Context;
+
+typedef struct __SHA256Context {
+	uint32_t state[8];
+	uint64_t length;
+	uint8_t buffer[64];
+	size_t used;
+} SHA256Context;
+
+void SHA1Init(SHA1Context*);
+void SHA1Update(SHA1Context*, const void*, size_t);
+void SHA1Final(SHA1Context*, uint8_t*); // Writes SHA1_DIGEST_SIZE bytes
+
+void SHA256Init(SHA256Context*);
+void SHA256Update(SHA256Context*, const void*, size_t);
+void SHA256Final(SHA256Context*, uint8_t*); // Writes SHA256_DIGEST_SIZE bytes
+
+#endif // !__CLOCK_SHA_H__
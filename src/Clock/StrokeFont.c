@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "StrokeFont.h"
+
+#include <math.h>
+#include <string.h>
+
+#define UP -1 // Lifts the pen: the next point starts a new polyline
+#define END -2
+
+#define LEFT_BEARING 1.5f // Every glyph's strokes start this far right of the pen
+#define TOP 2 // Glyph coordinates are relative to the top of the caps, which sits this far below the top of the line
+
+typedef struct __StrokeGlyph {
+	wchar_t ch;
+	int advance; // In font units
+	signed char points[48]; // x, y pairs on an 8 x 12 grid. UP and END go in the x slot.
+} StrokeGlyph;
+
+static const StrokeGlyph glyphs[] = {
+	{ L'0', 11, { 2,0, 6,0, 8,2, 8,10, 6,12, 2,12, 0,10, 0,2, 2,0, END } },
+	{ L'1', 11, { 2,2, 4,0, 4,12, UP,0, 1,12, 7,12, END } },
+	{ L'2', 11, { 0,2, 2,0, 6,0, 8,2, 8,4, 0,12, 8,12, END } },
+	{ L'3', 11, { 0,1, 2,0, 6,0, 8,2, 8,4, 6,6, 3,6, UP,0, 6,6, 8,8, 8,10, 6,12, 2,12, 0,11, END } },
+	{ L'4', 11, { 6,12, 6,0, 0,8, 8,8, END } },
+	{ L'5', 11, { 8,0, 0,0, 0,5, 6,5, 8,7, 8,10, 6,12, 2,12, 0,11, END } },
+	{ L'6', 11, { 7,0, 3,0, 0,4, 0,10, 2,12, 6,12, 8,10, 8,8, 6,6, 2,6, 0,8, END } },
+	{ L'7', 11, { 0,0, 8,0, 3,12, END } },
+	{ L'8', 11, { 2,0, 6,0, 8,2, 8,4, 6,6, 2,6, 0,4, 0,2, 2,0, UP,0, 2,6, 0,8, 0,10, 2,12, 6,12, 8,10, 8,8, 6,6, END } },
+	{ L'9', 11, { 1,12, 5,12, 8,8, 8,2, 6,0, 2,0, 0,2, 0,4, 2,6, 6,6, 8,4, END } },
+	{ L':', 4, { 0,3, 0,3, UP,0, 0,9, 0,9, END } },
+	{ L'-', 9, { 0,6, 6,6, END } },
+	{ L'.', 4, { 0,12, 0,12, END } },
+	{ L' ', 5, { END } },
+	{ L'A', 11, { 0,12, 4,0, 8,12, UP,0, 1,8, 7,8, END } },
+	{ L'P', 11, { 0,12, 0,0, 6,0, 8,2, 8,4, 6,6, 0,6, END } },
+	{ L'M', 11, { 0,12, 0,0, 4,7, 8,0, 8,12, END } },
+};
+
+static const StrokeGlyph* FindStrokeGlyph(wchar_t ch) {
+	for (size_t i = 0; i < sizeof(glyphs) / sizeof(glyphs[0]); i++) {
+		if (glyphs[i].ch == ch) {
+			return &glyphs[i];
+		}
+	}
+	return NULL;
+}
+
+static float SegmentDistance(float px, float py, float ax, float ay, float bx, float by) {
+	float dx = bx - ax, dy = by - ay;
+	float lengthSq = dx * dx + dy * dy;
+	float t = lengthSq > 0.0f ? ((px - ax) * dx + (py - ay) * dy) / lengthSq : 0.0f;
+	if (t < 0.0f) t = 0.0f;
+	if (t > 1.0f) t = 1.0f;
+	float ex = px - (ax + t * dx), ey = py - (ay + t * dy);
+	return sqrtf(ex * ex + ey * ey);
+}
+
+float StrokeGlyphDistance(wchar_t ch, float x, float y) {
+	const StrokeGlyph* glyph = FindStrokeGlyph(ch);
+	float best = 1e9f;
+	if (!glyph) return best;
+
+	// Into glyph coordinates
+	x -= LEFT_BEARING;
+	y -= TOP;
+
+	int hasPrevious = 0;
+	float prevX = 0.0f, prevY = 0.0f;
+	for (int i = 0; glyph->points[i] != END; i += 2) {
+		if (glyph->points[i] == UP) {
+			hasPrevious = 0;
+			continue;
+		}
+
+		float px = glyph->points[i], py = glyph->points[i + 1];
+		if (hasPrevious) {
+			float distance = SegmentDistance(x, y, prevX, prevY, px, py);
+			if (distance < best) best = distance;
+		}
+		prevX = px;
+		prevY = py;
+		hasPrevious = 1;
+	}
+
+	return best;
+}
+
+int StrokeGlyphAdvance(wchar_t ch) {
+	const StrokeGlyph* glyph = FindStrokeGlyph(ch);
+	return glyph ? glyph->advance : 5;
+}
+
+static void GetStrokeMetrics(void* context, GlyphFontMetrics* metrics) {
+	StrokeFont* font = (StrokeFont*)context;
+	metrics->lineHeight = font->lineHeight;
+	metrics->maxAdvance = (int)ceilf(11 * font->scale);
+}
+
+static int RasterizeStrokeGlyph(void* context, wchar_t ch, uint8_t* cell, int cellWidth, int cellHeight, int penX) {
+	StrokeFont* font = (StrokeFont*)context;
+	float radiusPx = font->radius * font->scale;
+
+	for (int y = 0; y < cellHeight; y++) {
+		for (int x = 0; x < cellWidth; x++) {
+			// Sample at the pixel center, in font units
+			float ux = (x + 0.5f - penX) / font->scale;
+			float uy = (y + 0.5f) / font->scale;
+			float distancePx = StrokeGlyphDistance(ch, ux, uy) * font->scale;
+
+			// Coverage ramps over one pixel across the edge of the pen
+			float coverage = radiusPx + 0.5f - distancePx;
+			if (coverage <= 0.0f) continue;
+			if (coverage > 1.0f) coverage = 1.0f;
+			cell[y * cellWidth + x] = (uint8_t)(coverage * 255.0f + 0.5f);
+		}
+	}
+
+	return (int)(StrokeGlyphAdvance(ch) * font->scale + 0.5f);
+}
+
+void InitStrokeFont(StrokeFont* font, int lineHeight, float radius) {
+	font->lineHeight = lineHeight;
+	font->scale = lineHeight / STROKE_FONT_UNITS_PER_LINE;
+	font->radius = radius;
+}
+
+void GetStrokeFontBackend(StrokeFont* font, GlyphBackend* backend) {
+	backend->context = font;
+	backend->GetMetrics = GetStrokeMetrics;
+	backend->Rasterize = RasterizeStrokeGlyph;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_STROKE_FONT_H__
+#define __CLOCK_STROKE_FONT_H__
+
+// A small built-in vector font covering GLYPH_ATLAS_CHARSET. Each glyph is a set of polylines drawn with a round pen,
+// so it can be rasterized at any size without a font system. Used as the glyph backend where GDI isn't available and for headless rendering.
+
+#include "GlyphAtlas.h"
+
+#define STROKE_FONT_UNITS_PER_LINE 16.0f // Glyphs are designed on a grid 16 units tall: cap height from 2 to 14
+
+typedef struct __StrokeFont {
+	int lineHeight; // In pixels
+	float scale; // Pixels per font unit
+	float radius; // Half the pen width, in font units
+} StrokeFont;
+
+void InitStrokeFont(StrokeFont*, int, float); // Sets up the font for a line height in pixels and a pen radius in font units. 0.8 looks like a regular weight
+void GetStrokeFontBackend(StrokeFont*, GlyphBackend*); // Fills in a glyph backend that rasterizes from this font
+float StrokeGlyphDistance(wchar_t, float, float); // Distance in font units from a point (relative to the pen position and the top of the line) to the center line of a glyph's strokes. Large if the glyph has no strokes
+int StrokeGlyphAdvance(wchar_t); // Advance of a glyph in font units
+
+#endif // !__CLOCK_STROKE_FONT_H__
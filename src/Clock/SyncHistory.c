@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SyncHistory.h"
+#include "Colors.h"
+
+#include <math.h>
+
+// Every NTP sample goes into a ring in memory, which the settings window draws from.
+// Samples that haven't been written yet are appended to the history file as one block every HISTORY_FLUSH_SAMPLES samples, so drift can be looked at later with src/Tools/HistoryDump.c.
+
+static CRITICAL_SECTION ringLock;
+static HistoryRecord ring[HISTORY_RING_SIZE];
+static size_t ringNext = 0; // Slot the next sample goes into
+static size_t ringCount = 0;
+static size_t unflushed = 0; // Newest samples that aren't in the file yet
+static DWORD lastFlushTick = 0;
+static double jitter = 0.0;
+
+static CRITICAL_SECTION fileLock; // Serializes writers so two flushes can't interleave blocks. Never held together with ringLock.
+static wchar_t historyPath[MAX_PATH]; // Resolved once by InitSyncHistory, since GetHistoryFile allocates a new copy on every call. Empty if logging to a file is off
+
+// Resolves the HistoryFile setting. Returns FALSE if logging to a file is turned off.
+static BOOL GetHistoryPath(wchar_t* path) {
+	const wchar_t* setting = GetHistoryFile(); // Only called once, so the copy is simply kept
+	if (setting[0] == L'\0') {
+		return FALSE;
+	}
+
+	// $(LocalDir) works the same as it does for the color file
+	if (wcsncmp(setting, L"$(LocalDir)\\", 12) == 0) {
+		if (!GetModuleFileNameW(NULL, path, MAX_PATH)) {
+			return FALSE;
+		}
+		PathRemoveFileSpecW(path);
+		if (wcslen(path) + wcslen(setting + 11) >= MAX_PATH) {
+			return FALSE;
+		}
+		wcscat(path, setting + 11);
+	}
+	else {
+		wcsncpy(path, setting, MAX_PATH - 1);
+		path[MAX_PATH - 1] = L'\0';
+	}
+
+	return TRUE;
+}
+
+// Appends one block to the history file, starting a new file first if the current one is too big.
+static void AppendToFile(const HistoryRecord* records, size_t count) {
+	const wchar_t* path = historyPath;
+	if (!path[0]) {
+		return;
+	}
+
+	uint8_t* block = (uint8_t*)malloc(HISTORY_HEADER_SIZE + HISTORY_MAX_BLOCK_HEADER + count * HISTORY_MAX_RECORD_SIZE);
+	if (!block) {
+		return;
+	}
+
+	EnterCriticalSection(&fileLock);
+
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (GetFileAttributesExW(path, GetFileExInfoStandard, &attributes) && (attributes.nFileSizeHigh != 0 || attributes.nFileSizeLow >= HISTORY_FILE_MAX)) {
+		wchar_t oldPath[MAX_PATH + 4];
+		swprintf(oldPath, MAX_PATH + 4, L"%s.old", path);
+		MoveFileExW(path, oldPath, MOVEFILE_REPLACE_EXISTING);
+	}
+
+	HANDLE hFile = CreateFileW(path, FILE_APPEND_DATA, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		yellow();
+		wprintf(L"Failed to open the sync history file '%s'! GetLastError: 0x%x\r\n", path, GetLastError());
+		reset();
+	}
+	else {
+		// A brand new file gets the header in the same write as its first block
+		size_t length = 0;
+		if (GetFileSize(hFile, NULL) == 0) {
+			length = HistoryWriteHeader(block);
+		}
+		length += HistoryEncodeBlock(records, count, block + length, HISTORY_MAX_BLOCK_HEADER + count * HISTORY_MAX_RECORD_SIZE);
+
+		DWORD written = 0;
+		WriteFile(hFile, block, (DWORD)length, &written, NULL);
+		CloseHandle(hFile);
+	}
+
+	LeaveCriticalSection(&fileLock);
+	free(block);
+}
+
+// Copies the newest 'count' samples out of the ring, oldest first. Must be called with ringLock held.
+static void CopyNewest(HistoryRecord* out, size_t count) {
+	size_t start = (ringNext + HISTORY_RING_SIZE - count) % HISTORY_RING_SIZE;
+	for (size_t i = 0; i < count; i++) {
+		out[i] = ring[(start + i) % HISTORY_RING_SIZE];
+	}
+}
+
+void InitSyncHistory(void) {
+	InitializeCriticalSection(&ringLock);
+	InitializeCriticalSection(&fileLock);
+	lastFlushTick = GetTickCount();
+	if (!GetHistoryPath(historyPath)) {
+		historyPath[0] = L'\0';
+	}
+}
+
+void RecordSyncSample(const NTPSample* sample) {
+	HistoryRecord record;
+	record.time = sample->serverTime - (int64_t)NTP_TIMESTAMP_DELTA * 1000;
+	record.offset = (int32_t)sample->offset;
+	record.delay = (int32_t)sample->delay;
+	record.server = sample->source;
+
+	HistoryRecord pending[HISTORY_RING_SIZE];
+	size_t pendingCount = 0;
+
+	EnterCriticalSection(&ringLock);
+
+	// Exponential average of the offset differences, like ntpd's peer jitter
+	if (ringCount > 0) {
+		double difference = (double)record.offset - ring[(ringNext + HISTORY_RING_SIZE - 1) % HISTORY_RING_SIZE].offset;
+		jitter = sqrt(jitter * jitter + (difference * difference - jitter * jitter) / 4.0);
+	}
+	record.jitter = (int32_t)(jitter + 0.5);
+
+	ring[ringNext] = record;
+	ringNext = (ringNext + 1) % HISTORY_RING_SIZE;
+	if (ringCount < HISTORY_RING_SIZE) ringCount++;
+	if (unflushed < HISTORY_RING_SIZE) unflushed++; // If the file can't keep up, the oldest samples are simply lost
+
+	if (unflushed >= HISTORY_FLUSH_SAMPLES || GetTickCount() - lastFlushTick >= HISTORY_FLUSH_MS) {
+		pendingCount = unflushed;
+		CopyNewest(pending, pendingCount);
+		unflushed = 0;
+		lastFlushTick = GetTickCount();
+	}
+
+	LeaveCriticalSection(&ringLock);
+
+	if (pendingCount > 0) {
+		AppendToFile(pending, pendingCount);
+	}
+}
+
+size_t GetSyncHistory(HistoryRecord* out, size_t maxCount) {
+	EnterCriticalSection(&ringLock);
+	size_t count = min(maxCount, ringCount);
+	CopyNewest(out, count);
+	LeaveCriticalSection(&ringLock);
+	return count;
+}
+
+void FlushSyncHistory(void) {
+	HistoryRecord pending[HISTORY_RING_SIZE];
+
+	EnterCriticalSection(&ringLock);
+	size_t pendingCount = unflushed;
+	CopyNewest(pending, pendingCount);
+	unflushed = 0;
+	lastFlushTick = GetTickCount();
+	LeaveCriticalSection(&ringLock);
+
+	if (pendingCount > 0) {
+		AppendToFile(pending, pendingCount);
+	}
+}
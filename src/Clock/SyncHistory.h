@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_SYNC_HISTORY_H__
+#define __CLOCK_SYNC_HISTORY_H__
+
+#include "Clock.h"
+#include "NTPClient.h"
+#include "HistoryLog.h"
+
+#define HISTORY_RING_SIZE		512 // Samples kept in memory. About 21 days at the default hourly sync interval, or under 10 hours of broadcasts at ntpd's default 64 seconds
+#define HISTORY_FLUSH_SAMPLES	32 // Append to the file after this many new samples...
+#define HISTORY_FLUSH_MS		3600000 // ...or after an hour, whichever comes first
+#define HISTORY_FILE_MAX		(256 * 1024) // The file is rotated to '.old' once it grows past this, so the log never takes more than twice this on disk
+
+void InitSyncHistory(void); // Must be called before any worker thread is started
+void RecordSyncSample(const NTPSample*); // Adds a sample to the ring and appends to the file when a flush is due. Called from the sync threads
+size_t GetSyncHistory(HistoryRecord*, size_t); // Copies up to the given number of the newest samples, oldest first. Returns how many were copied
+void FlushSyncHistory(void); // Appends every sample that isn't in the file yet. Called on exit
+
+#endif // !__CLOCK_SYNC_HISTORY_H__
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "TextEffects.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int Absolute(int value) {
+	return value < 0 ? -value : value;
+}
+
+// Box radius for a blur that fades out over roughly 'reach' pixels. Each pass spreads the mask by the box radius
+static int BoxRadius(int reach) {
+	int radius = (reach + TEXT_EFFECT_PASSES - 1) / TEXT_EFFECT_PASSES;
+	return radius < 1 ? 1 : radius > FRAMEBUFFER_MAX_BLUR ? FRAMEBUFFER_MAX_BLUR : radius;
+}
+
+int HasTextEffects(const TextEffectStyle* style) {
+	return style->shadowRadius > 0 || style->outlineWidth > 0 || style->glowRadius > 0;
+}
+
+// How far past the text the masks reach, before the shadow is moved
+static int GetMaskPadding(const TextEffectStyle* style) {
+	int padding = 0;
+	if (style->shadowRadius > 0) padding = BoxRadius(style->shadowRadius) * TEXT_EFFECT_PASSES;
+	if (style->outlineWidth > 0 && BoxRadius(style->outlineWidth) * TEXT_EFFECT_PASSES > padding) padding = BoxRadius(style->outlineWidth) * TEXT_EFFECT_PASSES;
+	if (style->glowRadius > 0 && BoxRadius(style->glowRadius) * TEXT_EFFECT_PASSES > padding) padding = BoxRadius(style->glowRadius) * TEXT_EFFECT_PASSES;
+	return padding;
+}
+
+int GetTextEffectPadding(const TextEffectStyle* style) {
+	int offset = 0;
+	if (style->shadowRadius > 0) {
+		offset = Absolute(style->shadowOffsetX) > Absolute(style->shadowOffsetY) ? Absolute(style->shadowOffsetX) : Absolute(style->shadowOffsetY);
+	}
+	return GetMaskPadding(style) + offset;
+}
+
+// Blurs the padded coverage into a new mask, then scales it by gain / 256 so a blurred edge can be made solid again. NULL if out of memory
+static uint8_t* BlurCoverage(const uint8_t* padded, int width, int height, int reach, int gain) {
+	size_t size = (size_t)width * height;
+	uint8_t* mask = (uint8_t*)malloc(size);
+	if (!mask) return NULL;
+
+	memcpy(mask, padded, size);
+	if (!FramebufferBlurMask(mask, width, height, width, BoxRadius(reach), TEXT_EFFECT_PASSES)) {
+		free(mask);
+		return NULL;
+	}
+
+	if (gain != 256) {
+		for (size_t i = 0; i < size; i++) {
+			int value = (mask[i] * gain) >> 8;
+			mask[i] = (uint8_t)(value > 255 ? 255 : value);
+		}
+	}
+	return mask;
+}
+
+int BuildTextEffects(TextEffects* effects, const uint8_t* coverage, int stride, int width, int height, const TextEffectStyle* style) {
+	FreeTextEffects(effects);
+	if (!HasTextEffects(style) || width <= 0 || height <= 0) return 1;
+
+	int padding = GetMaskPadding(style);
+	effects->width = width + padding * 2;
+	effects->height = height + padding * 2;
+	effects->padding = padding;
+
+	uint8_t* padded = (uint8_t*)calloc((size_t)effects->width * effects->height, 1);
+	if (!padded) {
+		FreeTextEffects(effects);
+		return 0;
+	}
+	for (int y = 0; y < height; y++) {
+		memcpy(padded + (size_t)(y + padding) * effects->width + padding, coverage + (size_t)y * stride, width);
+	}
+
+	// The blurred edge of a solid stroke sits at half coverage and fades to nothing about a radius out.
+	// The outline is boosted so it stays solid out to about its width, the glow a little so it reads as light rather than haze, and the shadow is left soft
+	int result = 1;
+	if (style->shadowRadius > 0) {
+		result = result && (effects->shadow = BlurCoverage(padded, effects->width, effects->height, style->shadowRadius, 224)) != NULL;
+	}
+	if (style->outlineWidth > 0) {
+		result = result && (effects->outline = BlurCoverage(padded, effects->width, effects->height, style->outlineWidth, 1024)) != NULL;
+	}
+	if (style->glowRadius > 0) {
+		result = result && (effects->glow = BlurCoverage(padded, effects->width, effects->height, style->glowRadius, 384)) != NULL;
+	}
+
+	free(padded);
+	if (!result) {
+		FreeTextEffects(effects);
+	}
+	return result;
+}
+
+void DrawTextEffects(const TextEffects* effects, Framebuffer* fb, int x, int y, const TextEffectStyle* style, const FramebufferRect* clip) {
+	int left = x - effects->padding, top = y - effects->padding;
+
+	if (effects->glow) {
+		FramebufferBlendMask(fb, left, top, effects->glow, effects->width, effects->width, effects->height, style->glowColor, clip);
+	}
+	if (effects->shadow) {
+		FramebufferBlendMask(fb, left + style->shadowOffsetX, top + style->shadowOffsetY, effects->shadow, effects->width, effects->width, effects->height, style->shadowColor, clip);
+	}
+	if (effects->outline) {
+		FramebufferBlendMask(fb, left, top, effects->outline, effects->width, effects->width, effects->height, style->outlineColor, clip);
+	}
+}
+
+void FreeTextEffects(TextEffects* effects) {
+	free(effects->shadow);
+	free(effects->outline);
+	free(effects->glow);
+	memset(effects, 0, sizeof(*effects));
+}
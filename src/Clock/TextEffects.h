@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __CLOCK_TEXT_EFFECTS_H__
+#define __CLOCK_TEXT_EFFECTS_H__
+
+// Drop shadow, outline and glow under the clock text, so it stays readable over light colors and pictures.
+// Each effect is a blurred copy of the text's coverage. They're built when the text changes, which is at most once a second,
+// and only blended every frame after that, so the DVD logo can carry its effects around for the cost of three masked fills.
+
+#include "Framebuffer.h"
+
+#define TEXT_EFFECT_PASSES 3 // Box blur passes. Three is close enough to a Gaussian that nobody can tell
+
+// Sizes are in pixels. An effect with a size of 0 is off
+typedef struct __TextEffectStyle {
+	int shadowRadius; // How far the shadow's edge fades out
+	int shadowOffsetX;
+	int shadowOffsetY;
+	uint32_t shadowColor;
+	int outlineWidth;
+	uint32_t outlineColor;
+	int glowRadius;
+	uint32_t glowColor;
+} TextEffectStyle;
+
+// Masks for each effect that's on, all the size of the text's coverage grown by 'padding' on every side
+typedef struct __TextEffects {
+	uint8_t* shadow; // Not offset yet. It's moved when drawn
+	uint8_t* outline;
+	uint8_t* glow;
+	int width;
+	int height;
+	int padding;
+} TextEffects;
+
+int HasTextEffects(const TextEffectStyle*); // Returns whether any effect is on
+int GetTextEffectPadding(const TextEffectStyle*); // How far past the text the effects can reach, including the shadow's offset
+int BuildTextEffects(TextEffects*, const uint8_t*, int, int, int, const TextEffectStyle*); // Builds the masks from the text's coverage. Takes the coverage, its stride, width and height, and the style. Returns 0 if out of memory
+void DrawTextEffects(const TextEffects*, Framebuffer*, int, int, const TextEffectStyle*, const FramebufferRect*); // Blends the glow, shadow and outline for text whose coverage starts at the given position. Draw the text itself afterwards
+void FreeTextEffects(TextEffects*); // Releases the masks
+
+#endif // !__CLOCK_TEXT_EFFECTS_H__
@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TilePool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+// Tiles are numbered in rows, and each thread starts with an even, contiguous share of them so neighbouring tiles stay on one core.
+// A thread takes tiles from the front of its own queue. Once that is empty it steals the back half of another thread's queue,
+// so a thread that got the expensive tiles (the text, say) doesn't hold up the whole frame.
+// The queues are only locked for the few instructions it takes to move their bounds.
+
+#ifdef _WIN32
+typedef HANDLE PoolThread;
+typedef HANDLE PoolSemaphore;
+#define AtomicExchange(p, v) InterlockedExchange((p), (v))
+#define AtomicStore(p, v) InterlockedExchange((p), (v))
+#define AtomicDecrement(p) InterlockedDecrement(p)
+#define YieldThread() SwitchToThread()
+#else
+typedef pthread_t PoolThread;
+typedef struct __PoolSemaphore {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int count;
+} PoolSemaphore;
+#define AtomicExchange(p, v) __atomic_exchange_n((p), (v), __ATOMIC_ACQUIRE)
+#define AtomicStore(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define AtomicDecrement(p) __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+#define YieldThread() sched_yield()
+#endif
+
+// One queue per thread, on its own cache line
+typedef struct __TileQueue {
+	volatile long lock;
+	int head; // Next tile the owner takes
+	int tail; // One past the last tile
+	char padding[64 - sizeof(long) - 2 * sizeof(int)];
+} TileQueue;
+
+typedef struct __TileWorker {
+	TilePool* pool;
+	int index;
+} TileWorker;
+
+struct __TilePool {
+	TileQueue queues[TILE_POOL_MAX_THREADS];
+	int threadCount;
+	PoolThread threads[TILE_POOL_MAX_THREADS];
+	TileWorker workers[TILE_POOL_MAX_THREADS];
+	PoolSemaphore start; // One count per worker per job
+	PoolSemaphore done; // Posted by the last worker to finish a job
+	volatile long pending; // Workers that haven't finished the current job
+	volatile long quit;
+
+	// The current job. Written before the workers are woken and only read while they run
+	FramebufferRect area;
+	int tileWidth;
+	int tileHeight;
+	int columns;
+	TileProc proc;
+	void* context;
+
+	TilePoolStats stats; // Each thread only writes its own tilesPerThread entry
+	long steals[TILE_POOL_MAX_THREADS]; // Same for steals, summed up by GetTilePoolStats
+};
+
+#ifdef _WIN32
+static int InitSemaphore(PoolSemaphore* semaphore) {
+	*semaphore = CreateSemaphoreW(NULL, 0, TILE_POOL_MAX_THREADS, NULL);
+	return *semaphore != NULL;
+}
+
+static void FreeSemaphore(PoolSemaphore* semaphore) {
+	CloseHandle(*semaphore);
+}
+
+static void PostSemaphore(PoolSemaphore* semaphore, int count) {
+	ReleaseSemaphore(*semaphore, count, NULL);
+}
+
+static void WaitSemaphore(PoolSemaphore* semaphore) {
+	WaitForSingleObject(*semaphore, INFINITE);
+}
+
+int GetProcessorCount(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+}
+#else
+static int InitSemaphore(PoolSemaphore* semaphore) {
+	semaphore->count = 0;
+	if (pthread_mutex_init(&semaphore->mutex, NULL) != 0) return 0;
+	if (pthread_cond_init(&semaphore->cond, NULL) != 0) {
+		pthread_mutex_destroy(&semaphore->mutex);
+		return 0;
+	}
+	return 1;
+}
+
+static void FreeSemaphore(PoolSemaphore* semaphore) {
+	pthread_cond_destroy(&semaphore->cond);
+	pthread_mutex_destroy(&semaphore->mutex);
+}
+
+static void PostSemaphore(PoolSemaphore* semaphore, int count) {
+	pthread_mutex_lock(&semaphore->mutex);
+	semaphore->count += count;
+	pthread_cond_broadcast(&semaphore->cond);
+	pthread_mutex_unlock(&semaphore->mutex);
+}
+
+static void WaitSemaphore(PoolSemaphore* semaphore) {
+	pthread_mutex_lock(&semaphore->mutex);
+	while (semaphore->count == 0) {
+		pthread_cond_wait(&semaphore->cond, &semaphore->mutex);
+	}
+	semaphore->count--;
+	pthread_mutex_unlock(&semaphore->mutex);
+}
+
+int GetProcessorCount(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+}
+#endif
+static void LockQueue(TileQueue* queue) {
+	while (AtomicExchange(&queue->lock, 1)) {
+		YieldThread();
+	}
+}
+
+static void UnlockQueue(TileQueue* queue) {
+	AtomicStore(&queue->lock, 0);
+}
+
+// Takes the next tile from the thread's own queue. Returns -1 if it's empty.
+static int PopTile(TileQueue* queue) {
+	int tile = -1;
+	LockQueue(queue);
+	if (queue->head < queue->tail) {
+		tile = queue->head++;
+	}
+	UnlockQueue(queue);
+	return tile;
+}
+
+// Moves the back half of the first non-empty queue found into the thief's queue and returns the first of those tiles. Returns -1 when every queue is empty.
+static int StealTiles(TilePool* pool, int thief) {
+	for (int i = 1; i < pool->threadCount; i++) {
+		TileQueue* victim = &pool->queues[(thief + i) % pool->threadCount];
+
+		LockQueue(victim);
+		int count = victim->tail - victim->head;
+		int take = (count + 1) / 2;
+		int first = victim->tail - take;
+		victim->tail = first;
+		UnlockQueue(victim);
+
+		if (take > 0) {
+			TileQueue* own = &pool->queues[thief];
+			LockQueue(own);
+			own->head = first + 1;
+			own->tail = first + take;
+			UnlockQueue(own);
+
+			pool->steals[thief]++;
+			return first;
+		}
+	}
+
+	return -1;
+}
+
+// Draws tiles until there are none left anywhere.
+static void DrainTiles(TilePool* pool, int index) {
+	for (;;) {
+		int tile = PopTile(&pool->queues[index]);
+		if (tile < 0) {
+			tile = StealTiles(pool, index);
+			if (tile < 0) break;
+		}
+
+		FramebufferRect rect;
+		rect.left = pool->area.left + (tile % pool->columns) * pool->tileWidth;
+		rect.top = pool->area.top + (tile / pool->columns) * pool->tileHeight;
+		rect.right = rect.left + pool->tileWidth < pool->area.right ? rect.left + pool->tileWidth : pool->area.right;
+		rect.bottom = rect.top + pool->tileHeight < pool->area.bottom ? rect.top + pool->tileHeight : pool->area.bottom;
+
+		pool->proc(&rect, pool->context);
+		pool->stats.tilesPerThread[index]++;
+	}
+}
+#ifdef _WIN32
+static DWORD WINAPI TileThread(LPVOID parameter) {
+#else
+static void* TileThread(void* parameter) {
+#endif
+	TileWorker* worker = (TileWorker*)parameter;
+	TilePool* pool = worker->pool;
+
+	for (;;) {
+		WaitSemaphore(&pool->start);
+		if (pool->quit) break;
+
+		DrainTiles(pool, worker->index);
+
+		if (AtomicDecrement(&pool->pending) == 0) {
+			PostSemaphore(&pool->done, 1);
+		}
+	}
+
+	return 0;
+}
+
+static void StopThreads(TilePool* pool, int started) {
+	AtomicStore(&pool->quit, 1);
+	PostSemaphore(&pool->start, started);
+
+	for (int i = 1; i <= started; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(pool->threads[i], INFINITE);
+		CloseHandle(pool->threads[i]);
+#else
+		pthread_join(pool->threads[i], NULL);
+#endif
+	}
+}
+
+TilePool* CreateTilePool(int threadCount) {
+	if (threadCount <= 0) threadCount = GetProcessorCount();
+	if (threadCount > TILE_POOL_MAX_THREADS) threadCount = TILE_POOL_MAX_THREADS;
+
+	// The kernels are otherwise picked on first use, which would be on several workers at once, all writing the function pointers
+	FramebufferGetKernels();
+
+	TilePool* pool = (TilePool*)calloc(1, sizeof(TilePool));
+	if (!pool) return NULL;
+
+	if (!InitSemaphore(&pool->start)) {
+		free(pool);
+		return NULL;
+	}
+	if (!InitSemaphore(&pool->done)) {
+		FreeSemaphore(&pool->start);
+		free(pool);
+		return NULL;
+	}
+
+	// Slot 0 belongs to the thread calling RunTiles
+	pool->threadCount = 1;
+	for (int i = 1; i < threadCount; i++) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].index = i;
+#ifdef _WIN32
+		pool->threads[i] = CreateThread(NULL, 0, TileThread, &pool->workers[i], 0, NULL);
+		if (!pool->threads[i]) break;
+#else
+		if (pthread_create(&pool->threads[i], NULL, TileThread, &pool->workers[i]) != 0) break;
+#endif
+		pool->threadCount++;
+	}
+
+	return pool;
+}
+
+void DestroyTilePool(TilePool* pool) {
+	if (!pool) return;
+
+	StopThreads(pool, pool->threadCount - 1);
+	FreeSemaphore(&pool->start);
+	FreeSemaphore(&pool->done);
+	free(pool);
+}
+
+int GetTilePoolThreads(const TilePool* pool) {
+	return pool ? pool->threadCount : 1;
+}
+
+void RunTiles(TilePool* pool, const FramebufferRect* area, int tileWidth, int tileHeight, TileProc proc, void* context) {
+	if (area->left >= area->right || area->top >= area->bottom || tileWidth <= 0 || tileHeight <= 0) return;
+
+	pool->area = *area;
+	pool->tileWidth = tileWidth;
+	pool->tileHeight = tileHeight;
+	pool->columns = (area->right - area->left + tileWidth - 1) / tileWidth;
+	pool->proc = proc;
+	pool->context = context;
+
+	int rows = (area->bottom - area->top + tileHeight - 1) / tileHeight;
+	int tileCount = pool->columns * rows;
+	for (int i = 0; i < pool->threadCount; i++) {
+		pool->queues[i].head = (int)((long long)tileCount * i / pool->threadCount);
+		pool->queues[i].tail = (int)((long long)tileCount * (i + 1) / pool->threadCount);
+	}
+
+	pool->stats.jobs++;
+	pool->stats.tiles += tileCount;
+
+	int workers = pool->threadCount - 1;
+	if (workers > 0) {
+		pool->pending = workers;
+		PostSemaphore(&pool->start, workers);
+	}
+
+	DrainTiles(pool, 0);
+
+	if (workers > 0) {
+		WaitSemaphore(&pool->done);
+	}
+}
+
+void GetTilePoolStats(const TilePool* pool, TilePoolStats* stats) {
+	*stats = pool->stats;
+	for (int i = 0; i < pool->threadCount; i++) {
+		stats->steals += pool->steals[i];
+	}
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CLOCK_TILE_POOL_H__
+#define __CLOCK_TILE_POOL_H__
+
+// A small thread pool that draws a rectangle of a framebuffer in tiles.
+// It uses Win32 threads on Windows and pthreads anywhere else.
+
+#include "Framebuffer.h"
+
+#define TILE_POOL_MAX_THREADS 64
+
+typedef struct __TilePool TilePool;
+
+typedef void (*TileProc)(const FramebufferRect*, void*); // Draws one tile. Called from several threads at once, each with a different tile
+
+typedef struct __TilePoolStats {
+	long jobs; // Calls to RunTiles
+	long tiles;
+	long steals; // Times a thread ran out of tiles and took half of another thread's
+	long tilesPerThread[TILE_POOL_MAX_THREADS]; // Index 0 is the thread calling RunTiles
+} TilePoolStats;
+
+int GetProcessorCount(void); // Number of logical processors
+TilePool* CreateTilePool(int); // Starts a pool. The count includes the thread that calls RunTiles, so 1 starts no threads. 0 means one per processor. Returns NULL on failure
+void DestroyTilePool(TilePool*); // Stops and joins the threads
+int GetTilePoolThreads(const TilePool*); // Threads drawing tiles, counting the caller
+void RunTiles(TilePool*, const FramebufferRect*, int, int, TileProc, void*); // Splits a rectangle into tiles of the given width and height and draws them all. Returns once every tile is done
+void GetTilePoolStats(const TilePool*, TilePoolStats*); // Copies the statistics. Only call it between RunTiles calls
+
+#endif // !__CLOCK_TILE_POOL_H__
@@ -17,6 +17,7 @@
  */
 
 #include "TrayIcon.h"
+#include "EventQueue.h"
 
 // ID's for the buttons in the icon
 #define ID_TRAY_APP_ICON 0x11
@@ -96,4 +97,17 @@ void StartTray(void) {
     if (!g_hWndTray) return;
 
     // No need to show a window here.
+}
+
+void ShowTrayNotification(LPCWSTR lpszTitle, LPCWSTR lpszText, int severity) {
+    if (!g_hWndTray) return;
+
+    nid.uFlags = NIF_INFO;
+    wcsncpy(nid.szInfoTitle, lpszTitle, ARRAYSIZE(nid.szInfoTitle) - 1);
+    nid.szInfoTitle[ARRAYSIZE(nid.szInfoTitle) - 1] = L'\0';
+    wcsncpy(nid.szInfo, lpszText, ARRAYSIZE(nid.szInfo) - 1);
+    nid.szInfo[ARRAYSIZE(nid.szInfo) - 1] = L'\0';
+    nid.dwInfoFlags = severity == CLOCK_EVENT_ERROR ? NIIF_ERROR : severity == CLOCK_EVENT_WARNING ? NIIF_WARNING : NIIF_INFO;
+
+    Shell_NotifyIcon(NIM_MODIFY, &nid);
 }
\ No newline at end of file
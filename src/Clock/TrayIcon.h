@@ -23,5 +23,6 @@
 
 LRESULT CALLBACK TrayProc(HWND, UINT, WPARAM, LPARAM); // WndProc for the tray icon
 void StartTray(void); // Function to start the tray icon
+void ShowTrayNotification(LPCWSTR, LPCWSTR, int); // Shows a balloon on the tray icon. Takes the title, the text and a CLOCK_EVENT_* severity. Does nothing if the tray icon isn't running
 
 #endif // !__CLOCK_TRAY_ICON_H__
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Prints a sync history file (history.bin, see HistoryLog.h) as CSV, one sample per line.
+// Builds on its own with any C compiler, so logs collected from displays can be read anywhere:
+//   cl /I..\Clock HistoryDump.c ..\Clock\HistoryLog.c
+//   cc -I../Clock HistoryDump.c ../Clock/HistoryLog.c -o historydump
+// Usage: historydump history.bin [history.bin.old ...]
+
+#include "HistoryLog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static void PrintRecord(const HistoryRecord* record, void* context) {
+	(void)context;
+
+	time_t seconds = (time_t)(record->time / 1000);
+	struct tm* utc = gmtime(&seconds);
+	const uint8_t* server = (const uint8_t*)&record->server; // Network order, so the bytes are already in dotted order
+
+	printf("%04d-%02d-%02dT%02d:%02d:%02d.%03dZ,%ld,%ld,%ld,%u.%u.%u.%u\n",
+		utc->tm_year + 1900, utc->tm_mon + 1, utc->tm_mday, utc->tm_hour, utc->tm_min, utc->tm_sec, (int)(record->time % 1000),
+		(long)record->offset, (long)record->delay, (long)record->jitter,
+		server[0], server[1], server[2], server[3]);
+}
+
+static int DumpFile(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		fprintf(stderr, "%s: could not open\n", path);
+		return 1;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	uint8_t* data = (uint8_t*)malloc(size > 0 ? (size_t)size : 1);
+	if (!data || fread(data, 1, (size_t)size, file) != (size_t)size) {
+		fprintf(stderr, "%s: could not read\n", path);
+		free(data);
+		fclose(file);
+		return 1;
+	}
+	fclose(file);
+
+	long records = HistoryDecode(data, (size_t)size, PrintRecord, NULL);
+	free(data);
+
+	if (records < 0) {
+		fprintf(stderr, "%s: not a sync history file\n", path);
+		return 1;
+	}
+
+	fprintf(stderr, "%s: %ld samples, %ld bytes\n", path, records, size);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s history.bin [more files...]\n", argv[0]);
+		return 2;
+	}
+
+	int result = 0;
+	printf("time,offset_ms,delay_ms,jitter_ms,server\n");
+
+	// Pass the .old file first to get one continuous series
+	for (int i = 1; i < argc; i++) {
+		result |= DumpFile(argv[i]);
+	}
+
+	return result;
+}
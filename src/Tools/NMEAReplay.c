@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+// Replays a captured NMEA log (NMEAReplay.nmea next to this file) through the GPS parser in chunks of many sizes, the way serial reads split it,
+// and checks every decoded RMC and ZDA time, the sentences rejected for bad or missing checksums, and that feeding never allocates.
+//   cl /I..\Clock NMEAReplay.c ..\Clock\NMEAParser.c
+//   cc -DCOUNT_ALLOCATIONS -I../Clock NMEAReplay.c ../Clock/NMEAParser.c -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc -o nmeareplay
+// Usage: nmeareplay [NMEAReplay.nmea]
+// Prints one line per chunking and exits with 1 if any check failed. The allocation check needs the GNU linker's --wrap, so it's only built with COUNT_ALLOCATIONS.
+
+#include "NMEAParser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_MAX_TIMES 32
+
+// What the log decodes to: 2025-04-05 23:59:58 UTC at 5 Hz, across midnight into April 6th
+static const NMEATime expectedTimes[] = {
+	{ 1743897598, 0, 'R' },
+	{ 1743897598, 200, 'R' },
+	{ 1743897599, 0, 'Z' },
+	{ 1743897599, 800, 'R' },
+	{ 1743897600, 0, 'Z' },
+	{ 1743897600, 800, 'R' },
+	{ 1743897601, 0, 'Z' },
+};
+#define EXPECTED_COUNT (sizeof(expectedTimes) / sizeof(expectedTimes[0]))
+#define EXPECTED_SENTENCES 12 // The sentence cut off by the next '$' isn't counted
+#define EXPECTED_CHECKSUM_ERRORS 2 // One wrong checksum and one sentence without any
+
+#ifdef COUNT_ALLOCATIONS
+static int counting = 0;
+static long allocations = 0;
+
+void* __real_malloc(size_t);
+void* __real_calloc(size_t, size_t);
+void* __real_realloc(void*, size_t);
+
+void* __wrap_malloc(size_t size) {
+	if (counting) allocations++;
+	return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+	if (counting) allocations++;
+	return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+	if (counting) allocations++;
+	return __real_realloc(pointer, size);
+}
+#endif
+
+typedef struct __Decoded {
+	NMEATime times[REPLAY_MAX_TIMES];
+	int count;
+} Decoded;
+
+static void OnTime(const NMEATime* time, void* context) {
+	Decoded* decoded = (Decoded*)context;
+	if (decoded->count < REPLAY_MAX_TIMES) {
+		decoded->times[decoded->count] = *time;
+	}
+	decoded->count++;
+}
+
+// Feeds the whole log in chunks of 'chunk' bytes, or of pseudo-random sizes from 1 to 64 if it's 0, and checks the results. Returns 1 if everything matched
+static int Replay(const char* data, size_t length, size_t chunk) {
+	NMEAParser parser;
+	Decoded decoded;
+	decoded.count = 0;
+	NMEAInit(&parser, OnTime, &decoded);
+
+	unsigned int seed = 12345;
+	size_t returned = 0;
+#ifdef COUNT_ALLOCATIONS
+	allocations = 0;
+	counting = 1;
+#endif
+	for (size_t offset = 0; offset < length; ) {
+		size_t size = chunk;
+		if (size == 0) {
+			seed = seed * 1103515245u + 12345u;
+			size = 1 + (seed >> 16) % 64;
+		}
+		if (size > length - offset) size = length - offset;
+		returned += NMEAFeed(&parser, data + offset, size);
+		offset += size;
+	}
+#ifdef COUNT_ALLOCATIONS
+	counting = 0;
+#endif
+
+	int ok = 1;
+	if (decoded.count != (int)EXPECTED_COUNT || returned != EXPECTED_COUNT || parser.timestamps != EXPECTED_COUNT) {
+		printf("  decoded %d times (returned %zu, counted %lu), expected %zu\n", decoded.count, returned, parser.timestamps, EXPECTED_COUNT);
+		ok = 0;
+	}
+	for (int i = 0; i < decoded.count && i < (int)EXPECTED_COUNT; i++) {
+		const NMEATime* got = &decoded.times[i];
+		const NMEATime* want = &expectedTimes[i];
+		if (got->seconds != want->seconds || got->milliseconds != want->milliseconds || got->type != want->type) {
+			printf("  time %d: got %c %lld.%03u, expected %c %lld.%03u\n", i, got->type, (long long)got->seconds, got->milliseconds, want->type, (long long)want->seconds, want->milliseconds);
+			ok = 0;
+		}
+	}
+	if (parser.sentences != EXPECTED_SENTENCES || parser.checksumErrors != EXPECTED_CHECKSUM_ERRORS) {
+		printf("  %lu sentences with %lu checksum errors, expected %d with %d\n", parser.sentences, parser.checksumErrors, EXPECTED_SENTENCES, EXPECTED_CHECKSUM_ERRORS);
+		ok = 0;
+	}
+#ifdef COUNT_ALLOCATIONS
+	if (allocations != 0) {
+		printf("  %ld allocations while feeding, expected none\n", allocations);
+		ok = 0;
+	}
+#endif
+	return ok;
+}
+
+int main(int argc, char** argv) {
+	const char* path = argc > 1 ? argv[1] : "NMEAReplay.nmea";
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		fprintf(stderr, "%s: could not open\n", path);
+		return 2;
+	}
+
+	static char data[65536];
+	size_t length = fread(data, 1, sizeof(data), file);
+	fclose(file);
+
+	static const size_t chunks[] = { 1, 2, 3, 5, 7, 13, 64, 512, 65536, 0 };
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+		int ok = Replay(data, length, chunks[i]);
+		if (chunks[i]) {
+			printf("%s: %zu byte chunks\n", ok ? "ok" : "FAILED", chunks[i]);
+		}
+		else {
+			printf("%s: random chunks\n", ok ? "ok" : "FAILED");
+		}
+		failed |= !ok;
+	}
+	return failed;
+}
@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+// A small NTP server for trying out the 'Network (NTP broadcast)' time source (see NTPBroadcast.h) without a real ntpd on the network.
+// It answers the client's calibration request and then sends a mode 5 broadcast every interval, optionally with a MAC.
+//   cl /I..\Clock NTPBroadcaster.c ..\Clock\Sha.c ws2_32.lib
+//   cc -I../Clock NTPBroadcaster.c ../Clock/Sha.c -o ntpbroadcaster
+// Usage: ntpbroadcaster [-b ADDRESS] [-d ADDRESS] [-p PORT] [-i SECONDS] [-k "ID TYPE SECRET"] [-o MILLISECONDS] [-r]
+// -b is the address the server answers on, 127.0.0.2 by default, and -d is where the broadcasts go, 127.0.0.1 by default. The two have to differ, because the
+// answering socket would otherwise take the broadcasts meant for the clock. To test multicast, bind to the machine's own address and send to a group, e.g. -d 224.0.1.1.
+// -p sets the port (123), -i the broadcast interval (16 seconds). -k authenticates every packet with a key, written the same as a line of the key file.
+// -o shifts the broadcast times away from the calibration answer's and -r sends every broadcast again halfway to the next one. The clock should drop repeated packets, and shifted ones once they are more than 10 seconds off.
+// Point the clock at the -b address and port, with the same key ID and key file if -k is used, and pick the broadcast time source.
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "Sha.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define closesocket close
+#endif
+
+#define NTP_TIMESTAMP_DELTA 2208988800ULL // Seconds from 1900 to 1970
+#define BROADCASTER_STRATUM 2
+
+// The one key given with -k. Secrets are decoded the same way as NTPAuth.c does it.
+typedef struct __BroadcastKey {
+	uint32_t id;
+	int sha256;
+	uint8_t secret[64];
+	size_t length;
+} BroadcastKey;
+
+static int HexNibble(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// Parses '<id> <type> <secret>'. Returns 0 if the key isn't usable.
+static int ParseKey(const char* text, BroadcastKey* key) {
+	unsigned long id;
+	char type[16];
+	char secret[129];
+	if (sscanf(text, "%lu %15s %128s", &id, type, secret) != 3 || id == 0) {
+		return 0;
+	}
+
+	key->id = (uint32_t)id;
+	if (strcmp(type, "SHA1") == 0 || strcmp(type, "SHA") == 0 || strcmp(type, "sha1") == 0) {
+		key->sha256 = 0;
+	}
+	else if (strcmp(type, "SHA256") == 0 || strcmp(type, "sha256") == 0) {
+		key->sha256 = 1;
+	}
+	else {
+		return 0;
+	}
+
+	size_t length = strlen(secret);
+	int isHex = (length == 40 || length == 64);
+	for (size_t i = 0; i < length && isHex; i++) {
+		isHex = HexNibble(secret[i]) >= 0;
+	}
+
+	if (isHex) {
+		for (size_t i = 0; i < length / 2; i++) {
+			key->secret[i] = (uint8_t)((HexNibble(secret[i * 2]) << 4) | HexNibble(secret[i * 2 + 1]));
+		}
+		key->length = length / 2;
+	}
+	else {
+		if (length > sizeof(key->secret)) return 0;
+		memcpy(key->secret, secret, length);
+		key->length = length;
+	}
+
+	return 1;
+}
+
+// Appends the key ID and digest(secret || packet). Returns the new packet length.
+static size_t AppendMac(const BroadcastKey* key, uint8_t* packet, size_t length) {
+	uint32_t id = htonl(key->id);
+	memcpy(packet + length, &id, sizeof(id));
+
+	if (key->sha256) {
+		SHA256Context ctx;
+		SHA256Init(&ctx);
+		SHA256Update(&ctx, key->secret, key->length);
+		SHA256Update(&ctx, packet, length);
+		SHA256Final(&ctx, packet + length + 4);
+		return length + 4 + SHA256_DIGEST_SIZE;
+	}
+
+	SHA1Context ctx;
+	SHA1Init(&ctx);
+	SHA1Update(&ctx, key->secret, key->length);
+	SHA1Update(&ctx, packet, length);
+	SHA1Final(&ctx, packet + length + 4);
+	return length + 4 + SHA1_DIGEST_SIZE;
+}
+
+// Current time in milliseconds since 1970.
+static int64_t GetNowMs(void) {
+#ifdef _WIN32
+	FILETIME ft;
+	GetSystemTimeAsFileTime(&ft);
+
+	ULARGE_INTEGER now;
+	now.LowPart = ft.dwLowDateTime;
+	now.HighPart = ft.dwHighDateTime;
+	return (int64_t)(now.QuadPart / 10000ULL) - 11644473600000LL;
+#else
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+#endif
+}
+
+static void WriteTimestamp(uint8_t* out, int64_t unixMs) {
+	uint32_t seconds = htonl((uint32_t)(unixMs / 1000 + NTP_TIMESTAMP_DELTA));
+	uint32_t fraction = htonl((uint32_t)(((uint64_t)(unixMs % 1000) << 32) / 1000));
+	memcpy(out, &seconds, sizeof(seconds));
+	memcpy(out + 4, &fraction, sizeof(fraction));
+}
+
+// Fills in the header fields both packet types share: no leap second pending, version 4, and a made up local reference.
+static void WriteHeader(uint8_t* packet, int mode, int64_t now) {
+	memset(packet, 0, 48);
+	packet[0] = (uint8_t)((4 << 3) | mode);
+	packet[1] = BROADCASTER_STRATUM;
+	packet[2] = 6; // Poll, 64 seconds
+	packet[3] = (uint8_t)-10; // Precision, about a millisecond
+	memcpy(packet + 12, "LOCL", 4);
+	WriteTimestamp(packet + 16, now);
+	WriteTimestamp(packet + 40, now);
+}
+
+static void Usage(void) {
+	fprintf(stderr, "Usage: ntpbroadcaster [-b ADDRESS] [-d ADDRESS] [-p PORT] [-i SECONDS] [-k \"ID TYPE SECRET\"] [-o MILLISECONDS] [-r]\n");
+}
+
+int main(int argc, char** argv) {
+	const char* bindAddress = "127.0.0.2";
+	const char* destination = "127.0.0.1";
+	unsigned int port = 123;
+	int interval = 16;
+	long shift = 0;
+	int replay = 0;
+	BroadcastKey key;
+	int authenticate = 0;
+
+	for (int i = 1; i < argc; i++) {
+		const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (strcmp(argv[i], "-r") == 0) {
+			replay = 1;
+			continue;
+		}
+		if (!value || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+			Usage();
+			return 2;
+		}
+
+		switch (argv[i][1]) {
+		case 'b': bindAddress = value; break;
+		case 'd': destination = value; break;
+		case 'p': port = (unsigned int)atoi(value); break;
+		case 'i': interval = atoi(value); break;
+		case 'o': shift = atol(value); break;
+		case 'k':
+			if (!ParseKey(value, &key)) {
+				fprintf(stderr, "Invalid key '%s'. Expected '<id> SHA1|SHA256 <secret>'.\n", value);
+				return 2;
+			}
+			authenticate = 1;
+			break;
+		default:
+			Usage();
+			return 2;
+		}
+		i++;
+	}
+
+	if (port == 0 || port > 65535 || interval < 1) {
+		Usage();
+		return 2;
+	}
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+		fprintf(stderr, "WSAStartup failed.\n");
+		return 1;
+	}
+#endif
+
+	struct sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = inet_addr(bindAddress);
+	local.sin_port = htons((unsigned short)port);
+
+	struct sockaddr_in target;
+	memset(&target, 0, sizeof(target));
+	target.sin_family = AF_INET;
+	target.sin_addr.s_addr = inet_addr(destination);
+	target.sin_port = htons((unsigned short)port);
+
+	// The clock binds the same port on all addresses, and both sides need to allow sharing it
+	int enable = 1;
+	SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock != INVALID_SOCKET) {
+		setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&enable, sizeof(enable));
+	}
+	if (sock == INVALID_SOCKET || bind(sock, (struct sockaddr*)&local, sizeof(local)) != 0) {
+		fprintf(stderr, "Couldn't bind to %s:%u.\n", bindAddress, port);
+		return 1;
+	}
+
+	setsockopt(sock, SOL_SOCKET, SO_BROADCAST, (const char*)&enable, sizeof(enable));
+	if ((ntohl(target.sin_addr.s_addr) >> 28) == 14) {
+		// Keep multicast on the local segment and let the clock on this machine hear it too
+		int ttl = 1, loop = 1;
+		setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, (const char*)&local.sin_addr, sizeof(local.sin_addr));
+		setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&ttl, sizeof(ttl));
+		setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&loop, sizeof(loop));
+	}
+
+	printf("Answering on %s:%u, broadcasting to %s:%u every %d s%s.\n", bindAddress, port, destination, port, interval, authenticate ? " with a MAC" : "");
+	fflush(stdout);
+
+	uint8_t packet[48 + 4 + SHA256_DIGEST_SIZE];
+	size_t length = 0;
+	int64_t nextBroadcast = GetNowMs();
+	int64_t resend = 0; // When to send the last broadcast again for -r
+	for (;;) {
+		int64_t now = GetNowMs();
+		if (now >= nextBroadcast) {
+			WriteHeader(packet, 5, now + shift);
+			length = authenticate ? AppendMac(&key, packet, 48) : 48;
+			sendto(sock, (const char*)packet, (int)length, 0, (struct sockaddr*)&target, sizeof(target));
+			printf("Sent broadcast for %lld ms.\n", (long long)(now + shift));
+			fflush(stdout);
+
+			nextBroadcast = now + interval * 1000LL;
+			resend = replay ? now + interval * 500LL : 0;
+		}
+		else if (resend && now >= resend) {
+			sendto(sock, (const char*)packet, (int)length, 0, (struct sockaddr*)&target, sizeof(target));
+			printf("Sent the last broadcast again.\n");
+			fflush(stdout);
+			resend = 0;
+		}
+
+		// Answer requests until the next packet is due
+		int64_t wake = (resend && resend < nextBroadcast) ? resend : nextBroadcast;
+		int64_t wait = wake - GetNowMs();
+		if (wait < 0) wait = 0;
+
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(sock, &readable);
+		struct timeval timeout;
+		timeout.tv_sec = (long)(wait / 1000);
+		timeout.tv_usec = (long)(wait % 1000) * 1000;
+		if (select((int)sock + 1, &readable, NULL, NULL, &timeout) <= 0) {
+			continue;
+		}
+
+		uint8_t request[48 + 4 + SHA256_DIGEST_SIZE];
+		struct sockaddr_in from;
+		socklen_t fromSize = sizeof(from);
+		int received = (int)recvfrom(sock, (char*)request, sizeof(request), 0, (struct sockaddr*)&from, &fromSize);
+		int64_t arrival = GetNowMs();
+		if (received < 48 || (request[0] & 0x07) != 3) {
+			continue; // Only client requests get an answer
+		}
+
+		uint8_t reply[48 + 4 + SHA256_DIGEST_SIZE];
+		WriteHeader(reply, 4, arrival);
+		memcpy(reply + 24, request + 40, 8); // Originate is the client's transmit time, which it checks
+		WriteTimestamp(reply + 32, arrival);
+		WriteTimestamp(reply + 40, GetNowMs());
+		size_t replyLength = authenticate ? AppendMac(&key, reply, 48) : 48;
+		sendto(sock, (const char*)reply, (int)replyLength, 0, (struct sockaddr*)&from, fromSize);
+
+		printf("Answered a request from %s:%u.\n", inet_ntoa(from.sin_addr), ntohs(from.sin_port));
+		fflush(stdout);
+	}
+}
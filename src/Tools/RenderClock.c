@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+// Draws the clock into frames for a video pipeline without Windows, the same as 'XPClock.exe --render' (see HeadlessClock.h). Glyphs come from the built-in stroke font.
+//   cl /I..\Clock RenderClock.c ..\Clock\HeadlessClock.c ..\Clock\FrameQueue.c ..\Clock\DisplayModel.c ..\Clock\Framebuffer.c ..\Clock\Gradient.c ..\Clock\GlyphAtlas.c ..\Clock\SdfAtlas.c ..\Clock\StrokeFont.c ..\Clock\SegmentDisplay.c ..\Clock\TilePool.c
+//   cc -O2 -pthread -I../Clock RenderClock.c ../Clock/HeadlessClock.c ../Clock/FrameQueue.c ../Clock/DisplayModel.c ../Clock/Framebuffer.c ../Clock/Gradient.c ../Clock/GlyphAtlas.c ../Clock/SdfAtlas.c ../Clock/StrokeFont.c ../Clock/SegmentDisplay.c ../Clock/TilePool.c -lm -o renderclock
+// Usage: renderclock [-s WIDTHxHEIGHT] [-r FPS] [-n FRAMES] [-l] [-t "YYYY-MM-DD HH:MM:SS"] [-f FORMAT] [-y seven|matrix] [-c COLORFILE] [-g 0|1] [-a DEGREES] [-h DEGREES] [-d] [-j THREADS] [-b FRAMES] [-o -|out.bgra|frame%05d.png]
+// -s and -r set the size and frame rate, 1920x1080 at 30 by default. -n stops after that many frames, otherwise it runs until the output is closed.
+// -l draws each frame at its time instead of as fast as the output takes them, for encoders that take a live feed. -t starts at a local time instead of now.
+// -f is the clock's DisplayFormat value: 0 and 1 are 24-hour time with and without the date, 2 and 3 the same in 12-hour time. -y draws the digits as segments.
+// -c reads the colors from a clock.col file. -g 0 fills the background with its first color, -g 1 (the default) draws the gradient, turned by -a, drifting by -h degrees
+// a minute and dithered with -d. -b sets how many frames can wait for the output.
+// Frames go to stdout as raw BGRA unless -o names a file, or a PNG sequence such as frame%05d.png. For example:
+//   renderclock -s 1280x720 -r 25 -l | ffmpeg -f rawvideo -pixel_format bgra -video_size 1280x720 -framerate 25 -i - overlay.mp4
+
+#include "HeadlessClock.h"
+#include "StrokeFont.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char** argv) {
+	HeadlessOptions options;
+	InitHeadlessOptions(&options);
+
+	for (int i = 1; i < argc; ) {
+		int option = i;
+		int result = ParseHeadlessOption(&options, argc, argv, &i);
+		if (result <= 0) {
+			if (result < 0) fprintf(stderr, "Bad value for %s\n", argv[option]);
+			fprintf(stderr, "Usage: %s %s\n", argv[0], HEADLESS_OPTIONS_USAGE);
+			return 2;
+		}
+	}
+
+#ifdef SIGPIPE
+	signal(SIGPIPE, SIG_IGN); // An encoder closing the pipe ends the run with a failed write instead of killing it
+#endif
+
+	// The distance field is built once at the reference size and scaled to whatever fits the frame
+	StrokeFont font;
+	GlyphBackend backend;
+	SdfAtlas sdf = { 0 };
+	InitStrokeFont(&font, SDF_REFERENCE_HEIGHT, 0.8f);
+	GetStrokeFontBackend(&font, &backend);
+	if (!BuildSdfAtlas(&sdf, &backend, GLYPH_ATLAS_CHARSET)) {
+		fprintf(stderr, "Failed to build the distance field atlas\n");
+		return 1;
+	}
+
+	FrameQueueStats stats;
+	int result = RunHeadlessClock(&options, &sdf, &stats);
+	if (result) {
+		fprintf(stderr, "%ld frames of %dx%d written: %ld drawn, %ld repeated, the writer held drawing up %ld times\n",
+			stats.written, options.width, options.height, stats.drawn, stats.repeated, stats.stalls);
+	}
+	FreeSdfAtlas(&sdf);
+	return result ? 0 : 1;
+}
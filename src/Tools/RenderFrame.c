@@ -0,0 +1,644 @@
+/*
+ * Copyright (C) 2025 Jamie Howell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Draws a clock frame with the same framebuffer and glyph atlas code the clock uses, without Windows, and saves it as PNG or PPM.
+// Used for golden images and for profiling the draw path on machines without GDI. Glyphs come from the built-in stroke font.
+//   cl /I..\Clock RenderFrame.c ..\Clock\Framebuffer.c ..\Clock\GlyphAtlas.c ..\Clock\StrokeFont.c ..\Clock\TilePool.c ..\Clock\Gradient.c ..\Clock\SdfAtlas.c ..\Clock\TextEffects.c ..\Clock\SegmentDisplay.c ..\Clock\AnalogFace.c ..\Clock\DigitTransition.c ..\Clock\DpiScale.c
+//   cc -O2 -pthread -I../Clock RenderFrame.c ../Clock/Framebuffer.c ../Clock/GlyphAtlas.c ../Clock/StrokeFont.c ../Clock/TilePool.c ../Clock/Gradient.c ../Clock/SdfAtlas.c ../Clock/TextEffects.c ../Clock/SegmentDisplay.c ../Clock/AnalogFace.c ../Clock/DigitTransition.c ../Clock/DpiScale.c -lm -o renderframe
+// Usage: renderframe [-s WIDTHxHEIGHT] [-t TEXT] [-a DEGREES] [-h DEGREES] [-d] [-z SIZE] [-o WIDTH] [-g RADIUS] [-e SHADOW,OUTLINE,GLOW] [-b RADIUS] [-y seven|matrix] [-c HH:MM:SS.mmm] [-f flap|slide,FRACTION,PREVIOUS] [-p DPI,...] [-k scalar|sse2|avx2] [-j THREADS] [-n FRAMES] out.png|out.ppm
+// -a turns the gradient, -h shifts its hue and -d dithers it.
+// -z draws the text from the signed distance field atlas with a line height of SIZE pixels, with an optional outline (-o) and glow (-g).
+// -e adds the clock's blurred text effects, with the sizes of the shadow, outline and glow in pixels (0 for off). They're built once, like in the clock.
+// -y draws the digits as seven-segment or dot-matrix shapes instead of glyphs, -z SIZE tall or as large as fits.
+// -c draws the analog face instead of the text, with its hands at the given time. With -n the hands are also timed on their own with every kernel set, sweeping one step per frame as at 60 frames per second.
+// -f draws the text partway through the digit animation from PREVIOUS, FRACTION of the way (0 to 1). With -n the animation's frames are also timed, redrawing only the changed cells.
+// -p draws the frame at a monitor's scale: the default size and the font grow with the DPI, as in the clock. With more than one DPI, the scales are switched between
+// in that order, the way the clock is when it's dragged between monitors, and each switch is timed. The frame is drawn at the last one.
+// -b times blurring a mask the size of the frame with the given radius and every kernel set, the way the effects are built.
+// The frame is drawn in tiles by the same thread pool the clock uses, with -j threads (default: one per processor).
+// With -n the frame is drawn that many times with 1, 2, 4, ... up to -j threads, and the average time for each is printed. The image is still written at the end.
+
+#include "Framebuffer.h"
+#include "GlyphAtlas.h"
+#include "StrokeFont.h"
+#include "TilePool.h"
+#include "Gradient.h"
+#include "SdfAtlas.h"
+#include "TextEffects.h"
+#include "SegmentDisplay.h"
+#include "AnalogFace.h"
+#include "DigitTransition.h"
+#include "DpiScale.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct __Frame {
+	Framebuffer* fb;
+	const GlyphAtlas* atlas;
+	const GradientLUT* gradient;
+	const SdfAtlas* sdf; // NULL to draw from the coverage atlas
+	const SegmentDisplay* segments; // Takes precedence over both atlases when set
+	const AnalogFace* face; // Drawn instead of the text when set
+	int faceX;
+	int faceY;
+	int handSteps[ANALOG_HAND_COUNT];
+	const DigitTransitions* transitions; // Characters being animated, drawn instead of the text under them
+	const TextEffects* effects;
+	TextEffectStyle effectStyle;
+	int coverageX; // Where the text's coverage, and so its effects, start
+	int coverageY;
+	SdfStyle style;
+	const wchar_t* text;
+	int length;
+	int x;
+	int y;
+	float sdfX;
+	float sdfY;
+} Frame;
+
+// Draws a run of the frame's text with whichever renderer it uses. 'offset' is the index of the run's first character, or -1 to draw the run at 0, 0.
+static void DrawFrameRun(const Frame* frame, Framebuffer* fb, const wchar_t* text, int length, int offset, const FramebufferRect* clip) {
+	int x = offset >= 0 ? frame->x : 0, y = offset >= 0 ? frame->y : 0;
+	if (frame->segments) {
+		if (offset > 0) x += MeasureSegmentText(frame->segments, frame->text, offset);
+		DrawSegmentText(frame->segments, fb, text, length, x, y, FRAMEBUFFER_RGB(255, 255, 255), 1, clip);
+	}
+	else if (frame->sdf) {
+		float left = offset >= 0 ? frame->sdfX + (offset > 0 ? MeasureSdfRun(frame->sdf, frame->text, offset, frame->style.size) : 0.0f) : 0.0f;
+		DrawSdfRun(frame->sdf, fb, text, length, left, offset >= 0 ? frame->sdfY : 0.0f, &frame->style, clip);
+	}
+	else {
+		if (offset > 0) x += MeasureGlyphRun(frame->atlas, frame->text, offset);
+		DrawGlyphRun(frame->atlas, fb, text, length, x, y, FRAMEBUFFER_RGB(255, 255, 255), clip);
+	}
+}
+
+// Width of the first n characters of the frame's text, rounded up to whole pixels
+static int MeasureFrameText(const Frame* frame, int length) {
+	if (frame->segments) return MeasureSegmentText(frame->segments, frame->text, length);
+	if (frame->sdf) return (int)(MeasureSdfRun(frame->sdf, frame->text, length, frame->style.size) + 0.999f);
+	return MeasureGlyphRun(frame->atlas, frame->text, length);
+}
+
+// Coverage proc for the digit animations. The context is the frame
+static void DrawFrameCell(wchar_t ch, uint8_t* mask, int width, int height, void* context) {
+	Framebuffer scratch;
+	if (!InitFramebuffer(&scratch, width, height)) return;
+
+	DrawFrameRun((const Frame*)context, &scratch, &ch, 1, -1, NULL);
+	for (size_t i = 0; i < (size_t)width * height; i++) {
+		mask[i] = (uint8_t)(scratch.pixels[i] >> 8);
+	}
+	FreeFramebuffer(&scratch);
+}
+
+// Same as the clock's default look: red to black gradient with white text in the middle
+static void DrawFrameTile(const FramebufferRect* tile, void* context) {
+	Frame* frame = (Frame*)context;
+	DrawGradient(frame->gradient, frame->fb, tile);
+	if (frame->face) {
+		DrawAnalogDial(frame->face, frame->fb, frame->faceX, frame->faceY, FRAMEBUFFER_RGB(255, 255, 255), tile);
+		DrawAnalogHands(frame->face, frame->fb, frame->faceX, frame->faceY, frame->handSteps, FRAMEBUFFER_RGB(255, 255, 255), FRAMEBUFFER_RGB(230, 40, 40), tile);
+		return;
+	}
+
+	DrawTextEffects(frame->effects, frame->fb, frame->coverageX, frame->coverageY, &frame->effectStyle, tile);
+
+	// Same as the clock: the text is drawn in the runs between the characters being animated
+	int first = 0;
+	for (int i = 0; i <= frame->length; i++) {
+		if (i == frame->length || IsDigitAnimating(frame->transitions, i)) {
+			if (i > first) {
+				DrawFrameRun(frame, frame->fb, frame->text + first, i - first, first, tile);
+			}
+			first = i + 1;
+		}
+	}
+	DrawDigitTransitions(frame->transitions, frame->fb, frame->x, frame->y, FRAMEBUFFER_RGB(255, 255, 255), tile);
+}
+
+// Draws the text white on black into a scratch framebuffer and keeps one channel as its coverage, which is what the effects are built from
+static uint8_t* RenderTextCoverage(Frame* frame, int width, int height) {
+	Framebuffer scratch;
+	if (!InitFramebuffer(&scratch, width, height)) return NULL;
+
+	uint8_t* coverage = (uint8_t*)malloc((size_t)width * height);
+	if (coverage) {
+		Frame local = *frame;
+		local.fb = &scratch;
+		local.x -= frame->coverageX;
+		local.y -= frame->coverageY;
+		local.sdfX -= frame->coverageX;
+		local.sdfY -= frame->coverageY;
+		if (local.segments) {
+			DrawSegmentText(local.segments, &scratch, local.text, local.length, local.x, local.y, FRAMEBUFFER_RGB(255, 255, 255), 0, NULL);
+		}
+		else if (local.sdf) {
+			DrawSdfRun(local.sdf, &scratch, local.text, local.length, local.sdfX, local.sdfY, &local.style, NULL);
+		}
+		else {
+			DrawGlyphRun(local.atlas, &scratch, local.text, local.length, local.x, local.y, FRAMEBUFFER_RGB(255, 255, 255), NULL);
+		}
+
+		for (size_t i = 0; i < (size_t)width * height; i++) {
+			coverage[i] = (uint8_t)(scratch.pixels[i] >> 8);
+		}
+	}
+
+	FreeFramebuffer(&scratch);
+	return coverage;
+}
+
+// Blurs a copy of the frame's green channel with each kernel set and prints the average time per blur
+static void TimeBlur(const Framebuffer* fb, int radius, int repeats) {
+	size_t size = (size_t)fb->width * fb->height;
+	uint8_t* source = (uint8_t*)malloc(size);
+	uint8_t* mask = (uint8_t*)malloc(size);
+	if (!source || !mask) {
+		fprintf(stderr, "Out of memory for the blur benchmark\n");
+		free(source);
+		free(mask);
+		return;
+	}
+
+	for (size_t i = 0; i < size; i++) {
+		source[i] = (uint8_t)(fb->pixels[i] >> 8);
+	}
+
+	int kernels = FramebufferGetKernels();
+	for (int set = FRAMEBUFFER_KERNELS_SCALAR; set <= kernels; set++) {
+		FramebufferSetKernels(set);
+		struct timespec start, end;
+		double total = 0.0;
+		for (int i = 0; i < repeats; i++) {
+			memcpy(mask, source, size);
+			timespec_get(&start, TIME_UTC);
+			FramebufferBlurMask(mask, fb->width, fb->height, fb->width, radius, TEXT_EFFECT_PASSES);
+			timespec_get(&end, TIME_UTC);
+			total += (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0;
+		}
+		fprintf(stderr, "%s: %d blurs of %dx%d, radius %d, %d passes, %.3f ms per blur\n", FramebufferKernelName(set), repeats, fb->width, fb->height, radius, TEXT_EFFECT_PASSES, total / repeats);
+	}
+	FramebufferSetKernels(kernels);
+
+	free(source);
+	free(mask);
+}
+
+// Draws the hands over and over with each kernel set, the second hand moving one step each time, and prints the average time per frame.
+// Like the clock, each frame only copies back and redraws the boxes the hands cover, not the whole face.
+static void TimeHands(Frame* frame, const Framebuffer* background, int repeats) {
+	int kernels = FramebufferGetKernels();
+	for (int set = FRAMEBUFFER_KERNELS_SCALAR; set <= kernels; set++) {
+		FramebufferSetKernels(set);
+		int steps[ANALOG_HAND_COUNT];
+		memcpy(steps, frame->handSteps, sizeof(steps));
+		struct timespec start, end;
+		timespec_get(&start, TIME_UTC);
+		for (int i = 0; i < repeats; i++) {
+			for (int hand = 0; hand < ANALOG_HAND_COUNT; hand++) {
+				FramebufferRect bounds;
+				GetAnalogHandBounds(frame->face, frame->faceX, frame->faceY, hand, steps[hand], &bounds);
+				FramebufferCopy(frame->fb, background, &bounds);
+			}
+			steps[ANALOG_HAND_SECOND] = (steps[ANALOG_HAND_SECOND] + 1) % ANALOG_ANGLE_STEPS;
+			DrawAnalogHands(frame->face, frame->fb, frame->faceX, frame->faceY, steps, FRAMEBUFFER_RGB(255, 255, 255), FRAMEBUFFER_RGB(230, 40, 40), NULL);
+		}
+		timespec_get(&end, TIME_UTC);
+		double total = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0;
+		fprintf(stderr, "%s: %d frames of hands on a %d pixel face, %.3f ms per frame\n", FramebufferKernelName(set), repeats, frame->face->size, total / repeats);
+	}
+	FramebufferSetKernels(kernels);
+}
+
+// Plays the whole digit animation over and over, each frame redrawing only the changed cells, and prints the average time per frame.
+static void TimeTransitions(Frame* frame, DigitTransitions* transitions, const wchar_t* previous, int repeats) {
+	int frames = 0;
+	struct timespec start, end;
+	timespec_get(&start, TIME_UTC);
+	for (int i = 0; i < repeats; i++) {
+		for (int index = 0; index < frame->length; index++) {
+			if (previous[index] != frame->text[index]) {
+				int left = MeasureFrameText(frame, index);
+				StartDigitTransition(transitions, index, previous[index], frame->text[index], left, MeasureFrameText(frame, index + 1) - left, frame->segments ? frame->segments->height : frame->sdf ? (int)(frame->style.size + 1.0f) : frame->atlas->lineHeight, 0.0, DrawFrameCell, frame);
+			}
+		}
+
+		for (int step = 0; step < DIGIT_TRANSITION_FRAMES; step++) {
+			FramebufferRect cells[DIGIT_TRANSITION_MAX_CELLS];
+			int count = UpdateDigitTransitions(transitions, (step + 0.5) * DIGIT_TRANSITION_SECONDS / DIGIT_TRANSITION_FRAMES, cells, DIGIT_TRANSITION_MAX_CELLS);
+			for (int cell = 0; cell < count; cell++) {
+				FramebufferRect rect = { frame->x + cells[cell].left, frame->y + cells[cell].top, frame->x + cells[cell].right, frame->y + cells[cell].bottom };
+				DrawFrameTile(&rect, frame);
+			}
+			frames++;
+		}
+	}
+	timespec_get(&end, TIME_UTC);
+	double total = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0;
+	fprintf(stderr, "%d animation frames, %.3f ms per frame. %ld sequences built, %ld reused\n", frames, total / frames, transitions->built, transitions->reused);
+}
+
+// What's built for each scale, kept in the same cache the clock uses for each monitor
+typedef struct __FrameScale {
+	int dpi;
+	GlyphAtlas atlas; // The clock's font is 48 pixels tall at 96 DPI
+} FrameScale;
+
+static void* BuildFrameScale(int dpi, void* context) {
+	(void)context;
+	FrameScale* scale = (FrameScale*)calloc(1, sizeof(FrameScale));
+	if (!scale) return NULL;
+
+	StrokeFont font;
+	GlyphBackend backend;
+	InitStrokeFont(&font, ScaleForDpi(48, dpi), 0.8f);
+	GetStrokeFontBackend(&font, &backend);
+	if (!BuildGlyphAtlas(&scale->atlas, &backend, GLYPH_ATLAS_CHARSET)) {
+		free(scale);
+		return NULL;
+	}
+	scale->dpi = dpi;
+	return scale;
+}
+
+static void FreeFrameScale(void* scale, void* context) {
+	(void)context;
+	FreeGlyphAtlas(&((FrameScale*)scale)->atlas);
+	free(scale);
+}
+
+// Draws the frame with the clock's tile size
+static void DrawFrame(TilePool* pool, Frame* frame) {
+	FramebufferRect all = { 0, 0, frame->fb->width, frame->fb->height };
+	RunTiles(pool, &all, 256, 64, DrawFrameTile, frame);
+}
+
+// Draws the frame over and over and returns the average milliseconds per frame. Uses wall time, since CPU time would count every thread.
+static double TimeFrames(TilePool* pool, Frame* frame, int frames) {
+	struct timespec start, end;
+	timespec_get(&start, TIME_UTC);
+	for (int i = 0; i < frames; i++) {
+		DrawFrame(pool, frame);
+	}
+	timespec_get(&end, TIME_UTC);
+	return ((end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0) / frames;
+}
+
+int main(int argc, char** argv) {
+	int width = 800, height = 600, frames = 0, threads = 0, kernels = FRAMEBUFFER_KERNELS_AVX2;
+	wchar_t text[64] = L"12:34:56 PM";
+	Gradient gradient;
+	InitGradient(&gradient, FRAMEBUFFER_RGB(255, 0, 0), FRAMEBUFFER_RGB(0, 0, 0));
+	const char* path = NULL;
+	int blurRadius = 0, segmentStyle = SEGMENT_STYLE_NONE;
+	double faceTime = -1.0;
+	int transitionStyle = DIGIT_TRANSITION_NONE;
+	float transitionFraction = 0.0f;
+	wchar_t previous[64] = L"";
+	int dpis[16] = { DPI_DEFAULT }, dpiCount = 1, sized = 0;
+	TextEffectStyle effectStyle = { 0, 0, 0, FRAMEBUFFER_RGB(0, 0, 0), 0, FRAMEBUFFER_RGB(0, 0, 0), 0, FRAMEBUFFER_RGB(255, 255, 160) };
+	SdfStyle style = { 0.0f, FRAMEBUFFER_RGB(255, 255, 255), 0.0f, FRAMEBUFFER_RGB(0, 0, 0), 0.0f, FRAMEBUFFER_RGB(255, 255, 160) };
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+				fprintf(stderr, "Bad size '%s'\n", argv[i]);
+				return 2;
+			}
+			sized = 1;
+		}
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			mbstowcs(text, argv[++i], 63);
+			text[63] = L'\0';
+		}
+		else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+			gradient.angle = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) {
+			gradient.hueShift = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-d") == 0) {
+			gradient.dither = 1;
+		}
+		else if (strcmp(argv[i], "-z") == 0 && i + 1 < argc) {
+			style.size = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			style.outlineWidth = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+			style.glowRadius = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%d,%d,%d", &effectStyle.shadowRadius, &effectStyle.outlineWidth, &effectStyle.glowRadius) != 3) {
+				fprintf(stderr, "Bad effects '%s'\n", argv[i]);
+				return 2;
+			}
+			effectStyle.shadowOffsetX = effectStyle.shadowRadius / 2;
+			effectStyle.shadowOffsetY = effectStyle.shadowRadius / 2;
+		}
+		else if (strcmp(argv[i], "-y") == 0 && i + 1 < argc) {
+			i++;
+			segmentStyle = strcmp(argv[i], "matrix") == 0 ? SEGMENT_STYLE_MATRIX : SEGMENT_STYLE_SEVEN;
+		}
+		else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+			int hours, minutes;
+			double seconds;
+			if (sscanf(argv[++i], "%d:%d:%lf", &hours, &minutes, &seconds) != 3) {
+				fprintf(stderr, "Bad time '%s'\n", argv[i]);
+				return 2;
+			}
+			faceTime = hours * 3600.0 + minutes * 60.0 + seconds;
+		}
+		else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			char name[16], previousText[64];
+			if (sscanf(argv[++i], "%15[a-z],%f,%63[^\n]", name, &transitionFraction, previousText) != 3) {
+				fprintf(stderr, "Bad animation '%s'\n", argv[i]);
+				return 2;
+			}
+			transitionStyle = strcmp(name, "slide") == 0 ? DIGIT_TRANSITION_SLIDE : DIGIT_TRANSITION_FLAP;
+			mbstowcs(previous, previousText, 63);
+			previous[63] = L'\0';
+		}
+		else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			dpiCount = 0;
+			for (char* next = argv[++i]; *next && dpiCount < 16; ) {
+				dpis[dpiCount] = (int)strtol(next, &next, 10);
+				if (dpis[dpiCount++] <= 0 || (*next && *next++ != ',')) {
+					fprintf(stderr, "Bad DPI list '%s'\n", argv[i]);
+					return 2;
+				}
+			}
+		}
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			blurRadius = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+			i++;
+			kernels = strcmp(argv[i], "scalar") == 0 ? FRAMEBUFFER_KERNELS_SCALAR : strcmp(argv[i], "sse2") == 0 ? FRAMEBUFFER_KERNELS_SSE2 : FRAMEBUFFER_KERNELS_AVX2;
+		}
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			frames = atoi(argv[++i]);
+		}
+		else {
+			path = argv[i];
+		}
+	}
+
+	if (!path) {
+		fprintf(stderr, "Usage: %s [-s WIDTHxHEIGHT] [-t TEXT] [-a DEGREES] [-h DEGREES] [-d] [-z SIZE] [-o WIDTH] [-g RADIUS] [-e SHADOW,OUTLINE,GLOW] [-b RADIUS] [-y seven|matrix] [-c HH:MM:SS.mmm] [-f flap|slide,FRACTION,PREVIOUS] [-p DPI,...] [-k scalar|sse2|avx2] [-j THREADS] [-n FRAMES] out.png|out.ppm\n", argv[0]);
+		return 2;
+	}
+
+	kernels = FramebufferSetKernels(kernels);
+
+	// Each scale's atlas is built the first time it's switched to and picked up again after that
+	DpiScaleCache scales;
+	InitDpiScaleCache(&scales, BuildFrameScale, FreeFrameScale, NULL);
+	FrameScale* scale = NULL;
+	for (int i = 0; i < dpiCount; i++) {
+		struct timespec start, end;
+		long built = scales.built;
+		timespec_get(&start, TIME_UTC);
+		scale = (FrameScale*)GetDpiScaleResources(&scales, dpis[i]);
+		timespec_get(&end, TIME_UTC);
+		if (!scale) {
+			fprintf(stderr, "Failed to build the glyph atlas\n");
+			return 1;
+		}
+		if (dpiCount > 1) {
+			fprintf(stderr, "%d DPI (%d%%): %s in %.3f ms\n", scale->dpi, ScaleForDpi(100, scale->dpi), scales.built > built ? "built" : "reused",
+				(end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0);
+		}
+	}
+	if (dpiCount > 1) {
+		fprintf(stderr, "%ld scales built, %ld reused, %ld evicted\n", scales.built, scales.reused, scales.evicted);
+	}
+	const GlyphAtlas* atlas = &scale->atlas;
+	if (!sized) {
+		width = ScaleForDpi(width, scale->dpi);
+		height = ScaleForDpi(height, scale->dpi);
+	}
+
+	// The distance field is built once at the reference size and scaled to whatever -z asks for
+	StrokeFont sdfFont;
+	GlyphBackend sdfBackend;
+	SdfAtlas sdf = { 0 };
+	if ((style.size > 0.0f && segmentStyle == SEGMENT_STYLE_NONE) || faceTime >= 0.0) {
+		InitStrokeFont(&sdfFont, SDF_REFERENCE_HEIGHT, 0.8f);
+		GetStrokeFontBackend(&sdfFont, &sdfBackend);
+		if (!BuildSdfAtlas(&sdf, &sdfBackend, GLYPH_ATLAS_CHARSET)) {
+			fprintf(stderr, "Failed to build the distance field atlas\n");
+			return 1;
+		}
+	}
+
+	Framebuffer fb;
+	if (!InitFramebuffer(&fb, width, height)) {
+		fprintf(stderr, "Out of memory for a %dx%d framebuffer\n", width, height);
+		return 1;
+	}
+
+	GradientLUT lut = { 0 };
+	if (!UpdateGradientLUT(&lut, &gradient, width, height)) {
+		fprintf(stderr, "Out of memory for the gradient\n");
+		return 1;
+	}
+
+	Frame frame;
+	frame.fb = &fb;
+	frame.atlas = atlas;
+	frame.gradient = &lut;
+	frame.text = text;
+	frame.length = (int)wcslen(text);
+	frame.x = (width - MeasureGlyphRun(atlas, text, frame.length)) / 2;
+	frame.y = (height - atlas->lineHeight) / 2;
+	frame.sdf = style.size > 0.0f && segmentStyle == SEGMENT_STYLE_NONE ? &sdf : NULL;
+	frame.style = style;
+	frame.sdfX = (width - MeasureSdfRun(&sdf, text, frame.length, style.size)) / 2.0f;
+	frame.sdfY = (height - style.size) / 2.0f;
+	if (frame.sdf) {
+		// Whole pixels, as the clock lays it out, so the animated cells line up with the text around them
+		frame.sdfX = floorf(frame.sdfX);
+		frame.sdfY = floorf(frame.sdfY);
+		frame.x = (int)frame.sdfX;
+		frame.y = (int)frame.sdfY;
+	}
+
+	// The segments are laid out once for their size, the same as the clock does on a resize
+	SegmentDisplay segments = { 0 };
+	frame.segments = NULL;
+	if (segmentStyle != SEGMENT_STYLE_NONE) {
+		const wchar_t* samples[1] = { text };
+		int segmentHeight = style.size > 0.0f ? (int)style.size : FitSegmentHeight(segmentStyle, samples, 1, width * 9 / 10, height * 9 / 10);
+		if (!SegmentDisplayCovers(text) || !InitSegmentDisplay(&segments, segmentStyle, segmentHeight)) {
+			fprintf(stderr, "Can't show '%ls' with segments\n", text);
+			return 1;
+		}
+		frame.segments = &segments;
+		frame.x = (width - MeasureSegmentText(&segments, text, frame.length)) / 2;
+		frame.y = (height - segments.height) / 2;
+	}
+
+	// The changed characters are animated from the previous text, and the animation moved on to the requested point
+	DigitTransitions transitions;
+	InitDigitTransitions(&transitions, transitionStyle);
+	frame.transitions = &transitions;
+	if (transitionStyle != DIGIT_TRANSITION_NONE && wcslen(previous) == (size_t)frame.length) {
+		int textHeight = frame.segments ? frame.segments->height : frame.sdf ? (int)(style.size + 1.0f) : atlas->lineHeight;
+		for (int i = 0; i < frame.length; i++) {
+			if (previous[i] != text[i]) {
+				int left = MeasureFrameText(&frame, i);
+				StartDigitTransition(&transitions, i, previous[i], text[i], left, MeasureFrameText(&frame, i + 1) - left, textHeight, 0.0, DrawFrameCell, &frame);
+			}
+		}
+		FramebufferRect cells[DIGIT_TRANSITION_MAX_CELLS];
+		UpdateDigitTransitions(&transitions, transitionFraction * DIGIT_TRANSITION_SECONDS, cells, DIGIT_TRANSITION_MAX_CELLS);
+	}
+
+	// The face is as large as fits, with its dial drawn once and the numerals taken from the distance field
+	AnalogFace face = { 0 };
+	frame.face = NULL;
+	if (faceTime >= 0.0) {
+		if (!InitAnalogFace(&face, (width < height ? width : height) * 9 / 10, &sdf)) {
+			fprintf(stderr, "Out of memory for the analog face\n");
+			return 1;
+		}
+		frame.face = &face;
+		frame.faceX = (width - face.size) / 2;
+		frame.faceY = (height - face.size) / 2;
+		GetAnalogHandSteps(faceTime, frame.handSteps);
+	}
+
+	// The effects are built from the text's coverage once, over the text's box with room for glyphs that draw past their advance
+	TextEffects effects = { 0 };
+	int textWidth = frame.segments ? MeasureSegmentText(&segments, text, frame.length) : frame.sdf ? (int)(MeasureSdfRun(&sdf, text, frame.length, style.size) + 1.0f) : MeasureGlyphRun(atlas, text, frame.length);
+	int textHeight = frame.segments ? segments.height : frame.sdf ? (int)(style.size + 1.0f) : atlas->lineHeight;
+	int overhang = textHeight / 8;
+	frame.coverageX = (frame.sdf ? (int)frame.sdfX : frame.x) - overhang;
+	frame.coverageY = frame.sdf ? (int)frame.sdfY : frame.y;
+	frame.effects = &effects;
+	frame.effectStyle = effectStyle;
+	if (HasTextEffects(&effectStyle)) {
+		uint8_t* coverage = RenderTextCoverage(&frame, textWidth + overhang * 2, textHeight + 1);
+		if (!coverage || !BuildTextEffects(&effects, coverage, textWidth + overhang * 2, textWidth + overhang * 2, textHeight + 1, &effectStyle)) {
+			fprintf(stderr, "Out of memory for the text effects\n");
+			return 1;
+		}
+		free(coverage);
+	}
+
+	if (threads <= 0) threads = GetProcessorCount();
+
+	if (frames > 0) {
+		double single = 0.0;
+		for (int count = 1; ; count = count * 2 < threads ? count * 2 : threads) {
+			TilePool* pool = CreateTilePool(count);
+			if (!pool) {
+				fprintf(stderr, "Failed to start %d threads\n", count);
+				return 1;
+			}
+
+			DrawFrame(pool, &frame); // Warm up the threads and the caches
+			double ms = TimeFrames(pool, &frame, frames);
+			if (count == 1) single = ms;
+
+			TilePoolStats stats;
+			GetTilePoolStats(pool, &stats);
+			fprintf(stderr, "%s, %2d threads: %d frames of %dx%d, %.3f ms per frame, %.2fx, %ld steals\n",
+				FramebufferKernelName(kernels), GetTilePoolThreads(pool), frames, width, height, ms, single / ms, stats.steals);
+			DestroyTilePool(pool);
+
+			if (count == threads) break;
+		}
+	}
+	else {
+		TilePool* pool = CreateTilePool(threads);
+		if (!pool) {
+			fprintf(stderr, "Failed to start %d threads\n", threads);
+			return 1;
+		}
+		DrawFrame(pool, &frame);
+		DestroyTilePool(pool);
+	}
+
+	if (frame.face && frames > 0) {
+		// The hands are drawn over a copy of the background and dial, like the clock's cached background, so the saved frame isn't touched
+		Framebuffer background, work;
+		if (!InitFramebuffer(&background, width, height) || !InitFramebuffer(&work, width, height)) {
+			fprintf(stderr, "Out of memory for the hand benchmark\n");
+			return 1;
+		}
+		DrawGradient(&lut, &background, NULL);
+		DrawAnalogDial(&face, &background, frame.faceX, frame.faceY, FRAMEBUFFER_RGB(255, 255, 255), NULL);
+		FramebufferCopy(&work, &background, NULL);
+
+		Frame hands = frame;
+		hands.fb = &work;
+		TimeHands(&hands, &background, frames);
+		FreeFramebuffer(&background);
+		FreeFramebuffer(&work);
+	}
+
+	if (transitions.cellCount > 0 && frames > 0) {
+		// Played on a copy of the frame, so the saved image still shows the requested point of the animation
+		Framebuffer work;
+		if (!InitFramebuffer(&work, width, height)) {
+			fprintf(stderr, "Out of memory for the animation benchmark\n");
+			return 1;
+		}
+		FramebufferCopy(&work, &fb, NULL);
+
+		DigitTransitions timed;
+		InitDigitTransitions(&timed, transitionStyle);
+		Frame animated = frame;
+		animated.fb = &work;
+		animated.transitions = &timed;
+		TimeTransitions(&animated, &timed, previous, frames);
+		FreeDigitTransitions(&timed);
+		FreeFramebuffer(&work);
+	}
+
+	if (blurRadius > 0) {
+		TimeBlur(&fb, blurRadius, frames > 0 ? frames : 10);
+	}
+
+	size_t pathLength = strlen(path);
+	int written = (pathLength > 4 && strcmp(path + pathLength - 4, ".ppm") == 0) ? WriteFramebufferPPM(&fb, path) : WriteFramebufferPNG(&fb, path);
+	if (!written) {
+		fprintf(stderr, "%s: could not write\n", path);
+	}
+
+	FreeFramebuffer(&fb);
+	FreeDpiScaleCache(&scales);
+	FreeGradientLUT(&lut);
+	FreeSdfAtlas(&sdf);
+	FreeTextEffects(&effects);
+	FreeSegmentDisplay(&segments);
+	FreeAnalogFace(&face);
+	FreeDigitTransitions(&transitions);
+	return written ? 0 : 1;
+}